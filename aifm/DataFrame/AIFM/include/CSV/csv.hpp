@@ -36,6 +36,7 @@
 #include "deref_scope.hpp"
 #include "manager.hpp"
 #include "simple_time.hpp"
+#include "thread.h"
 
 #include <algorithm>
 #include <cstdio>
@@ -51,8 +52,11 @@
 #endif
 #include <cassert>
 #include <cerrno>
+#include <fcntl.h>
 #include <istream>
 #include <memory>
+#include <sys/stat.h>
+#include <unistd.h>
 
 namespace io
 {
@@ -223,6 +227,45 @@ class NonOwningStringByteSource : public ByteSourceBase
     long long remaining_byte_count;
 };
 
+// Serves the header line first and then the byte range [begin, end) of an
+// already opened file. It allows several readers to parse disjoint slices of
+// the same file while still going through the regular read_header() path.
+class FileRangeByteSource : public ByteSourceBase
+{
+   public:
+    FileRangeByteSource(int fd, const std::string& header, off_t begin, off_t end)
+        : fd(fd), header(header), header_pos(0), cur(begin), end(end)
+    {
+    }
+
+    int read(char* buffer, int size)
+    {
+        int copied = 0;
+        if (header_pos < header.size()) {
+            copied = std::min(static_cast<std::size_t>(size), header.size() - header_pos);
+            std::memcpy(buffer, header.data() + header_pos, copied);
+            header_pos += copied;
+        }
+        while (copied < size && cur < end) {
+            auto len = std::min(static_cast<off_t>(size - copied), end - cur);
+            auto ret = ::pread(fd, buffer + copied, len, cur);
+            if (ret <= 0) break;
+            copied += ret;
+            cur += ret;
+        }
+        return copied;
+    }
+
+    ~FileRangeByteSource() {}
+
+   private:
+    int fd;
+    std::string header;
+    std::size_t header_pos;
+    off_t cur;
+    off_t end;
+};
+
 #ifndef CSV_IO_NO_THREAD
 class AsynchronousReader
 {
@@ -335,19 +378,25 @@ class SynchronousReader
     char* buffer;
     int desired_byte_count;
 };
+
+#ifdef CSV_IO_NO_THREAD
+using DefaultReader = SynchronousReader;
+#else
+using DefaultReader = AsynchronousReader;
+#endif
 }  // namespace detail
 
-class LineReader
+// reader_type is detail::SynchronousReader for the readers that run on
+// uthreads, where the read-ahead std::thread of detail::AsynchronousReader
+// would block the kthread on its std::mutex.
+template <class reader_type = detail::DefaultReader>
+class BasicLineReader
 {
    private:
     static const int block_len = 1 << 20;
     std::unique_ptr<char[]>
         buffer;  // must be constructed before (and thus destructed after) the reader!
-#ifdef CSV_IO_NO_THREAD
-    detail::SynchronousReader reader;
-#else
-    detail::AsynchronousReader reader;
-#endif
+    reader_type reader;
     int data_begin;
     int data_end;
 
@@ -389,67 +438,67 @@ class LineReader
     }
 
    public:
-    LineReader()                  = delete;
-    LineReader(const LineReader&) = delete;
-    LineReader& operator=(const LineReader&) = delete;
+    BasicLineReader()                       = delete;
+    BasicLineReader(const BasicLineReader&) = delete;
+    BasicLineReader& operator=(const BasicLineReader&) = delete;
 
-    explicit LineReader(const char* file_name)
+    explicit BasicLineReader(const char* file_name)
     {
         set_file_name(file_name);
         init(open_file(file_name));
     }
 
-    explicit LineReader(const std::string& file_name)
+    explicit BasicLineReader(const std::string& file_name)
     {
         set_file_name(file_name.c_str());
         init(open_file(file_name.c_str()));
     }
 
-    LineReader(const char* file_name, std::unique_ptr<ByteSourceBase> byte_source)
+    BasicLineReader(const char* file_name, std::unique_ptr<ByteSourceBase> byte_source)
     {
         set_file_name(file_name);
         init(std::move(byte_source));
     }
 
-    LineReader(const std::string& file_name, std::unique_ptr<ByteSourceBase> byte_source)
+    BasicLineReader(const std::string& file_name, std::unique_ptr<ByteSourceBase> byte_source)
     {
         set_file_name(file_name.c_str());
         init(std::move(byte_source));
     }
 
-    LineReader(const char* file_name, const char* data_begin, const char* data_end)
+    BasicLineReader(const char* file_name, const char* data_begin, const char* data_end)
     {
         set_file_name(file_name);
         init(std::unique_ptr<ByteSourceBase>(
             new detail::NonOwningStringByteSource(data_begin, data_end - data_begin)));
     }
 
-    LineReader(const std::string& file_name, const char* data_begin, const char* data_end)
+    BasicLineReader(const std::string& file_name, const char* data_begin, const char* data_end)
     {
         set_file_name(file_name.c_str());
         init(std::unique_ptr<ByteSourceBase>(
             new detail::NonOwningStringByteSource(data_begin, data_end - data_begin)));
     }
 
-    LineReader(const char* file_name, FILE* file)
+    BasicLineReader(const char* file_name, FILE* file)
     {
         set_file_name(file_name);
         init(std::unique_ptr<ByteSourceBase>(new detail::OwningStdIOByteSourceBase(file)));
     }
 
-    LineReader(const std::string& file_name, FILE* file)
+    BasicLineReader(const std::string& file_name, FILE* file)
     {
         set_file_name(file_name.c_str());
         init(std::unique_ptr<ByteSourceBase>(new detail::OwningStdIOByteSourceBase(file)));
     }
 
-    LineReader(const char* file_name, std::istream& in)
+    BasicLineReader(const char* file_name, std::istream& in)
     {
         set_file_name(file_name);
         init(std::unique_ptr<ByteSourceBase>(new detail::NonOwningIStreamByteSource(in)));
     }
 
-    LineReader(const std::string& file_name, std::istream& in)
+    BasicLineReader(const std::string& file_name, std::istream& in)
     {
         set_file_name(file_name.c_str());
         init(std::unique_ptr<ByteSourceBase>(new detail::NonOwningIStreamByteSource(in)));
@@ -535,6 +584,8 @@ class LineReader
     }
 };
 
+using LineReader = BasicLineReader<>;
+
 ////////////////////////////////////////////////////////////////////////////
 //                                 CSV                                    //
 ////////////////////////////////////////////////////////////////////////////
@@ -1206,11 +1257,11 @@ void parse(char* col, T& x)
 
 template <unsigned column_count, class trim_policy = trim_chars<' ', '\t'>,
           class quote_policy = no_quote_escape<','>, class overflow_policy = throw_on_overflow,
-          class comment_policy = no_comment>
+          class comment_policy = no_comment, class reader_type = detail::DefaultReader>
 class CSVReader
 {
    private:
-    LineReader in;
+    BasicLineReader<reader_type> in;
 
     char* row[column_count];
     std::string column_names[column_count];
@@ -1391,6 +1442,142 @@ std::tuple<far_memory::DataFrameVector<ColTypes>...> parse_csv_to_vectors(
     return col_vecs;
 }
 
+namespace detail
+{
+// Returns the offset right after the first '\n' at or after pos.
+inline off_t next_line_offset(int fd, off_t pos, off_t file_size)
+{
+    constexpr int kScanBufSize = 4096;
+    char buf[kScanBufSize];
+    while (pos < file_size) {
+        auto ret = ::pread(fd, buf, kScanBufSize, pos);
+        if (ret <= 0) break;
+        auto* newline = static_cast<char*>(std::memchr(buf, '\n', ret));
+        if (newline) return pos + (newline - buf) + 1;
+        pos += ret;
+    }
+    return file_size;
+}
+}  // namespace detail
+
+constexpr off_t kDefaultCSVSegmentSize = 16 << 20;  // 16 MiB.
+
+// Parallel version of parse_csv_to_vectors(). The file is cut into segments
+// of about segment_size bytes at newline boundaries (so quoted fields must not
+// embed newlines), each segment is parsed by its own uthread into local column
+// buffers, and the buffers are then bulk appended into the DataFrameVectors in
+// file order. A parse error of any segment is rethrown to the caller once all
+// the parse uthreads of its round have been joined.
+template <typename... ColTypes, typename... Strs>
+std::tuple<far_memory::DataFrameVector<ColTypes>...> parallel_parse_csv_to_vectors_in_segments(
+    far_memory::FarMemManager* manager, std::string csv_file_path, off_t segment_size,
+    Strs... col_names)
+{
+    constexpr uint32_t kNumParseThreads = helpers::kNumCPUs;
+    using ColBufs                       = std::tuple<std::vector<ColTypes>...>;
+    BUG_ON(segment_size <= 0);
+
+    int fd = ::open(csv_file_path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        int x = errno;
+        error::can_not_open_file err;
+        err.set_errno(x);
+        err.set_file_name(csv_file_path.c_str());
+        throw err;
+    }
+    auto fd_guard = helpers::finally([&] { ::close(fd); });
+    struct stat file_stat;
+    BUG_ON(::fstat(fd, &file_stat) != 0);
+    off_t file_size = file_stat.st_size;
+
+    off_t header_end = detail::next_line_offset(fd, 0, file_size);
+    std::string header(header_end, '\0');
+    BUG_ON(::pread(fd, header.data(), header_end, 0) != header_end);
+
+    std::vector<std::pair<off_t, off_t>> segments;
+    for (off_t begin = header_end; begin < file_size;) {
+        auto end = detail::next_line_offset(fd, std::min(begin + segment_size, file_size) - 1,
+                                            file_size);
+        segments.emplace_back(begin, end);
+        begin = end;
+    }
+
+    auto col_vecs = std::make_tuple(manager->allocate_dataframe_vector<ColTypes>()...);
+    auto seq      = std::index_sequence_for<ColTypes...>{};
+    std::vector<ColBufs> col_bufs(kNumParseThreads);
+    std::vector<std::exception_ptr> errors(kNumParseThreads);
+    for (uint64_t round_begin = 0; round_begin < segments.size();
+         round_begin += kNumParseThreads) {
+        auto num_segments = std::min(static_cast<uint64_t>(kNumParseThreads),
+                                     segments.size() - round_begin);
+        std::vector<rt::Thread> threads;
+        for (uint32_t tid = 0; tid < num_segments; tid++) {
+            threads.emplace_back(rt::Thread([&, tid]() {
+                try {
+                    auto [begin, end] = segments[round_begin + tid];
+                    io::CSVReader<sizeof...(col_names), io::trim_chars<' '>,
+                                  io::double_quote_escape<',', '\"'>, throw_on_overflow,
+                                  no_comment, detail::SynchronousReader>
+                        in(csv_file_path,
+                           std::unique_ptr<ByteSourceBase>(
+                               new detail::FileRangeByteSource(fd, header, begin, end)));
+                    in.read_header(io::ignore_extra_column, col_names...);
+                    std::tuple<ColTypes...> col_fields;
+                    auto& bufs = col_bufs[tid];
+                    while (std::apply([&](auto&... fields) { return in.read_row(fields...); },
+                                      col_fields)) {
+                        [&]<typename T, T... ints>(std::integer_sequence<T, ints...> int_seq)
+                        {
+                            ((std::get<ints>(bufs).push_back(std::get<ints>(col_fields))),
+                             ...);
+                        }
+                        (seq);
+                    }
+                } catch (...) {
+                    errors[tid] = std::current_exception();
+                }
+            }));
+        }
+        for (auto& thread : threads) {
+            thread.Join();
+        }
+        for (uint32_t tid = 0; tid < num_segments; tid++) {
+            if (errors[tid]) {
+                std::rethrow_exception(errors[tid]);
+            }
+        }
+        for (uint32_t tid = 0; tid < num_segments; tid++) {
+            auto& bufs = col_bufs[tid];
+            [&]<typename T, T... ints>(std::integer_sequence<T, ints...> int_seq)
+            {
+                ((std::get<ints>(col_vecs).append(std::get<ints>(bufs).data(),
+                                                  std::get<ints>(bufs).size()),
+                  std::get<ints>(bufs).clear()),
+                 ...);
+            }
+            (seq);
+        }
+    }
+    std::apply([&](auto&... vecs) { (vecs.flush(), ...); }, col_vecs);
+    return col_vecs;
+}
+
+// Files that fit in a single segment are parsed serially by
+// parse_csv_to_vectors(), which saves the uthread and the staging buffers.
+template <typename... ColTypes, typename... Strs>
+std::tuple<far_memory::DataFrameVector<ColTypes>...> parallel_parse_csv_to_vectors(
+    far_memory::FarMemManager* manager, std::string csv_file_path, Strs... col_names)
+{
+    struct stat file_stat;
+    if (::stat(csv_file_path.c_str(), &file_stat) == 0 &&
+        file_stat.st_size <= kDefaultCSVSegmentSize) {
+        return parse_csv_to_vectors<ColTypes...>(manager, std::move(csv_file_path),
+                                                 col_names...);
+    }
+    return parallel_parse_csv_to_vectors_in_segments<ColTypes...>(
+        manager, std::move(csv_file_path), kDefaultCSVSegmentSize, col_names...);
+}
+
 }  // namespace io
 
 #endif
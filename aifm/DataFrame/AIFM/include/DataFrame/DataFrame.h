@@ -725,12 +725,18 @@ public:  // Data manipulation
                const char *name4, sort_spec dir4,
                const char *name5, sort_spec dir5);
 
-    // Groupby copies the DataFrame into a temp DataFrame and sorts
-    // the temp df by gb_col_name before performing groupby.
+    // Groupby performs a hash groupby on the memory server, so the DataFrame
+    // does not need to be sorted. Groups appear in the result in the order
+    // of their first occurrence.
     // if gb_col_name is DF_INDEX_COL_NAME, it groups by index.
     //
     // F:
-    //   type functor to be applied to columns to group by
+    //   type functor to be applied to columns to group by. One of GroupbySum,
+    //   GroupbyCount, GroupbyMean, GroupbyVar, GroupbyStd, GroupbyFirst,
+    //   GroupbyLast, GroupbyMax, GroupbyMin, GroupbyMedian or
+    //   GroupbyQuantile. GroupbyCount turns the data columns into unsigned
+    //   long long counts. GroupbyQuantile estimates the quantile from a
+    //   bounded-memory sketch unless its exact flag is set
     // T:
     //   type of the groupby column. In case if index, it is type of index
     // Ts:
@@ -742,8 +748,7 @@ public:  // Data manipulation
     // gb_col_name:
     //   Name of the column
     // already_sorted:
-    //   If the DataFrame is already sorted by gb_col_name, this will save the
-    //   expensive sort operation
+    //   Kept for compatibility. The hash groupby never sorts
     //
     template<typename F, typename T, typename ... Ts>
     [[nodiscard]] DataFrame
@@ -752,6 +757,39 @@ public:  // Data manipulation
             const char *gb_col_name,
             sort_state already_sorted = sort_state::not_sorted) const;
 
+    // Same as groupby() above, but groups by the combination of two columns
+    //
+    // T1:
+    //   type of the first groupby column. In case if index, it is type of
+    //   index
+    // T2:
+    //   type of the second groupby column. In case if index, it is type of
+    //   index
+    //
+    template<typename F, typename T1, typename T2, typename ... Ts>
+    [[nodiscard]] DataFrame
+    groupby2(far_memory::FarMemManager *manager,
+             F &&func,
+             const char *gb_col_name1,
+             const char *gb_col_name2) const;
+
+    // Same as groupby() above, but groups by the combination of any number
+    // of columns. Each key column refines the groups of the previous ones
+    // through the same hash groupby on the memory server.
+    //
+    // GbTs:
+    //   std::tuple of the types of the groupby columns, in the order of
+    //   gb_col_names. In case if index, it is type of index
+    // gb_col_names:
+    //   Names of the groupby columns
+    //
+    template<typename F, typename GbTs, typename ... Ts>
+    [[nodiscard]] DataFrame
+    groupby_n(far_memory::FarMemManager *manager,
+              F &&func,
+              const std::array<const char *, std::tuple_size_v<GbTs>>
+                  &gb_col_names) const;
+
     // Same as groupby() above, but executed asynchronously
     //
     template<typename F, typename T, typename ... Ts>
@@ -862,10 +900,14 @@ public:  // Data manipulation
 
     // It joins the data between self (lhs) and rhs and returns the joined data
     // in a StdDataFrame, based on specification in join_policy.
+    // The matching is a hash join offloaded to the memory server; only the
+    // matched row indices come back and the columns are materialized through
+    // copy_data_by_idx(). The joined rows are sorted by index.
     // The following conditions must be meet for this method
     // to compile and work properly:
     //   1) IndexType type must be the same between lhs and rhs.
-    //   2) Ordering (< > != ==) must be well defined for type IndexType
+    //   2) Equality (==), less than (<) and std::hash must be well defined for
+    //      type IndexType
     //   3) In both lhs and rhs, columns with the same name must have the same
     //      type
     //
@@ -882,7 +924,9 @@ public:  // Data manipulation
     //
     template<typename RHS_T, typename ... Ts>
     [[nodiscard]] StdDataFrame<IndexType>
-    join_by_index(const RHS_T &rhs, join_policy jp) const;
+    join_by_index(far_memory::FarMemManager *manager,
+                  const RHS_T &rhs,
+                  join_policy jp) const;
 
     // It joins the data between self (lhs) and rhs and returns the joined data
     // in a StdDataFrame, based on specification in join_policy.
@@ -890,10 +934,12 @@ public:  // Data manipulation
     // 0 to N. The returned DataFrame will at least have two columns names
     // lhs.INDEX and rhs.INDEX containing the lhs and rhs indices based on join
     // policy.
+    // Like join_by_index(), the matching is offloaded to the memory server,
+    // and the joined rows are sorted by the named column.
     // The following conditions must be meet for this method
     // to compile and work properly:
-    //   1) Ordering (< > != ==) must be well defined for the type of the
-    //      named column.
+    //   1) Equality (==), less than (<) and std::hash must be well defined for
+    //      the type of the named column.
     //   2) Both lhs and rhs must contain the named column
     //   3) In both lhs and rhs, columns with the same name must have the same
     //      type
@@ -915,7 +961,10 @@ public:  // Data manipulation
     //
     template<typename RHS_T, typename T, typename ... Ts>
     [[nodiscard]] StdDataFrame<unsigned int>
-    join_by_column(const RHS_T &rhs, const char *name, join_policy jp) const;
+    join_by_column(far_memory::FarMemManager *manager,
+                   const RHS_T &rhs,
+                   const char *name,
+                   join_policy jp) const;
 
     // It concatenates rhs to the end of self and returns the result as
     // another DataFrame.
@@ -2394,120 +2443,55 @@ private:  // Static helper functions
     void
     setup_view_column_(const char *name, Index2D<ITR> range);
 
-    using IndexIdxVector = std::vector<std::tuple<size_type, size_type>>;
+    using JoinIdxVector = far_memory::DataFrameVector<unsigned long long>;
+    using GroupIdxVector = far_memory::DataFrameVector<unsigned long long>;
+
     template<typename T>
-    using JoinSortingPair = std::pair<const T *, size_type>;
+    far_memory::DataFrameVector<T> &
+    groupby_key_column_(const char *name) const;
+
+    template<typename F, typename ... Ts>
+    void
+    groupby_common_(far_memory::FarMemManager *manager,
+                    const std::decay_t<F> &func,
+                    GroupIdxVector &group_ids,
+                    GroupIdxVector &first_idx,
+                    const std::vector<const char *> &gb_col_names,
+                    DataFrame &result) const;
+
+    static far_memory::JoinType
+    to_join_type_(join_policy jp);
 
     template<typename LHS_T, typename RHS_T, typename IDX_T, typename ... Ts>
     static void
-    join_helper_common_(const LHS_T &lhs,
+    join_helper_common_(far_memory::FarMemManager *manager,
+                        const LHS_T &lhs,
                         const RHS_T &rhs,
-                        const IndexIdxVector &joined_index_idx,
+                        JoinIdxVector &lhs_idx,
+                        JoinIdxVector &rhs_idx,
                         StdDataFrame<IDX_T> &result,
                         const char *skip_col_name = nullptr);
 
-    template<typename LHS_T, typename RHS_T, typename ... Ts>
-    static StdDataFrame<IndexType>
-    index_join_helper_(const LHS_T &lhs,
-                       const RHS_T &rhs,
-                       const IndexIdxVector &joined_index_idx);
-
-    template<typename LHS_T, typename RHS_T, typename T, typename ... Ts>
-    static StdDataFrame<unsigned int>
-    column_join_helper_(const LHS_T &lhs,
-                        const RHS_T &rhs,
-                        const char *col_name,
-                        const IndexIdxVector &joined_index_idx);
-
     template<typename T>
-    static IndexIdxVector
-    get_inner_index_idx_vector_(
-        const std::vector<JoinSortingPair<T>> &col_vec_lhs,
-        const std::vector<JoinSortingPair<T>> &col_vec_rhs);
-
-    template<typename LHS_T, typename RHS_T, typename ... Ts>
-    static StdDataFrame<IndexType>
-    index_inner_join_(
-        const LHS_T &lhs, const RHS_T &rhs,
-        const std::vector<JoinSortingPair<IndexType>> &col_vec_lhs,
-        const std::vector<JoinSortingPair<IndexType>> &col_vec_rhs);
-
-    template<typename LHS_T, typename RHS_T, typename T, typename ... Ts>
-    static StdDataFrame<unsigned int>
-    column_inner_join_(const LHS_T &lhs,
-                       const RHS_T &rhs,
-                       const char *col_name,
-                       const std::vector<JoinSortingPair<T>> &col_vec_lhs,
-                       const std::vector<JoinSortingPair<T>> &col_vec_rhs);
-
-    template<typename T>
-    static IndexIdxVector
-    get_left_index_idx_vector_(
-        const std::vector<JoinSortingPair<T>> &col_vec_lhs,
-        const std::vector<JoinSortingPair<T>> &col_vec_rhs);
-
-    template<typename LHS_T, typename RHS_T, typename ... Ts>
-    static StdDataFrame<IndexType>
-    index_left_join_(
-        const LHS_T &lhs, const RHS_T &rhs,
-        const std::vector<JoinSortingPair<IndexType>> &col_vec_lhs,
-        const std::vector<JoinSortingPair<IndexType>> &col_vec_rhs);
-
-    template<typename LHS_T, typename RHS_T, typename T, typename ... Ts>
-    static StdDataFrame<unsigned int>
-    column_left_join_(const LHS_T &lhs,
-                      const RHS_T &rhs,
-                      const char *col_name,
-                      const std::vector<JoinSortingPair<T>> &col_vec_lhs,
-                      const std::vector<JoinSortingPair<T>> &col_vec_rhs);
+    static far_memory::DataFrameVector<T>
+    join_keys_(far_memory::FarMemManager *manager,
+               far_memory::DataFrameVector<T> &lhs_vec,
+               far_memory::DataFrameVector<T> &rhs_vec,
+               JoinIdxVector &lhs_idx,
+               JoinIdxVector &rhs_idx,
+               join_policy jp);
 
     template<typename T>
-    static IndexIdxVector
-    get_right_index_idx_vector_(
-        const std::vector<JoinSortingPair<T>> &col_vec_lhs,
-        const std::vector<JoinSortingPair<T>> &col_vec_rhs);
-
-    template<typename LHS_T, typename RHS_T, typename ... Ts>
-    static StdDataFrame<IndexType>
-    index_right_join_(
-        const LHS_T &lhs, const RHS_T &rhs,
-        const std::vector<JoinSortingPair<IndexType>> &col_vec_lhs,
-        const std::vector<JoinSortingPair<IndexType>> &col_vec_rhs);
-
-    template<typename LHS_T, typename RHS_T, typename T, typename ... Ts>
-    static StdDataFrame<unsigned int>
-    column_right_join_(const LHS_T &lhs,
-                       const RHS_T &rhs,
-                       const char *col_name,
-                       const std::vector<JoinSortingPair<T>> &col_vec_lhs,
-                       const std::vector<JoinSortingPair<T>> &col_vec_rhs);
+    static void
+    sort_join_rows_(far_memory::FarMemManager *manager,
+                    far_memory::DataFrameVector<T> &keys,
+                    JoinIdxVector &lhs_idx,
+                    JoinIdxVector &rhs_idx);
 
     template<typename LHS_T, typename RHS_T, typename ... Ts>
     static void
     concat_helper_(LHS_T &lhs, const RHS_T &rhs, bool add_new_columns);
 
-    template<typename T>
-    static IndexIdxVector
-    get_left_right_index_idx_vector_(
-        const std::vector<JoinSortingPair<T>> &col_vec_lhs,
-        const std::vector<JoinSortingPair<T>> &col_vec_rhs);
-
-    template<typename LHS_T, typename RHS_T, typename ... Ts>
-    static StdDataFrame<IndexType>
-    index_left_right_join_(
-        const LHS_T &lhs, const RHS_T &rhs,
-        const std::vector<JoinSortingPair<IndexType>> &col_vec_lhs,
-        const std::vector<JoinSortingPair<IndexType>> &col_vec_rhs);
-
-    template<typename LHS_T, typename RHS_T, typename T, typename ... Ts>
-    static StdDataFrame<unsigned int>
-    column_left_right_join_(
-        const LHS_T &lhs,
-        const RHS_T &rhs,
-        const char *col_name,
-        const std::vector<JoinSortingPair<T>> &col_vec_lhs,
-        const std::vector<JoinSortingPair<T>> &col_vec_rhs);
-
     template<typename V>
     static bool
     is_monotonic_increasing_(const V &column);
@@ -29,8 +29,12 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #pragma once
 
+#include "groupby.hpp"
+
 #include <DataFrame/DataFrameStatsVisitors.h>
 
+#include <type_traits>
+
 // ----------------------------------------------------------------------------
 
 namespace hmdf
@@ -106,6 +110,65 @@ struct  GroupbyMedian  {
     get_aggregator()  { return (MedianVisitor<T, I>()); }
 };
 
+// ----------------------------------------------------------------------------
+
+// The following ones are only supported by groupby(), which is offloaded.
+
+struct  GroupbyCount  {  };
+
+// ----------------------------------------------------------------------------
+
+struct  GroupbyFirst  {  };
+
+// ----------------------------------------------------------------------------
+
+struct  GroupbyLast  {  };
+
+// ----------------------------------------------------------------------------
+
+// The q-quantile of each group. Unless exact, it is estimated in one pass and
+// bounded memory by a per-group far_memory::QuantileSketch.
+
+struct  GroupbyQuantile  {
+
+    double  q;
+    bool    exact { false };
+};
+
+// ----------------------------------------------------------------------------
+
+template<typename F>
+inline constexpr far_memory::AggregateOp get_groupby_op()  {
+
+    using Func = std::decay_t<F>;
+
+    if constexpr (std::is_same<Func, GroupbySum>::value)
+        return (far_memory::AggSum);
+    else if constexpr (std::is_same<Func, GroupbyCount>::value)
+        return (far_memory::AggCount);
+    else if constexpr (std::is_same<Func, GroupbyMean>::value)
+        return (far_memory::AggMean);
+    else if constexpr (std::is_same<Func, GroupbyVar>::value)
+        return (far_memory::AggVar);
+    else if constexpr (std::is_same<Func, GroupbyStd>::value)
+        return (far_memory::AggStd);
+    else if constexpr (std::is_same<Func, GroupbyFirst>::value)
+        return (far_memory::AggFirst);
+    else if constexpr (std::is_same<Func, GroupbyLast>::value)
+        return (far_memory::AggLast);
+    else if constexpr (std::is_same<Func, GroupbyMax>::value)
+        return (far_memory::AggMax);
+    else if constexpr (std::is_same<Func, GroupbyMin>::value)
+        return (far_memory::AggMin);
+    else if constexpr (std::is_same<Func, GroupbyMedian>::value)
+        return (far_memory::AggMedian);
+    else if constexpr (std::is_same<Func, GroupbyQuantile>::value)
+        return (far_memory::AggQuantile);
+    else
+        static_assert(std::is_same<Func, GroupbyMedian>::value,
+                      "Unsupported groupby functor");
+}
+
 } // namespace hmdf
 
 // ----------------------------------------------------------------------------
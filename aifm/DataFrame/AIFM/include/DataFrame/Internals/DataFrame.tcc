@@ -1097,44 +1097,114 @@ DataFrame<I, H> DataFrame<I, H>::
 groupby (far_memory::FarMemManager *manager, F &&func, const char *gb_col_name,
          sort_state already_sorted) const  {
 
-    DataFrame   tmp_df = *this;
+    auto        &gb_vec = groupby_key_column_<T>(gb_col_name);
+    auto        [group_ids, first_idx] = gb_vec.hash_group(manager);
+    DataFrame   result(manager);
 
-    // Sort the whole dataframe by gb_col.
-    if (already_sorted == sort_state::not_sorted)  {
-        tmp_df.sort<T, Ts ...>(manager, gb_col_name, sort_spec::ascen);
-    }
+    groupby_common_<F, Ts ...>(manager, func, group_ids, first_idx,
+                               { gb_col_name }, result);
+    return (result);
+}
+
+// ----------------------------------------------------------------------------
+
+template<typename I, typename H>
+template<typename F, typename T1, typename T2, typename ...Ts>
+DataFrame<I, H> DataFrame<I, H>::
+groupby2 (far_memory::FarMemManager *manager,
+          F &&func,
+          const char *gb_col_name1,
+          const char *gb_col_name2) const  {
+
+    return (groupby_n<F, std::tuple<T1, T2>, Ts ...>(
+                manager, std::forward<F>(func),
+                { gb_col_name1, gb_col_name2 }));
+}
+
+// ----------------------------------------------------------------------------
+
+template<typename I, typename H>
+template<typename F, typename GbTs, typename ...Ts>
+DataFrame<I, H> DataFrame<I, H>::
+groupby_n (far_memory::FarMemManager *manager,
+           F &&func,
+           const std::array<const char *, std::tuple_size_v<GbTs>>
+               &gb_col_names) const  {
+
+    constexpr std::size_t   kNumKeys = std::tuple_size_v<GbTs>;
+
+    static_assert(kNumKeys > 0, "groupby_n() needs at least one key column");
+
+    // Each key column refines the group ids of the columns before it.
+    auto    groups =
+        groupby_key_column_<std::tuple_element_t<0, GbTs>>(gb_col_names[0]).
+            hash_group(manager);
+
+    [&]<std::size_t ... Is>(std::index_sequence<Is ...>)  {
+        ((groups = groupby_key_column_<std::tuple_element_t<Is + 1, GbTs>>(
+                       gb_col_names[Is + 1]).
+                       hash_group(manager, &groups.first)), ...);
+    }(std::make_index_sequence<kNumKeys - 1>{});
 
     DataFrame   result(manager);
 
-    // Do aggregation.
-    if (! ::strcmp(gb_col_name, DF_INDEX_COL_NAME))  { // Index
-		auto gb_vec = get_index();
-        groupby_functor_<I, F, Ts...> functor(manager, DF_INDEX_COL_NAME,
-                                              gb_vec, func, result);
-		functor(gb_vec);
+    groupby_common_<F, Ts ...>(manager, func, groups.first, groups.second,
+                               std::vector<const char *>(gb_col_names.begin(),
+                                                         gb_col_names.end()),
+                               result);
+    return (result);
+}
 
-        for (const auto& iter : tmp_df.column_tb_) {
-            groupby_functor_<I, F, Ts...> functor(manager, iter.first.c_str(),
-                                               gb_vec, func, result);
+// ----------------------------------------------------------------------------
 
-            tmp_df.data_[iter.second].change(functor);
-        }
+template<typename I, typename H>
+template<typename T>
+far_memory::DataFrameVector<T> &
+DataFrame<I, H>::groupby_key_column_(const char *name) const  {
+
+    if (! ::strcmp(name, DF_INDEX_COL_NAME))  {
+        if constexpr (std::is_same<I, T>::value)
+            return (const_cast<IndexVecType &>(indices_));
+        BUG();
     }
-    else  { // Non-index column
-        const auto &gb_vec = tmp_df.get_column<T>(gb_col_name);
-        groupby_functor_<T, F, Ts...> functor(manager, DF_INDEX_COL_NAME,
-                                              gb_vec, func, result);
-		functor(get_index());
+    return (const_cast<far_memory::DataFrameVector<T> &>(
+        get_column<T>(name)));
+}
 
-        for (const auto& iter : tmp_df.column_tb_) {
-            groupby_functor_<T, F, Ts...> functor(manager, iter.first.c_str(),
-                                              gb_vec, func, result);
+// ----------------------------------------------------------------------------
 
-            tmp_df.data_[iter.second].change(functor);
-        }
-    }
+template<typename I, typename H>
+template<typename F, typename ... Ts>
+void DataFrame<I, H>::
+groupby_common_(far_memory::FarMemManager *manager,
+                const std::decay_t<F> &func,
+                GroupIdxVector &group_ids,
+                GroupIdxVector &first_idx,
+                const std::vector<const char *> &gb_col_names,
+                DataFrame &result) const  {
+
+    auto    is_key = [&](const char *name) -> bool  {
+        for (auto gb_col_name : gb_col_names)
+            if (! ::strcmp(name, gb_col_name))  return (true);
+        return (false);
+    };
 
-    return (result);
+    groupby_functor_<F, Ts...>  index_functor(manager, func,
+                                              DF_INDEX_COL_NAME,
+                                              group_ids, first_idx,
+                                              is_key(DF_INDEX_COL_NAME),
+                                              result);
+
+    index_functor(indices_);
+    for (const auto& iter : column_tb_) {
+        groupby_functor_<F, Ts...>  functor(manager, func,
+                                            iter.first.c_str(),
+                                            group_ids, first_idx,
+                                            is_key(iter.first.c_str()),
+                                            result);
+
+        data_[iter.second].change(functor);
+    }
 }
 
 // ----------------------------------------------------------------------------
@@ -173,21 +173,28 @@ struct add_col_functor_ : DataVec::template visitor_base<Ts ...>  {
 
 // ----------------------------------------------------------------------------
 
-template<typename T, typename F, typename ... Ts>
+// It copies the first row of each group for the groupby key columns and
+// aggregates the rows of each group with F for the other columns.
+template<typename F, typename ... Ts>
 struct groupby_functor_ : DataVec::template visitor_base<Ts ...>  {
 
     inline groupby_functor_ (far_memory::FarMemManager *m,
+                             const std::decay_t<F> &f,
                              const char *n,
-                             const far_memory::DataFrameVector<T> &k,
-                             F &f,
+                             GroupIdxVector &gi,
+                             GroupIdxVector &fi,
+                             bool ik,
                              DataFrame &d)
-        : manager(m), name(n), key_vec(k), functor(f), df(d) {  }
+        : manager(m), func(f), name(n), group_ids(gi), first_idx(fi),
+          is_key(ik), df(d) {  }
 
-    far_memory::FarMemManager             *manager;
-    const char                            *name;
-    const far_memory::DataFrameVector<T>  &key_vec;
-    F                                     &functor;
-    DataFrame                             &df;
+    far_memory::FarMemManager   *manager;
+    const std::decay_t<F>       &func;
+    const char                  *name;
+    GroupIdxVector              &group_ids;
+    GroupIdxVector              &first_idx;
+    const bool                  is_key;
+    DataFrame                   &df;
 
     template<typename U>
     void operator() (const U &vec);
@@ -294,40 +301,48 @@ template<typename RES_T, typename ... Ts>
 struct  index_join_functor_common_ : DataVec::template visitor_base<Ts ...>  {
 
     inline index_join_functor_common_ (
+        far_memory::FarMemManager *m,
         const char *n,
         const DataFrame &r,
-        const IndexIdxVector &mii,
+        JoinIdxVector &li,
+        JoinIdxVector &ri,
         RES_T &res)
-        : name(n), rhs(r), joined_index_idx(mii), result(res)  {  }
+        : manager(m), name(n), rhs(r), lhs_idx(li), rhs_idx(ri), result(res)  {
+    }
 
-    const char              *name;
-    const DataFrame         &rhs;
-    const IndexIdxVector    &joined_index_idx;
-    RES_T                   &result;
+    far_memory::FarMemManager   *manager;
+    const char                  *name;
+    const DataFrame             &rhs;
+    JoinIdxVector               &lhs_idx;
+    JoinIdxVector               &rhs_idx;
+    RES_T                       &result;
 
     template<typename T>
-    void operator() (const std::vector<T> &lhs_vec);
+    void operator() (const far_memory::DataFrameVector<T> &lhs_vec);
 };
 
 // ----------------------------------------------------------------------------
 
-// SIDE:  0 = Left, 1 = Right
-template<int SIDE, typename RES_T, typename ... Ts>
+// It materializes a column that exists only on one side of the join, by the
+// row indices of that side.
+template<typename RES_T, typename ... Ts>
 struct  index_join_functor_oneside_
     : DataVec::template visitor_base<Ts ...>  {
 
     inline index_join_functor_oneside_ (
+        far_memory::FarMemManager *m,
         const char *n,
-        const IndexIdxVector &mii,
+        JoinIdxVector &i,
         RES_T &res)
-        : name(n), joined_index_idx(mii), result(res)  {  }
+        : manager(m), name(n), idx(i), result(res)  {  }
 
-    const char              *name;
-    const IndexIdxVector    &joined_index_idx;
-    RES_T                   &result;
+    far_memory::FarMemManager   *manager;
+    const char                  *name;
+    JoinIdxVector               &idx;
+    RES_T                       &result;
 
     template<typename T>
-    void operator() (const std::vector<T> &vec);
+    void operator() (const far_memory::DataFrameVector<T> &vec);
 };
 
 // ----------------------------------------------------------------------------
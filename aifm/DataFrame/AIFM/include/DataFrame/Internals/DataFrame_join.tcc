@@ -31,7 +31,12 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <DataFrame/DataFrame.h>
 
+#include <algorithm>
+#include <cmath>
 #include <cstdio>
+#include <numeric>
+#include <tuple>
+#include <vector>
 
 // ----------------------------------------------------------------------------
 
@@ -41,7 +46,9 @@ namespace hmdf
 template<typename I, typename H>
 template<typename RHS_T, typename ... Ts>
 StdDataFrame<I> DataFrame<I, H>::
-join_by_index (const RHS_T &rhs, join_policy mp) const  {
+join_by_index (far_memory::FarMemManager *manager,
+               const RHS_T &rhs,
+               join_policy mp) const  {
 
     static_assert(std::is_base_of<StdDataFrame<I>, RHS_T>::value ||
                       std::is_base_of<DataFrameView<I>, RHS_T>::value ||
@@ -49,47 +56,22 @@ join_by_index (const RHS_T &rhs, join_policy mp) const  {
                   "The rhs argument to join_by_index() can only be "
                   "StdDataFrame<IndexType> or DataFrame[Ptr]View<IndexType>");
 
-    const auto                              &lhs_idx = get_index();
-    const auto                              &rhs_idx = rhs.get_index();
-    const size_type                         lhs_idx_s = lhs_idx.size();
-    const size_type                         rhs_idx_s = rhs_idx.size();
-    std::vector<JoinSortingPair<IndexType>> idx_vec_lhs;
-    std::vector<JoinSortingPair<IndexType>> idx_vec_rhs;
-
-    idx_vec_lhs.reserve(lhs_idx_s);
-    for (size_type i = 0; i < lhs_idx_s; ++i)
-        idx_vec_lhs.push_back(std::make_pair(&(lhs_idx[i]), i));
-    idx_vec_rhs.reserve(rhs_idx_s);
-    for (size_type i = 0; i < rhs_idx_s; ++i)
-        idx_vec_rhs.push_back(std::make_pair(&(rhs_idx[i]), i));
-
-    auto    cf = [] (const JoinSortingPair<IndexType> &l,
-                     const JoinSortingPair<IndexType> &r) -> bool  {
-                     return (*(l.first) < *(r.first));
-                 };
-
-    std::sort(idx_vec_lhs.begin(), idx_vec_lhs.end(), cf);
-    std::sort(idx_vec_rhs.begin(), idx_vec_rhs.end(), cf);
-
-    switch(mp)  {
-        case join_policy::inner_join:
-            return (index_inner_join_
-                        <decltype(*this), RHS_T, Ts ...>
-                    (*this, rhs, idx_vec_lhs, idx_vec_rhs));
-        case join_policy::left_join:
-            return (index_left_join_
-                        <decltype(*this), RHS_T, Ts ...>
-                    (*this, rhs, idx_vec_lhs, idx_vec_rhs));
-        case join_policy::right_join:
-            return (index_right_join_
-                        <decltype(*this), RHS_T, Ts ...>
-                    (*this, rhs, idx_vec_lhs, idx_vec_rhs));
-        case join_policy::left_right_join:
-        default:
-            return (index_left_right_join_
-                        <decltype(*this), RHS_T, Ts ...>
-                    (*this, rhs, idx_vec_lhs, idx_vec_rhs));
-    }
+    auto    &lhs_idx_vec = const_cast<IndexVecType &>(get_index());
+    auto    &rhs_idx_vec = const_cast<IndexVecType &>(rhs.get_index());
+    auto    [lhs_idx, rhs_idx] =
+        lhs_idx_vec.hash_join(manager, rhs_idx_vec, to_join_type_(mp));
+
+    auto    keys = join_keys_(manager, lhs_idx_vec, rhs_idx_vec,
+                              lhs_idx, rhs_idx, mp);
+
+    sort_join_rows_(manager, keys, lhs_idx, rhs_idx);
+
+    StdDataFrame<IndexType> result(manager);
+
+    result.load_index(std::move(keys));
+    join_helper_common_<decltype(*this), RHS_T, IndexType, Ts ...>
+        (manager, *this, rhs, lhs_idx, rhs_idx, result);
+    return (result);
 }
 
 // ----------------------------------------------------------------------------
@@ -97,7 +79,10 @@ join_by_index (const RHS_T &rhs, join_policy mp) const  {
 template<typename I, typename H>
 template<typename RHS_T, typename T, typename ... Ts>
 StdDataFrame<unsigned int> DataFrame<I, H>::
-join_by_column (const RHS_T &rhs, const char *name, join_policy mp) const  {
+join_by_column (far_memory::FarMemManager *manager,
+                const RHS_T &rhs,
+                const char *name,
+                join_policy mp) const  {
 
     static_assert(std::is_base_of<StdDataFrame<I>, RHS_T>::value ||
                       std::is_base_of<DataFrameView<I>, RHS_T>::value ||
@@ -105,47 +90,65 @@ join_by_column (const RHS_T &rhs, const char *name, join_policy mp) const  {
                   "The rhs argument to join_by_column() can only be "
                   "StdDataFrame<IndexType> or DataFrame[Ptr]View<IndexType>");
 
-    const auto      &lhs_vec = get_column<T>(name);
-    const auto      &rhs_vec = rhs.template get_column<T>(name);
-    const size_type lhs_vec_s = lhs_vec.size();
-    const size_type rhs_vec_s = rhs_vec.size();
+    auto    &lhs_vec =
+        const_cast<far_memory::DataFrameVector<T> &>(get_column<T>(name));
+    auto    &rhs_vec = const_cast<far_memory::DataFrameVector<T> &>(
+        rhs.template get_column<T>(name));
+    auto    [lhs_idx, rhs_idx] =
+        lhs_vec.hash_join(manager, rhs_vec, to_join_type_(mp));
+    auto    keys = join_keys_(manager, lhs_vec, rhs_vec, lhs_idx, rhs_idx, mp);
+
+    sort_join_rows_(manager, keys, lhs_idx, rhs_idx);
+
+    StdDataFrame<unsigned int>  result(manager);
+    auto                        result_index =
+        manager->allocate_dataframe_vector<unsigned int>();
+    constexpr unsigned int      kNumElementsPerBatch = 1 << 16;
+    std::vector<unsigned int>   batch(kNumElementsPerBatch);
+    const size_type             num_rows = lhs_idx.size();
+
+    for (size_type i = 0; i < num_rows; i += kNumElementsPerBatch)  {
+        const size_type len =
+            std::min(static_cast<size_type>(kNumElementsPerBatch),
+                     num_rows - i);
+
+        std::iota(batch.begin(), batch.begin() + len, i);
+        result_index.append(batch.data(), len);
+    }
+    result.load_index(std::move(result_index));
 
-    std::vector<JoinSortingPair<T>> col_vec_lhs;
-    std::vector<JoinSortingPair<T>> col_vec_rhs;
+    auto    &lhs_index = const_cast<IndexVecType &>(get_index());
+    auto    &rhs_index = const_cast<IndexVecType &>(rhs.get_index());
 
-    col_vec_lhs.reserve(lhs_vec_s);
-    for (size_type i = 0; i < lhs_vec_s; ++i)
-        col_vec_lhs.push_back(std::make_pair(&(lhs_vec[i]), i));
-    col_vec_rhs.reserve(rhs_vec_s);
-    for (size_type i = 0; i < rhs_vec_s; ++i)
-        col_vec_rhs.push_back(std::make_pair(&(rhs_vec[i]), i));
+    result.load_column(manager, "lhs.INDEX",
+                       lhs_index.copy_data_by_idx(manager, lhs_idx),
+                       nan_policy::dont_pad_with_nans);
+    result.load_column(manager, "rhs.INDEX",
+                       rhs_index.copy_data_by_idx(manager, rhs_idx),
+                       nan_policy::dont_pad_with_nans);
+    result.load_column(manager, name, std::move(keys),
+                       nan_policy::dont_pad_with_nans);
 
-    auto    cf = [] (const JoinSortingPair<T> &l,
-                     const JoinSortingPair<T> &r) -> bool  {
-                     return (*(l.first) < *(r.first));
-                 };
+    join_helper_common_<decltype(*this), RHS_T, unsigned int, Ts ...>
+        (manager, *this, rhs, lhs_idx, rhs_idx, result, name);
+    return (result);
+}
 
-    std::sort(col_vec_lhs.begin(), col_vec_lhs.end(), cf);
-    std::sort(col_vec_rhs.begin(), col_vec_rhs.end(), cf);
+// ----------------------------------------------------------------------------
+
+template<typename I, typename H>
+far_memory::JoinType DataFrame<I, H>::to_join_type_(join_policy jp)  {
 
-    switch(mp)  {
+    switch(jp)  {
         case join_policy::inner_join:
-            return (column_inner_join_
-                        <decltype(*this), RHS_T, T, Ts ...>
-                            (*this, rhs, name, col_vec_lhs, col_vec_rhs));
+            return (far_memory::InnerJoin);
         case join_policy::left_join:
-            return (column_left_join_
-                        <decltype(*this), RHS_T, T, Ts ...>
-                            (*this, rhs, name, col_vec_lhs, col_vec_rhs));
+            return (far_memory::LeftJoin);
         case join_policy::right_join:
-            return (column_right_join_
-                        <decltype(*this), RHS_T, T, Ts ...>
-                            (*this, rhs, name, col_vec_lhs, col_vec_rhs));
+            return (far_memory::RightJoin);
         case join_policy::left_right_join:
         default:
-            return (column_left_right_join_
-                        <decltype(*this), RHS_T, T, Ts ...>
-                            (*this, rhs, name, col_vec_lhs, col_vec_rhs));
+            return (far_memory::OuterJoin);
     }
 }
 
@@ -154,9 +157,11 @@ join_by_column (const RHS_T &rhs, const char *name, join_policy mp) const  {
 template<typename I, typename H>
 template<typename LHS_T, typename RHS_T, typename IDX_T, typename ... Ts>
 void DataFrame<I, H>::
-join_helper_common_(const LHS_T &lhs,
+join_helper_common_(far_memory::FarMemManager *manager,
+                    const LHS_T &lhs,
                     const RHS_T &rhs,
-                    const IndexIdxVector &joined_index_idx,
+                    JoinIdxVector &lhs_idx,
+                    JoinIdxVector &rhs_idx,
                     StdDataFrame<IDX_T> &result,
                     const char *skip_col_name)  {
 
@@ -169,18 +174,20 @@ join_helper_common_(const LHS_T &lhs,
         // Common column between two frames
         if (rhs_citer != rhs.column_tb_.end())  {
             index_join_functor_common_<decltype(result), Ts ...> functor(
+                manager,
                 iter.first.c_str(),
                 rhs,
-                joined_index_idx,
+                lhs_idx,
+                rhs_idx,
                 result);
 
             lhs.data_[iter.second].change(functor);
         }
         else  {  // lhs only column
-            // 0 = Left
-            index_join_functor_oneside_<0, decltype(result), Ts ...> functor (
+            index_join_functor_oneside_<decltype(result), Ts ...> functor (
+                manager,
                 iter.first.c_str(),
-                joined_index_idx,
+                lhs_idx,
                 result);
 
             lhs.data_[iter.second].change(functor);
@@ -194,10 +201,10 @@ join_helper_common_(const LHS_T &lhs,
         if (skip_col_name && iter.first == skip_col_name)  continue;
 
         if (lhs_citer == lhs.column_tb_.end())  {  // rhs only column
-            // 1 = Right
-            index_join_functor_oneside_<1, decltype(result), Ts ...> functor (
+            index_join_functor_oneside_<decltype(result), Ts ...> functor (
+                manager,
                 iter.first.c_str(),
-                joined_index_idx,
+                rhs_idx,
                 result);
 
             rhs.data_[iter.second].change(functor);
@@ -207,335 +214,130 @@ join_helper_common_(const LHS_T &lhs,
 
 // ----------------------------------------------------------------------------
 
-template<typename I, typename H>
-template<typename LHS_T, typename RHS_T, typename ... Ts>
-StdDataFrame<I> DataFrame<I, H>::
-index_join_helper_(const LHS_T &lhs,
-                   const RHS_T &rhs,
-                   const IndexIdxVector &joined_index_idx)  {
-
-    StdDataFrame<IndexType>    result;
-    std::vector<IndexType>     result_index;
-
-    // Load the index
-    result_index.reserve(joined_index_idx.size());
-    for (const auto &citer : joined_index_idx)  {
-        const size_type left_i = std::get<0>(citer);
-
-        result_index.push_back(
-            left_i != std::numeric_limits<size_type>::max()
-                ? lhs.indices_[left_i] : rhs.indices_[std::get<1>(citer)]);
-    }
-    result.load_index(std::move(result_index));
-
-    join_helper_common_<LHS_T, RHS_T, IndexType, Ts ...>
-        (lhs, rhs, joined_index_idx, result);
-    return(result);
-}
-
-// ----------------------------------------------------------------------------
-
-template<typename I, typename H>
-template<typename LHS_T, typename RHS_T, typename T, typename ... Ts>
-StdDataFrame<unsigned int> DataFrame<I, H>::
-column_join_helper_(const LHS_T &lhs,
-                    const RHS_T &rhs,
-                    const char *col_name,
-                    const IndexIdxVector &joined_index_idx)  {
-	BUG();
-}
-
-// ----------------------------------------------------------------------------
-
+// The join keys of a row come from lhs, unless the row only exists in rhs.
 template<typename I, typename H>
 template<typename T>
-typename DataFrame<I, H>::IndexIdxVector
-DataFrame<I, H>::get_inner_index_idx_vector_(
-    const std::vector<JoinSortingPair<T>> &col_vec_lhs,
-    const std::vector<JoinSortingPair<T>> &col_vec_rhs)  {
-
-    size_type       lhs_current = 0;
-    const size_type lhs_end = col_vec_lhs.size();
-    size_type       rhs_current = 0;
-    const size_type rhs_end = col_vec_rhs.size();
-
-    IndexIdxVector  joined_index_idx;
-
-    joined_index_idx.reserve(std::min(lhs_end, rhs_end));
-    while (lhs_current != lhs_end && rhs_current != rhs_end) {
-        if (*(col_vec_lhs[lhs_current].first) <
-                *(col_vec_rhs[rhs_current].first))
-            lhs_current += 1;
-        else  {
-            if (*(col_vec_lhs[lhs_current].first) ==
-                    *(col_vec_rhs[rhs_current].first))
-                joined_index_idx.emplace_back(
-                    col_vec_lhs[lhs_current++].second,
-                    col_vec_rhs[rhs_current].second);
-            rhs_current += 1;
+far_memory::DataFrameVector<T> DataFrame<I, H>::
+join_keys_(far_memory::FarMemManager *manager,
+           far_memory::DataFrameVector<T> &lhs_vec,
+           far_memory::DataFrameVector<T> &rhs_vec,
+           JoinIdxVector &lhs_idx,
+           JoinIdxVector &rhs_idx,
+           join_policy jp)  {
+
+    auto    keys = lhs_vec.copy_data_by_idx(manager, lhs_idx);
+
+    if (jp == join_policy::inner_join || jp == join_policy::left_join)
+        return (keys);
+
+    constexpr uint64_t  kNumElementsPerScope = 1024;
+    auto                rhs_keys = rhs_vec.copy_data_by_idx(manager, rhs_idx);
+    far_memory::DerefScope  scope;
+    auto                keys_it = keys.fbegin(scope);
+    auto                rhs_keys_it = rhs_keys.cfbegin(scope);
+    auto                lhs_idx_it = lhs_idx.cfbegin(scope);
+
+    for (size_type i = 0; i < keys.size();
+         ++i, ++keys_it, ++rhs_keys_it, ++lhs_idx_it)  {
+        if (unlikely(i % kNumElementsPerScope == 0))  {
+            scope.renew();
+            keys_it.renew(scope);
+            rhs_keys_it.renew(scope);
+            lhs_idx_it.renew(scope);
         }
+        if (*lhs_idx_it == far_memory::kJoinNullIdx)
+            *keys_it = *rhs_keys_it;
     }
-    return (joined_index_idx);
-}
-
-// ----------------------------------------------------------------------------
-
-template<typename I, typename H>
-template<typename LHS_T, typename RHS_T, typename ... Ts>
-StdDataFrame<I> DataFrame<I, H>::
-index_inner_join_(const LHS_T &lhs, const RHS_T &rhs,
-                  const std::vector<JoinSortingPair<IndexType>> &col_vec_lhs,
-                  const std::vector<JoinSortingPair<IndexType>> &col_vec_rhs) {
-
-    return (index_join_helper_<LHS_T, RHS_T, Ts ...>
-                (lhs, rhs,
-                 get_inner_index_idx_vector_(col_vec_lhs, col_vec_rhs)));
-}
-
-// ----------------------------------------------------------------------------
-
-template<typename I, typename H>
-template<typename LHS_T, typename RHS_T, typename T, typename ... Ts>
-StdDataFrame<unsigned int> DataFrame<I, H>::
-column_inner_join_(const LHS_T &lhs,
-                   const RHS_T &rhs,
-                   const char *col_name,
-                   const std::vector<JoinSortingPair<T>> &col_vec_lhs,
-                   const std::vector<JoinSortingPair<T>> &col_vec_rhs)  {
-
-    return (column_join_helper_<LHS_T, RHS_T, T, Ts ...>
-                (lhs, rhs, col_name,
-                 get_inner_index_idx_vector_(col_vec_lhs, col_vec_rhs)));
+    return (keys);
 }
 
 // ----------------------------------------------------------------------------
 
+// The hash join emits the rows in hash order. This restores the order of the
+// sort-merge join it replaced: ascending by key, then by lhs and rhs row. The
+// sort runs on the client over a local copy of the keys and row indices.
 template<typename I, typename H>
 template<typename T>
-typename DataFrame<I, H>::IndexIdxVector
-DataFrame<I, H>::get_left_index_idx_vector_(
-    const std::vector<JoinSortingPair<T>> &col_vec_lhs,
-    const std::vector<JoinSortingPair<T>> &col_vec_rhs)  {
-
-    size_type       lhs_current = 0;
-    const size_type lhs_end = col_vec_lhs.size();
-    size_type       rhs_current = 0;
-    const size_type rhs_end = col_vec_rhs.size();
-
-    IndexIdxVector  joined_index_idx;
-
-    joined_index_idx.reserve(lhs_end);
-    while (lhs_current != lhs_end || rhs_current != rhs_end) {
-        if (lhs_current >= lhs_end)  break;
-        if (rhs_current >= rhs_end)  {
-            joined_index_idx.emplace_back(
-                col_vec_lhs[lhs_current++].second,
-                std::numeric_limits<size_type>::max());
-            continue;
-        }
-
-        if (*(col_vec_lhs[lhs_current].first) <
-                *(col_vec_rhs[rhs_current].first))
-            joined_index_idx.emplace_back(
-                col_vec_lhs[lhs_current++].second,
-                std::numeric_limits<size_type>::max());
-        else  {
-            if (*(col_vec_lhs[lhs_current].first) ==
-                    *(col_vec_rhs[rhs_current].first))
-                joined_index_idx.emplace_back(col_vec_lhs[lhs_current++].second,
-                                              col_vec_rhs[rhs_current].second);
-            rhs_current += 1;
-        }
-    }
-    return (joined_index_idx);
-}
-// ----------------------------------------------------------------------------
-
-template<typename I, typename H>
-template<typename LHS_T, typename RHS_T, typename ... Ts>
-StdDataFrame<I> DataFrame<I, H>::
-index_left_join_(const LHS_T &lhs, const RHS_T &rhs,
-                 const std::vector<JoinSortingPair<IndexType>> &col_vec_lhs,
-                 const std::vector<JoinSortingPair<IndexType>> &col_vec_rhs) {
-
-    return (index_join_helper_<LHS_T, RHS_T, Ts ...>
-                (lhs, rhs,
-                 get_left_index_idx_vector_(col_vec_lhs, col_vec_rhs)));
-}
-
-// ----------------------------------------------------------------------------
-
-template<typename I, typename H>
-template<typename LHS_T, typename RHS_T, typename T, typename ... Ts>
-StdDataFrame<unsigned int> DataFrame<I, H>::
-column_left_join_(const LHS_T &lhs,
-                  const RHS_T &rhs,
-                  const char *col_name,
-                  const std::vector<JoinSortingPair<T>> &col_vec_lhs,
-                  const std::vector<JoinSortingPair<T>> &col_vec_rhs)  {
-
-    return (column_join_helper_<LHS_T, RHS_T, T, Ts ...>
-                (lhs, rhs, col_name,
-                 get_left_index_idx_vector_(col_vec_lhs, col_vec_rhs)));
-}
-
-// ----------------------------------------------------------------------------
-
-template<typename I, typename H>
-template<typename T>
-typename DataFrame<I, H>::IndexIdxVector
-DataFrame<I, H>::get_right_index_idx_vector_(
-    const std::vector<JoinSortingPair<T>> &col_vec_lhs,
-    const std::vector<JoinSortingPair<T>> &col_vec_rhs)  {
-
-    size_type       lhs_current = 0;
-    const size_type lhs_end = col_vec_lhs.size();
-    size_type       rhs_current = 0;
-    const size_type rhs_end = col_vec_rhs.size();
-
-    IndexIdxVector  joined_index_idx;
-
-    joined_index_idx.reserve(rhs_end);
-    while (lhs_current != lhs_end || rhs_current != rhs_end) {
-        if (rhs_current >= rhs_end)  break;
-        if (lhs_current >= lhs_end)  {
-            joined_index_idx.emplace_back(
-                std::numeric_limits<size_type>::max(),
-                col_vec_rhs[rhs_current++].second);
-            continue;
-        }
-
-        if (*(col_vec_lhs[lhs_current].first) <
-                *(col_vec_rhs[rhs_current].first))
-            lhs_current += 1;
-        else  {
-            if (*(col_vec_lhs[lhs_current].first) ==
-                    *(col_vec_rhs[rhs_current].first))
-                joined_index_idx.emplace_back(
-                    col_vec_lhs[lhs_current++].second,
-                    col_vec_rhs[rhs_current].second);
-            else
-                joined_index_idx.emplace_back(
-                    std::numeric_limits<size_type>::max(),
-                    col_vec_rhs[rhs_current].second);
-            rhs_current += 1;
+void DataFrame<I, H>::
+sort_join_rows_(far_memory::FarMemManager *manager,
+                far_memory::DataFrameVector<T> &keys,
+                JoinIdxVector &lhs_idx,
+                JoinIdxVector &rhs_idx)  {
+
+    using RowIdx = unsigned long long;
+    struct  JoinRow  {
+        T       key;
+        RowIdx  lhs;
+        RowIdx  rhs;
+    };
+
+    constexpr uint64_t      kNumElementsPerScope = 1024;
+    const size_type         num_rows = keys.size();
+    std::vector<JoinRow>    rows;
+
+    rows.reserve(num_rows);
+    {
+        far_memory::DerefScope  scope;
+        auto                    keys_it = keys.cfbegin(scope);
+        auto                    lhs_idx_it = lhs_idx.cfbegin(scope);
+        auto                    rhs_idx_it = rhs_idx.cfbegin(scope);
+
+        for (size_type i = 0; i < num_rows;
+             ++i, ++keys_it, ++lhs_idx_it, ++rhs_idx_it)  {
+            if (unlikely(i % kNumElementsPerScope == 0))  {
+                scope.renew();
+                keys_it.renew(scope);
+                lhs_idx_it.renew(scope);
+                rhs_idx_it.renew(scope);
+            }
+            rows.push_back({ *keys_it, *lhs_idx_it, *rhs_idx_it });
         }
     }
-    return (joined_index_idx);
-}
 
-// ----------------------------------------------------------------------------
-
-template<typename I, typename H>
-template<typename LHS_T, typename RHS_T, typename ... Ts>
-StdDataFrame<I> DataFrame<I, H>::
-index_right_join_(const LHS_T &lhs, const RHS_T &rhs,
-                  const std::vector<JoinSortingPair<IndexType>> &col_vec_lhs,
-                  const std::vector<JoinSortingPair<IndexType>> &col_vec_rhs) {
-
-    return (index_join_helper_<LHS_T, RHS_T, Ts ...>
-                (lhs, rhs,
-                 get_right_index_idx_vector_(col_vec_lhs, col_vec_rhs)));
-}
-
-// ----------------------------------------------------------------------------
-
-template<typename I, typename H>
-template<typename LHS_T, typename RHS_T, typename T, typename ... Ts>
-StdDataFrame<unsigned int> DataFrame<I, H>::
-column_right_join_(const LHS_T &lhs,
-                   const RHS_T &rhs,
-                   const char *col_name,
-                   const std::vector<JoinSortingPair<T>> &col_vec_lhs,
-                   const std::vector<JoinSortingPair<T>> &col_vec_rhs)  {
-
-    return (column_join_helper_<LHS_T, RHS_T, T, Ts ...>
-                (lhs, rhs, col_name,
-                 get_right_index_idx_vector_(col_vec_lhs, col_vec_rhs)));
-}
-
-// ----------------------------------------------------------------------------
-
-template<typename I, typename H>
-template<typename T>
-typename DataFrame<I, H>::IndexIdxVector
-DataFrame<I, H>::get_left_right_index_idx_vector_(
-    const std::vector<JoinSortingPair<T>> &col_vec_lhs,
-    const std::vector<JoinSortingPair<T>> &col_vec_rhs)  {
-
-    size_type       lhs_current = 0;
-    const size_type lhs_end = col_vec_lhs.size();
-    size_type       rhs_current = 0;
-    const size_type rhs_end = col_vec_rhs.size();
-
-    IndexIdxVector  joined_index_idx;
-
-    joined_index_idx.reserve(std::max(lhs_end, rhs_end));
-    while (lhs_current != lhs_end || rhs_current != rhs_end) {
-        if (lhs_current >= lhs_end && rhs_current < rhs_end)  {
-            joined_index_idx.emplace_back(
-                std::numeric_limits<size_type>::max(),
-                col_vec_rhs[rhs_current++].second);
-            continue;
-        }
-        if (rhs_current >= rhs_end && lhs_current < lhs_end)  {
-            joined_index_idx.emplace_back(
-                col_vec_lhs[lhs_current++].second,
-                std::numeric_limits<size_type>::max());
-            continue;
-        }
-
-        if (*(col_vec_lhs[lhs_current].first) <
-                *(col_vec_rhs[rhs_current].first))  {
-            joined_index_idx.emplace_back(
-                col_vec_lhs[lhs_current++].second,
-                std::numeric_limits<size_type>::max());
-        }
-        else  {
-            if (*(col_vec_lhs[lhs_current].first) ==
-                    *(col_vec_rhs[rhs_current].first))
-                joined_index_idx.emplace_back(col_vec_lhs[lhs_current++].second,
-                                              col_vec_rhs[rhs_current].second);
-            else
-                joined_index_idx.emplace_back(
-                    std::numeric_limits<size_type>::max(),
-                    col_vec_rhs[rhs_current].second);
-            rhs_current += 1;
+    // NaN keys go last, so that the comparison stays a strict weak order.
+    auto    is_nan = [](const T &key) -> bool  {
+        if constexpr (std::is_floating_point<T>::value)
+            return (std::isnan(key));
+        else
+            return (false);
+    };
+
+    std::sort(rows.begin(), rows.end(),
+              [&is_nan](const JoinRow &lhs, const JoinRow &rhs) -> bool  {
+                  return (std::make_tuple(is_nan(lhs.key), lhs.key,
+                                          lhs.lhs, lhs.rhs) <
+                          std::make_tuple(is_nan(rhs.key), rhs.key,
+                                          rhs.lhs, rhs.rhs));
+              });
+
+    auto                sorted_keys = manager->allocate_dataframe_vector<T>();
+    auto                sorted_lhs_idx =
+        manager->allocate_dataframe_vector<RowIdx>();
+    auto                sorted_rhs_idx =
+        manager->allocate_dataframe_vector<RowIdx>();
+    constexpr size_type kNumElementsPerBatch = 1 << 16;
+    std::vector<T>      key_batch;
+    std::vector<RowIdx> lhs_batch;
+    std::vector<RowIdx> rhs_batch;
+
+    for (size_type i = 0; i < num_rows; i += kNumElementsPerBatch)  {
+        const size_type len = std::min(kNumElementsPerBatch, num_rows - i);
+
+        key_batch.clear();
+        lhs_batch.clear();
+        rhs_batch.clear();
+        for (size_type j = i; j < i + len; ++j)  {
+            key_batch.push_back(rows[j].key);
+            lhs_batch.push_back(rows[j].lhs);
+            rhs_batch.push_back(rows[j].rhs);
         }
+        sorted_keys.append(key_batch.data(), len);
+        sorted_lhs_idx.append(lhs_batch.data(), len);
+        sorted_rhs_idx.append(rhs_batch.data(), len);
     }
-    return (joined_index_idx);
-}
-
-// ----------------------------------------------------------------------------
-
-template<typename I, typename H>
-template<typename LHS_T, typename RHS_T, typename ... Ts>
-StdDataFrame<I> DataFrame<I, H>::
-index_left_right_join_(
-    const LHS_T &lhs,
-    const RHS_T &rhs,
-    const std::vector<JoinSortingPair<IndexType>> &col_vec_lhs,
-    const std::vector<JoinSortingPair<IndexType>> &col_vec_rhs) {
-
-    return (index_join_helper_<LHS_T, RHS_T, Ts ...>
-                (lhs, rhs,
-                 get_left_right_index_idx_vector_(col_vec_lhs, col_vec_rhs)));
-}
-
-// ----------------------------------------------------------------------------
-
-template<typename I, typename H>
-template<typename LHS_T, typename RHS_T, typename T, typename ... Ts>
-StdDataFrame<unsigned int> DataFrame<I, H>::
-column_left_right_join_(const LHS_T &lhs,
-                        const RHS_T &rhs,
-                        const char *col_name,
-                        const std::vector<JoinSortingPair<T>> &col_vec_lhs,
-                        const std::vector<JoinSortingPair<T>> &col_vec_rhs)  {
-
-    return (column_join_helper_<LHS_T, RHS_T, T, Ts ...>
-                (lhs, rhs, col_name,
-                 get_left_right_index_idx_vector_(col_vec_lhs, col_vec_rhs)));
+    keys = std::move(sorted_keys);
+    lhs_idx = std::move(sorted_lhs_idx);
+    rhs_idx = std::move(sorted_rhs_idx);
 }
 
 // ----------------------------------------------------------------------------
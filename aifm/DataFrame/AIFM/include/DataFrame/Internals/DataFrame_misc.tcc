@@ -171,33 +171,54 @@ DataFrame<I, H>::add_col_functor_<Ts ...>::operator() (const T &vec)  {
 // ----------------------------------------------------------------------------
 
 template<typename I, typename H>
-template<typename T, typename F, typename ... Ts>
+template<typename F, typename ... Ts>
 template<typename U>
 void
-DataFrame<I, H>::groupby_functor_<T, F, Ts ...>::operator() (const U &vec)  {
-
-    auto agg_vec = manager->allocate_dataframe_vector<typename U::value_type>();
-
-    if constexpr (std::is_same<F, GroupbyMax>::value) {
-        agg_vec = const_cast<U *>(&vec)->aggregate_max(manager, key_vec);
-    } else if constexpr (std::is_same<F, GroupbyMin>::value) {
-        agg_vec = const_cast<U *>(&vec)->aggregate_min(manager, key_vec);
-    } else if constexpr (std::is_same<F, GroupbyMedian>::value) {
-        agg_vec = const_cast<U *>(&vec)->aggregate_median(manager, key_vec);
-    } else {
-        BUG();
+DataFrame<I, H>::groupby_functor_<F, Ts ...>::operator() (const U &vec)  {
+
+    using ValueType = typename U::value_type;
+
+    constexpr bool  is_count = get_groupby_op<F>() == far_memory::AggCount;
+    const bool      is_index = ! ::strcmp(name, DF_INDEX_COL_NAME);
+    auto            &nc_vec = *const_cast<U *>(&vec);
+
+    if constexpr (is_count)  {
+        // The counts are unsigned long long whatever the column type is. The
+        // index keeps the one of the first row of each group instead.
+        if (! is_key && ! is_index)  {
+            df.template load_column<unsigned long long>(
+                manager, name,
+                nc_vec.count_by_group(manager, group_ids, first_idx.size()),
+                nan_policy::dont_pad_with_nans);
+            return;
+        }
     }
 
-    if (! ::strcmp(name, DF_INDEX_COL_NAME))  {
+    auto    aggregate = [&]()  {
+        if constexpr (get_groupby_op<F>() == far_memory::AggQuantile)
+            return (nc_vec.quantile_by_group(manager, group_ids,
+                                             first_idx.size(),
+                                             func.q, func.exact));
+        else
+            return (nc_vec.aggregate_by_group(manager, group_ids,
+                                              first_idx.size(),
+                                              get_groupby_op<F>()));
+    };
+    auto    agg_vec =
+        (is_key || is_count)
+            ? nc_vec.copy_data_by_idx(manager, first_idx)
+            : aggregate();
+
+    if (is_index)  {
         // If condition is always hold; it is used to avoid compilation errors when vec
         // is not index vector,
-        if constexpr (std::is_same<I, typename decltype(agg_vec)::value_type>::value) {
+        if constexpr (std::is_same<I, ValueType>::value) {
             df.load_index(std::move(agg_vec));
         }
     }
     else  {
-        df.load_column<typename U::value_type>(manager, name, std::move(agg_vec),
-                                               nan_policy::dont_pad_with_nans);
+        df.template load_column<ValueType>(manager, name, std::move(agg_vec),
+                                           nan_policy::dont_pad_with_nans);
     }
     return;
 }
@@ -475,55 +496,39 @@ template<typename T>
 void
 DataFrame<I, H>::
 index_join_functor_common_<RES_T, Ts ...>::
-operator()(const std::vector<T> &lhs_vec)  {
+operator()(const far_memory::DataFrameVector<T> &lhs_vec)  {
 
-    const std::vector<T>    &rhs_vec = rhs.get_column<T>(name);
-    std::vector<T>          lhs_result_col;
-    std::vector<T>          rhs_result_col;
-
-    lhs_result_col.reserve(joined_index_idx.size());
-    rhs_result_col.reserve(joined_index_idx.size());
-    for (auto &citer : joined_index_idx)  {
-        const size_type left_i = std::get<0>(citer);
-        const size_type right_i = std::get<1>(citer);
-
-        lhs_result_col.push_back(
-            left_i != std::numeric_limits<size_type>::max()
-                ? lhs_vec[left_i] : DataFrame::_get_nan<T>());
-        rhs_result_col.push_back(
-            right_i != std::numeric_limits<size_type>::max()
-                ? rhs_vec[right_i] : DataFrame::_get_nan<T>());
-    }
+    auto    &rhs_vec = const_cast<far_memory::DataFrameVector<T> &>(
+        rhs.get_column<T>(name));
+    auto    lhs_result_col =
+        const_cast<far_memory::DataFrameVector<T> &>(lhs_vec).
+            copy_data_by_idx(manager, lhs_idx);
+    auto    rhs_result_col = rhs_vec.copy_data_by_idx(manager, rhs_idx);
 
     char    lhs_str[256];
     char    rhs_str[256];
 
     ::sprintf(lhs_str, "lhs.%s", name);
     ::sprintf(rhs_str, "rhs.%s", name);
-    result.load_column(lhs_str, std::move(lhs_result_col));
-    result.load_column(rhs_str, std::move(rhs_result_col));
+    result.load_column(manager, lhs_str, std::move(lhs_result_col),
+                       nan_policy::dont_pad_with_nans);
+    result.load_column(manager, rhs_str, std::move(rhs_result_col),
+                       nan_policy::dont_pad_with_nans);
 }
 
 // ----------------------------------------------------------------------------
 
 template<typename I, typename H>
-template<int SIDE, typename RES_T, typename ... Ts>
+template<typename RES_T, typename ... Ts>
 template<typename T>
-void DataFrame<I, H>::index_join_functor_oneside_<SIDE, RES_T, Ts ...>::
-operator()(const std::vector<T> &vec)  {
-
-    std::vector<T>          result_col;
+void DataFrame<I, H>::index_join_functor_oneside_<RES_T, Ts ...>::
+operator()(const far_memory::DataFrameVector<T> &vec)  {
 
-    result_col.reserve(joined_index_idx.size());
-    for (auto &citer : joined_index_idx)  {
-        const size_type i = std::get<SIDE>(citer);
-
-        result_col.push_back(
-            i != std::numeric_limits<size_type>::max()
-                ? vec[i] : DataFrame::_get_nan<T>());
-    }
+    auto    result_col = const_cast<far_memory::DataFrameVector<T> &>(vec).
+        copy_data_by_idx(manager, idx);
 
-    result.load_column(name, std::move(result_col));
+    result.load_column(manager, name, std::move(result_col),
+                       nan_policy::dont_pad_with_nans);
 }
 
 // ----------------------------------------------------------------------------
@@ -37,6 +37,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <cstdlib>
 #include <functional>
 #include <memory>
+#include <numeric>
 
 // ----------------------------------------------------------------------------
 
@@ -460,8 +461,8 @@ auto read_csv(far_memory::FarMemManager* manager, std::string csv_file_path,
     using IndexType =
         std::conditional<kUseDefaultIndex, DefaultIndexType, IndicatedIndexType>::type;
     StdDataFrame<IndexType> df(manager);
-    auto vecs = io::parse_csv_to_vectors<ColTypes...>(manager, csv_file_path,
-													  data_col_names...);
+    auto vecs = io::parallel_parse_csv_to_vectors<ColTypes...>(
+        manager, csv_file_path, data_col_names...);
     auto seq  = std::index_sequence_for<ColTypes...>{};
     if constexpr (kUseDefaultIndex) {
         IndexType num_rows;
@@ -471,13 +472,12 @@ auto read_csv(far_memory::FarMemManager* manager, std::string csv_file_path,
             num_rows = std::max({std::get<ints>(vecs).size()...});
         }
         (seq);
-		far_memory::DerefScope scope;
-		auto kNumElementPerScope = 1024;
-        for (IndexType i = 0; i < num_rows; i++) {
-			if (unlikely((i % kNumElementPerScope) == 0)) {
-				scope.renew();
-			}
-            index_vec.push_back(scope, i);
+        constexpr IndexType kNumElementsPerBatch = 1 << 16;
+        std::vector<IndexType> batch(kNumElementsPerBatch);
+        for (IndexType i = 0; i < num_rows; i += kNumElementsPerBatch) {
+            auto len = std::min(kNumElementsPerBatch, num_rows - i);
+            std::iota(batch.begin(), batch.begin() + len, i);
+            index_vec.append(batch.data(), len);
         }
         df.load_index(std::move(index_vec));
     } else {
@@ -997,7 +997,8 @@ static void test_index_inner_join()  {
 
     MyDataFrame join_df =
         df.join_by_index<decltype(df2), double, int>
-            (df2, join_policy::inner_join);
+            (far_memory::FarMemManagerFactory::get(), df2,
+             join_policy::inner_join);
 
     std::cout << "Now The joined DF:" << std::endl;
     join_df.write<std::ostream, double, int>(std::cout);
@@ -1053,7 +1054,8 @@ static void test_index_left_join()  {
 
     MyDataFrame join_df =
         df.join_by_index<decltype(df2), double, int>
-            (df2, join_policy::left_join);
+            (far_memory::FarMemManagerFactory::get(), df2,
+             join_policy::left_join);
 
     std::cout << "Now The joined DF:" << std::endl;
     join_df.write<std::ostream, double, int>(std::cout);
@@ -1109,7 +1111,8 @@ static void test_index_right_join()  {
 
     MyDataFrame join_df =
         df.join_by_index<decltype(df2), double, int>
-            (df2, join_policy::right_join);
+            (far_memory::FarMemManagerFactory::get(), df2,
+             join_policy::right_join);
 
     std::cout << "Now The joined DF:" << std::endl;
     join_df.write<std::ostream, double, int>(std::cout);
@@ -1165,7 +1168,8 @@ static void test_index_left_right_join()  {
 
     MyDataFrame join_df =
         df.join_by_index<decltype(df2), double, int>
-            (df2, join_policy::left_right_join);
+            (far_memory::FarMemManagerFactory::get(), df2,
+             join_policy::left_right_join);
 
     std::cout << "Now The joined DF:" << std::endl;
     join_df.write<std::ostream, double, int>(std::cout);
@@ -4330,7 +4334,8 @@ static void test_join_by_column()  {
 
     StdDataFrame<unsigned int>  inner_result =
         df.join_by_column<decltype(df2), double, double, int>
-           (df2, "col_2", join_policy::inner_join);
+           (far_memory::FarMemManagerFactory::get(), df2, "col_2",
+            join_policy::inner_join);
 
     assert(inner_result.get_index().size() == 3);
     assert(inner_result.get_column<double>("xcol_1")[2] == 113.0);
@@ -4344,7 +4349,8 @@ static void test_join_by_column()  {
 
     StdDataFrame<unsigned int>  left_result =
         df.join_by_column<decltype(df2), double, double, int>
-           (df2, "col_2", join_policy::left_join);
+           (far_memory::FarMemManagerFactory::get(), df2, "col_2",
+            join_policy::left_join);
 
     assert(left_result.get_index().size() == 14);
     assert(std::isnan(left_result.get_column<double>("xcol_1")[5]));
@@ -4358,7 +4364,8 @@ static void test_join_by_column()  {
 
     StdDataFrame<unsigned int>  right_result =
         df.join_by_column<decltype(df2), double, double, int>
-           (df2, "col_2", join_policy::right_join);
+           (far_memory::FarMemManagerFactory::get(), df2, "col_2",
+            join_policy::right_join);
 
     assert(right_result.get_index().size() == 14);
     assert(right_result.get_column<double>("xcol_1")[5] == 18.0);
@@ -4372,7 +4379,8 @@ static void test_join_by_column()  {
 
     StdDataFrame<unsigned int>  left_right_result =
         df.join_by_column<decltype(df2), double, double, int>
-           (df2, "col_2", join_policy::left_right_join);
+           (far_memory::FarMemManagerFactory::get(), df2, "col_2",
+            join_policy::left_right_join);
 
     assert(left_right_result.get_index().size() == 25);
     assert(left_right_result.get_column<double>("xcol_1")[2] == 15.0);
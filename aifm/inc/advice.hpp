@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+
+namespace far_memory {
+
+// madvise()-style hints on a range of objects, which can be OR'ed together.
+// They let applications that know their phases move data ahead of time rather
+// than leaving it to the GC and the prefetcher.
+enum Advice : uint32_t {
+  // Swap the range in in the background.
+  kAdviceWillNeed = 1 << 0,
+  // Evict the range proactively. Its regions are GCed ahead of the others.
+  kAdviceDontNeed = 1 << 1,
+  // Prefetch eagerly. Container-wide, regardless of the range.
+  kAdviceSequential = 1 << 2,
+  // Stop prefetching. Container-wide, regardless of the range.
+  kAdviceRandom = 1 << 3,
+  // Swap the range in and keep it local. The GC copies the pinned objects
+  // instead of evicting them, as long as there is free cache for the copies.
+  kAdvicePin = 1 << 4,
+  // Undo kAdvicePin. Pins are counted.
+  kAdviceUnpin = 1 << 5,
+};
+
+} // namespace far_memory
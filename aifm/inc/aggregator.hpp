@@ -1,6 +1,7 @@
 #pragma once
 
 #include "deref_scope.hpp"
+#include "quantile_sketch.hpp"
 
 #include <algorithm>
 #include <limits>
@@ -41,6 +42,30 @@ public:
   T aggregate();
 };
 
+// Exact quantile of rank floor(q * n); buffers the whole group.
+template <typename T> class AggregatorQuantile : public Aggregator<T> {
+private:
+  double q_;
+  std::vector<T> vec_;
+
+public:
+  AggregatorQuantile(double q);
+  void add(DerefScope *scope, T t);
+  T aggregate();
+};
+
+// Approximate quantile within bounded memory regardless of the group size.
+template <typename T> class AggregatorApproxQuantile : public Aggregator<T> {
+private:
+  double q_;
+  QuantileSketch<T> sketch_;
+
+public:
+  AggregatorApproxQuantile(double q);
+  void add(DerefScope *scope, T t);
+  T aggregate();
+};
+
 template <typename T> class DataFrameVector;
 class FarMemManager;
 
@@ -54,10 +79,25 @@ public:
   T aggregate();
 };
 
+// Same as AggregatorQuantile, but spills the group into far memory.
+template <typename T>
+class AggregatorQuantileLimitedMem : public Aggregator<T> {
+private:
+  double q_;
+  DataFrameVector<T> vec_;
+
+public:
+  AggregatorQuantileLimitedMem(FarMemManager *manager, double q);
+  void add(DerefScope *scope, T t);
+  T aggregate();
+};
+
 template <typename T> class AggregatorFactory {
 public:
+  // quantile and exact are only used by AggregateQuantile.
   static Aggregator<T> *build(uint8_t opcode, bool limited_mem,
-                              FarMemManager *manager);
+                              FarMemManager *manager, double quantile = 0.5,
+                              bool exact = false);
 };
 
 } // namespace far_memory
@@ -1,9 +1,13 @@
 #pragma once
 
+#include "advice.hpp"
 #include "deref_scope.hpp"
+#include "helpers.hpp"
+#include "object.hpp"
 #include "pointer.hpp"
 #include "prefetcher.hpp"
 
+#include <algorithm>
 #include <cstdint>
 #include <limits>
 #include <memory>
@@ -41,6 +45,14 @@ protected:
   Prefetcher<decltype(kInduceFn), decltype(kInferFn), decltype(kMappingFn)>
       prefetcher_;
 
+  // About kPreferredChunkSize bytes' worth of elements of type T, rounded up
+  // to a power of two as DataFrameVector does.
+  template <typename T> static constexpr uint32_t packed_chunk_num_entries() {
+    constexpr uint32_t kPreferredChunkSize = 4096;
+    return helpers::round_up_power_of_two(
+        std::max(static_cast<uint64_t>(1), kPreferredChunkSize / sizeof(T)));
+  }
+
   GenericArray(FarMemManager *manager, uint32_t item_size, uint64_t num_items);
   ~GenericArray();
   NOT_COPYABLE(GenericArray);
@@ -50,20 +62,23 @@ public:
   void disable_prefetch();
   void enable_prefetch();
   void static_prefetch(Index_t start, Index_t step, uint32_t num);
+  // Applies the Advice flags to the flat indices [start, start + num).
+  void advise(Index_t start, Index_t num, uint32_t advice);
   GenericUniquePtr *at(bool nt, Index_t idx);
 };
 
-template <typename T, uint64_t... Dims> class Array : public GenericArray {
+// The indexing and accessors shared by Array and PackedArray, which store
+// ChunkNumEntries elements per far-memory object. The prefetcher works on
+// chunk indices.
+template <typename T, uint32_t ChunkNumEntries, uint64_t... Dims>
+class ChunkedArray : public GenericArray {
 private:
   using num_dim_t = uint8_t;
   static_assert(std::numeric_limits<num_dim_t>::max() >= sizeof...(Dims));
 
-  friend class FarMemManager;
-  friend class FarMemTest;
-
-  Array(FarMemManager *manager);
-  NOT_COPYABLE(Array);
-  NOT_MOVEABLE(Array);
+  // The last chunk traced, so that the prefetcher sees one trace per chunk
+  // rather than a run of zero strides.
+  Index_t last_traced_chunk_idx_ = std::numeric_limits<Index_t>::max();
 
   template <auto DimIdx> static constexpr uint64_t get_dim_size();
 
@@ -74,8 +89,21 @@ private:
     return N * _size(rest_dims...);
   }
 
+  GenericUniquePtr *chunk_at(bool nt, Index_t chunk_idx);
+
+protected:
+  ChunkedArray(FarMemManager *manager);
+  NOT_COPYABLE(ChunkedArray);
+  NOT_MOVEABLE(ChunkedArray);
+
 public:
   static constexpr uint64_t kSize = _size(Dims...);
+  constexpr static uint32_t kChunkNumEntries = ChunkNumEntries;
+  static_assert(kChunkNumEntries >= 1);
+  constexpr static uint32_t kChunkSize = sizeof(T) * kChunkNumEntries;
+  static_assert(kChunkSize <= Object::kMaxObjectDataSize);
+  static constexpr uint64_t kNumChunks =
+      (kSize + kChunkNumEntries - 1) / kChunkNumEntries;
 
   template <auto DimIdx, typename... Indices>
   static constexpr int64_t _get_flat_idx(Indices... indices);
@@ -97,9 +125,42 @@ public:
   void write(U &&u, Indices... indices);
   template <bool Nt = false, typename U, typename... Indices>
   void write_safe(U &&u, Indices... indices);
+  // In elements; prefetches the chunks covering them.
   template <typename... ArgsStart, typename... ArgsStep>
   void static_prefetch(std::tuple<ArgsStart...> start,
                        std::tuple<ArgsStep...> step, uint32_t num);
+  // Applies the Advice flags to the chunks covering the flat element indices
+  // [start, start + num).
+  void advise(Index_t start, Index_t num, uint32_t advice);
+};
+
+// One element per far-memory object.
+template <typename T, uint64_t... Dims>
+class Array : public ChunkedArray<T, 1, Dims...> {
+private:
+  friend class FarMemManager;
+  friend class FarMemTest;
+
+  Array(FarMemManager *manager);
+  NOT_COPYABLE(Array);
+  NOT_MOVEABLE(Array);
+};
+
+// An Array variant that packs kChunkNumEntries elements into each far-memory
+// object, with the chunk size picked from sizeof(T). For small element types,
+// it amortizes the per-object pointer, header and object ID, and turns
+// per-element misses into per-chunk ones.
+template <typename T, uint64_t... Dims>
+class PackedArray
+    : public ChunkedArray<T, GenericArray::packed_chunk_num_entries<T>(),
+                          Dims...> {
+private:
+  friend class FarMemManager;
+  friend class FarMemTest;
+
+  PackedArray(FarMemManager *manager);
+  NOT_COPYABLE(PackedArray);
+  NOT_MOVEABLE(PackedArray);
 };
 
 } // namespace far_memory
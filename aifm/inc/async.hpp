@@ -0,0 +1,181 @@
+#pragma once
+
+#if !__has_include(<coroutine>)
+#error "async.hpp requires C++20 coroutines (GCC >= 10 with -fcoroutines)."
+#endif
+
+#include "sync.h"
+
+#include "concurrent_hopscotch.hpp"
+#include "deref_scope.hpp"
+#include "device.hpp"
+#include "helpers.hpp"
+#include "manager.hpp"
+#include "pointer.hpp"
+
+#include <coroutine>
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <utility>
+#include <vector>
+
+// Asynchronous dereferences built on C++20 coroutines. A single uthread runs
+// an AsyncExecutor that interleaves many coroutines. A coroutine that misses
+// in the local cache sends the read through FarMemDevice::read_object_async()
+// and is suspended until the device completes it, so one uthread keeps many
+// misses in flight instead of blocking on each of them, and no thread is
+// parked per miss. The reads bypass the IOScheduler: they are pipelined on
+// connections of their own rather than holding one of its slots each.
+//
+//   Task<uint64_t> sum(const DerefScope &scope, UniquePtr<Node> *ptr) {
+//     auto *node = co_await ptr->deref_async(scope);
+//     co_return node->val;
+//   }
+//
+//   AsyncExecutor executor;
+//   for (...)
+//     executor.spawn(visit(executor.scope(), ...));
+//   executor.run();
+//
+// The executor enters its DerefScope while resuming coroutines and exits it
+// whenever it blocks, so the GC is never stalled by a suspended coroutine.
+// Hence a raw pointer obtained from a dereference is only valid until the
+// next co_await.
+
+namespace far_memory {
+
+class AsyncExecutor;
+
+namespace internal {
+
+struct PromiseBase {
+  AsyncExecutor *executor = nullptr;
+  std::coroutine_handle<> continuation;
+
+  struct FinalAwaiter {
+    bool await_ready() noexcept { return false; }
+    template <typename P>
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<P> h) noexcept;
+    void await_resume() noexcept {}
+  };
+
+  std::suspend_always initial_suspend() noexcept { return {}; }
+  FinalAwaiter final_suspend() noexcept { return {}; }
+  void unhandled_exception() { BUG(); }
+};
+
+template <typename T> struct Promise : public PromiseBase {
+  std::optional<T> value;
+
+  void return_value(T t) { value.emplace(std::move(t)); }
+};
+
+template <> struct Promise<void> : public PromiseBase {
+  void return_void() {}
+};
+
+} // namespace internal
+
+// A lazily started coroutine. co_await'ing it runs it on the executor of the
+// awaiting coroutine and resumes the latter once it finishes.
+template <typename T = void> class Task {
+public:
+  struct promise_type : public internal::Promise<T> {
+    Task get_return_object();
+  };
+
+private:
+  std::coroutine_handle<promise_type> handle_;
+  friend class AsyncExecutor;
+
+  Task(std::coroutine_handle<promise_type> handle);
+
+public:
+  Task(Task &&other);
+  ~Task();
+  NOT_COPYABLE(Task);
+  bool await_ready() const noexcept { return false; }
+  template <typename P>
+  std::coroutine_handle<> await_suspend(std::coroutine_handle<P> awaiter);
+  T await_resume();
+};
+
+class AsyncExecutor {
+private:
+  constexpr static uint32_t kMaxNumResumesPerScope = 1024;
+
+  // Touched by the uthread that invokes run() only.
+  std::deque<std::coroutine_handle<>> ready_;
+  std::vector<std::coroutine_handle<>> resumed_;
+  uint64_t num_live_roots_ = 0;
+  // Constructed while the coroutines run and destructed before blocking.
+  alignas(DerefScope) uint8_t scope_buf_[sizeof(DerefScope)];
+  // Filled by the device threads.
+  rt::Spin spin_;
+  rt::CondVar cv_;
+  std::vector<std::coroutine_handle<>> completed_;
+
+  friend struct internal::PromiseBase;
+
+  void resume_batch();
+
+public:
+  AsyncExecutor();
+  ~AsyncExecutor();
+  NOT_COPYABLE(AsyncExecutor);
+  NOT_MOVEABLE(AsyncExecutor);
+  // The scope to pass to the coroutines; it is entered whenever they run.
+  const DerefScope &scope() const;
+  void spawn(Task<void> &&task);
+  // Runs until all spawned tasks finish.
+  void run();
+  // Invoked by the device when the I/O a coroutine waits for completes.
+  void complete(std::coroutine_handle<> handle);
+};
+
+// Returned by UniquePtr<T>::deref_async() and deref_mut_async(). On a miss the
+// object is swapped in by FarMemManager::swap_in_async().
+template <typename T, bool Mut, bool Nt> class DerefAwaiter {
+private:
+  GenericUniquePtr *ptr_;
+  AsyncExecutor *executor_;
+  std::coroutine_handle<> awaiter_;
+  AsyncSwapIn swap_in_;
+
+  static void swapped_in_fn(void *arg);
+
+public:
+  DerefAwaiter(GenericUniquePtr *ptr);
+  bool await_ready();
+  template <typename P> bool await_suspend(std::coroutine_handle<P> awaiter);
+  T *await_resume();
+};
+
+// Returned by GenericConcurrentHopscotch::get_async(). A key that is not
+// cached locally is read from the remote side, and cached once the coroutine
+// resumes.
+class GetAwaiter {
+private:
+  GenericConcurrentHopscotch *hopscotch_;
+  uint8_t key_len_;
+  const uint8_t *key_;
+  uint16_t *val_len_;
+  uint8_t *val_;
+  AsyncExecutor *executor_;
+  std::coroutine_handle<> awaiter_;
+  bool forwarded_ = false;
+
+  static void forwarded_fn(void *arg);
+
+public:
+  GetAwaiter(GenericConcurrentHopscotch *hopscotch, uint8_t key_len,
+             const uint8_t *key, uint16_t *val_len, uint8_t *val);
+  bool await_ready();
+  template <typename P> bool await_suspend(std::coroutine_handle<P> awaiter);
+  void await_resume();
+};
+
+} // namespace far_memory
+
+#include "internal/async.ipp"
@@ -0,0 +1,137 @@
+#pragma once
+
+#include "dataframe_vector.hpp"
+#include "deref_scope.hpp"
+#include "helpers.hpp"
+#include "object.hpp"
+#include "optimistic_lock.hpp"
+#include "pointer.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+namespace far_memory {
+
+// An ordered far-memory index. The inner nodes and a small descriptor per
+// leaf live in local memory, so a lookup only touches far memory at the
+// leaf, whose entries form a single far-memory object of about a chunk.
+// Duplicate keys are allowed, which suits, e.g., time-series indices.
+//
+// Concurrency follows optimistic lock coupling: readers never write to
+// shared state and validate the versions of the nodes they read, and writers
+// only lock the nodes they modify. Leaves are never merged or freed before
+// the tree is destructed, which lets scans walk the leaf chain lock-free.
+template <typename K, typename V> class BPlusTree {
+private:
+  static_assert(std::is_trivially_copyable_v<K>);
+  static_assert(std::is_trivially_copyable_v<V>);
+
+  constexpr static uint32_t kPreferredLeafSize = 4096;
+  constexpr static uint32_t kLeafCapacity =
+      kPreferredLeafSize / (sizeof(K) + sizeof(V));
+  static_assert(kLeafCapacity >= 4);
+  constexpr static uint32_t kInnerFanout = 64;
+  constexpr static uint32_t kMaxScanPrefetchDepth = 16;
+  constexpr static double kDefaultFillFactor = 0.9;
+  constexpr static uint32_t kNumLeavesPerLoadBatch = 64;
+
+  // The far-memory part of a leaf. The number of entries is kept locally.
+  struct LeafData {
+    K keys[kLeafCapacity];
+    V vals[kLeafCapacity];
+  };
+  static_assert(sizeof(LeafData) <= Object::kMaxObjectDataSize);
+
+  struct Node {
+    OptimisticLock lock;
+    bool is_leaf;
+
+    Node(bool leaf);
+  };
+
+  struct InnerNode : public Node {
+    uint32_t num_keys = 0;
+    // keys[i] is the upper bound of the keys in children[i]. The last child
+    // is unbounded.
+    K keys[kInnerFanout - 1];
+    // Zeroed, as the descent may read a child before validating the node.
+    Node *children[kInnerFanout] = {};
+
+    InnerNode();
+    bool is_full() const;
+    // The index of the leftmost child that may hold key.
+    uint32_t lower_bound(const K &key) const;
+    InnerNode *split(K *separator);
+    // Inserts right after children[pos], which got split at separator.
+    void insert_at(uint32_t pos, const K &separator, Node *right);
+  };
+
+  struct LeafNode : public Node {
+    uint32_t num_entries = 0;
+    std::atomic<LeafNode *> next{nullptr};
+    // Set while the prefetch service swaps the leaf in.
+    bool inflight = false;
+    GenericUniquePtr ptr;
+
+    LeafNode();
+  };
+
+  std::atomic<Node *> root_;
+  LeafNode *head_;
+  std::atomic<uint64_t> size_{0};
+  friend class FarMemTest;
+
+  static bool is_equal(const K &a, const K &b);
+  static uint32_t lower_bound(const K *keys, uint32_t num, const K &key);
+  static uint32_t upper_bound(const K *keys, uint32_t num, const K &key);
+  static LeafNode *allocate_leaf();
+  static K split_leaf(const DerefScope &scope, LeafNode *leaf,
+                      LeafNode *right);
+  void make_root(const K &separator, Node *left, Node *right);
+  LeafNode *find_leaf(const K &key);
+  void prefetch_leaves(LeafNode *leaf, LeafNode **cursor,
+                       uint32_t *num_ahead, uint32_t window);
+  template <bool Renew, typename Fn>
+  void _scan(const DerefScope &scope, const K &lo, const K &hi, Fn &&fn);
+  template <typename ReadValsFn>
+  void _bulk_load(DataFrameVector<K> &keys, ReadValsFn &&read_vals,
+                  double fill_factor);
+  void destroy(Node *node);
+
+public:
+  BPlusTree();
+  ~BPlusTree();
+  NOT_COPYABLE(BPlusTree);
+  NOT_MOVEABLE(BPlusTree);
+
+  uint64_t size() const;
+  bool empty() const;
+  // The order among entries with equal keys is unspecified.
+  void insert(const DerefScope &scope, const K &key, const V &val);
+  // Finds the first entry of key.
+  bool find(const DerefScope &scope, const K &key, V *val);
+  // Removes the first entry of key.
+  bool remove(const DerefScope &scope, const K &key);
+  // Invokes fn(key, val) on the entries within [lo, hi] in key order until
+  // it returns false. The scope is renewed in between the leaves, which are
+  // prefetched ahead of the scan. Each leaf is read atomically, while the
+  // scan as a whole is not: it sees every entry that exists throughout the
+  // scan exactly once.
+  template <typename Fn>
+  void scan(DerefScope &scope, const K &lo, const K &hi, Fn &&fn);
+  // Builds the tree from keys sorted in the ascending order, with either the
+  // matching values or the row indices (for an integral V) as the values.
+  // Leaves are filled up to fill_factor to absorb later inserts. The tree
+  // must be empty, and it must be invoked out of any DerefScope and not
+  // concurrently with other operations.
+  void bulk_load(DataFrameVector<K> &keys, DataFrameVector<V> &vals,
+                 double fill_factor = kDefaultFillFactor);
+  void bulk_load(DataFrameVector<K> &keys,
+                 double fill_factor = kDefaultFillFactor);
+};
+
+} // namespace far_memory
+
+#include "internal/bplus_tree.ipp"
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "deref_scope.hpp"
+#include "helpers.hpp"
+#include "pointer.hpp"
+
+#include <cstdint>
+#include <type_traits>
+
+namespace far_memory {
+
+// The fast iterator of the chunked far-memory vectors, i.e., DataFrameVector
+// and FarVector. Vec keeps ChunkNumEntries elements of T per chunk in its
+// chunk_ptrs_, and has the chunk accesses traced by prefetch_record().
+//
+// Not STL compatible, but faster. Its lifetime is bound to the DerefScope that
+// is used to create the iterator. It amortizes the GC sync overhead with the
+// chunk size.
+template <typename Vec, typename T, uint32_t ChunkNumEntries, bool Mut>
+class ChunkedFastIterator {
+private:
+  using Elem_t = std::conditional<Mut, T, const T>::type;
+
+  DerefScope *scope_;
+  GenericUniquePtr *chunk_ptr_;
+  Vec *vec_;
+  Elem_t *data_ptr_;
+  Elem_t *data_ptr_begin_;
+  Elem_t *data_ptr_end_;
+  friend Vec;
+
+  template <bool Nt = false>
+  ChunkedFastIterator(DerefScope &scope,
+                      std::conditional<Mut, Vec *, const Vec *>::type vec,
+                      uint64_t idx);
+  template <bool Nt> void update_on_new_chunk();
+
+public:
+  using difference_type = int64_t;
+
+  uint64_t get_idx() const;
+  template <bool Nt = false> ChunkedFastIterator &operator++();
+  template <bool Nt = false> ChunkedFastIterator operator++(int);
+  template <bool Nt = false> ChunkedFastIterator &operator--();
+  template <bool Nt = false> ChunkedFastIterator operator--(int);
+  template <bool Nt = false>
+  ChunkedFastIterator &operator+=(difference_type dis);
+  template <bool Nt = false>
+  ChunkedFastIterator operator+(difference_type dis) const;
+  bool operator==(const ChunkedFastIterator &other) const;
+  bool operator!=(const ChunkedFastIterator &other) const;
+  bool operator<(const ChunkedFastIterator &other) const;
+  bool operator<=(const ChunkedFastIterator &other) const;
+  bool operator>(const ChunkedFastIterator &other) const;
+  bool operator>=(const ChunkedFastIterator &other) const;
+  // Renew the iterator. Its lifetime is bound to the argument scope.
+  template <bool Nt = false> void renew(DerefScope &scope);
+  Elem_t &operator*() const;
+  Elem_t *operator->() const;
+};
+
+} // namespace far_memory
+
+#include "internal/chunked_iterator.ipp"
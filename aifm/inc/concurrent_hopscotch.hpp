@@ -3,16 +3,22 @@
 #include "sync.h"
 
 #include "cb.hpp"
+#include "counting_bloom_filter.hpp"
 #include "deref_scope.hpp"
+#include "frequency_sketch.hpp"
 #include "helpers.hpp"
 #include "pointer.hpp"
 
 #include <cstdint>
 #include <memory>
 #include <optional>
+#include <string>
+#include <string_view>
 
 namespace far_memory {
 
+class GetAwaiter;
+
 class GenericConcurrentHopscotch {
 private:
   struct BucketEntry {
@@ -46,28 +52,46 @@ private:
   uint8_t ds_id_;
   CircularBuffer<EvacNotifierMeta, /* Sync = */ true, kEvacNotifierStashSize>
       evac_notifier_stash_;
+  // Null if every fetched value is cached.
+  std::unique_ptr<FrequencySketch> admission_filter_;
+  // Null if every local miss goes to the remote side.
+  std::unique_ptr<CountingBloomFilter> negative_filter_;
+  // Empty for the unnamed tables, see FarMemManager.
+  std::string name_;
+  bool persistent_ = true;
+  bool attached_ = false;
+  // The size tracked by ConcurrentHopscotch, kept across sessions.
+  int64_t persisted_size_ = 0;
 
   friend class FarMemTest;
   friend class FarMemManager;
+  friend class GetAwaiter;
   template <typename K, typename V> friend class ConcurrentHopscotch;
 
   GenericConcurrentHopscotch(uint8_t ds_id, uint32_t local_num_entries_shift,
                              uint32_t remote_num_entries_shift,
-                             uint64_t remote_data_size);
+                             uint64_t remote_data_size,
+                             std::string_view name = {});
   NOT_COPYABLE(GenericConcurrentHopscotch);
   NOT_MOVEABLE(GenericConcurrentHopscotch);
   bool __get(uint8_t key_len, const uint8_t *key, uint16_t *val_len,
              uint8_t *val);
   void forward_get(uint8_t key_len, const uint8_t *key, uint16_t *val_len,
                    uint8_t *val);
+  // The two halves of forward_get() around the remote read.
+  bool may_exist_remotely(uint8_t key_len, const uint8_t *key);
+  void cache_forwarded(uint8_t key_len, const uint8_t *key, uint16_t val_len,
+                       const uint8_t *val);
   void _get(uint8_t key_len, const uint8_t *key, uint16_t *val_len,
             uint8_t *val, bool *forwarded);
   bool _put(uint8_t key_len, const uint8_t *key, uint16_t val_len,
             const uint8_t *val, bool swap_in);
   bool _remove(uint8_t key_len, const uint8_t *key);
+  bool admit(uint32_t hash);
   void process_evac_notifier_stash();
   void do_evac_notifier(EvacNotifierMeta meta);
   void evac_notifier(Object object);
+  void detach();
 
 public:
   constexpr static uint32_t kMetadataSize = sizeof(EvacNotifierMeta);
@@ -77,12 +101,35 @@ public:
            uint16_t *val_len, uint8_t *val);
   void get_tp(uint8_t key_len, const uint8_t *key, uint16_t *val_len,
               uint8_t *val);
+  // Awaitable version of get(), see async.hpp.
+  GetAwaiter get_async(const DerefScope &scope, uint8_t key_len,
+                       const uint8_t *key, uint16_t *val_len, uint8_t *val);
   bool put(const DerefScope &scope, uint8_t key_len, const uint8_t *key,
            uint16_t val_len, const uint8_t *val);
   bool put_tp(uint8_t key_len, const uint8_t *key, uint16_t val_len,
               const uint8_t *val);
   bool remove(const DerefScope &scope, uint8_t key_len, const uint8_t *key);
   bool remove_tp(uint8_t key_len, const uint8_t *key);
+  // With the admission filter, which counts the recent lookups of every key, a
+  // value fetched from the remote side is only cached locally if its key is
+  // looked up more often than the coldest key cached in the same bucket, which
+  // it would compete with (TinyLFU); otherwise it is just returned in the
+  // caller's buffer. This keeps one-off scans from flushing the hot keys.
+  // Sized for num_cached_keys, the number of values the local cache holds; 0
+  // disables it. Must not race with other operations.
+  void set_admission_filter(uint64_t num_cached_keys);
+  // With the negative filter, which tracks all the keys ever put and not yet
+  // removed, a local miss on a key that is definitely absent returns without
+  // the remote round trip. Sized for expected_num_keys keys; 0 disables it.
+  // Must be invoked before the first put(), and not on attached tables.
+  void set_negative_filter(uint64_t expected_num_keys);
+  // Whether the named table was reattached rather than newly constructed. Its
+  // local buckets start out empty and get refilled by the misses.
+  bool is_attached() const;
+  // Whether the named table is detached, rather than destructed, on
+  // destruction, which is the default. Detaching writes back the dirty local
+  // entries first.
+  void set_persistent(bool persistent);
 };
 
 template <typename K, typename V>
@@ -97,11 +144,12 @@ private:
   bool _erase(const K &key);
   ConcurrentHopscotch(uint8_t ds_id, uint32_t local_num_entries_shift,
                       uint32_t remote_num_entries_shift,
-                      uint64_t remote_data_size);
+                      uint64_t remote_data_size, std::string_view name = {});
   NOT_COPYABLE(ConcurrentHopscotch);
   NOT_MOVEABLE(ConcurrentHopscotch);
 
 public:
+  ~ConcurrentHopscotch();
   bool empty() const;
   uint64_t size() const;
   std::optional<V> find(const DerefScope &scope, const K &key);
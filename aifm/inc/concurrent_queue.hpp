@@ -0,0 +1,99 @@
+#pragma once
+
+#include "sync.h"
+
+#include "deref_scope.hpp"
+#include "helpers.hpp"
+#include "pointer.hpp"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace far_memory {
+
+// A multi-producer/multi-consumer queue of fixed-size items, stored as a
+// linked list of far-memory segments. Producers serialize on the tail lock
+// and consumers on the head lock, so the two ends never contend with each
+// other. The head and tail segments are pinned locally; the interior ones
+// spill to far memory as whole objects. Driven by the queue depth, a
+// producer evicts the segment it seals once the queue is deep enough, and a
+// consumer moving to a new head segment fetches the next few ahead of time.
+class GenericConcurrentQueue {
+private:
+  struct Segment {
+    GenericUniquePtr ptr;
+    Segment *next = nullptr;
+    // Only the tail lock holder writes it, published with release semantics.
+    uint32_t num_pushed = 0;
+    // Guarded by the head lock.
+    uint32_t num_popped = 0;
+    // Set while a fetch-ahead or a spill of ptr is in flight.
+    bool inflight = false;
+  };
+
+  constexpr static uint32_t kDefaultSegmentSize = 16384;
+  constexpr static uint32_t kMaxNumFetchAheadSegments = 4;
+  // The depth, in segments, beyond which the sealed segments are evicted.
+  constexpr static uint32_t kSpillAheadDepth = 2 * kMaxNumFetchAheadSegments;
+
+  const uint16_t kItemSize_;
+  const uint32_t kNumItemsPerSegment_;
+  // The seqs and counters are written by their lock holder only and read
+  // without a lock by size() and depth().
+  alignas(64) rt::Spin head_spin_;
+  Segment *head_;
+  uint64_t head_seq_ = 0;
+  uint64_t num_popped_ = 0;
+  alignas(64) rt::Spin tail_spin_;
+  Segment *tail_;
+  uint64_t tail_seq_ = 0;
+  uint64_t num_pushed_ = 0;
+
+  template <typename T> friend class ConcurrentQueue;
+  friend class FarMemTest;
+
+  GenericConcurrentQueue(const DerefScope &scope, uint16_t item_size,
+                         uint32_t num_items_per_segment);
+  NOT_COPYABLE(GenericConcurrentQueue);
+  NOT_MOVEABLE(GenericConcurrentQueue);
+  Segment *allocate_segment(const DerefScope &scope);
+  void free_segment(Segment *segment);
+  static void pin(const DerefScope &scope, Segment *segment);
+  static void unpin(Segment *segment);
+  static bool try_set_inflight(Segment *segment);
+  static void spill_fn(void *arg);
+  void seal(const DerefScope &scope, Segment *segment);
+  void fetch_ahead(Segment *segment);
+  uint64_t depth() const;
+
+public:
+  ~GenericConcurrentQueue();
+  uint64_t size() const;
+  bool empty() const;
+  void push_n(const DerefScope &scope, const uint8_t *items, uint32_t num);
+  // Pops up to num items. Returns the number of popped ones, which is less
+  // than num only if the queue runs empty.
+  uint32_t pop_n(const DerefScope &scope, uint8_t *items, uint32_t num);
+};
+
+template <typename T> class ConcurrentQueue : public GenericConcurrentQueue {
+private:
+  constexpr static uint32_t kNumItemsPerSegment =
+      std::max(static_cast<uint32_t>(1),
+               static_cast<uint32_t>(kDefaultSegmentSize / sizeof(T)));
+  static_assert(sizeof(T) * kNumItemsPerSegment <= Object::kMaxObjectDataSize);
+
+  ConcurrentQueue(const DerefScope &scope);
+  friend class FarMemManager;
+
+public:
+  void push(const DerefScope &scope, const T &item);
+  void push_n(const DerefScope &scope, const T *items, uint32_t num);
+  // Returns false if the queue is empty.
+  bool pop(const DerefScope &scope, T *item);
+  uint32_t pop_n(const DerefScope &scope, T *items, uint32_t num);
+};
+
+} // namespace far_memory
+
+#include "internal/concurrent_queue.ipp"
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "helpers.hpp"
+
+#include <cstdint>
+#include <memory>
+
+namespace far_memory {
+
+// A blocked counting Bloom filter: all the kNumHashes counters of a key live
+// in one cacheline-sized block, so a query costs a single cache miss. The
+// 8-bit counters support deletions; a saturated counter sticks, trading a
+// few false positives for never producing a false negative. All updates are
+// atomic, so there is no external locking.
+class CountingBloomFilter {
+private:
+  constexpr static uint32_t kBlockSize = 64;
+  constexpr static uint32_t kNumHashes = 4;
+  // About 3% false positives for the blocked layout.
+  constexpr static uint32_t kNumCountersPerKey = 10;
+  constexpr static uint64_t kBlockSeed = 0x9E3779B97F4A7C15ULL;
+  constexpr static uint64_t kOffsetSeed = 0xC2B2AE3D27D4EB4FULL;
+
+  uint32_t num_blocks_shift_;
+  std::unique_ptr<uint8_t[]> counters_mem_;
+  uint8_t *counters_; // Aligned to kBlockSize.
+
+  uint8_t *block(uint32_t hash) const;
+  uint32_t offset(uint32_t hash, uint32_t i) const;
+
+public:
+  CountingBloomFilter(uint64_t expected_num_keys);
+  NOT_COPYABLE(CountingBloomFilter);
+  NOT_MOVEABLE(CountingBloomFilter);
+  void add(uint32_t hash);
+  // The key must have been added.
+  void remove(uint32_t hash);
+  bool may_contain(uint32_t hash) const;
+};
+
+} // namespace far_memory
+
+#include "internal/counting_bloom_filter.ipp"
@@ -1,8 +1,11 @@
 #pragma once
 
+#include "chunked_iterator.hpp"
 #include "dataframe_vector.hpp"
 #include "deref_scope.hpp"
 #include "device.hpp"
+#include "groupby.hpp"
+#include "hash_join.hpp"
 #include "helpers.hpp"
 #include "internal/dataframe_types.hpp"
 #include "pointer.hpp"
@@ -12,6 +15,9 @@
 #include <cstdint>
 #include <memory>
 #include <optional>
+#include <span>
+#include <string>
+#include <string_view>
 #include <type_traits>
 #include <vector>
 
@@ -45,10 +51,16 @@
 #define DISABLE_OFFLOAD_AGGREGATE 0
 #endif
 
+#ifdef DISABLE_OFFLOAD_JOIN
+#define DISABLE_OFFLOAD_JOIN 1
+#else
+#define DISABLE_OFFLOAD_JOIN 0
+#endif
+
 #define DISABLE_OFFLOAD                                                        \
   (DISABLE_OFFLOAD_UNIQUE & DISABLE_OFFLOAD_COPY_DATA_BY_IDX &                 \
    DISABLE_OFFLOAD_SHUFFLE_DATA_BY_IDX & DISABLE_OFFLOAD_ASSIGN &              \
-   DISABLE_OFFLOAD_AGGREGATE)
+   DISABLE_OFFLOAD_AGGREGATE & DISABLE_OFFLOAD_JOIN)
 
 namespace far_memory {
 
@@ -64,13 +76,29 @@ private:
     Assign,
     AggregateMax,
     AggregateMin,
-    AggregateMedian
+    AggregateMedian,
+    HashJoin,
+    HashGroup,
+    AggregateByGroup,
+    AggregateQuantile
   };
 
+#pragma pack(push, 1)
+  // What the client keeps on the remote side when detaching.
+  struct PersistedMeta {
+    uint8_t dt_id;
+    uint32_t chunk_size;
+    uint64_t size;
+    uint64_t num_chunks;
+    uint64_t remote_vec_capacity;
+  };
+#pragma pack(pop)
+
   uint32_t chunk_size_;
   uint32_t chunk_num_entries_;
   FarMemDevice *device_;
   uint8_t ds_id_;
+  uint8_t dt_id_;
   uint64_t size_ = 0;
   uint64_t remote_vec_capacity_ = 0;
   ReaderWriterLock lock_;
@@ -78,17 +106,27 @@ private:
   bool moved_ = false;
   bool dirty_ = false;
   uint64_t last_idx_ = std::numeric_limits<uint64_t>::max();
+  // Empty for the unnamed vectors, see FarMemManager.
+  std::string name_;
+  bool persistent_ = true;
+  bool attached_ = false;
   template <typename T> friend class DataFrameVector;
   template <typename T> friend class ServerDataFrameVector;
+  template <typename V, typename U, uint32_t N, bool M>
+  friend class ChunkedFastIterator;
 
   void expand(uint64_t num);
   void expand_no_alloc(uint64_t num);
   void reserve_remote(uint64_t num);
+  void swap_in_chunks(uint64_t begin, uint64_t end);
   void cleanup();
+  void attach();
+  void detach();
 
 public:
   GenericDataFrameVector(const uint32_t chunk_size, uint32_t chunk_num_entries,
-                         uint8_t ds_id, uint8_t dt_id);
+                         uint8_t ds_id, uint8_t dt_id,
+                         std::string_view name = {});
   NOT_COPYABLE(GenericDataFrameVector);
   GenericDataFrameVector(GenericDataFrameVector &&other);
   GenericDataFrameVector &operator=(GenericDataFrameVector &&other);
@@ -98,6 +136,13 @@ public:
   uint64_t size() const;
   void clear();
   void flush();
+  // Whether the named vector was reattached rather than newly constructed.
+  // Its chunks start out absent and get swapped in on demand.
+  bool is_attached() const;
+  // Whether the named vector is detached, rather than destructed, on
+  // destruction, which is the default. Detaching writes back the dirty chunks
+  // first.
+  void set_persistent(bool persistent);
 };
 
 template <typename T> class DataFrameVector : public GenericDataFrameVector {
@@ -115,6 +160,7 @@ private:
   constexpr static uint32_t kNumEntriesPerExpansion =
       (kSizePerExpansion - 1) / sizeof(T) + 1;
   constexpr static uint64_t kNumElementsPerScope = 1024;
+  constexpr static uint64_t kNumChunksPerRangeBatch = 64;
 
   static Pattern_t induce_fn(Index_t idx_0, Index_t idx_1);
   static Index_t infer_fn(Index_t idx, Pattern_t stride);
@@ -137,6 +183,7 @@ private:
   bool dynamic_prefetch_enabled_ = true;  
 
   friend class FarMemTest;
+  template <typename U> friend class DataFrameVector;
   template <typename U> friend class ServerDataFrameVector;
 
   // STL compatible, but slower (since it takes GC sync overhead per
@@ -175,49 +222,12 @@ private:
     T operator*() const;
   };
 
-  // Not STL compatible, but faster. Its lifetime is bound to the DerefScope
-  // that is used to create the iterator. It amortizes the GC sync overhead with
-  // the chunk size.
-  template <bool Mut> class FastIterator {
-  private:
-    DerefScope *scope_;
-    GenericUniquePtr *chunk_ptr_;
-    DataFrameVector *dataframe_vec_;
-    std::conditional<Mut, T *, const T *>::type data_ptr_;
-    std::conditional<Mut, T *, const T *>::type data_ptr_begin_;
-    std::conditional<Mut, T *, const T *>::type data_ptr_end_;
-    template <bool Nt = false>
-    FastIterator(DerefScope &scope,
-                 std::conditional<Mut, DataFrameVector *,
-                                  const DataFrameVector *>::type dataframe_vec,
-                 uint64_t idx);
-    friend class DataFrameVector;
-
-    uint64_t get_idx() const;
-    template <bool Nt> void update_on_new_chunk();
-
-  public:
-    using difference_type = int64_t;
-
-    template <bool Nt = false> FastIterator<Mut> &operator++();
-    template <bool Nt = false> FastIterator<Mut> operator++(int);
-    template <bool Nt = false> FastIterator<Mut> &operator--();
-    template <bool Nt = false> FastIterator<Mut> operator--(int);
-    template <bool Nt = false>
-    FastIterator<Mut> &operator+=(difference_type dis);
-    template <bool Nt = false>
-    FastIterator<Mut> operator+(difference_type dis) const;
-    bool operator==(const FastIterator &other) const;
-    bool operator!=(const FastIterator &other) const;
-    bool operator<(const FastIterator &other) const;
-    bool operator<=(const FastIterator &other) const;
-    bool operator>(const FastIterator &other) const;
-    bool operator>=(const FastIterator &other) const;
-    // Renew the iterator. Its lifetime is bound to the argument scope.
-    template <bool Nt = false> void renew(DerefScope &scope);
-    std::conditional<Mut, T &, const T &>::type operator*() const;
-    std::conditional<Mut, T *, const T *>::type operator->() const;
-  };
+  // Not STL compatible, but faster; see ChunkedFastIterator.
+  template <bool Mut>
+  using FastIterator =
+      ChunkedFastIterator<DataFrameVector, T, kRealChunkNumEntries, Mut>;
+  template <typename V, typename U, uint32_t N, bool M>
+  friend class ChunkedFastIterator;
 
   std::pair<uint64_t, uint64_t> get_chunk_stats(uint64_t index);
   void expand(uint64_t num);
@@ -229,10 +239,13 @@ private:
       DataFrameVector<unsigned long long> *indices);
   template <typename U>
   DataFrameVector<T> aggregate_locally(FarMemManager *manager, const U &key_vec,
-                                       OpCode opcode);
+                                       OpCode opcode, double quantile = 0.5,
+                                       bool exact = false);
   template <typename U>
   DataFrameVector<T> aggregate_remotely(FarMemManager *manager,
-                                        const U &key_vec, OpCode opcode);
+                                        const U &key_vec, OpCode opcode,
+                                        double quantile = 0.5,
+                                        bool exact = false);
   DataFrameVector<T> get_col_unique_values_locally(FarMemManager *manager);
   DataFrameVector<T> get_col_unique_values_remotely(FarMemManager *manager);
   DataFrameVector<T>
@@ -247,6 +260,39 @@ private:
   DataFrameVector<T>
   shuffle_data_by_idx_remotely(FarMemManager *manager,
                                DataFrameVector<unsigned long long> &idx_vec);
+  std::pair<DataFrameVector<unsigned long long>,
+            DataFrameVector<unsigned long long>>
+  hash_join_locally(FarMemManager *manager, DataFrameVector<T> &rhs,
+                    JoinType type);
+  std::pair<DataFrameVector<unsigned long long>,
+            DataFrameVector<unsigned long long>>
+  hash_join_remotely(FarMemManager *manager, DataFrameVector<T> &rhs,
+                     JoinType type);
+  std::pair<DataFrameVector<unsigned long long>,
+            DataFrameVector<unsigned long long>>
+  hash_group_locally(FarMemManager *manager,
+                     DataFrameVector<unsigned long long> *prev_group_ids);
+  std::pair<DataFrameVector<unsigned long long>,
+            DataFrameVector<unsigned long long>>
+  hash_group_remotely(FarMemManager *manager,
+                      DataFrameVector<unsigned long long> *prev_group_ids);
+  DataFrameVector<T>
+  aggregate_by_group_locally(FarMemManager *manager,
+                             DataFrameVector<unsigned long long> &group_ids,
+                             uint64_t num_groups, AggregateOp op,
+                             double q = 0, bool exact = true);
+  // U is unsigned long long for AggCount, and T otherwise. q and exact are
+  // only read by AggQuantile.
+  template <typename U>
+  DataFrameVector<U>
+  aggregate_by_group_remotely(FarMemManager *manager,
+                              DataFrameVector<unsigned long long> &group_ids,
+                              uint64_t num_groups, AggregateOp op,
+                              double q = 0, bool exact = true);
+  DataFrameVector<unsigned long long>
+  count_by_group_locally(FarMemManager *manager,
+                         DataFrameVector<unsigned long long> &group_ids,
+                         uint64_t num_groups);
   void assign_locally(const Iterator &begin, const Iterator &end);
   void assign_remotely(const Iterator &begin, const Iterator &end);
   T _nth_element(uint64_t begin, uint64_t len, uint64_t n);
@@ -254,7 +300,7 @@ private:
 public:
   using value_type = T;
 
-  DataFrameVector(FarMemManager *manager);
+  DataFrameVector(FarMemManager *manager, std::string_view name = {});
   // Copy constructor is not allowed since the new instance has to acquire a
   // new ds_id.
   DataFrameVector(const DataFrameVector &other);
@@ -266,6 +312,12 @@ public:
   uint64_t capacity() const;
   template <typename U, bool Nt = false>
   void push_back(const DerefScope &scope, U &&u);
+  // Bulk versions of push_back(), at() and at_mut(). They work chunk by chunk
+  // and must be invoked out of any DerefScope.
+  void append(const T *data, uint64_t num);
+  void append(std::span<const T> data);
+  void read_range(uint64_t begin, uint64_t num, T *out);
+  void write_range(uint64_t begin, uint64_t num, const T *in);
   void pop_back(const DerefScope &scope);
   void reserve(uint64_t count);
   void resize(uint64_t count);
@@ -294,6 +346,12 @@ public:
   DataFrameVector<T>
   shuffle_data_by_idx(FarMemManager *manager,
                       DataFrameVector<unsigned long long> &idx_vec);
+  // Equi-joins *this (lhs) with rhs and returns the (lhs, rhs) row indices of
+  // the output rows. The absent side of an outer join row is kJoinNullIdx,
+  // which copy_data_by_idx() materializes as HashJoiner<T>::null_value().
+  std::pair<DataFrameVector<unsigned long long>,
+            DataFrameVector<unsigned long long>>
+  hash_join(FarMemManager *manager, DataFrameVector<T> &rhs, JoinType type);
   void assign(const Iterator &begin, const Iterator &end);
   template <typename U>
   DataFrameVector<T> aggregate_min(FarMemManager *manager, const U &key_vec);
@@ -301,9 +359,47 @@ public:
   DataFrameVector<T> aggregate_max(FarMemManager *manager, const U &key_vec);
   template <typename U>
   DataFrameVector<T> aggregate_median(FarMemManager *manager, const U &key_vec);
+  // Computes the q-quantile (q in [0, 1]) of every run of equal keys. Unless
+  // exact is set, it uses a bounded-memory QuantileSketch per group instead of
+  // buffering the whole group, so the result is approximate for large groups.
+  template <typename U>
+  DataFrameVector<T> aggregate_quantile(FarMemManager *manager,
+                                        const U &key_vec, double q,
+                                        bool exact = false);
+  // Hash groupby, which does not require the keys to be sorted. It assigns
+  // every row a dense group id (in the order of first appearance) by its
+  // value, refined by prev_group_ids for multi-key groupbys. Returns the group
+  // ids and the index of the first row of each group, whose size is the
+  // number of groups.
+  std::pair<DataFrameVector<unsigned long long>,
+            DataFrameVector<unsigned long long>>
+  hash_group(FarMemManager *manager,
+             DataFrameVector<unsigned long long> *prev_group_ids = nullptr);
+  // Aggregates the rows into num_groups values by the group ids produced by
+  // hash_group(). AggCount and AggQuantile go through count_by_group() and
+  // quantile_by_group() instead.
+  DataFrameVector<T>
+  aggregate_by_group(FarMemManager *manager,
+                     DataFrameVector<unsigned long long> &group_ids,
+                     uint64_t num_groups, AggregateOp op);
+  // Counts the rows of each group, whatever T is.
+  DataFrameVector<unsigned long long>
+  count_by_group(FarMemManager *manager,
+                 DataFrameVector<unsigned long long> &group_ids,
+                 uint64_t num_groups);
+  // The q-quantile of each group. Unless exact, it comes from a per-group
+  // QuantileSketch in a single pass over the rows, and is within the sketch's
+  // rank error; otherwise a second pass selects it exactly.
+  DataFrameVector<T>
+  quantile_by_group(FarMemManager *manager,
+                    DataFrameVector<unsigned long long> &group_ids,
+                    uint64_t num_groups, double q, bool exact = false);
   void disable_prefetch();
   void enable_prefetch();
   void static_prefetch(Index_t start, Index_t step, uint32_t num);
+  // Applies the Advice flags to the chunks holding the elements [begin, end).
+  void advise(FarMemManager *manager, uint64_t begin, uint64_t end,
+              uint32_t advice);
   template <bool Ascending = true>
   DataFrameVector<unsigned long long>
   get_sorted_indices(FarMemManager *manager, bool already_sorted_asc);
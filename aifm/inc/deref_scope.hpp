@@ -23,6 +23,7 @@ private:
   static void mutator_wait_for_gc_cache();
   static int32_t get_num_threads(Status status);
   static bool is_status_expected();
+  static void switch_status(Status status);
 
   friend class FarMemManager;
   friend class GenericConcurrentHopscotch;
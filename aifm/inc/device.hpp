@@ -4,24 +4,55 @@ extern "C" {
 #include <runtime/tcp.h>
 }
 
+#include "sync.h"
+#include "thread.h"
+
 #include "helpers.hpp"
+#include "io_scheduler.hpp"
 #include "server.hpp"
 #include "shared_pool.hpp"
 
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
 namespace far_memory {
 
+// The completion of a request that was submitted without blocking. fn(arg)
+// runs on a thread of the device once the response is in place, so it must
+// not block.
+struct IOCompletion {
+  void (*fn)(void *arg);
+  void *arg;
+};
+
 class FarMemDevice {
 public:
   uint64_t far_mem_size_;
   uint32_t prefetch_win_size_;
+  // Null if the device has no contended resources to schedule.
+  std::unique_ptr<IOScheduler> io_scheduler_;
 
   FarMemDevice(uint64_t far_mem_size, uint32_t prefetch_win_size);
   virtual ~FarMemDevice() {}
   uint64_t get_far_mem_size() const { return far_mem_size_; }
   uint32_t get_prefetch_win_size() const { return prefetch_win_size_; }
+  // The data-plane callers (swap-in, write-back, prefetch) hold an
+  // IOAdmission of it around read_object() and write_object().
+  IOScheduler *get_io_scheduler() const { return io_scheduler_.get(); }
   virtual void read_object(uint8_t ds_id, uint8_t obj_id_len,
                            const uint8_t *obj_id, uint16_t *data_len,
                            uint8_t *data_buf) = 0;
+  // Returns once the request is sent and invokes completion once data_len
+  // and data_buf are filled in; obj_id may be reused right away, but the
+  // other buffers must live until then. By default it serves the request
+  // synchronously and completes it before returning.
+  virtual void read_object_async(uint8_t ds_id, uint8_t obj_id_len,
+                                 const uint8_t *obj_id, uint16_t *data_len,
+                                 uint8_t *data_buf, IOCompletion completion);
   virtual void write_object(uint8_t ds_id, uint8_t obj_id_len,
                             const uint8_t *obj_id, uint16_t data_len,
                             const uint8_t *data_buf) = 0;
@@ -30,6 +61,12 @@ public:
   virtual void construct(uint8_t ds_type, uint8_t ds_id, uint8_t param_len,
                          uint8_t *params) = 0;
   virtual void destruct(uint8_t ds_id) = 0;
+  // See Server::attach() and Server::detach().
+  virtual uint8_t attach(uint8_t ds_type, uint8_t ds_id, uint8_t name_len,
+                         const uint8_t *name, uint8_t param_len,
+                         uint8_t *params, uint8_t *meta_len,
+                         uint8_t *meta) = 0;
+  virtual void detach(uint8_t ds_id, uint8_t meta_len, const uint8_t *meta) = 0;
   virtual void compute(uint8_t ds_id, uint8_t opcode, uint16_t input_len,
                        const uint8_t *input_buf, uint16_t *output_len,
                        uint8_t *output_buf) = 0;
@@ -39,6 +76,7 @@ class FakeDevice : public FarMemDevice {
 private:
   constexpr static uint32_t kPrefetchWinSize = 1 << 20;
   Server server_;
+  friend class FarMemTest;
 
 public:
   FakeDevice(uint64_t far_mem_size);
@@ -51,17 +89,63 @@ public:
   void construct(uint8_t ds_type, uint8_t ds_id, uint8_t param_len,
                  uint8_t *params);
   void destruct(uint8_t ds_id);
+  uint8_t attach(uint8_t ds_type, uint8_t ds_id, uint8_t name_len,
+                 const uint8_t *name, uint8_t param_len, uint8_t *params,
+                 uint8_t *meta_len, uint8_t *meta);
+  void detach(uint8_t ds_id, uint8_t meta_len, const uint8_t *meta);
   void compute(uint8_t ds_id, uint8_t opcode, uint16_t input_len,
                const uint8_t *input_buf, uint16_t *output_len,
                uint8_t *output_buf);
 };
 
+// Thrown by the TCPDevice constructor when the memory server refuses the
+// session; status() is one of the TCPDevice::kInit* codes.
+class TCPDeviceInitError : public std::runtime_error {
+public:
+  TCPDeviceInitError(uint8_t status)
+      : std::runtime_error("TCPDevice: init refused by the memory server"),
+        status_(status) {}
+  uint8_t status() const { return status_; }
+
+private:
+  uint8_t status_;
+};
+
 class TCPDevice : public FarMemDevice {
 private:
   constexpr static uint32_t kPrefetchWinSize = 1 << 20;
+  constexpr static uint32_t kNumPipelinedConnections = 4;
+
+  struct PendingRead {
+    uint16_t *data_len;
+    uint8_t *data_buf;
+    IOCompletion completion;
+  };
+
+  // A connection that read_object_async() pipelines its requests on. The
+  // server serves a connection in order, so its receiver matches each
+  // response to the oldest pending request.
+  struct PipelinedConnection {
+    tcpconn_t *conn;
+    // Held across a send, so that pending is in the order of the requests.
+    rt::Mutex send_mutex;
+    // Never held while blocked on the connection, so that a sender waiting
+    // for the send window cannot stall the receiver.
+    rt::Mutex pending_mutex;
+    std::deque<PendingRead> pending;
+    rt::Thread receiver;
+  };
 
   tcpconn_t *remote_master_;
   SharedPool<tcpconn_t *> shared_pool_;
+  std::vector<std::unique_ptr<PipelinedConnection>> pipelined_conns_;
+  std::atomic<uint32_t> next_pipelined_conn_{0};
+
+  tcpconn_t *join(netaddr raddr, uint32_t session_id);
+  void receive_fn(PipelinedConnection *pipelined_conn);
+  static uint32_t fill_read_object_req(uint8_t *req, uint8_t ds_id,
+                                       uint8_t obj_id_len,
+                                       const uint8_t *obj_id);
 
   void _read_object(tcpconn_t *remote_slave, uint8_t ds_id, uint8_t obj_id_len,
                     const uint8_t *obj_id, uint16_t *data_len,
@@ -74,6 +158,11 @@ private:
   void _construct(tcpconn_t *remote_slave, uint8_t ds_type, uint8_t ds_id,
                   uint8_t param_len, uint8_t *params);
   void _destruct(tcpconn_t *remote_slave, uint8_t ds_id);
+  uint8_t _attach(tcpconn_t *remote_slave, uint8_t ds_type, uint8_t ds_id,
+                  uint8_t name_len, const uint8_t *name, uint8_t param_len,
+                  uint8_t *params, uint8_t *meta_len, uint8_t *meta);
+  void _detach(tcpconn_t *remote_slave, uint8_t ds_id, uint8_t meta_len,
+               const uint8_t *meta);
   void _compute(tcpconn_t *remote_slave, uint8_t ds_id, uint8_t opcode,
                 uint16_t input_len, const uint8_t *input_buf,
                 uint16_t *output_len, uint8_t *output_buf);
@@ -91,6 +180,9 @@ public:
   //     5. construct
   //     6. destruct
   //     7. compute
+  //     8. attach
+  //     9. detach
+  //     10. join
   constexpr static uint32_t kOpcodeSize = 1;
   constexpr static uint32_t kPortSize = 2;
   constexpr static uint32_t kLargeDataSize = 512;
@@ -104,17 +196,39 @@ public:
   constexpr static uint8_t kOpConstruct = 5;
   constexpr static uint8_t kOpDeconstruct = 6;
   constexpr static uint8_t kOpCompute = 7;
+  constexpr static uint8_t kOpAttach = 8;
+  constexpr static uint8_t kOpDetach = 9;
+  constexpr static uint8_t kOpJoin = 10;
+
+  // The init status.
+  constexpr static uint8_t kInitOK = 0;
+  constexpr static uint8_t kInitOverQuota = 1;
+  constexpr static uint8_t kInitTenantBusy = 2;
+  constexpr static uint8_t kInitInvalid = 3;
+  constexpr static uint8_t kInitTooManyTenants = 4;
 
-  TCPDevice(netaddr raddr, uint32_t num_connections, uint64_t far_mem_size);
+  // The memory server keeps a separate namespace (ds_ids, named DSes and far
+  // memory quota) for each tenant, which serves one client at a time. The
+  // default tenant is the empty one. Throws TCPDeviceInitError if the server
+  // refuses the session.
+  TCPDevice(netaddr raddr, uint32_t num_connections, uint64_t far_mem_size,
+            std::string_view tenant = {});
   ~TCPDevice();
   void read_object(uint8_t ds_id, uint8_t obj_id_len, const uint8_t *obj_id,
                    uint16_t *data_len, uint8_t *data_buf);
+  void read_object_async(uint8_t ds_id, uint8_t obj_id_len,
+                         const uint8_t *obj_id, uint16_t *data_len,
+                         uint8_t *data_buf, IOCompletion completion);
   void write_object(uint8_t ds_id, uint8_t obj_id_len, const uint8_t *obj_id,
                     uint16_t data_len, const uint8_t *data_buf);
   bool remove_object(uint64_t ds_id, uint8_t obj_id_len, const uint8_t *obj_id);
   void construct(uint8_t ds_type, uint8_t ds_id, uint8_t param_len,
                  uint8_t *params);
   void destruct(uint8_t ds_id);
+  uint8_t attach(uint8_t ds_type, uint8_t ds_id, uint8_t name_len,
+                 const uint8_t *name, uint8_t param_len, uint8_t *params,
+                 uint8_t *meta_len, uint8_t *meta);
+  void detach(uint8_t ds_id, uint8_t meta_len, const uint8_t *meta);
   void compute(uint8_t ds_id, uint8_t opcode, uint16_t input_len,
                const uint8_t *input_buf, uint16_t *output_len,
                uint8_t *output_buf);
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "helpers.hpp"
+#include "slab.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <limits>
+
+namespace far_memory {
+
+class EpochReclaimer;
+
+class EpochGuard {
+private:
+  EpochReclaimer &reclaimer_;
+  EpochGuard(EpochReclaimer &reclaimer);
+  friend class EpochReclaimer;
+
+public:
+  ~EpochGuard();
+  NOT_COPYABLE(EpochGuard);
+  NOT_MOVEABLE(EpochGuard);
+};
+
+// Epoch-based reclamation of memory allocated from a Slab. Lock-free
+// readers enter a critical section, within which the nodes they reach stay
+// allocated even if they get unlinked concurrently. An unlinked node is
+// retired instead of freed, and is returned to the slab once every core has
+// left the epoch it was retired in. Critical sections disable preemption,
+// so they are tracked per core and must not block.
+class EpochReclaimer {
+private:
+  constexpr static uint64_t kQuiescent = std::numeric_limits<uint64_t>::max();
+  constexpr static uint32_t kNumRetiresPerAdvance = 64;
+
+  struct Retired {
+    uint8_t *ptr;
+    uint32_t size;
+    uint64_t epoch;
+  };
+
+  struct alignas(64) CoreState {
+    std::atomic<uint64_t> epoch{kQuiescent};
+    uint32_t nesting = 0;
+    uint32_t num_retires = 0;
+    std::deque<Retired> limbo;
+  };
+
+  Slab *slab_;
+  alignas(64) std::atomic<uint64_t> global_epoch_{0};
+  CoreState core_states_[helpers::kNumCPUs];
+  friend class FarMemTest;
+
+  bool try_advance();
+  void reclaim(CoreState *state);
+
+public:
+  EpochReclaimer(Slab *slab);
+  ~EpochReclaimer();
+  NOT_COPYABLE(EpochReclaimer);
+  NOT_MOVEABLE(EpochReclaimer);
+  void enter();
+  void exit();
+  bool is_in_critical_section() const;
+  // Frees ptr back to the slab once no critical section can still reach
+  // it. Must be invoked within a critical section after ptr is unlinked.
+  void retire(uint8_t *ptr, uint32_t size);
+  EpochGuard get_guard();
+};
+
+} // namespace far_memory
+
+#include "internal/epoch.ipp"
@@ -0,0 +1,186 @@
+#pragma once
+
+#include "chunked_iterator.hpp"
+#include "deref_scope.hpp"
+#include "device.hpp"
+#include "helpers.hpp"
+#include "object.hpp"
+#include "pointer.hpp"
+#include "prefetcher.hpp"
+#include "reader_writer_lock.hpp"
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+namespace far_memory {
+
+class FarMemManager;
+
+// The type-erased part of FarVector, which works on bytes so that it is
+// shared by all element types. The elements are stored in fixed-size chunks,
+// each of which is a far-memory object. By default the chunks are vanilla
+// objects; an offloaded vector instead keeps its chunks in a ServerFarVector
+// under its own ds_id (with the chunk index as the object id), which lets the
+// server copy and assign ranges without moving them through the client.
+class GenericFarVector {
+private:
+  enum OpCode { Reserve = 0, Assign };
+
+  constexpr static uint64_t kNumChunksPerRangeBatch = 64;
+  constexpr static uint64_t kMinSizePerExpansion = 4 << 20;  // 4 MiB.
+  constexpr static uint64_t kMaxSizePerExpansion = 64 << 20; // 64 MiB.
+
+  uint32_t chunk_size_;
+  uint32_t chunk_num_entries_;
+  uint32_t item_size_;
+  FarMemDevice *device_;
+  uint8_t ds_id_;
+  bool offloaded_;
+  uint64_t size_ = 0;
+  uint64_t remote_capacity_ = 0;
+  ReaderWriterLock lock_;
+  std::vector<GenericUniquePtr> chunk_ptrs_;
+  bool moved_ = false;
+  bool dirty_ = false;
+  uint64_t last_chunk_idx_ = std::numeric_limits<uint64_t>::max();
+  template <typename T> friend class FarVector;
+  template <typename V, typename U, uint32_t N, bool M>
+  friend class ChunkedFastIterator;
+  friend class ServerFarVector;
+  friend class FarMemTest;
+
+  void expand(uint64_t num);
+  void expand_no_alloc(uint64_t num);
+  void grow();
+  void reserve_remote(uint64_t num);
+  void swap_in_chunks(uint64_t begin, uint64_t end);
+  void free_chunks();
+  void cleanup();
+  void read_range(uint64_t begin, uint64_t num, uint8_t *out);
+  void write_range(uint64_t begin, uint64_t num, const uint8_t *in);
+  void assign_locally(GenericFarVector *other, uint64_t begin, uint64_t end);
+  void assign_remotely(GenericFarVector *other, uint64_t begin, uint64_t end);
+  void assign(GenericFarVector *other, uint64_t begin, uint64_t end);
+  GenericUniquePtr *get_chunk_ptr(uint64_t chunk_idx);
+
+public:
+  GenericFarVector(uint32_t chunk_size, uint32_t chunk_num_entries,
+                   uint8_t ds_id, bool offloaded);
+  NOT_COPYABLE(GenericFarVector);
+  GenericFarVector(GenericFarVector &&other);
+  GenericFarVector &operator=(GenericFarVector &&other);
+  ~GenericFarVector();
+
+  bool empty() const;
+  uint64_t size() const;
+  uint64_t capacity() const;
+  bool is_offloaded() const;
+  void clear();
+  void reserve(uint64_t count);
+  // The new elements are uninitialized.
+  void resize(uint64_t count);
+  // Writes the dirty chunks back to the server. Only needed by offloaded
+  // vectors, whose server-side copies must be up to date before compute().
+  void flush();
+};
+
+// A growable far-memory vector of any trivially copyable type, e.g., the
+// structs that DataFrameVector does not take. Elements are packed into
+// chunks of about kPreferredChunkSize bytes. Unless the vector is offloaded,
+// it needs no server-side support.
+template <typename T> class FarVector : public GenericFarVector {
+private:
+  static_assert(std::is_trivially_copyable_v<T>);
+  using Index_t = uint64_t;
+  using Pattern_t = int64_t;
+
+  constexpr static uint32_t kPreferredChunkSize = 4096;
+  constexpr static uint32_t kChunkNumEntries =
+      std::max(static_cast<uint32_t>(1),
+               helpers::round_up_power_of_two(kPreferredChunkSize / sizeof(T)));
+  constexpr static uint32_t kChunkSize = sizeof(T) * kChunkNumEntries;
+  static_assert(kChunkSize <= Object::kMaxObjectDataSize);
+  constexpr static uint64_t kNumElementsPerScope = 1024;
+
+  static Pattern_t induce_fn(Index_t idx_0, Index_t idx_1);
+  static Index_t infer_fn(Index_t idx, Pattern_t stride);
+  static GenericUniquePtr *mapping_fn(uint8_t *&state, Index_t idx);
+  constexpr static auto kInduceFn = [](Index_t idx_0,
+                                       Index_t idx_1) -> Pattern_t {
+    return induce_fn(idx_0, idx_1);
+  };
+  constexpr static auto kInferFn = [](Index_t idx,
+                                      Pattern_t stride) -> Index_t {
+    return infer_fn(idx, stride);
+  };
+  constexpr static auto kMappingFn = [](uint8_t *&state,
+                                        Index_t idx) -> GenericUniquePtr * {
+    return mapping_fn(state, idx);
+  };
+  std::unique_ptr<
+      Prefetcher<decltype(kInduceFn), decltype(kInferFn), decltype(kMappingFn)>>
+      prefetcher_;
+  bool dynamic_prefetch_enabled_ = true;
+
+  friend class FarMemTest;
+
+  template <bool Mut>
+  using FastIterator = ChunkedFastIterator<FarVector, T, kChunkNumEntries, Mut>;
+  template <typename V, typename U, uint32_t N, bool M>
+  friend class ChunkedFastIterator;
+
+  std::pair<uint64_t, uint64_t> get_chunk_stats(uint64_t index) const;
+  void prefetch_record(bool nt, Index_t idx);
+  FarVector &lock();
+
+public:
+  using value_type = T;
+
+  FarVector(FarMemManager *manager, bool offloaded = false);
+  // Copies keep the offloading mode of other.
+  FarVector(const FarVector &other);
+  FarVector &operator=(const FarVector &other);
+  FarVector(FarVector &&other);
+  FarVector &operator=(FarVector &&other);
+  ~FarVector();
+
+  template <bool Nt = false>
+  void push_back(const DerefScope &scope, const T &value);
+  void pop_back(const DerefScope &scope);
+  // Bulk versions of push_back(), at() and at_mut(). They fetch the missing
+  // chunks of a batch concurrently and must be invoked out of any DerefScope.
+  void append(const T *data, uint64_t num);
+  void append(std::span<const T> data);
+  void read_range(uint64_t begin, uint64_t num, T *out);
+  void write_range(uint64_t begin, uint64_t num, const T *in);
+  // Replaces the content with other[begin, end). If both vectors are
+  // offloaded, the copy is done by the server. Must be invoked out of any
+  // DerefScope.
+  void assign(const FarVector &other, uint64_t begin, uint64_t end);
+  T &front_mut(const DerefScope &scope);
+  const T &front(const DerefScope &scope);
+  T &back_mut(const DerefScope &scope);
+  const T &back(const DerefScope &scope);
+  template <bool Prefetch = true, bool Nt = false>
+  T &at_mut(const DerefScope &scope, uint64_t index);
+  template <bool Prefetch = true, bool Nt = false>
+  const T &at(const DerefScope &scope, uint64_t index);
+  FastIterator</* Mut = */ true> fbegin(DerefScope &scope);
+  FastIterator</* Mut = */ true> fend(DerefScope &scope);
+  FastIterator</* Mut = */ false> cfbegin(DerefScope &scope) const;
+  FastIterator</* Mut = */ false> cfend(DerefScope &scope) const;
+  void disable_prefetch();
+  void enable_prefetch();
+  void static_prefetch(Index_t start, Index_t step, uint32_t num);
+  // Applies the Advice flags to the chunks holding the elements [begin, end).
+  void advise(FarMemManager *manager, uint64_t begin, uint64_t end,
+              uint32_t advice);
+};
+
+} // namespace far_memory
+
+#include "internal/far_vector.ipp"
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "helpers.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+namespace far_memory {
+
+// A count-min sketch of 8-bit saturating counters with TinyLFU-style aging:
+// every sample_size records, all counters are halved so that the estimates
+// follow the recent accesses. The halving is spread over the following
+// records, kNumCountersPerAgingStep counters at a time, rather than done in
+// one pass. Updates are not atomic; a lost increment under contention only
+// lowers an estimate slightly.
+class FrequencySketch {
+private:
+  constexpr static uint32_t kNumRows = 4;
+  constexpr static uint32_t kSampleSizeFactor = 10;
+  constexpr static uint32_t kNumCountersPerAgingStep = 64;
+  constexpr static uint64_t kSeeds[kNumRows] = {
+      0x9E3779B97F4A7C15ULL, 0xC2B2AE3D27D4EB4FULL, 0x165667B19E3779F9ULL,
+      0xD6E8FEB86659FD93ULL};
+
+  uint32_t width_shift_;
+  uint64_t num_counters_;
+  std::unique_ptr<uint8_t[]> counters_;
+  uint64_t sample_size_;
+  std::atomic<uint64_t> num_records_{0};
+  // The next counter to halve; no less than num_counters_ when not aging.
+  std::atomic<uint64_t> aging_cursor_;
+
+  uint8_t *counter(uint32_t hash, uint32_t row) const;
+  void start_aging(uint64_t num_records);
+  void age_step();
+
+public:
+  // The width is rounded up to a power of 2; it should be no less than the
+  // number of distinct items to tell apart.
+  FrequencySketch(uint32_t width);
+  NOT_COPYABLE(FrequencySketch);
+  NOT_MOVEABLE(FrequencySketch);
+  void record(uint32_t hash);
+  uint8_t estimate(uint32_t hash) const;
+};
+
+} // namespace far_memory
+
+#include "internal/frequency_sketch.ipp"
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "sync.h"
+
+#include "helpers.hpp"
+
+#include <atomic>
+#include <cstdint>
+
+namespace far_memory {
+
+// Paces the cache GC by the observed rates instead of fixed thresholds.
+//   1. alloc rate: the free regions consumed by the mutators per us, sampled
+//      every few successful refills of their core-local regions.
+//   2. reclaim rate: the regions one GC thread evacuates per us, measured
+//      over the last rounds.
+// The GC starts once the free regions would otherwise drain to
+// kAlmostEmptyThresh within kSafetyFactor GC rounds, so mutators never stall,
+// and stops at a threshold proportional to that headroom, so read-mostly
+// phases do not evacuate more than needed. Each round only uses the GC
+// threads needed to finish before the headroom runs out. All ratios are
+// relative to the total number of cache regions.
+class GCPacer {
+public:
+  struct Stats {
+    uint64_t num_rounds;
+    // Rounds started above the static low threshold, i.e., earlier than the
+    // fixed-threshold policy would.
+    uint64_t num_early_rounds;
+    uint64_t num_stalls;
+    uint64_t stall_us;
+    // Estimated stall time of the fixed-threshold policy on the early rounds;
+    // see on_gc_round_end().
+    uint64_t avoided_stall_us;
+  };
+
+private:
+  // The alloc rate is sampled this many times per cache's worth of regions.
+  constexpr static uint32_t kNumSamplesPerCache = 64;
+  constexpr static double kEWMAWeight = 0.25;
+  constexpr static double kSafetyFactor = 2;
+  constexpr static double kMinLowThresh = 0.05;
+  constexpr static double kMaxLowThresh = 0.4;
+
+  const uint32_t num_regions_;
+  const uint32_t max_num_gc_threads_;
+  const double almost_empty_thresh_;
+  const double static_low_thresh_;
+  const double static_high_thresh_;
+  const double min_ratio_per_round_;
+  const uint32_t sample_interval_;
+
+  std::atomic<uint64_t> num_allocated_regions_{0};
+  rt::Spin sample_spin_;
+  uint64_t last_sample_us_ = 0;
+  uint64_t last_num_allocated_regions_ = 0;
+  // Both in regions per us. Written under sample_spin_ and by the GC master
+  // respectively, read racily.
+  double alloc_rate_ = 0;
+  double reclaim_rate_per_thread_ = 0;
+  // Fall back to the static thresholds until the first round is measured.
+  double low_thresh_;
+  double high_thresh_;
+  // Stays at the static thresholds when cleared.
+  bool adaptive_ = true;
+  uint64_t round_start_us_;
+  double round_start_free_ratio_;
+  Stats stats_ = {};
+
+  void sample(uint64_t now_us);
+  void update_thresholds();
+
+public:
+  GCPacer(uint32_t num_regions, uint32_t max_num_gc_threads,
+          double almost_empty_thresh, double low_thresh, double high_thresh,
+          double min_ratio_per_round);
+  NOT_COPYABLE(GCPacer);
+  NOT_MOVEABLE(GCPacer);
+  // Invoked by the mutators with preemption disabled, after a successful
+  // refill of their core-local region.
+  void on_region_allocated();
+  // Invoked by the mutators with FarMemManager::gc_lock_ held.
+  void add_stall(uint64_t stall_us);
+  double get_low_thresh() const;
+  double get_high_thresh() const;
+  Stats get_stats() const;
+  void reset_stats();
+  void set_adaptive(bool adaptive);
+  // Invoked by the GC master only.
+  void on_gc_round_start(double free_ratio);
+  void on_gc_round_end(uint32_t num_regions, uint32_t num_gc_threads);
+  double get_ratio_per_round(double free_ratio, double max_ratio) const;
+  uint32_t get_num_gc_threads(double free_ratio, uint32_t num_regions) const;
+};
+
+} // namespace far_memory
+
+#include "internal/gc_pacer.ipp"
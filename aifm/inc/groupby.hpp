@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstdint>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace far_memory {
+
+enum AggregateOp : uint8_t {
+  AggSum = 0,
+  AggCount,
+  AggMean,
+  AggVar,
+  AggStd,
+  AggFirst,
+  AggLast,
+  AggMin,
+  AggMax,
+  AggMedian,
+  AggQuantile
+};
+
+// Shared by the local and the offloaded groupby paths. Groups are numbered
+// densely in the order of their first appearance, so the input never needs to
+// be sorted.
+template <typename T> class HashGrouper {
+private:
+  struct KeyHash {
+    std::size_t operator()(const std::pair<uint64_t, T> &key) const;
+  };
+
+  // The values of a group whose ranks may hold the selected ones, see
+  // select().
+  struct RankWindow {
+    uint64_t count;
+    bool bounded;
+    T lo;
+    T hi;
+    uint64_t num_below = 0;
+    std::vector<T> values;
+  };
+
+  template <typename GetFn, typename GroupIdFn, typename EmitFn>
+  static void median(uint64_t size, uint64_t num_groups, GetFn get_fn,
+                     GroupIdFn group_id_fn, EmitFn emit_fn);
+  // Emits combine(lo, hi) per group of n rows, where lo and hi are the values
+  // of ranks lo_rank(n) and hi_rank(n). Each group is first summarized by a
+  // QuantileSketch; unless exact, the sketch answers. Otherwise a second pass
+  // buffers only the values within the sketch's rank error of the ranks.
+  template <typename LoRankFn, typename HiRankFn, typename CombineFn,
+            typename GetFn, typename GroupIdFn, typename EmitFn>
+  static void select(uint64_t size, uint64_t num_groups, bool exact,
+                     LoRankFn lo_rank, HiRankFn hi_rank, CombineFn combine,
+                     GetFn get_fn, GroupIdFn group_id_fn, EmitFn emit_fn);
+
+public:
+  // The key of row i is (prev_id_fn(i), get_fn(i)), where prev_id_fn() returns
+  // the group id computed on the previous key column (or 0 for the first key
+  // column). emit_fn(group_id) is invoked for every row in order, and
+  // new_group_fn(i) whenever row i opens a new group. Returns the number of
+  // groups.
+  template <typename GetFn, typename PrevIdFn, typename EmitFn,
+            typename NewGroupFn>
+  static uint64_t group(uint64_t size, GetFn get_fn, PrevIdFn prev_id_fn,
+                        EmitFn emit_fn, NewGroupFn new_group_fn);
+  // Folds the rows into num_groups values with op, except AggCount (see
+  // count()) and AggQuantile (see quantile()). emit_fn(value) is invoked in
+  // group id order. Statistics are computed in double and converted back to
+  // T, which makes them only supported for arithmetic T. The median averages
+  // the two middle values of even-sized groups when T supports it, like
+  // AggregatorMedian, and buffers only a window of each group around its
+  // median.
+  template <typename GetFn, typename GroupIdFn, typename EmitFn>
+  static void aggregate(AggregateOp op, uint64_t size, uint64_t num_groups,
+                        GetFn get_fn, GroupIdFn group_id_fn, EmitFn emit_fn);
+  // The value of rank min(n - 1, q * n) of each group of n rows, in group id
+  // order. Unless exact, it is read off a per-group QuantileSketch in a single
+  // pass and bounded memory, within the sketch's rank error.
+  template <typename GetFn, typename GroupIdFn, typename EmitFn>
+  static void quantile(uint64_t size, uint64_t num_groups, double q, bool exact,
+                       GetFn get_fn, GroupIdFn group_id_fn, EmitFn emit_fn);
+  // Counts the rows of each group, for any T. emit_fn(uint64_t) is invoked in
+  // group id order.
+  template <typename GroupIdFn, typename EmitFn>
+  static void count(uint64_t size, uint64_t num_groups, GroupIdFn group_id_fn,
+                    EmitFn emit_fn);
+};
+
+} // namespace far_memory
+
+#include "internal/groupby.ipp"
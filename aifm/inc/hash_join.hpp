@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace far_memory {
+
+enum JoinType : uint8_t { InnerJoin = 0, LeftJoin, RightJoin, OuterJoin };
+
+// Marks the absent side of a row produced by an outer join.
+constexpr static uint64_t kJoinNullIdx = std::numeric_limits<uint64_t>::max();
+
+// Shared by the local and the offloaded join paths. The hash table is built
+// on the smaller side and probed by the larger side. Both sides are accessed
+// through get_fns so that the callers decide how the elements are fetched.
+template <typename T> class HashJoiner {
+public:
+  // emit_fn(lhs_idx, rhs_idx) is invoked once per output row.
+  template <typename LhsGetFn, typename RhsGetFn, typename EmitFn>
+  static void join(uint64_t lhs_size, uint64_t rhs_size, LhsGetFn lhs_get_fn,
+                   RhsGetFn rhs_get_fn, JoinType type, EmitFn emit_fn);
+  // The value materialized for kJoinNullIdx.
+  static T null_value();
+};
+
+} // namespace far_memory
+
+#include "internal/hash_join.ipp"
@@ -96,6 +96,10 @@ static void tcp_read_until(tcpconn_t *c, void *buf, size_t expect);
 static void tcp_write_until(tcpconn_t *c, const void *buf, size_t expect);
 static void tcp_write2_until(tcpconn_t *c, const void *buf_0, size_t expect_0,
                              const void *buf_1, size_t expect_1);
+// Like the two above, but return false rather than spinning forever once the
+// connection is closed or fails, e.g., when the peer is gone.
+static bool tcp_try_read_until(tcpconn_t *c, void *buf, size_t expect);
+static bool tcp_try_write_until(tcpconn_t *c, const void *buf, size_t expect);
 static constexpr size_t static_log(uint64_t b, uint64_t n);
 static uint32_t align_to(uint32_t n, uint32_t factor);
 static uint64_t align_to(uint64_t n, uint64_t factor);
@@ -47,6 +47,42 @@ template <typename T> FORCE_INLINE T AggregatorMedian<T>::aggregate() {
   return ret;
 }
 
+FORCE_INLINE uint64_t quantile_to_index(double q, uint64_t size) {
+  BUG_ON(q < 0 || q > 1);
+  return std::min(size - 1, static_cast<uint64_t>(q * size));
+}
+
+template <typename T>
+FORCE_INLINE AggregatorQuantile<T>::AggregatorQuantile(double q) : q_(q) {}
+
+template <typename T>
+FORCE_INLINE void AggregatorQuantile<T>::add(DerefScope *scope, T t) {
+  vec_.push_back(t);
+}
+
+template <typename T> FORCE_INLINE T AggregatorQuantile<T>::aggregate() {
+  auto nth = vec_.begin() + quantile_to_index(q_, vec_.size());
+  std::nth_element(vec_.begin(), nth, vec_.end());
+  auto ret = *nth;
+  vec_.clear();
+  return ret;
+}
+
+template <typename T>
+FORCE_INLINE AggregatorApproxQuantile<T>::AggregatorApproxQuantile(double q)
+    : q_(q) {}
+
+template <typename T>
+FORCE_INLINE void AggregatorApproxQuantile<T>::add(DerefScope *scope, T t) {
+  sketch_.add(t);
+}
+
+template <typename T> FORCE_INLINE T AggregatorApproxQuantile<T>::aggregate() {
+  auto ret = sketch_.quantile(q_);
+  sketch_.clear();
+  return ret;
+}
+
 template <typename T>
 FORCE_INLINE AggregatorMedianLimitedMem<T>::AggregatorMedianLimitedMem(
     FarMemManager *manager)
@@ -70,10 +106,29 @@ FORCE_INLINE T AggregatorMedianLimitedMem<T>::aggregate() {
   return ret;
 }
 
+template <typename T>
+FORCE_INLINE AggregatorQuantileLimitedMem<T>::AggregatorQuantileLimitedMem(
+    FarMemManager *manager, double q)
+    : q_(q), vec_(std::move(manager->allocate_dataframe_vector<T>())) {}
+
+template <typename T>
+FORCE_INLINE void AggregatorQuantileLimitedMem<T>::add(DerefScope *scope,
+                                                       T t) {
+  vec_.push_back(*scope, t);
+}
+
+template <typename T>
+FORCE_INLINE T AggregatorQuantileLimitedMem<T>::aggregate() {
+  auto ret = vec_.nth_element(quantile_to_index(q_, vec_.size()));
+  vec_.clear();
+  return ret;
+}
+
 template <typename T>
 FORCE_INLINE Aggregator<T> *
 AggregatorFactory<T>::build(uint8_t opcode, bool limited_mem,
-                            FarMemManager *manager) {
+                            FarMemManager *manager, double quantile,
+                            bool exact) {
   BUG_ON(limited_mem && manager == nullptr);
   switch (opcode) {
   case GenericDataFrameVector::OpCode::AggregateMax:
@@ -85,6 +140,15 @@ AggregatorFactory<T>::build(uint8_t opcode, bool limited_mem,
                ? reinterpret_cast<Aggregator<T> *>(
                      new AggregatorMedianLimitedMem<T>(manager))
                : reinterpret_cast<Aggregator<T> *>(new AggregatorMedian<T>());
+  case GenericDataFrameVector::OpCode::AggregateQuantile:
+    if (!exact) {
+      return new AggregatorApproxQuantile<T>(quantile);
+    }
+    return limited_mem ? reinterpret_cast<Aggregator<T> *>(
+                             new AggregatorQuantileLimitedMem<T>(manager,
+                                                                 quantile))
+                       : reinterpret_cast<Aggregator<T> *>(
+                             new AggregatorQuantile<T>(quantile));
   default:
     BUG();
   }
@@ -3,6 +3,7 @@
 #include "helpers.hpp"
 
 #include <cstddef>
+#include <cstdlib>
 #include <stdexcept>
 #include <type_traits>
 
@@ -34,13 +35,24 @@ FORCE_INLINE GenericUniquePtr *GenericArray::at(bool nt, Index_t idx) {
   return &ptrs_[idx];
 }
 
+template <typename T, uint32_t ChunkNumEntries, uint64_t... Dims>
+FORCE_INLINE ChunkedArray<T, ChunkNumEntries, Dims...>::ChunkedArray(
+    FarMemManager *manager)
+    : GenericArray(manager, kChunkSize, kNumChunks) {}
+
 template <typename T, uint64_t... Dims>
 FORCE_INLINE Array<T, Dims...>::Array(FarMemManager *manager)
-    : GenericArray(manager, sizeof(T), kSize) {}
+    : ChunkedArray<T, 1, Dims...>(manager) {}
 
 template <typename T, uint64_t... Dims>
+FORCE_INLINE PackedArray<T, Dims...>::PackedArray(FarMemManager *manager)
+    : ChunkedArray<T, GenericArray::packed_chunk_num_entries<T>(), Dims...>(
+          manager) {}
+
+template <typename T, uint32_t ChunkNumEntries, uint64_t... Dims>
 template <auto DimIdx>
-FORCE_INLINE constexpr uint64_t Array<T, Dims...>::get_dim_size() {
+FORCE_INLINE constexpr uint64_t
+ChunkedArray<T, ChunkNumEntries, Dims...>::get_dim_size() {
   if constexpr (DimIdx == sizeof...(Dims)) {
     return 1;
   } else {
@@ -48,10 +60,10 @@ FORCE_INLINE constexpr uint64_t Array<T, Dims...>::get_dim_size() {
   }
 }
 
-template <typename T, uint64_t... Dims>
+template <typename T, uint32_t ChunkNumEntries, uint64_t... Dims>
 template <auto DimIdx, typename... Indices>
 FORCE_INLINE constexpr int64_t
-Array<T, Dims...>::_get_flat_idx(Indices... indices) {
+ChunkedArray<T, ChunkNumEntries, Dims...>::_get_flat_idx(Indices... indices) {
   if constexpr (DimIdx == sizeof...(Dims)) {
     return 0;
   } else {
@@ -61,102 +73,150 @@ Array<T, Dims...>::_get_flat_idx(Indices... indices) {
   }
 }
 
-template <typename T, uint64_t... Dims>
+template <typename T, uint32_t ChunkNumEntries, uint64_t... Dims>
 template <typename... Indices>
 FORCE_INLINE constexpr int64_t
-Array<T, Dims...>::get_flat_idx(Indices... indices) {
+ChunkedArray<T, ChunkNumEntries, Dims...>::get_flat_idx(Indices... indices) {
   static_assert(sizeof...(Dims) == sizeof...(indices));
   return _get_flat_idx<0>(indices...);
 }
 
-template <typename T, uint64_t... Dims>
+template <typename T, uint32_t ChunkNumEntries, uint64_t... Dims>
+FORCE_INLINE GenericUniquePtr *
+ChunkedArray<T, ChunkNumEntries, Dims...>::chunk_at(bool nt,
+                                                    Index_t chunk_idx) {
+  if (ACCESS_ONCE(dynamic_prefetch_enabled_) &&
+      ACCESS_ONCE(last_traced_chunk_idx_) != chunk_idx) {
+    ACCESS_ONCE(last_traced_chunk_idx_) = chunk_idx;
+    prefetcher_.add_trace(nt, chunk_idx);
+  }
+  return &ptrs_[chunk_idx];
+}
+
+template <typename T, uint32_t ChunkNumEntries, uint64_t... Dims>
 template <typename... Indices>
-FORCE_INLINE void Array<T, Dims...>::check_indices(Indices... indices) {
+FORCE_INLINE void
+ChunkedArray<T, ChunkNumEntries, Dims...>::check_indices(Indices... indices) {
   static_assert(sizeof...(Dims) == sizeof...(indices));
+  uint64_t dims[] = {Dims...};
+  int64_t idxes[] = {static_cast<int64_t>(indices)...};
   for (num_dim_t i = 0; i < sizeof...(Dims); i++) {
-    if (unlikely(helpers::variadic_get<i>(indices...) >=
-                     helpers::variadic_get<i>(Dims...) ||
-                 helpers::variadic_get<i>(indices...) < 0)) {
+    if (unlikely(idxes[i] < 0 || static_cast<uint64_t>(idxes[i]) >= dims[i])) {
       throw std::invalid_argument("Index of out range.");
     }
   }
 }
 
-template <typename T, uint64_t... Dims>
+template <typename T, uint32_t ChunkNumEntries, uint64_t... Dims>
 template <bool Nt, typename... Indices>
-FORCE_INLINE const T &Array<T, Dims...>::at(const DerefScope &scope,
-                                            Indices... indices) noexcept {
-  auto idx = get_flat_idx(indices...);
-  auto ptr = reinterpret_cast<UniquePtr<T> *>(GenericArray::at(Nt, idx));
-  return *(ptr->template deref<Nt>(scope));
+FORCE_INLINE const T &
+ChunkedArray<T, ChunkNumEntries, Dims...>::at(const DerefScope &scope,
+                                              Indices... indices) noexcept {
+  uint64_t idx = get_flat_idx(indices...);
+  auto *ptr = chunk_at(Nt, idx / kChunkNumEntries);
+  auto *chunk = static_cast<const T *>(ptr->template deref<Nt>(scope));
+  return chunk[idx % kChunkNumEntries];
 }
 
-template <typename T, uint64_t... Dims>
+template <typename T, uint32_t ChunkNumEntries, uint64_t... Dims>
 template <bool Nt, typename... Indices>
-FORCE_INLINE const T &Array<T, Dims...>::at_safe(const DerefScope &scope,
-                                                 Indices... indices) {
+FORCE_INLINE const T &
+ChunkedArray<T, ChunkNumEntries, Dims...>::at_safe(const DerefScope &scope,
+                                                   Indices... indices) {
   check_indices(indices...);
-  return at(scope, indices...);
+  return at<Nt>(scope, indices...);
 }
 
-template <typename T, uint64_t... Dims>
+template <typename T, uint32_t ChunkNumEntries, uint64_t... Dims>
 template <bool Nt, typename... Indices>
-FORCE_INLINE T Array<T, Dims...>::read(Indices... indices) {
+FORCE_INLINE T
+ChunkedArray<T, ChunkNumEntries, Dims...>::read(Indices... indices) {
   DerefScope scope;
-  return at(scope, indices...);
+  return at<Nt>(scope, indices...);
 }
 
-template <typename T, uint64_t... Dims>
+template <typename T, uint32_t ChunkNumEntries, uint64_t... Dims>
 template <bool Nt, typename... Indices>
-FORCE_INLINE T Array<T, Dims...>::read_safe(Indices... indices) {
+FORCE_INLINE T
+ChunkedArray<T, ChunkNumEntries, Dims...>::read_safe(Indices... indices) {
   check_indices(indices...);
-  return read(indices...);
+  return read<Nt>(indices...);
 }
 
-template <typename T, uint64_t... Dims>
+template <typename T, uint32_t ChunkNumEntries, uint64_t... Dims>
 template <bool Nt, typename... Indices>
-FORCE_INLINE T &Array<T, Dims...>::at_mut(const DerefScope &scope,
-                                          Indices... indices) noexcept {
-  auto idx = get_flat_idx(indices...);
-  auto ptr = reinterpret_cast<UniquePtr<T> *>(GenericArray::at(Nt, idx));
-  return *(ptr->template deref_mut<Nt>(scope));
+FORCE_INLINE T &
+ChunkedArray<T, ChunkNumEntries, Dims...>::at_mut(const DerefScope &scope,
+                                                  Indices... indices) noexcept {
+  uint64_t idx = get_flat_idx(indices...);
+  auto *ptr = chunk_at(Nt, idx / kChunkNumEntries);
+  auto *chunk = static_cast<T *>(ptr->template deref_mut<Nt>(scope));
+  return chunk[idx % kChunkNumEntries];
 }
 
-template <typename T, uint64_t... Dims>
+template <typename T, uint32_t ChunkNumEntries, uint64_t... Dims>
 template <bool Nt, typename... Indices>
-FORCE_INLINE T &Array<T, Dims...>::at_mut_safe(const DerefScope &scope,
-                                               Indices... indices) {
+FORCE_INLINE T &
+ChunkedArray<T, ChunkNumEntries, Dims...>::at_mut_safe(const DerefScope &scope,
+                                                       Indices... indices) {
   check_indices(indices...);
-  return at_mut(scope, indices...);
+  return at_mut<Nt>(scope, indices...);
 }
 
-template <typename T, uint64_t... Dims>
+template <typename T, uint32_t ChunkNumEntries, uint64_t... Dims>
 template <bool Nt, typename U, typename... Indices>
-FORCE_INLINE void Array<T, Dims...>::write(U &&u, Indices... indices) {
+FORCE_INLINE void
+ChunkedArray<T, ChunkNumEntries, Dims...>::write(U &&u, Indices... indices) {
   static_assert(std::is_same<std::decay_t<U>, std::decay_t<T>>::value,
                 "U must be the same as T");
   DerefScope scope;
-  at_mut(scope, indices...) = u;
+  at_mut<Nt>(scope, indices...) = u;
 }
 
-template <typename T, uint64_t... Dims>
+template <typename T, uint32_t ChunkNumEntries, uint64_t... Dims>
 template <bool Nt, typename U, typename... Indices>
-FORCE_INLINE void Array<T, Dims...>::write_safe(U &&u, Indices... indices) {
+FORCE_INLINE void
+ChunkedArray<T, ChunkNumEntries, Dims...>::write_safe(U &&u,
+                                                      Indices... indices) {
   check_indices(indices...);
-  write_safe(indices..., u);
+  write<Nt>(std::forward<U>(u), indices...);
 }
 
-template <typename T, uint64_t... Dims>
+template <typename T, uint32_t ChunkNumEntries, uint64_t... Dims>
 template <typename... ArgsStart, typename... ArgsStep>
-FORCE_INLINE void
-Array<T, Dims...>::static_prefetch(std::tuple<ArgsStart...> start,
-                                   std::tuple<ArgsStep...> step, uint32_t num) {
-  // Get their flat indices.
+FORCE_INLINE void ChunkedArray<T, ChunkNumEntries, Dims...>::static_prefetch(
+    std::tuple<ArgsStart...> start, std::tuple<ArgsStep...> step,
+    uint32_t num) {
   auto start_flat_idx =
       std::apply([&](auto &&... args) { return get_flat_idx(args...); }, start);
   auto step_flat_idx =
       std::apply([&](auto &&... args) { return get_flat_idx(args...); }, step);
-  GenericArray::static_prefetch(start_flat_idx, step_flat_idx, num);
+  auto start_chunk_idx = start_flat_idx / kChunkNumEntries;
+  if (std::abs(step_flat_idx) >= kChunkNumEntries) {
+    GenericArray::static_prefetch(start_chunk_idx,
+                                  step_flat_idx / kChunkNumEntries, num);
+  } else {
+    // Several elements per chunk; prefetch the chunks they span.
+    auto end_chunk_idx = (start_flat_idx + step_flat_idx * num) /
+                         static_cast<int64_t>(kChunkNumEntries);
+    auto num_chunks = std::abs(end_chunk_idx - start_chunk_idx) + 1;
+    GenericArray::static_prefetch(start_chunk_idx, step_flat_idx < 0 ? -1 : 1,
+                                  num_chunks);
+  }
+}
+
+template <typename T, uint32_t ChunkNumEntries, uint64_t... Dims>
+FORCE_INLINE void
+ChunkedArray<T, ChunkNumEntries, Dims...>::advise(Index_t start, Index_t num,
+                                                  uint32_t advice) {
+  BUG_ON(start + num > kSize);
+  if (!num) {
+    return;
+  }
+  auto start_chunk_idx = start / kChunkNumEntries;
+  auto end_chunk_idx = (start + num - 1) / kChunkNumEntries + 1;
+  GenericArray::advise(start_chunk_idx, end_chunk_idx - start_chunk_idx,
+                       advice);
 }
 
 } // namespace far_memory
@@ -0,0 +1,209 @@
+#pragma once
+
+#include <new>
+
+namespace far_memory {
+
+// Everything is defined inline here rather than in src/, so that the library
+// itself builds without coroutine support.
+
+namespace internal {
+
+template <typename P>
+FORCE_INLINE std::coroutine_handle<>
+PromiseBase::FinalAwaiter::await_suspend(std::coroutine_handle<P> h) noexcept {
+  auto &promise = h.promise();
+  if (promise.continuation) {
+    return promise.continuation;
+  }
+  // A root task, which is owned by the executor.
+  auto *executor = promise.executor;
+  h.destroy();
+  executor->num_live_roots_--;
+  return std::noop_coroutine();
+}
+
+} // namespace internal
+
+template <typename T>
+FORCE_INLINE Task<T> Task<T>::promise_type::get_return_object() {
+  return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+}
+
+template <typename T>
+FORCE_INLINE Task<T>::Task(std::coroutine_handle<promise_type> handle)
+    : handle_(handle) {}
+
+template <typename T>
+FORCE_INLINE Task<T>::Task(Task &&other)
+    : handle_(std::exchange(other.handle_, nullptr)) {}
+
+template <typename T> FORCE_INLINE Task<T>::~Task() {
+  if (handle_) {
+    handle_.destroy();
+  }
+}
+
+template <typename T>
+template <typename P>
+FORCE_INLINE std::coroutine_handle<>
+Task<T>::await_suspend(std::coroutine_handle<P> awaiter) {
+  auto &promise = handle_.promise();
+  promise.executor = awaiter.promise().executor;
+  promise.continuation = awaiter;
+  return handle_;
+}
+
+template <typename T> FORCE_INLINE T Task<T>::await_resume() {
+  if constexpr (!std::is_void_v<T>) {
+    return std::move(*handle_.promise().value);
+  }
+}
+
+FORCE_INLINE AsyncExecutor::AsyncExecutor() {}
+
+FORCE_INLINE AsyncExecutor::~AsyncExecutor() {
+  // Tasks that were spawned but never run.
+  for (auto handle : ready_) {
+    handle.destroy();
+  }
+}
+
+FORCE_INLINE const DerefScope &AsyncExecutor::scope() const {
+  return *reinterpret_cast<const DerefScope *>(scope_buf_);
+}
+
+FORCE_INLINE void AsyncExecutor::spawn(Task<void> &&task) {
+  auto handle = std::exchange(task.handle_, nullptr);
+  handle.promise().executor = this;
+  ready_.push_back(handle);
+  num_live_roots_++;
+}
+
+FORCE_INLINE void AsyncExecutor::resume_batch() {
+  new (scope_buf_) DerefScope();
+  for (uint32_t i = 0; i < kMaxNumResumesPerScope && !ready_.empty(); i++) {
+    auto handle = ready_.front();
+    ready_.pop_front();
+    handle.resume();
+  }
+  // Lets the GC proceed in between the batches.
+  std::launder(reinterpret_cast<DerefScope *>(scope_buf_))->~DerefScope();
+}
+
+FORCE_INLINE void AsyncExecutor::run() {
+  while (num_live_roots_) {
+    {
+      rt::ScopedLock<rt::Spin> lock(&spin_);
+      while (ready_.empty() && completed_.empty()) {
+        cv_.Wait(&spin_);
+      }
+      // Swapped rather than copied to avoid allocating with the spin held.
+      std::swap(resumed_, completed_);
+    }
+    ready_.insert(ready_.end(), resumed_.begin(), resumed_.end());
+    resumed_.clear();
+    resume_batch();
+  }
+}
+
+FORCE_INLINE void AsyncExecutor::complete(std::coroutine_handle<> handle) {
+  rt::ScopedLock<rt::Spin> lock(&spin_);
+  completed_.push_back(handle);
+  cv_.Signal();
+}
+
+template <typename T, bool Mut, bool Nt>
+FORCE_INLINE DerefAwaiter<T, Mut, Nt>::DerefAwaiter(GenericUniquePtr *ptr)
+    : ptr_(ptr) {}
+
+template <typename T, bool Mut, bool Nt>
+FORCE_INLINE bool DerefAwaiter<T, Mut, Nt>::await_ready() {
+  // Other slow paths, e.g., the object being evacuated, do not block for
+  // long and are left to _deref().
+  return ptr_->is_null() || ptr_->meta().is_present();
+}
+
+template <typename T, bool Mut, bool Nt>
+void DerefAwaiter<T, Mut, Nt>::swapped_in_fn(void *arg) {
+  auto *awaiter = reinterpret_cast<DerefAwaiter *>(arg);
+  // The awaiter lives in the coroutine frame, which may be gone afterwards.
+  awaiter->executor_->complete(awaiter->awaiter_);
+}
+
+template <typename T, bool Mut, bool Nt>
+template <typename P>
+FORCE_INLINE bool
+DerefAwaiter<T, Mut, Nt>::await_suspend(std::coroutine_handle<P> awaiter) {
+  executor_ = awaiter.promise().executor;
+  awaiter_ = awaiter;
+  swap_in_.done = {.fn = swapped_in_fn, .arg = this};
+  // Resumes right away if someone else has swapped it in meanwhile.
+  return FarMemManagerFactory::get()->swap_in_async(Nt, ptr_, &swap_in_);
+}
+
+template <typename T, bool Mut, bool Nt>
+FORCE_INLINE T *DerefAwaiter<T, Mut, Nt>::await_resume() {
+  // The object might have been swapped out again in between, in which case
+  // _deref() swaps it in synchronously.
+  return static_cast<T *>(ptr_->_deref<Mut, Nt>());
+}
+
+template <typename T>
+FORCE_INLINE DerefAwaiter<const T, /* Mut = */ false, /* Nt = */ false>
+UniquePtr<T>::deref_async(const DerefScope &scope) {
+  return DerefAwaiter<const T, /* Mut = */ false, /* Nt = */ false>(this);
+}
+
+template <typename T>
+FORCE_INLINE DerefAwaiter<T, /* Mut = */ true, /* Nt = */ false>
+UniquePtr<T>::deref_mut_async(const DerefScope &scope) {
+  return DerefAwaiter<T, /* Mut = */ true, /* Nt = */ false>(this);
+}
+
+FORCE_INLINE GetAwaiter::GetAwaiter(GenericConcurrentHopscotch *hopscotch,
+                                    uint8_t key_len, const uint8_t *key,
+                                    uint16_t *val_len, uint8_t *val)
+    : hopscotch_(hopscotch), key_len_(key_len), key_(key), val_len_(val_len),
+      val_(val) {}
+
+FORCE_INLINE bool GetAwaiter::await_ready() {
+  // __get() returns true on a local miss.
+  return !hopscotch_->__get(key_len_, key_, val_len_, val_);
+}
+
+FORCE_INLINE void GetAwaiter::forwarded_fn(void *arg) {
+  auto *awaiter = reinterpret_cast<GetAwaiter *>(arg);
+  awaiter->executor_->complete(awaiter->awaiter_);
+}
+
+template <typename P>
+FORCE_INLINE bool GetAwaiter::await_suspend(std::coroutine_handle<P> awaiter) {
+  executor_ = awaiter.promise().executor;
+  awaiter_ = awaiter;
+  if (!hopscotch_->may_exist_remotely(key_len_, key_)) {
+    *val_len_ = 0;
+    return false;
+  }
+  forwarded_ = true;
+  FarMemManagerFactory::get()->read_object_async(
+      hopscotch_->ds_id_, key_len_, key_, val_len_, val_,
+      {.fn = forwarded_fn, .arg = this});
+  return true;
+}
+
+FORCE_INLINE void GetAwaiter::await_resume() {
+  // Within the scope of the executor, unlike forwarded_fn().
+  if (forwarded_) {
+    hopscotch_->cache_forwarded(key_len_, key_, *val_len_, val_);
+  }
+}
+
+FORCE_INLINE GetAwaiter
+GenericConcurrentHopscotch::get_async(const DerefScope &scope, uint8_t key_len,
+                                      const uint8_t *key, uint16_t *val_len,
+                                      uint8_t *val) {
+  return GetAwaiter(this, key_len, key, val_len, val);
+}
+
+} // namespace far_memory
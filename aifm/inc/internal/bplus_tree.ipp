@@ -0,0 +1,583 @@
+#pragma once
+
+extern "C" {
+#include <runtime/thread.h>
+}
+
+#include "manager.hpp"
+#include "prefetch_service.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace far_memory {
+
+template <typename K, typename V>
+FORCE_INLINE BPlusTree<K, V>::Node::Node(bool leaf) : is_leaf(leaf) {}
+
+template <typename K, typename V>
+FORCE_INLINE BPlusTree<K, V>::InnerNode::InnerNode() : Node(false) {}
+
+template <typename K, typename V>
+FORCE_INLINE bool BPlusTree<K, V>::InnerNode::is_full() const {
+  return num_keys == kInnerFanout - 1;
+}
+
+template <typename K, typename V>
+FORCE_INLINE uint32_t
+BPlusTree<K, V>::InnerNode::lower_bound(const K &key) const {
+  // Racy reads are validated by the caller, but must stay within bounds.
+  uint32_t num = ACCESS_ONCE(num_keys);
+  num = std::min(num, kInnerFanout - 1);
+  return BPlusTree::lower_bound(keys, num, key);
+}
+
+template <typename K, typename V>
+FORCE_INLINE BPlusTree<K, V>::InnerNode *
+BPlusTree<K, V>::InnerNode::split(K *separator) {
+  auto *right = new InnerNode();
+  auto mid = num_keys / 2;
+  *separator = keys[mid];
+  right->num_keys = num_keys - mid - 1;
+  memcpy(right->keys, keys + mid + 1, right->num_keys * sizeof(K));
+  memcpy(right->children, children + mid + 1,
+         (right->num_keys + 1) * sizeof(Node *));
+  num_keys = mid;
+  return right;
+}
+
+template <typename K, typename V>
+FORCE_INLINE void BPlusTree<K, V>::InnerNode::insert_at(uint32_t pos,
+                                                        const K &separator,
+                                                        Node *right) {
+  assert(!is_full() && pos <= num_keys);
+  memmove(keys + pos + 1, keys + pos, (num_keys - pos) * sizeof(K));
+  memmove(children + pos + 2, children + pos + 1,
+          (num_keys - pos) * sizeof(Node *));
+  keys[pos] = separator;
+  children[pos + 1] = right;
+  num_keys++;
+}
+
+template <typename K, typename V>
+FORCE_INLINE BPlusTree<K, V>::LeafNode::LeafNode() : Node(true) {}
+
+template <typename K, typename V>
+FORCE_INLINE bool BPlusTree<K, V>::is_equal(const K &a, const K &b) {
+  return !(a < b) && !(b < a);
+}
+
+template <typename K, typename V>
+FORCE_INLINE uint32_t BPlusTree<K, V>::lower_bound(const K *keys, uint32_t num,
+                                                   const K &key) {
+  return std::lower_bound(keys, keys + num, key) - keys;
+}
+
+template <typename K, typename V>
+FORCE_INLINE uint32_t BPlusTree<K, V>::upper_bound(const K *keys, uint32_t num,
+                                                   const K &key) {
+  return std::upper_bound(keys, keys + num, key) - keys;
+}
+
+template <typename K, typename V>
+FORCE_INLINE BPlusTree<K, V>::LeafNode *BPlusTree<K, V>::allocate_leaf() {
+  auto *leaf = new LeafNode();
+  leaf->ptr = FarMemManagerFactory::get()->allocate_generic_unique_ptr(
+      kVanillaPtrDSID, sizeof(LeafData));
+  return leaf;
+}
+
+template <typename K, typename V>
+FORCE_INLINE BPlusTree<K, V>::BPlusTree() {
+  head_ = allocate_leaf();
+  root_ = head_;
+}
+
+template <typename K, typename V>
+FORCE_INLINE void BPlusTree<K, V>::destroy(Node *node) {
+  if (node->is_leaf) {
+    return;
+  }
+  auto *inner = static_cast<InnerNode *>(node);
+  for (uint32_t i = 0; i <= inner->num_keys; i++) {
+    destroy(inner->children[i]);
+  }
+  delete inner;
+}
+
+template <typename K, typename V> FORCE_INLINE BPlusTree<K, V>::~BPlusTree() {
+  destroy(root_.load());
+  auto *leaf = head_;
+  while (leaf) {
+    // The prefetch service may still be swapping it in.
+    while (ACCESS_ONCE(leaf->inflight)) {
+      thread_yield();
+    }
+    auto *next = leaf->next.load();
+    delete leaf;
+    leaf = next;
+  }
+}
+
+template <typename K, typename V>
+FORCE_INLINE uint64_t BPlusTree<K, V>::size() const {
+  return size_.load(std::memory_order_relaxed);
+}
+
+template <typename K, typename V>
+FORCE_INLINE bool BPlusTree<K, V>::empty() const {
+  return size() == 0;
+}
+
+template <typename K, typename V>
+FORCE_INLINE K BPlusTree<K, V>::split_leaf(const DerefScope &scope,
+                                           LeafNode *leaf, LeafNode *right) {
+  auto *data = static_cast<LeafData *>(leaf->ptr.deref_mut(scope));
+  auto *right_data = static_cast<LeafData *>(right->ptr.deref_mut(scope));
+  auto mid = leaf->num_entries / 2;
+  right->num_entries = leaf->num_entries - mid;
+  memcpy(right_data->keys, data->keys + mid, right->num_entries * sizeof(K));
+  memcpy(right_data->vals, data->vals + mid, right->num_entries * sizeof(V));
+  leaf->num_entries = mid;
+  right->next.store(leaf->next.load(), std::memory_order_relaxed);
+  // Publish the right leaf only after it is fully built.
+  leaf->next.store(right, std::memory_order_release);
+  return data->keys[mid - 1];
+}
+
+template <typename K, typename V>
+FORCE_INLINE void BPlusTree<K, V>::make_root(const K &separator, Node *left,
+                                             Node *right) {
+  auto *root = new InnerNode();
+  root->num_keys = 1;
+  root->keys[0] = separator;
+  root->children[0] = left;
+  root->children[1] = right;
+  root_.store(root, std::memory_order_release);
+}
+
+template <typename K, typename V>
+FORCE_INLINE void BPlusTree<K, V>::insert(const DerefScope &scope,
+                                          const K &key, const V &val) {
+  std::unique_ptr<LeafNode> spare_leaf;
+
+restart:
+  bool restart = false;
+  auto *node = root_.load(std::memory_order_acquire);
+  auto version = node->lock.read_lock_or_restart(restart);
+  if (restart || node != root_.load(std::memory_order_acquire)) {
+    thread_yield();
+    goto restart;
+  }
+  InnerNode *parent = nullptr;
+  uint64_t parent_version = 0;
+  uint32_t pos = 0;
+
+  while (!node->is_leaf) {
+    auto *inner = static_cast<InnerNode *>(node);
+    if (inner->is_full()) {
+      // Splits eagerly on the way down, so that the parent always has room.
+      if (parent) {
+        parent->lock.upgrade_to_write_lock_or_restart(parent_version, restart);
+        if (restart) {
+          thread_yield();
+          goto restart;
+        }
+      }
+      inner->lock.upgrade_to_write_lock_or_restart(version, restart);
+      if (restart) {
+        if (parent) {
+          parent->lock.write_unlock();
+        }
+        thread_yield();
+        goto restart;
+      }
+      if (!parent && node != root_.load(std::memory_order_acquire)) {
+        // Someone else has just grown the tree.
+        inner->lock.write_unlock();
+        goto restart;
+      }
+      K separator;
+      auto *right = inner->split(&separator);
+      if (parent) {
+        parent->insert_at(pos, separator, right);
+      } else {
+        make_root(separator, inner, right);
+      }
+      inner->lock.write_unlock();
+      if (parent) {
+        parent->lock.write_unlock();
+      }
+      goto restart;
+    }
+    if (parent) {
+      parent->lock.check_or_restart(parent_version, restart);
+      if (restart) {
+        goto restart;
+      }
+    }
+    pos = inner->lower_bound(key);
+    auto *child = ACCESS_ONCE(inner->children[pos]);
+    if (unlikely(!child)) {
+      goto restart;
+    }
+    // Reads the child's version before validating inner. A split of the
+    // child either completes before the read, in which case it has bumped
+    // inner's version too, or bumps the child's version afterwards and fails
+    // the later upgrade.
+    auto child_version = child->lock.read_lock_or_restart(restart);
+    if (restart) {
+      thread_yield();
+      goto restart;
+    }
+    inner->lock.check_or_restart(version, restart);
+    if (restart) {
+      goto restart;
+    }
+    parent = inner;
+    parent_version = version;
+    node = child;
+    version = child_version;
+  }
+
+  auto *leaf = static_cast<LeafNode *>(node);
+  if (ACCESS_ONCE(leaf->num_entries) == kLeafCapacity) {
+    if (!spare_leaf) {
+      // Allocated before taking any lock, as it may block on the GC.
+      spare_leaf.reset(allocate_leaf());
+    }
+    if (parent) {
+      parent->lock.upgrade_to_write_lock_or_restart(parent_version, restart);
+      if (restart) {
+        thread_yield();
+        goto restart;
+      }
+    }
+    leaf->lock.upgrade_to_write_lock_or_restart(version, restart);
+    if (restart) {
+      if (parent) {
+        parent->lock.write_unlock();
+      }
+      thread_yield();
+      goto restart;
+    }
+    if (!parent && node != root_.load(std::memory_order_acquire)) {
+      leaf->lock.write_unlock();
+      goto restart;
+    }
+    auto *right = spare_leaf.release();
+    auto separator = split_leaf(scope, leaf, right);
+    if (parent) {
+      parent->insert_at(pos, separator, right);
+    } else {
+      make_root(separator, leaf, right);
+    }
+    leaf->lock.write_unlock();
+    if (parent) {
+      parent->lock.write_unlock();
+    }
+    goto restart;
+  }
+
+  leaf->lock.upgrade_to_write_lock_or_restart(version, restart);
+  if (restart) {
+    thread_yield();
+    goto restart;
+  }
+  if (parent) {
+    // The leaf must still be the one the parent routes key to.
+    parent->lock.check_or_restart(parent_version, restart);
+    if (restart) {
+      leaf->lock.write_unlock();
+      thread_yield();
+      goto restart;
+    }
+  }
+  auto *data = static_cast<LeafData *>(leaf->ptr.deref_mut(scope));
+  auto num = leaf->num_entries;
+  auto idx = upper_bound(data->keys, num, key);
+  memmove(data->keys + idx + 1, data->keys + idx, (num - idx) * sizeof(K));
+  memmove(data->vals + idx + 1, data->vals + idx, (num - idx) * sizeof(V));
+  data->keys[idx] = key;
+  data->vals[idx] = val;
+  leaf->num_entries = num + 1;
+  leaf->lock.write_unlock();
+  size_.fetch_add(1, std::memory_order_relaxed);
+}
+
+template <typename K, typename V>
+FORCE_INLINE BPlusTree<K, V>::LeafNode *
+BPlusTree<K, V>::find_leaf(const K &key) {
+  // A leaf only ever hands its upper keys over to its new right sibling, so
+  // the leftmost leaf that may hold key stays a valid starting point of a
+  // rightward walk even if it gets split afterwards. Only the inner nodes
+  // along the path need to be validated.
+restart:
+  bool restart = false;
+  auto *node = root_.load(std::memory_order_acquire);
+  auto version = node->lock.read_lock_or_restart(restart);
+  if (restart || node != root_.load(std::memory_order_acquire)) {
+    thread_yield();
+    goto restart;
+  }
+  while (!node->is_leaf) {
+    auto *inner = static_cast<InnerNode *>(node);
+    auto *child = ACCESS_ONCE(inner->children[inner->lower_bound(key)]);
+    inner->lock.check_or_restart(version, restart);
+    if (restart) {
+      thread_yield();
+      goto restart;
+    }
+    node = child;
+    version = node->lock.read_lock_or_restart(restart);
+    if (restart) {
+      thread_yield();
+      goto restart;
+    }
+  }
+  return static_cast<LeafNode *>(node);
+}
+
+template <typename K, typename V>
+FORCE_INLINE void BPlusTree<K, V>::prefetch_leaves(LeafNode *leaf,
+                                                   LeafNode **cursor,
+                                                   uint32_t *num_ahead,
+                                                   uint32_t window) {
+  if (!*num_ahead) {
+    *cursor = leaf;
+  }
+  GenericUniquePtr *ptrs[kMaxScanPrefetchDepth];
+  bool *inflights[kMaxScanPrefetchDepth];
+  uint32_t num = 0;
+  while (*num_ahead < window) {
+    auto *next = (*cursor)->next.load(std::memory_order_acquire);
+    if (!next) {
+      break;
+    }
+    *cursor = next;
+    (*num_ahead)++;
+    if (!next->ptr.meta().is_present() &&
+        !__atomic_test_and_set(&next->inflight, __ATOMIC_ACQUIRE)) {
+      ptrs[num] = &next->ptr;
+      inflights[num] = &next->inflight;
+      num++;
+    }
+  }
+  if (num) {
+    PrefetchService::get()->submit(/* stream = */ nullptr, ptrs, num,
+                                   /* nt = */ false, kIOPrefetch, inflights);
+  }
+}
+
+template <typename K, typename V>
+template <bool Renew, typename Fn>
+FORCE_INLINE void BPlusTree<K, V>::_scan(const DerefScope &scope, const K &lo,
+                                         const K &hi, Fn &&fn) {
+  LeafData snapshot;
+  auto *leaf = find_leaf(lo);
+  LeafNode *cursor = leaf;
+  uint32_t num_ahead = 0;
+  uint32_t window = 1;
+
+  while (leaf) {
+    bool restart = false;
+    auto version = leaf->lock.read_lock_or_restart(restart);
+    if (restart) {
+      thread_yield();
+      continue;
+    }
+    uint32_t num = ACCESS_ONCE(leaf->num_entries);
+    num = std::min(num, kLeafCapacity);
+    auto *next = leaf->next.load(std::memory_order_acquire);
+    if constexpr (Renew) {
+      prefetch_leaves(leaf, &cursor, &num_ahead, window);
+      window = std::min(window * 2, kMaxScanPrefetchDepth);
+    }
+    auto *data = static_cast<const LeafData *>(leaf->ptr.deref(scope));
+    auto begin = lower_bound(data->keys, num, lo);
+    memcpy(snapshot.keys, data->keys + begin, (num - begin) * sizeof(K));
+    memcpy(snapshot.vals, data->vals + begin, (num - begin) * sizeof(V));
+    leaf->lock.check_or_restart(version, restart);
+    if (restart) {
+      // Only retries this leaf, as the others stay intact.
+      thread_yield();
+      continue;
+    }
+    for (uint32_t i = 0; i < num - begin; i++) {
+      if (hi < snapshot.keys[i] || !fn(snapshot.keys[i], snapshot.vals[i])) {
+        return;
+      }
+    }
+    leaf = next;
+    if (num_ahead) {
+      num_ahead--;
+    }
+    if constexpr (Renew) {
+      const_cast<DerefScope &>(scope).renew();
+    }
+  }
+}
+
+template <typename K, typename V>
+template <typename Fn>
+FORCE_INLINE void BPlusTree<K, V>::scan(DerefScope &scope, const K &lo,
+                                        const K &hi, Fn &&fn) {
+  _scan</* Renew = */ true>(scope, lo, hi, std::forward<Fn>(fn));
+}
+
+template <typename K, typename V>
+FORCE_INLINE bool BPlusTree<K, V>::find(const DerefScope &scope, const K &key,
+                                        V *val) {
+  bool found = false;
+  _scan</* Renew = */ false>(scope, key, key,
+                             [&](const K &k, const V &v) {
+                               *val = v;
+                               found = true;
+                               return false;
+                             });
+  return found;
+}
+
+template <typename K, typename V>
+FORCE_INLINE bool BPlusTree<K, V>::remove(const DerefScope &scope,
+                                          const K &key) {
+  auto *leaf = find_leaf(key);
+  while (true) {
+    bool restart = false;
+    auto version = leaf->lock.read_lock_or_restart(restart);
+    if (!restart) {
+      leaf->lock.upgrade_to_write_lock_or_restart(version, restart);
+    }
+    if (restart) {
+      thread_yield();
+      continue;
+    }
+    auto *data = static_cast<LeafData *>(leaf->ptr.deref_mut(scope));
+    auto num = leaf->num_entries;
+    auto idx = lower_bound(data->keys, num, key);
+    if (idx < num) {
+      bool found = is_equal(data->keys[idx], key);
+      if (found) {
+        memmove(data->keys + idx, data->keys + idx + 1,
+                (num - idx - 1) * sizeof(K));
+        memmove(data->vals + idx, data->vals + idx + 1,
+                (num - idx - 1) * sizeof(V));
+        leaf->num_entries = num - 1;
+        size_.fetch_sub(1, std::memory_order_relaxed);
+      }
+      leaf->lock.write_unlock();
+      return found;
+    }
+    // All entries here are smaller, but the next leaf may still hold key.
+    auto *next = leaf->next.load(std::memory_order_acquire);
+    leaf->lock.write_unlock();
+    if (!next) {
+      return false;
+    }
+    leaf = next;
+  }
+}
+
+template <typename K, typename V>
+template <typename ReadValsFn>
+FORCE_INLINE void BPlusTree<K, V>::_bulk_load(DataFrameVector<K> &keys,
+                                              ReadValsFn &&read_vals,
+                                              double fill_factor) {
+  assert(!DerefScope::is_in_deref_scope());
+  BUG_ON(!empty() || !root_.load()->is_leaf);
+  auto num_per_leaf = std::clamp(static_cast<uint32_t>(kLeafCapacity *
+                                                       fill_factor),
+                                 static_cast<uint32_t>(1), kLeafCapacity);
+  auto num_per_batch = static_cast<uint64_t>(num_per_leaf) *
+                       kNumLeavesPerLoadBatch;
+  std::unique_ptr<K[]> key_buf(new K[num_per_batch]);
+  std::unique_ptr<V[]> val_buf(new V[num_per_batch]);
+  // The upper bound key and node of each subtree of the level being built.
+  std::vector<std::pair<K, Node *>> level;
+
+  auto *leaf = head_;
+  for (uint64_t i = 0; i < keys.size(); i += num_per_batch) {
+    auto len = std::min(num_per_batch, keys.size() - i);
+    keys.read_range(i, len, key_buf.get());
+    read_vals(i, len, val_buf.get());
+    for (uint64_t j = 0; j < len; j += num_per_leaf) {
+      auto num = static_cast<uint32_t>(
+          std::min(static_cast<uint64_t>(num_per_leaf), len - j));
+      for (uint64_t k = j + 1; k < j + num; k++) {
+        BUG_ON(key_buf[k] < key_buf[k - 1]);
+      }
+      if (!level.empty()) {
+        BUG_ON(key_buf[j] < level.back().first);
+        auto *new_leaf = allocate_leaf();
+        leaf->next.store(new_leaf, std::memory_order_relaxed);
+        leaf = new_leaf;
+      }
+      {
+        DerefScope scope;
+        auto *data = static_cast<LeafData *>(leaf->ptr.deref_mut(scope));
+        memcpy(data->keys, key_buf.get() + j, num * sizeof(K));
+        memcpy(data->vals, val_buf.get() + j, num * sizeof(V));
+      }
+      leaf->num_entries = num;
+      level.emplace_back(key_buf[j + num - 1], leaf);
+    }
+  }
+  size_ = keys.size();
+
+  // Builds the inner levels bottom-up.
+  auto num_per_inner = std::clamp(
+      static_cast<uint32_t>(kInnerFanout * fill_factor),
+      static_cast<uint32_t>(2), kInnerFanout);
+  while (level.size() > 1) {
+    std::vector<std::pair<K, Node *>> upper_level;
+    for (uint64_t i = 0; i < level.size(); i += num_per_inner) {
+      auto num = std::min(static_cast<uint64_t>(num_per_inner),
+                          level.size() - i);
+      auto *inner = new InnerNode();
+      for (uint32_t j = 0; j < num; j++) {
+        inner->children[j] = level[i + j].second;
+        if (j + 1 < num) {
+          inner->keys[j] = level[i + j].first;
+        }
+      }
+      inner->num_keys = num - 1;
+      upper_level.emplace_back(level[i + num - 1].first, inner);
+    }
+    level = std::move(upper_level);
+  }
+  if (!level.empty()) {
+    root_.store(level.front().second, std::memory_order_release);
+  }
+}
+
+template <typename K, typename V>
+FORCE_INLINE void BPlusTree<K, V>::bulk_load(DataFrameVector<K> &keys,
+                                             DataFrameVector<V> &vals,
+                                             double fill_factor) {
+  BUG_ON(keys.size() != vals.size());
+  _bulk_load(
+      keys,
+      [&](uint64_t begin, uint64_t num, V *out) {
+        vals.read_range(begin, num, out);
+      },
+      fill_factor);
+}
+
+template <typename K, typename V>
+FORCE_INLINE void BPlusTree<K, V>::bulk_load(DataFrameVector<K> &keys,
+                                             double fill_factor) {
+  static_assert(std::is_integral_v<V>);
+  _bulk_load(
+      keys,
+      [&](uint64_t begin, uint64_t num, V *out) {
+        for (uint64_t i = 0; i < num; i++) {
+          out[i] = begin + i;
+        }
+      },
+      fill_factor);
+}
+
+} // namespace far_memory
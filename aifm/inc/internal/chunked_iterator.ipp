@@ -0,0 +1,179 @@
+#pragma once
+
+namespace far_memory {
+
+template <typename Vec, typename T, uint32_t ChunkNumEntries, bool Mut>
+template <bool Nt>
+FORCE_INLINE void
+ChunkedFastIterator<Vec, T, ChunkNumEntries, Mut>::update_on_new_chunk() {
+  auto chunk_idx = chunk_ptr_ - vec_->chunk_ptrs_.data();
+  if (likely(chunk_idx >= 0 &&
+             static_cast<uint64_t>(chunk_idx) < vec_->chunk_ptrs_.size())) {
+    vec_->prefetch_record(Nt, chunk_idx);
+    if constexpr (Mut) {
+      data_ptr_begin_ =
+          reinterpret_cast<T *>(chunk_ptr_->template deref_mut<Nt>(*scope_));
+    } else {
+      data_ptr_begin_ =
+          reinterpret_cast<const T *>(chunk_ptr_->template deref<Nt>(*scope_));
+    }
+    data_ptr_end_ = data_ptr_begin_ + ChunkNumEntries;
+  } else {
+    data_ptr_begin_ = data_ptr_end_ = nullptr;
+  }
+}
+
+template <typename Vec, typename T, uint32_t ChunkNumEntries, bool Mut>
+template <bool Nt>
+FORCE_INLINE
+ChunkedFastIterator<Vec, T, ChunkNumEntries, Mut>::ChunkedFastIterator(
+    DerefScope &scope, std::conditional<Mut, Vec *, const Vec *>::type vec,
+    uint64_t idx)
+    : scope_(&scope), vec_(const_cast<Vec *>(vec)) {
+  // It's superfast since the chunk size is a power of 2.
+  chunk_ptr_ = vec_->chunk_ptrs_.data() + idx / ChunkNumEntries;
+  update_on_new_chunk<Nt>();
+  data_ptr_ = data_ptr_begin_ + idx % ChunkNumEntries;
+}
+
+template <typename Vec, typename T, uint32_t ChunkNumEntries, bool Mut>
+FORCE_INLINE uint64_t
+ChunkedFastIterator<Vec, T, ChunkNumEntries, Mut>::get_idx() const {
+  return (data_ptr_ - data_ptr_begin_) +
+         (chunk_ptr_ - vec_->chunk_ptrs_.data()) * ChunkNumEntries;
+}
+
+template <typename Vec, typename T, uint32_t ChunkNumEntries, bool Mut>
+template <bool Nt>
+FORCE_INLINE ChunkedFastIterator<Vec, T, ChunkNumEntries, Mut> &
+ChunkedFastIterator<Vec, T, ChunkNumEntries, Mut>::operator++() {
+  data_ptr_++;
+  if (very_unlikely(data_ptr_ == data_ptr_end_)) {
+    chunk_ptr_++;
+    update_on_new_chunk<Nt>();
+    data_ptr_ = data_ptr_begin_;
+  }
+  return *this;
+}
+
+template <typename Vec, typename T, uint32_t ChunkNumEntries, bool Mut>
+template <bool Nt>
+FORCE_INLINE ChunkedFastIterator<Vec, T, ChunkNumEntries, Mut>
+ChunkedFastIterator<Vec, T, ChunkNumEntries, Mut>::operator++(int) {
+  auto retval = *this;
+  this->template operator++<Nt>();
+  return retval;
+}
+
+template <typename Vec, typename T, uint32_t ChunkNumEntries, bool Mut>
+template <bool Nt>
+FORCE_INLINE ChunkedFastIterator<Vec, T, ChunkNumEntries, Mut> &
+ChunkedFastIterator<Vec, T, ChunkNumEntries, Mut>::operator--() {
+  if (very_unlikely(data_ptr_ == data_ptr_begin_)) {
+    chunk_ptr_--;
+    update_on_new_chunk<Nt>();
+    data_ptr_ = data_ptr_end_;
+  }
+  data_ptr_--;
+  return *this;
+}
+
+template <typename Vec, typename T, uint32_t ChunkNumEntries, bool Mut>
+template <bool Nt>
+FORCE_INLINE ChunkedFastIterator<Vec, T, ChunkNumEntries, Mut>
+ChunkedFastIterator<Vec, T, ChunkNumEntries, Mut>::operator--(int) {
+  auto retval = *this;
+  this->template operator--<Nt>();
+  return retval;
+}
+
+template <typename Vec, typename T, uint32_t ChunkNumEntries, bool Mut>
+template <bool Nt>
+FORCE_INLINE ChunkedFastIterator<Vec, T, ChunkNumEntries, Mut> &
+ChunkedFastIterator<Vec, T, ChunkNumEntries, Mut>::operator+=(
+    difference_type dis) {
+  *this = ChunkedFastIterator(*scope_, vec_, get_idx() + dis);
+  return *this;
+}
+
+template <typename Vec, typename T, uint32_t ChunkNumEntries, bool Mut>
+template <bool Nt>
+FORCE_INLINE ChunkedFastIterator<Vec, T, ChunkNumEntries, Mut>
+ChunkedFastIterator<Vec, T, ChunkNumEntries, Mut>::operator+(
+    difference_type dis) const {
+  auto ret = *this;
+  ret.template operator+=<Nt>(dis);
+  return ret;
+}
+
+template <typename Vec, typename T, uint32_t ChunkNumEntries, bool Mut>
+FORCE_INLINE bool ChunkedFastIterator<Vec, T, ChunkNumEntries, Mut>::
+operator==(const ChunkedFastIterator &other) const {
+  return data_ptr_ == other.data_ptr_;
+}
+
+template <typename Vec, typename T, uint32_t ChunkNumEntries, bool Mut>
+FORCE_INLINE bool ChunkedFastIterator<Vec, T, ChunkNumEntries, Mut>::
+operator!=(const ChunkedFastIterator &other) const {
+  return !(*this == other);
+}
+
+template <typename Vec, typename T, uint32_t ChunkNumEntries, bool Mut>
+FORCE_INLINE bool ChunkedFastIterator<Vec, T, ChunkNumEntries, Mut>::
+operator<(const ChunkedFastIterator &other) const {
+  if (chunk_ptr_ == other.chunk_ptr_) {
+    return data_ptr_ < other.data_ptr_;
+  }
+  return chunk_ptr_ < other.chunk_ptr_;
+}
+
+template <typename Vec, typename T, uint32_t ChunkNumEntries, bool Mut>
+FORCE_INLINE bool ChunkedFastIterator<Vec, T, ChunkNumEntries, Mut>::
+operator<=(const ChunkedFastIterator &other) const {
+  if (chunk_ptr_ == other.chunk_ptr_) {
+    return data_ptr_ <= other.data_ptr_;
+  }
+  return chunk_ptr_ < other.chunk_ptr_;
+}
+
+template <typename Vec, typename T, uint32_t ChunkNumEntries, bool Mut>
+FORCE_INLINE bool ChunkedFastIterator<Vec, T, ChunkNumEntries, Mut>::
+operator>(const ChunkedFastIterator &other) const {
+  if (chunk_ptr_ == other.chunk_ptr_) {
+    return data_ptr_ > other.data_ptr_;
+  }
+  return chunk_ptr_ > other.chunk_ptr_;
+}
+
+template <typename Vec, typename T, uint32_t ChunkNumEntries, bool Mut>
+FORCE_INLINE bool ChunkedFastIterator<Vec, T, ChunkNumEntries, Mut>::
+operator>=(const ChunkedFastIterator &other) const {
+  if (chunk_ptr_ == other.chunk_ptr_) {
+    return data_ptr_ >= other.data_ptr_;
+  }
+  return chunk_ptr_ > other.chunk_ptr_;
+}
+
+template <typename Vec, typename T, uint32_t ChunkNumEntries, bool Mut>
+template <bool Nt>
+FORCE_INLINE void
+ChunkedFastIterator<Vec, T, ChunkNumEntries, Mut>::renew(DerefScope &scope) {
+  auto offset = data_ptr_ - data_ptr_begin_;
+  scope_ = &scope;
+  update_on_new_chunk<Nt>();
+  data_ptr_ = data_ptr_begin_ + offset;
+}
+
+template <typename Vec, typename T, uint32_t ChunkNumEntries, bool Mut>
+FORCE_INLINE ChunkedFastIterator<Vec, T, ChunkNumEntries, Mut>::Elem_t &
+ChunkedFastIterator<Vec, T, ChunkNumEntries, Mut>::operator*() const {
+  return *data_ptr_;
+}
+
+template <typename Vec, typename T, uint32_t ChunkNumEntries, bool Mut>
+FORCE_INLINE ChunkedFastIterator<Vec, T, ChunkNumEntries, Mut>::Elem_t *
+ChunkedFastIterator<Vec, T, ChunkNumEntries, Mut>::operator->() const {
+  return data_ptr_;
+}
+
+} // namespace far_memory
@@ -69,6 +69,14 @@ FORCE_INLINE bool GenericConcurrentHopscotch::remove_tp(uint8_t key_len,
   return remove(scope, key_len, key);
 }
 
+FORCE_INLINE bool GenericConcurrentHopscotch::is_attached() const {
+  return attached_;
+}
+
+FORCE_INLINE void GenericConcurrentHopscotch::set_persistent(bool persistent) {
+  persistent_ = persistent;
+}
+
 FORCE_INLINE void GenericConcurrentHopscotch::process_evac_notifier_stash() {
   if (unlikely(evac_notifier_stash_.size())) {
     EvacNotifierMeta meta;
@@ -129,6 +137,9 @@ FORCE_INLINE bool GenericConcurrentHopscotch::__get(uint8_t key_len,
                         reinterpret_cast<const char *>(key), key_len) == 0) {
               *val_len = obj_data_len - sizeof(EvacNotifierMeta);
               memcpy(val, obj_val_ptr, *val_len);
+              if (admission_filter_) {
+                admission_filter_->record(hash);
+              }
               return true;
             }
           }
@@ -158,9 +169,18 @@ FORCE_INLINE bool GenericConcurrentHopscotch::__get(uint8_t key_len,
 template <typename K, typename V>
 FORCE_INLINE ConcurrentHopscotch<K, V>::ConcurrentHopscotch(
     uint8_t ds_id, uint32_t local_num_entries_shift,
-    uint32_t remote_num_entries_shift, uint64_t remote_data_size)
+    uint32_t remote_num_entries_shift, uint64_t remote_data_size,
+    std::string_view name)
     : GenericConcurrentHopscotch(ds_id, local_num_entries_shift,
-                                 remote_num_entries_shift, remote_data_size) {}
+                                 remote_num_entries_shift, remote_data_size,
+                                 name) {
+  per_core_size_[0].data = persisted_size_;
+}
+
+template <typename K, typename V>
+FORCE_INLINE ConcurrentHopscotch<K, V>::~ConcurrentHopscotch() {
+  persisted_size_ = size();
+}
 
 template <typename K, typename V>
 FORCE_INLINE std::optional<V> ConcurrentHopscotch<K, V>::_find(const K &key) {
@@ -0,0 +1,44 @@
+#pragma once
+
+namespace far_memory {
+
+FORCE_INLINE uint64_t GenericConcurrentQueue::size() const {
+  return ACCESS_ONCE(num_pushed_) - ACCESS_ONCE(num_popped_);
+}
+
+FORCE_INLINE bool GenericConcurrentQueue::empty() const { return !size(); }
+
+FORCE_INLINE uint64_t GenericConcurrentQueue::depth() const {
+  return ACCESS_ONCE(tail_seq_) - ACCESS_ONCE(head_seq_) + 1;
+}
+
+template <typename T>
+FORCE_INLINE ConcurrentQueue<T>::ConcurrentQueue(const DerefScope &scope)
+    : GenericConcurrentQueue(scope, sizeof(T), kNumItemsPerSegment) {}
+
+template <typename T>
+FORCE_INLINE void ConcurrentQueue<T>::push(const DerefScope &scope,
+                                           const T &item) {
+  push_n(scope, &item, 1);
+}
+
+template <typename T>
+FORCE_INLINE void ConcurrentQueue<T>::push_n(const DerefScope &scope,
+                                             const T *items, uint32_t num) {
+  GenericConcurrentQueue::push_n(
+      scope, reinterpret_cast<const uint8_t *>(items), num);
+}
+
+template <typename T>
+FORCE_INLINE bool ConcurrentQueue<T>::pop(const DerefScope &scope, T *item) {
+  return pop_n(scope, item, 1);
+}
+
+template <typename T>
+FORCE_INLINE uint32_t ConcurrentQueue<T>::pop_n(const DerefScope &scope,
+                                                T *items, uint32_t num) {
+  return GenericConcurrentQueue::pop_n(
+      scope, reinterpret_cast<uint8_t *>(items), num);
+}
+
+} // namespace far_memory
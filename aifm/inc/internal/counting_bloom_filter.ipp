@@ -0,0 +1,59 @@
+#pragma once
+
+#include <limits>
+
+namespace far_memory {
+
+FORCE_INLINE uint8_t *CountingBloomFilter::block(uint32_t hash) const {
+  auto idx = (hash * kBlockSeed) >> (64 - num_blocks_shift_);
+  return counters_ + idx * kBlockSize;
+}
+
+FORCE_INLINE uint32_t CountingBloomFilter::offset(uint32_t hash,
+                                                  uint32_t i) const {
+  // Each hash takes 6 bits, i.e., one of the 64 counters of the block.
+  static_assert(kBlockSize == 64);
+  return ((hash * kOffsetSeed) >> (64 - 6 * (i + 1))) & (kBlockSize - 1);
+}
+
+FORCE_INLINE void CountingBloomFilter::add(uint32_t hash) {
+  auto *b = block(hash);
+  for (uint32_t i = 0; i < kNumHashes; i++) {
+    auto *c = &b[offset(hash, i)];
+    auto val = ACCESS_ONCE(*c);
+    do {
+      if (unlikely(val == std::numeric_limits<uint8_t>::max())) {
+        break;
+      }
+    } while (!__atomic_compare_exchange_n(c, &val, val + 1, /* weak = */ true,
+                                          __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+  }
+}
+
+FORCE_INLINE void CountingBloomFilter::remove(uint32_t hash) {
+  auto *b = block(hash);
+  for (uint32_t i = 0; i < kNumHashes; i++) {
+    auto *c = &b[offset(hash, i)];
+    auto val = ACCESS_ONCE(*c);
+    do {
+      // Lost the count of the keys sharing it.
+      if (unlikely(val == std::numeric_limits<uint8_t>::max())) {
+        break;
+      }
+      assert(val);
+    } while (!__atomic_compare_exchange_n(c, &val, val - 1, /* weak = */ true,
+                                          __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+  }
+}
+
+FORCE_INLINE bool CountingBloomFilter::may_contain(uint32_t hash) const {
+  auto *b = block(hash);
+  for (uint32_t i = 0; i < kNumHashes; i++) {
+    if (!ACCESS_ONCE(b[offset(hash, i)])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace far_memory
@@ -33,10 +33,11 @@ FORCE_INLINE GenericUniquePtr *DataFrameVector<T>::mapping_fn(uint8_t *&state,
 }
 
 template <typename T>
-FORCE_INLINE DataFrameVector<T>::DataFrameVector(FarMemManager *manager)
+FORCE_INLINE DataFrameVector<T>::DataFrameVector(FarMemManager *manager,
+                                                  std::string_view name)
     : GenericDataFrameVector(kRealChunkSize, kRealChunkNumEntries,
                              manager->allocate_ds_id(),
-                             get_dataframe_type_id<T>()),
+                             get_dataframe_type_id<T>(), name),
       prefetcher_(new Prefetcher<decltype(kInduceFn), decltype(kInferFn),
                                  decltype(kMappingFn)>(
           manager->get_device(), reinterpret_cast<uint8_t *>(&lock_),
@@ -52,11 +53,12 @@ template <typename T>
 template <typename U>
 FORCE_INLINE DataFrameVector<T>
 DataFrameVector<T>::aggregate_locally(FarMemManager *manager, const U &key_vec,
-                                      OpCode opcode) {
+                                      OpCode opcode, double quantile,
+                                      bool exact) {
   assert(size() == key_vec.size());
   auto result = DataFrameVector<T>(manager);
-  std::unique_ptr<Aggregator<T>> aggregator(
-      AggregatorFactory<T>::build(opcode, /* limited_mem */ true, manager));
+  std::unique_ptr<Aggregator<T>> aggregator(AggregatorFactory<T>::build(
+      opcode, /* limited_mem */ true, manager, quantile, exact));
   uint64_t i = 0;
   while (i < size_) {
     DerefScope scope;
@@ -82,6 +84,14 @@ DataFrameVector<T>::aggregate_locally(FarMemManager *manager, const U &key_vec,
 
 FORCE_INLINE void GenericDataFrameVector::clear() { size_ = 0; }
 
+FORCE_INLINE bool GenericDataFrameVector::is_attached() const {
+  return attached_;
+}
+
+FORCE_INLINE void GenericDataFrameVector::set_persistent(bool persistent) {
+  persistent_ = persistent;
+}
+
 FORCE_INLINE bool GenericDataFrameVector::empty() const { return size() == 0; }
 
 FORCE_INLINE uint64_t GenericDataFrameVector::size() const { return size_; }
@@ -90,9 +100,11 @@ FORCE_INLINE
 GenericDataFrameVector::GenericDataFrameVector(GenericDataFrameVector &&other)
     : chunk_size_(other.chunk_size_),
       chunk_num_entries_(other.chunk_num_entries_), device_(other.device_),
-      ds_id_(other.ds_id_), size_(other.size_),
+      ds_id_(other.ds_id_), dt_id_(other.dt_id_), size_(other.size_),
+      remote_vec_capacity_(other.remote_vec_capacity_),
       chunk_ptrs_(std::move(other.chunk_ptrs_)), moved_(false),
-      dirty_(other.dirty_) {
+      dirty_(other.dirty_), name_(std::move(other.name_)),
+      persistent_(other.persistent_), attached_(other.attached_) {
   assert(!other.moved_);
   other.moved_ = true;
 }
@@ -104,10 +116,15 @@ operator=(GenericDataFrameVector &&other) {
   chunk_num_entries_ = other.chunk_num_entries_;
   device_ = other.device_;
   ds_id_ = other.ds_id_;
+  dt_id_ = other.dt_id_;
   size_ = other.size_;
+  remote_vec_capacity_ = other.remote_vec_capacity_;
   chunk_ptrs_ = std::move(other.chunk_ptrs_);
   moved_ = false;
   dirty_ = other.dirty_;
+  name_ = std::move(other.name_);
+  persistent_ = other.persistent_;
+  attached_ = other.attached_;
   other.moved_ = true;
   return *this;
 }
@@ -238,14 +255,6 @@ FORCE_INLINE T DataFrameVector<T>::Iterator::operator*() const {
   return *(reinterpret_cast<const T *>(raw_ptr) + chunk_offset_);
 }
 
-template <typename T>
-template <bool Mut>
-FORCE_INLINE uint64_t DataFrameVector<T>::FastIterator<Mut>::get_idx() const {
-  return (data_ptr_ - data_ptr_begin_) +
-         (chunk_ptr_ - &(dataframe_vec_->chunk_ptrs_.front())) *
-             kRealChunkNumEntries;
-}
-
 template <typename T>
 FORCE_INLINE DataFrameVector<T>::Iterator::difference_type
 DataFrameVector<T>::Iterator::operator-(const Iterator &other) const {
@@ -256,195 +265,6 @@ DataFrameVector<T>::Iterator::operator-(const Iterator &other) const {
           static_cast<int64_t>(other.chunk_offset_));
 }
 
-template <typename T>
-template <bool Mut>
-template <bool Nt>
-FORCE_INLINE void DataFrameVector<T>::FastIterator<Mut>::update_on_new_chunk() {
-  if (likely(chunk_ptr_ <= &dataframe_vec_->chunk_ptrs_.back() &&
-             chunk_ptr_ >= &dataframe_vec_->chunk_ptrs_.front())) {
-    dataframe_vec_->prefetcher_->add_trace(
-        Nt, chunk_ptr_ - &(dataframe_vec_->chunk_ptrs_.front()));
-    if constexpr (Mut) {
-      data_ptr_begin_ =
-          reinterpret_cast<T *>(chunk_ptr_->deref_mut<Nt>(*scope_));
-    } else {
-      data_ptr_begin_ =
-          reinterpret_cast<const T *>(chunk_ptr_->deref<Nt>(*scope_));
-    }
-    data_ptr_end_ = data_ptr_begin_ + kRealChunkNumEntries;
-  } else {
-    data_ptr_begin_ = data_ptr_end_ = nullptr;
-  }
-}
-
-template <typename T>
-template <bool Mut>
-template <bool Nt>
-FORCE_INLINE DataFrameVector<T>::FastIterator<Mut>::FastIterator(
-    DerefScope &scope,
-    std::conditional<Mut, DataFrameVector *, const DataFrameVector *>::type
-        dataframe_vec,
-    uint64_t idx)
-    : scope_(&scope),
-      dataframe_vec_(const_cast<DataFrameVector *>(dataframe_vec)) {
-  auto [chunk_idx, chunk_offset] = dataframe_vec_->get_chunk_stats(idx);
-  chunk_ptr_ = &(dataframe_vec_->chunk_ptrs_[chunk_idx]);
-  update_on_new_chunk<Nt>();
-  data_ptr_ = data_ptr_begin_ + chunk_offset;
-}
-
-template <typename T>
-template <bool Mut>
-template <bool Nt>
-FORCE_INLINE DataFrameVector<T>::template FastIterator<Mut> &
-DataFrameVector<T>::FastIterator<Mut>::operator++() {
-  data_ptr_++;
-  if (very_unlikely(data_ptr_ == data_ptr_end_)) {
-    chunk_ptr_++;
-    update_on_new_chunk<Nt>();
-    data_ptr_ = data_ptr_begin_;
-  }
-  return *this;
-}
-
-template <typename T>
-template <bool Mut>
-template <bool Nt>
-FORCE_INLINE DataFrameVector<T>::template FastIterator<Mut>
-DataFrameVector<T>::FastIterator<Mut>::operator++(int) {
-  FastIterator retval = *this;
-  this->operator++<Nt>();
-  return retval;
-}
-
-template <typename T>
-template <bool Mut>
-template <bool Nt>
-FORCE_INLINE DataFrameVector<T>::template FastIterator<Mut> &
-DataFrameVector<T>::FastIterator<Mut>::operator--() {
-  if (very_unlikely(data_ptr_ == data_ptr_begin_)) {
-    chunk_ptr_--;
-    update_on_new_chunk<Nt>();
-    data_ptr_ = data_ptr_end_;
-  }
-  data_ptr_--;
-  return *this;
-}
-
-template <typename T>
-template <bool Mut>
-template <bool Nt>
-FORCE_INLINE DataFrameVector<T>::template FastIterator<Mut>
-DataFrameVector<T>::FastIterator<Mut>::operator--(int) {
-  FastIterator retval = *this;
-  this->operator--<Nt>();
-  return retval;
-}
-
-template <typename T>
-template <bool Mut>
-template <bool Nt>
-FORCE_INLINE DataFrameVector<T>::template FastIterator<Mut> &
-DataFrameVector<T>::FastIterator<Mut>::operator+=(difference_type dis) {
-  *this = FastIterator<Mut>(*scope_, dataframe_vec_, dis + get_idx());
-  return *this;
-}
-
-template <typename T>
-template <bool Mut>
-template <bool Nt>
-FORCE_INLINE DataFrameVector<T>::template FastIterator<Mut>
-DataFrameVector<T>::FastIterator<Mut>::operator+(difference_type dis) const {
-  auto ret = *this;
-  ret.operator+=(dis);
-  return ret;
-}
-
-template <typename T>
-template <bool Mut>
-FORCE_INLINE bool DataFrameVector<T>::FastIterator<Mut>::
-operator==(const FastIterator<Mut> &other) const {
-  return data_ptr_ == other.data_ptr_;
-}
-
-template <typename T>
-template <bool Mut>
-FORCE_INLINE bool DataFrameVector<T>::FastIterator<Mut>::
-operator!=(const FastIterator<Mut> &other) const {
-  return !(*this == other);
-}
-
-template <typename T>
-template <bool Mut>
-FORCE_INLINE bool DataFrameVector<T>::FastIterator<Mut>::
-operator<(const FastIterator<Mut> &other) const {
-  if (chunk_ptr_ == other.chunk_ptr_) {
-    return data_ptr_ < other.data_ptr_;
-  }
-  return chunk_ptr_ < other.chunk_ptr_;
-}
-
-template <typename T>
-template <bool Mut>
-FORCE_INLINE bool DataFrameVector<T>::FastIterator<Mut>::
-operator<=(const FastIterator<Mut> &other) const {
-  if (chunk_ptr_ == other.chunk_ptr_) {
-    return data_ptr_ <= other.data_ptr_;
-  }
-  return chunk_ptr_ < other.chunk_ptr_;
-}
-
-template <typename T>
-template <bool Mut>
-FORCE_INLINE bool DataFrameVector<T>::FastIterator<Mut>::
-operator>(const FastIterator<Mut> &other) const {
-  if (chunk_ptr_ == other.chunk_ptr_) {
-    return data_ptr_ > other.data_ptr_;
-  }
-  return chunk_ptr_ > other.chunk_ptr_;
-}
-
-template <typename T>
-template <bool Mut>
-FORCE_INLINE bool DataFrameVector<T>::FastIterator<Mut>::
-operator>=(const FastIterator<Mut> &other) const {
-  if (chunk_ptr_ == other.chunk_ptr_) {
-    return data_ptr_ >= other.data_ptr_;
-  }
-  return chunk_ptr_ > other.chunk_ptr_;
-}
-
-template <typename T>
-template <bool Mut>
-template <bool Nt>
-FORCE_INLINE void
-DataFrameVector<T>::FastIterator<Mut>::renew(DerefScope &scope) {
-  auto offset = data_ptr_ - data_ptr_begin_;
-  if constexpr (Mut) {
-    data_ptr_begin_ =
-        reinterpret_cast<T *>(chunk_ptr_->template deref_mut<Nt>(*scope_));
-  } else {
-    data_ptr_begin_ =
-        reinterpret_cast<const T *>(chunk_ptr_->template deref<Nt>(*scope_));
-  }
-  data_ptr_ = data_ptr_begin_ + offset;
-  data_ptr_end_ = data_ptr_begin_ + kRealChunkNumEntries;
-}
-
-template <typename T>
-template <bool Mut>
-FORCE_INLINE std::conditional<Mut, T &, const T &>::type
-    DataFrameVector<T>::FastIterator<Mut>::operator*() const {
-  return *data_ptr_;
-}
-
-template <typename T>
-template <bool Mut>
-FORCE_INLINE std::conditional<Mut, T *, const T *>::type
-    DataFrameVector<T>::FastIterator<Mut>::operator->() const {
-  return data_ptr_;
-}
-
 template <typename T>
 FORCE_INLINE DataFrameVector<T> &DataFrameVector<T>::
 operator=(const DataFrameVector &other) {
@@ -516,6 +336,79 @@ FORCE_INLINE void DataFrameVector<T>::push_back(const DerefScope &scope,
   dirty_ = true;
 }
 
+template <typename T>
+FORCE_INLINE void DataFrameVector<T>::append(const T *data, uint64_t num) {
+  assert(!DerefScope::is_in_deref_scope());
+  if (unlikely(!num)) {
+    return;
+  }
+  auto old_size = size_;
+  if (size_ + num > capacity()) {
+    // A single expand() reserves the remote capacity once for the whole batch.
+    expand(std::max(size_ + num - capacity(),
+                    static_cast<uint64_t>(kNumEntriesPerExpansion)));
+  }
+  size_ += num;
+  write_range(old_size, num, data);
+}
+
+template <typename T>
+FORCE_INLINE void DataFrameVector<T>::append(std::span<const T> data) {
+  append(data.data(), data.size());
+}
+
+template <typename T>
+FORCE_INLINE void DataFrameVector<T>::read_range(uint64_t begin, uint64_t num,
+                                                 T *out) {
+  assert(!DerefScope::is_in_deref_scope());
+  assert(begin + num <= size_);
+  auto end = begin + num;
+  while (begin < end) {
+    auto chunk_begin = begin / kRealChunkNumEntries;
+    auto chunk_end = std::min((end - 1) / kRealChunkNumEntries + 1,
+                              chunk_begin + kNumChunksPerRangeBatch);
+    // Fetch all missing chunks of the batch concurrently before copying.
+    swap_in_chunks(chunk_begin, chunk_end);
+    DerefScope scope;
+    for (auto chunk_idx = chunk_begin; chunk_idx < chunk_end; chunk_idx++) {
+      auto chunk_offset = begin % kRealChunkNumEntries;
+      auto len = std::min(end - begin, kRealChunkNumEntries - chunk_offset);
+      auto *raw_ptr = chunk_ptrs_[chunk_idx].deref(scope);
+      memcpy(out, reinterpret_cast<const T *>(raw_ptr) + chunk_offset,
+             len * sizeof(T));
+      out += len;
+      begin += len;
+      scope.renew();
+    }
+  }
+}
+
+template <typename T>
+FORCE_INLINE void DataFrameVector<T>::write_range(uint64_t begin, uint64_t num,
+                                                  const T *in) {
+  assert(!DerefScope::is_in_deref_scope());
+  assert(begin + num <= size_);
+  auto end = begin + num;
+  while (begin < end) {
+    auto chunk_begin = begin / kRealChunkNumEntries;
+    auto chunk_end = std::min((end - 1) / kRealChunkNumEntries + 1,
+                              chunk_begin + kNumChunksPerRangeBatch);
+    swap_in_chunks(chunk_begin, chunk_end);
+    DerefScope scope;
+    for (auto chunk_idx = chunk_begin; chunk_idx < chunk_end; chunk_idx++) {
+      auto chunk_offset = begin % kRealChunkNumEntries;
+      auto len = std::min(end - begin, kRealChunkNumEntries - chunk_offset);
+      auto *raw_mut_ptr = chunk_ptrs_[chunk_idx].deref_mut(scope);
+      memcpy(reinterpret_cast<T *>(raw_mut_ptr) + chunk_offset, in,
+             len * sizeof(T));
+      in += len;
+      begin += len;
+      scope.renew();
+    }
+  }
+  dirty_ = true;
+}
+
 template <typename T>
 FORCE_INLINE void DataFrameVector<T>::pop_back(const DerefScope &scope) {
   size_--;
@@ -782,7 +675,9 @@ FORCE_INLINE DataFrameVector<T> DataFrameVector<T>::copy_data_by_idx_locally(
       to_it.renew(scope);
       idx_it.renew(scope);
     }
-    *to_it = at(scope, *idx_it);
+    auto idx = *idx_it;
+    *to_it =
+        (idx == kJoinNullIdx) ? HashJoiner<T>::null_value() : at(scope, idx);
   }
 
   return ret;
@@ -870,6 +765,301 @@ DataFrameVector<T>::shuffle_data_by_idx_remotely(
   return ret;
 }
 
+template <typename T>
+FORCE_INLINE std::pair<DataFrameVector<unsigned long long>,
+                       DataFrameVector<unsigned long long>>
+DataFrameVector<T>::hash_group(
+    FarMemManager *manager, DataFrameVector<unsigned long long> *prev_group_ids) {
+  assert(!prev_group_ids || prev_group_ids->size() == size_);
+  if constexpr (DISABLE_OFFLOAD_AGGREGATE) {
+    return hash_group_locally(manager, prev_group_ids);
+  } else {
+    return hash_group_remotely(manager, prev_group_ids);
+  }
+}
+
+template <typename T>
+FORCE_INLINE std::pair<DataFrameVector<unsigned long long>,
+                       DataFrameVector<unsigned long long>>
+DataFrameVector<T>::hash_group_locally(
+    FarMemManager *manager, DataFrameVector<unsigned long long> *prev_group_ids) {
+  auto group_ids = DataFrameVector<unsigned long long>(manager);
+  auto first_idx = DataFrameVector<unsigned long long>(manager);
+  DerefScope scope;
+  uint64_t num_ops = 0;
+  HashGrouper<T>::group(
+      size_,
+      [&](uint64_t idx) -> T {
+        if (unlikely(++num_ops % kNumElementsPerScope == 0)) {
+          scope.renew();
+        }
+        return at(scope, idx);
+      },
+      [&](uint64_t idx) -> unsigned long long {
+        return prev_group_ids ? prev_group_ids->at(scope, idx) : 0;
+      },
+      [&](unsigned long long group_id) {
+        group_ids.push_back(scope, group_id);
+      },
+      [&](unsigned long long idx) { first_idx.push_back(scope, idx); });
+  return std::make_pair(std::move(group_ids), std::move(first_idx));
+}
+
+template <typename T>
+FORCE_INLINE std::pair<DataFrameVector<unsigned long long>,
+                       DataFrameVector<unsigned long long>>
+DataFrameVector<T>::hash_group_remotely(
+    FarMemManager *manager, DataFrameVector<unsigned long long> *prev_group_ids) {
+  flush();
+  if (prev_group_ids) {
+    prev_group_ids->flush();
+  }
+  auto group_ids = DataFrameVector<unsigned long long>(manager);
+  auto first_idx = DataFrameVector<unsigned long long>(manager);
+  uint8_t has_prev = (prev_group_ids != nullptr);
+  uint8_t prev_ds_id = has_prev ? prev_group_ids->ds_id_ : 0;
+  uint8_t input_data[sizeof(group_ids.ds_id_) + sizeof(first_idx.ds_id_) +
+                     sizeof(has_prev) + sizeof(prev_ds_id) + sizeof(size_)];
+  uint16_t input_len = sizeof(input_data);
+  input_data[0] = group_ids.ds_id_;
+  input_data[1] = first_idx.ds_id_;
+  input_data[2] = has_prev;
+  input_data[3] = prev_ds_id;
+  __builtin_memcpy(input_data + 4, &size_, sizeof(size_));
+  uint16_t output_len;
+  uint64_t output_data[3];
+  device_->compute(ds_id_, OpCode::HashGroup, input_len, input_data,
+                   &output_len, reinterpret_cast<uint8_t *>(output_data));
+  assert(output_len == sizeof(output_data));
+  group_ids.size_ = size_;
+  group_ids.remote_vec_capacity_ = output_data[1];
+  group_ids.expand_no_alloc(group_ids.remote_vec_capacity_);
+  first_idx.size_ = output_data[0];
+  first_idx.remote_vec_capacity_ = output_data[2];
+  first_idx.expand_no_alloc(first_idx.remote_vec_capacity_);
+  return std::make_pair(std::move(group_ids), std::move(first_idx));
+}
+
+template <typename T>
+FORCE_INLINE DataFrameVector<T> DataFrameVector<T>::aggregate_by_group(
+    FarMemManager *manager, DataFrameVector<unsigned long long> &group_ids,
+    uint64_t num_groups, AggregateOp op) {
+  assert(group_ids.size() == size_);
+  BUG_ON(op == AggCount || op == AggQuantile);
+  if constexpr (DISABLE_OFFLOAD_AGGREGATE) {
+    return aggregate_by_group_locally(manager, group_ids, num_groups, op);
+  } else {
+    return aggregate_by_group_remotely<T>(manager, group_ids, num_groups, op);
+  }
+}
+
+template <typename T>
+FORCE_INLINE DataFrameVector<unsigned long long>
+DataFrameVector<T>::count_by_group(
+    FarMemManager *manager, DataFrameVector<unsigned long long> &group_ids,
+    uint64_t num_groups) {
+  assert(group_ids.size() == size_);
+  if constexpr (DISABLE_OFFLOAD_AGGREGATE) {
+    return count_by_group_locally(manager, group_ids, num_groups);
+  } else {
+    return aggregate_by_group_remotely<unsigned long long>(
+        manager, group_ids, num_groups, AggCount);
+  }
+}
+
+template <typename T>
+FORCE_INLINE DataFrameVector<T> DataFrameVector<T>::quantile_by_group(
+    FarMemManager *manager, DataFrameVector<unsigned long long> &group_ids,
+    uint64_t num_groups, double q, bool exact) {
+  assert(group_ids.size() == size_);
+  BUG_ON(q < 0 || q > 1);
+  if constexpr (DISABLE_OFFLOAD_AGGREGATE) {
+    return aggregate_by_group_locally(manager, group_ids, num_groups,
+                                      AggQuantile, q, exact);
+  } else {
+    return aggregate_by_group_remotely<T>(manager, group_ids, num_groups,
+                                          AggQuantile, q, exact);
+  }
+}
+
+template <typename T>
+FORCE_INLINE DataFrameVector<unsigned long long>
+DataFrameVector<T>::count_by_group_locally(
+    FarMemManager *manager, DataFrameVector<unsigned long long> &group_ids,
+    uint64_t num_groups) {
+  auto result = DataFrameVector<unsigned long long>(manager);
+  DerefScope scope;
+  uint64_t num_ops = 0;
+  HashGrouper<T>::count(
+      size_, num_groups,
+      [&](uint64_t idx) -> unsigned long long {
+        if (unlikely(++num_ops % kNumElementsPerScope == 0)) {
+          scope.renew();
+        }
+        return group_ids.at(scope, idx);
+      },
+      [&](uint64_t count) {
+        if (unlikely(++num_ops % kNumElementsPerScope == 0)) {
+          scope.renew();
+        }
+        result.push_back(scope, count);
+      });
+  return result;
+}
+
+template <typename T>
+FORCE_INLINE DataFrameVector<T> DataFrameVector<T>::aggregate_by_group_locally(
+    FarMemManager *manager, DataFrameVector<unsigned long long> &group_ids,
+    uint64_t num_groups, AggregateOp op, double q, bool exact) {
+  auto result = DataFrameVector<T>(manager);
+  DerefScope scope;
+  uint64_t num_ops = 0;
+  auto get_fn = [&](uint64_t idx) -> T {
+    if (unlikely(++num_ops % kNumElementsPerScope == 0)) {
+      scope.renew();
+    }
+    return at(scope, idx);
+  };
+  auto group_id_fn = [&](uint64_t idx) -> unsigned long long {
+    return group_ids.at(scope, idx);
+  };
+  auto emit_fn = [&](const T &value) {
+    if (unlikely(++num_ops % kNumElementsPerScope == 0)) {
+      scope.renew();
+    }
+    result.push_back(scope, value);
+  };
+  if (op == AggQuantile) {
+    HashGrouper<T>::quantile(size_, num_groups, q, exact, get_fn, group_id_fn,
+                             emit_fn);
+  } else {
+    HashGrouper<T>::aggregate(op, size_, num_groups, get_fn, group_id_fn,
+                              emit_fn);
+  }
+  return result;
+}
+
+template <typename T>
+template <typename U>
+FORCE_INLINE DataFrameVector<U> DataFrameVector<T>::aggregate_by_group_remotely(
+    FarMemManager *manager, DataFrameVector<unsigned long long> &group_ids,
+    uint64_t num_groups, AggregateOp op, double q, bool exact) {
+  flush();
+  group_ids.flush();
+  auto result = DataFrameVector<U>(manager);
+  uint8_t agg_op = op;
+  uint8_t exact_u8 = exact;
+  uint8_t input_data[sizeof(result.ds_id_) + sizeof(group_ids.ds_id_) +
+                     sizeof(agg_op) + sizeof(num_groups) + sizeof(size_) +
+                     sizeof(q) + sizeof(exact_u8)];
+  uint16_t input_len = sizeof(input_data);
+  input_data[0] = result.ds_id_;
+  input_data[1] = group_ids.ds_id_;
+  input_data[2] = agg_op;
+  auto *ptr = input_data + 3;
+  __builtin_memcpy(ptr, &num_groups, sizeof(num_groups));
+  ptr += sizeof(num_groups);
+  __builtin_memcpy(ptr, &size_, sizeof(size_));
+  ptr += sizeof(size_);
+  __builtin_memcpy(ptr, &q, sizeof(q));
+  ptr += sizeof(q);
+  *ptr = exact_u8;
+  uint16_t output_len;
+  uint64_t output_data[2];
+  device_->compute(ds_id_, OpCode::AggregateByGroup, input_len, input_data,
+                   &output_len, reinterpret_cast<uint8_t *>(output_data));
+  assert(output_len == sizeof(output_data));
+  result.size_ = output_data[0];
+  result.remote_vec_capacity_ = output_data[1];
+  result.expand_no_alloc(result.remote_vec_capacity_);
+  return result;
+}
+
+template <typename T>
+FORCE_INLINE std::pair<DataFrameVector<unsigned long long>,
+                       DataFrameVector<unsigned long long>>
+DataFrameVector<T>::hash_join(FarMemManager *manager, DataFrameVector<T> &rhs,
+                              JoinType type) {
+  if constexpr (DISABLE_OFFLOAD_JOIN) {
+    return hash_join_locally(manager, rhs, type);
+  } else {
+    return hash_join_remotely(manager, rhs, type);
+  }
+}
+
+template <typename T>
+FORCE_INLINE std::pair<DataFrameVector<unsigned long long>,
+                       DataFrameVector<unsigned long long>>
+DataFrameVector<T>::hash_join_locally(FarMemManager *manager,
+                                      DataFrameVector<T> &rhs, JoinType type) {
+  auto lhs_idx_vec = DataFrameVector<unsigned long long>(manager);
+  auto rhs_idx_vec = DataFrameVector<unsigned long long>(manager);
+  DerefScope scope;
+  uint64_t num_ops = 0;
+  auto maybe_renew = [&]() {
+    if (unlikely(++num_ops % kNumElementsPerScope == 0)) {
+      scope.renew();
+    }
+  };
+  HashJoiner<T>::join(
+      size_, rhs.size_,
+      [&](uint64_t idx) -> T {
+        maybe_renew();
+        return at(scope, idx);
+      },
+      [&](uint64_t idx) -> T {
+        maybe_renew();
+        return rhs.at(scope, idx);
+      },
+      type,
+      [&](unsigned long long lhs_idx, unsigned long long rhs_idx) {
+        maybe_renew();
+        lhs_idx_vec.push_back(scope, lhs_idx);
+        rhs_idx_vec.push_back(scope, rhs_idx);
+      });
+  return std::make_pair(std::move(lhs_idx_vec), std::move(rhs_idx_vec));
+}
+
+template <typename T>
+FORCE_INLINE std::pair<DataFrameVector<unsigned long long>,
+                       DataFrameVector<unsigned long long>>
+DataFrameVector<T>::hash_join_remotely(FarMemManager *manager,
+                                       DataFrameVector<T> &rhs,
+                                       JoinType type) {
+  flush();
+  rhs.flush();
+  auto lhs_idx_vec = DataFrameVector<unsigned long long>(manager);
+  auto rhs_idx_vec = DataFrameVector<unsigned long long>(manager);
+  uint8_t join_type = type;
+  uint8_t input_data[sizeof(lhs_idx_vec.ds_id_) + sizeof(rhs_idx_vec.ds_id_) +
+                     sizeof(rhs.ds_id_) + sizeof(join_type) + sizeof(size_) +
+                     sizeof(rhs.size_)];
+  uint16_t input_len = sizeof(input_data);
+  auto *ptr = input_data;
+  __builtin_memcpy(ptr, &lhs_idx_vec.ds_id_, sizeof(lhs_idx_vec.ds_id_));
+  ptr += sizeof(lhs_idx_vec.ds_id_);
+  __builtin_memcpy(ptr, &rhs_idx_vec.ds_id_, sizeof(rhs_idx_vec.ds_id_));
+  ptr += sizeof(rhs_idx_vec.ds_id_);
+  __builtin_memcpy(ptr, &rhs.ds_id_, sizeof(rhs.ds_id_));
+  ptr += sizeof(rhs.ds_id_);
+  __builtin_memcpy(ptr, &join_type, sizeof(join_type));
+  ptr += sizeof(join_type);
+  __builtin_memcpy(ptr, &size_, sizeof(size_));
+  ptr += sizeof(size_);
+  __builtin_memcpy(ptr, &rhs.size_, sizeof(rhs.size_));
+  uint16_t output_len;
+  uint64_t output_data[3];
+  device_->compute(ds_id_, OpCode::HashJoin, input_len, input_data,
+                   &output_len, reinterpret_cast<uint8_t *>(output_data));
+  assert(output_len == sizeof(output_data));
+  lhs_idx_vec.size_ = rhs_idx_vec.size_ = output_data[0];
+  lhs_idx_vec.remote_vec_capacity_ = output_data[1];
+  rhs_idx_vec.remote_vec_capacity_ = output_data[2];
+  lhs_idx_vec.expand_no_alloc(lhs_idx_vec.remote_vec_capacity_);
+  rhs_idx_vec.expand_no_alloc(rhs_idx_vec.remote_vec_capacity_);
+  return std::make_pair(std::move(lhs_idx_vec), std::move(rhs_idx_vec));
+}
+
 template <typename T>
 FORCE_INLINE void
 DataFrameVector<T>::assign(const DataFrameVector<T>::Iterator &begin,
@@ -998,15 +1188,18 @@ template <typename T>
 template <typename U>
 FORCE_INLINE DataFrameVector<T>
 DataFrameVector<T>::aggregate_remotely(FarMemManager *manager, const U &key_vec,
-                                       OpCode opcode) {
+                                       OpCode opcode, double quantile,
+                                       bool exact) {
   const_cast<U *>(&key_vec)->flush();
   assert(size() == key_vec.size());
   auto result = DataFrameVector<T>(manager);
   flush();
   uint16_t input_len;
   uint8_t key_vec_type_id = get_dataframe_type_id<typename U::value_type>();
+  uint8_t exact_u8 = exact;
   uint8_t input_data[sizeof(result.ds_id_) + sizeof(key_vec.ds_id_) +
-                     sizeof(size_) + sizeof(key_vec_type_id)];
+                     sizeof(size_) + sizeof(key_vec_type_id) +
+                     sizeof(quantile) + sizeof(exact_u8)];
   input_len = sizeof(input_data);
   __builtin_memcpy(input_data, &result.ds_id_, sizeof(result.ds_id_));
   __builtin_memcpy(input_data + sizeof(result.ds_id_), &key_vec.ds_id_,
@@ -1016,6 +1209,13 @@ DataFrameVector<T>::aggregate_remotely(FarMemManager *manager, const U &key_vec,
   __builtin_memcpy(input_data + sizeof(result.ds_id_) + sizeof(key_vec.ds_id_) +
                        sizeof(size_),
                    &key_vec_type_id, sizeof(key_vec_type_id));
+  __builtin_memcpy(input_data + sizeof(result.ds_id_) + sizeof(key_vec.ds_id_) +
+                       sizeof(size_) + sizeof(key_vec_type_id),
+                   &quantile, sizeof(quantile));
+  __builtin_memcpy(input_data + sizeof(result.ds_id_) + sizeof(key_vec.ds_id_) +
+                       sizeof(size_) + sizeof(key_vec_type_id) +
+                       sizeof(quantile),
+                   &exact_u8, sizeof(exact_u8));
   uint16_t output_len;
   uint64_t output_data[2];
   device_->compute(ds_id_, opcode, input_len, input_data, &output_len,
@@ -1060,6 +1260,18 @@ DataFrameVector<T>::aggregate_median(FarMemManager *manager, const U &key_vec) {
   }
 }
 
+template <typename T>
+template <typename U>
+FORCE_INLINE DataFrameVector<T>
+DataFrameVector<T>::aggregate_quantile(FarMemManager *manager,
+                                       const U &key_vec, double q, bool exact) {
+  if constexpr (DISABLE_OFFLOAD_AGGREGATE) {
+    return aggregate_locally(manager, key_vec, AggregateQuantile, q, exact);
+  } else {
+    return aggregate_remotely(manager, key_vec, AggregateQuantile, q, exact);
+  }
+}
+
 template <typename T>
 FORCE_INLINE DataFrameVector<T> &DataFrameVector<T>::lock() {
   lock_.lock_writer();
@@ -1083,4 +1295,26 @@ DataFrameVector<T>::static_prefetch(DataFrameVector<T>::Index_t start,
   prefetcher_->static_prefetch(start, step, num);
 }
 
+template <typename T>
+FORCE_INLINE void DataFrameVector<T>::advise(FarMemManager *manager,
+                                             uint64_t begin, uint64_t end,
+                                             uint32_t advice) {
+  assert(begin <= end && end <= size_);
+  if (advice & kAdviceRandom) {
+    disable_prefetch();
+    prefetcher_->set_eager(false);
+  }
+  if (advice & kAdviceSequential) {
+    enable_prefetch();
+    prefetcher_->set_eager(true);
+  }
+  if (begin == end) {
+    return;
+  }
+  auto chunk_begin = begin / kRealChunkNumEntries;
+  auto chunk_end = (end - 1) / kRealChunkNumEntries + 1;
+  manager->advise(&chunk_ptrs_[chunk_begin], chunk_end - chunk_begin, advice,
+                  prefetcher_->get_stream());
+}
+
 } // namespace far_memory
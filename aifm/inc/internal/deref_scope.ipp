@@ -63,6 +63,14 @@ FORCE_INLINE void DerefScope::renew() {
   enter();
 }
 
+// Moves the current thread, which is within a DerefScope, into status.
+FORCE_INLINE void DerefScope::switch_status(Status status) {
+  auto old_th_status = get_self_th_status();
+  __asm__("decl %0" : "=m"(num_threads_on_status[old_th_status]));
+  __asm__("incl %0" : "=m"(num_threads_on_status[status]));
+  set_self_th_status(status);
+}
+
 FORCE_INLINE bool DerefScope::is_in_deref_scope() {
   return get_self_th_status() != OutofScope;
 }
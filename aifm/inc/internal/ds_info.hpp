@@ -20,4 +20,7 @@ constexpr static uint8_t kHashTableDSType = 1;
 // DataFrameVector.
 constexpr static uint8_t kDataFrameVectorDSType = 2;
 
+// FarVector, only for the offloaded ones.
+constexpr static uint8_t kFarVectorDSType = 3;
+
 } // namespace far_memory
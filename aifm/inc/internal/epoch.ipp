@@ -0,0 +1,46 @@
+#pragma once
+
+extern "C" {
+#include <base/compiler.h>
+#include <runtime/preempt.h>
+}
+
+namespace far_memory {
+
+FORCE_INLINE EpochGuard::EpochGuard(EpochReclaimer &reclaimer)
+    : reclaimer_(reclaimer) {
+  reclaimer.enter();
+}
+
+FORCE_INLINE EpochGuard::~EpochGuard() { reclaimer_.exit(); }
+
+FORCE_INLINE void EpochReclaimer::enter() {
+  preempt_disable();
+  auto &state = core_states_[get_core_num()];
+  if (state.nesting++ == 0) {
+    state.epoch.store(global_epoch_.load(std::memory_order_relaxed),
+                      std::memory_order_relaxed);
+    // Publishes the epoch before reading any shared node.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+  }
+}
+
+FORCE_INLINE void EpochReclaimer::exit() {
+  auto &state = core_states_[get_core_num()];
+  assert(state.nesting);
+  if (--state.nesting == 0) {
+    state.epoch.store(kQuiescent, std::memory_order_release);
+  }
+  preempt_enable();
+}
+
+FORCE_INLINE bool EpochReclaimer::is_in_critical_section() const {
+  // Critical sections run with preemption disabled.
+  return !preempt_enabled() && core_states_[get_core_num()].nesting;
+}
+
+FORCE_INLINE EpochGuard EpochReclaimer::get_guard() {
+  return EpochGuard(*this);
+}
+
+} // namespace far_memory
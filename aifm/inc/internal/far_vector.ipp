@@ -0,0 +1,313 @@
+#pragma once
+
+#include "helpers.hpp"
+#include "manager.hpp"
+
+#include <cstring>
+
+namespace far_memory {
+
+FORCE_INLINE GenericFarVector::GenericFarVector(GenericFarVector &&other)
+    : chunk_size_(other.chunk_size_),
+      chunk_num_entries_(other.chunk_num_entries_),
+      item_size_(other.item_size_), device_(other.device_),
+      ds_id_(other.ds_id_), offloaded_(other.offloaded_), size_(other.size_),
+      remote_capacity_(other.remote_capacity_),
+      chunk_ptrs_(std::move(other.chunk_ptrs_)), moved_(false),
+      dirty_(other.dirty_) {
+  assert(!other.moved_);
+  other.moved_ = true;
+}
+
+FORCE_INLINE GenericFarVector &
+GenericFarVector::operator=(GenericFarVector &&other) {
+  cleanup();
+  chunk_size_ = other.chunk_size_;
+  chunk_num_entries_ = other.chunk_num_entries_;
+  item_size_ = other.item_size_;
+  device_ = other.device_;
+  ds_id_ = other.ds_id_;
+  offloaded_ = other.offloaded_;
+  size_ = other.size_;
+  remote_capacity_ = other.remote_capacity_;
+  chunk_ptrs_ = std::move(other.chunk_ptrs_);
+  moved_ = false;
+  dirty_ = other.dirty_;
+  last_chunk_idx_ = std::numeric_limits<uint64_t>::max();
+  other.moved_ = true;
+  return *this;
+}
+
+FORCE_INLINE bool GenericFarVector::empty() const { return size() == 0; }
+
+FORCE_INLINE uint64_t GenericFarVector::size() const { return size_; }
+
+FORCE_INLINE uint64_t GenericFarVector::capacity() const {
+  return chunk_ptrs_.size() * chunk_num_entries_;
+}
+
+FORCE_INLINE bool GenericFarVector::is_offloaded() const { return offloaded_; }
+
+FORCE_INLINE void GenericFarVector::clear() { size_ = 0; }
+
+FORCE_INLINE GenericUniquePtr *
+GenericFarVector::get_chunk_ptr(uint64_t chunk_idx) {
+  auto reader_lock = lock_.get_reader_lock();
+  return chunk_idx < chunk_ptrs_.size() ? &chunk_ptrs_[chunk_idx] : nullptr;
+}
+
+template <typename T>
+FORCE_INLINE FarVector<T>::Pattern_t FarVector<T>::induce_fn(Index_t idx_0,
+                                                             Index_t idx_1) {
+  return static_cast<Pattern_t>(idx_1) - static_cast<Pattern_t>(idx_0);
+}
+
+template <typename T>
+FORCE_INLINE FarVector<T>::Index_t FarVector<T>::infer_fn(Index_t idx,
+                                                          Pattern_t stride) {
+  return idx + stride;
+}
+
+template <typename T>
+FORCE_INLINE GenericUniquePtr *FarVector<T>::mapping_fn(uint8_t *&state,
+                                                        Index_t idx) {
+  return reinterpret_cast<GenericFarVector *>(ACCESS_ONCE(state))
+      ->get_chunk_ptr(idx);
+}
+
+template <typename T>
+FORCE_INLINE FarVector<T>::FarVector(FarMemManager *manager, bool offloaded)
+    : GenericFarVector(kChunkSize, kChunkNumEntries,
+                       offloaded ? manager->allocate_ds_id() : kVanillaPtrDSID,
+                       offloaded),
+      prefetcher_(new Prefetcher<decltype(kInduceFn), decltype(kInferFn),
+                                 decltype(kMappingFn)>(
+          manager->get_device(),
+          reinterpret_cast<uint8_t *>(static_cast<GenericFarVector *>(this)),
+          kChunkSize)) {}
+
+template <typename T>
+FORCE_INLINE FarVector<T>::FarVector(const FarVector &other)
+    : FarVector(FarMemManagerFactory::get(), other.offloaded_) {
+  assign(other, 0, other.size());
+}
+
+template <typename T>
+FORCE_INLINE FarVector<T> &FarVector<T>::operator=(const FarVector &other) {
+  assign(other, 0, other.size());
+  return *this;
+}
+
+template <typename T>
+FORCE_INLINE FarVector<T>::FarVector(FarVector &&other)
+    : GenericFarVector(std::move(other.lock())),
+      prefetcher_(std::move(other.prefetcher_)),
+      dynamic_prefetch_enabled_(other.dynamic_prefetch_enabled_) {
+  prefetcher_->update_state(
+      reinterpret_cast<uint8_t *>(static_cast<GenericFarVector *>(this)));
+  other.lock_.unlock_writer();
+}
+
+template <typename T>
+FORCE_INLINE FarVector<T> &FarVector<T>::operator=(FarVector &&other) {
+  auto writer_lock = other.lock_.get_writer_lock();
+  GenericFarVector::operator=(std::move(other));
+  prefetcher_ = std::move(other.prefetcher_);
+  prefetcher_->update_state(
+      reinterpret_cast<uint8_t *>(static_cast<GenericFarVector *>(this)));
+  dynamic_prefetch_enabled_ = other.dynamic_prefetch_enabled_;
+  return *this;
+}
+
+template <typename T> FORCE_INLINE FarVector<T>::~FarVector() {
+  prefetcher_.reset();
+}
+
+template <typename T> FORCE_INLINE FarVector<T> &FarVector<T>::lock() {
+  lock_.lock_writer();
+  return *this;
+}
+
+template <typename T>
+FORCE_INLINE std::pair<uint64_t, uint64_t>
+FarVector<T>::get_chunk_stats(uint64_t index) const {
+  // It's superfast since the chunk size is a power of 2.
+  return std::make_pair(index / kChunkNumEntries, index % kChunkNumEntries);
+}
+
+template <typename T>
+FORCE_INLINE void FarVector<T>::prefetch_record(bool nt, Index_t idx) {
+  if (unlikely(last_chunk_idx_ != idx)) {
+    if (ACCESS_ONCE(dynamic_prefetch_enabled_)) {
+      prefetcher_->add_trace(nt, idx);
+    }
+    last_chunk_idx_ = idx;
+  }
+}
+
+template <typename T>
+template <bool Nt>
+FORCE_INLINE void FarVector<T>::push_back(const DerefScope &scope,
+                                          const T &value) {
+  auto [chunk_idx, chunk_offset] = get_chunk_stats(size_);
+  if (unlikely(chunk_ptrs_.size() == chunk_idx)) {
+    grow();
+  }
+  auto *raw_mut_ptr = chunk_ptrs_[chunk_idx].template deref_mut<Nt>(scope);
+  __builtin_memcpy(reinterpret_cast<T *>(raw_mut_ptr) + chunk_offset, &value,
+                   sizeof(T));
+  size_++;
+  prefetch_record(Nt, chunk_idx);
+  dirty_ = true;
+}
+
+template <typename T>
+FORCE_INLINE void FarVector<T>::pop_back(const DerefScope &scope) {
+  assert(size_);
+  size_--;
+}
+
+template <typename T>
+FORCE_INLINE void FarVector<T>::append(const T *data, uint64_t num) {
+  assert(!DerefScope::is_in_deref_scope());
+  if (unlikely(!num)) {
+    return;
+  }
+  auto old_size = size_;
+  // A single expand() for the whole batch.
+  resize(size_ + num);
+  write_range(old_size, num, data);
+}
+
+template <typename T>
+FORCE_INLINE void FarVector<T>::append(std::span<const T> data) {
+  append(data.data(), data.size());
+}
+
+template <typename T>
+FORCE_INLINE void FarVector<T>::read_range(uint64_t begin, uint64_t num,
+                                           T *out) {
+  GenericFarVector::read_range(begin, num, reinterpret_cast<uint8_t *>(out));
+}
+
+template <typename T>
+FORCE_INLINE void FarVector<T>::write_range(uint64_t begin, uint64_t num,
+                                            const T *in) {
+  GenericFarVector::write_range(begin, num,
+                                reinterpret_cast<const uint8_t *>(in));
+}
+
+template <typename T>
+FORCE_INLINE void FarVector<T>::assign(const FarVector &other, uint64_t begin,
+                                       uint64_t end) {
+  GenericFarVector::assign(const_cast<FarVector *>(&other), begin, end);
+}
+
+template <typename T>
+template <bool Prefetch, bool Nt>
+FORCE_INLINE T &FarVector<T>::at_mut(const DerefScope &scope, uint64_t index) {
+  auto [chunk_idx, chunk_offset] = get_chunk_stats(index);
+  assert(index < size_);
+  if constexpr (Prefetch) {
+    prefetch_record(Nt, chunk_idx);
+  }
+  dirty_ = true;
+  auto *raw_mut_ptr = chunk_ptrs_[chunk_idx].template deref_mut<Nt>(scope);
+  return *(reinterpret_cast<T *>(raw_mut_ptr) + chunk_offset);
+}
+
+template <typename T>
+template <bool Prefetch, bool Nt>
+FORCE_INLINE const T &FarVector<T>::at(const DerefScope &scope,
+                                       uint64_t index) {
+  auto [chunk_idx, chunk_offset] = get_chunk_stats(index);
+  assert(index < size_);
+  if constexpr (Prefetch) {
+    prefetch_record(Nt, chunk_idx);
+  }
+  auto *raw_ptr = chunk_ptrs_[chunk_idx].template deref<Nt>(scope);
+  return *(reinterpret_cast<const T *>(raw_ptr) + chunk_offset);
+}
+
+template <typename T>
+FORCE_INLINE T &FarVector<T>::front_mut(const DerefScope &scope) {
+  return at_mut</* Prefetch = */ false>(scope, 0);
+}
+
+template <typename T>
+FORCE_INLINE const T &FarVector<T>::front(const DerefScope &scope) {
+  return at</* Prefetch = */ false>(scope, 0);
+}
+
+template <typename T>
+FORCE_INLINE T &FarVector<T>::back_mut(const DerefScope &scope) {
+  return at_mut</* Prefetch = */ false>(scope, size_ - 1);
+}
+
+template <typename T>
+FORCE_INLINE const T &FarVector<T>::back(const DerefScope &scope) {
+  return at</* Prefetch = */ false>(scope, size_ - 1);
+}
+
+template <typename T>
+FORCE_INLINE FarVector<T>::template FastIterator<true>
+FarVector<T>::fbegin(DerefScope &scope) {
+  dirty_ = true;
+  return FastIterator<true>(scope, this, 0);
+}
+
+template <typename T>
+FORCE_INLINE FarVector<T>::template FastIterator<true>
+FarVector<T>::fend(DerefScope &scope) {
+  dirty_ = true;
+  return FastIterator<true>(scope, this, size_);
+}
+
+template <typename T>
+FORCE_INLINE FarVector<T>::template FastIterator<false>
+FarVector<T>::cfbegin(DerefScope &scope) const {
+  return FastIterator<false>(scope, this, 0);
+}
+
+template <typename T>
+FORCE_INLINE FarVector<T>::template FastIterator<false>
+FarVector<T>::cfend(DerefScope &scope) const {
+  return FastIterator<false>(scope, this, size_);
+}
+
+template <typename T> FORCE_INLINE void FarVector<T>::disable_prefetch() {
+  ACCESS_ONCE(dynamic_prefetch_enabled_) = false;
+}
+
+template <typename T> FORCE_INLINE void FarVector<T>::enable_prefetch() {
+  ACCESS_ONCE(dynamic_prefetch_enabled_) = true;
+}
+
+template <typename T>
+FORCE_INLINE void FarVector<T>::static_prefetch(Index_t start, Index_t step,
+                                                uint32_t num) {
+  ACCESS_ONCE(dynamic_prefetch_enabled_) = false;
+  prefetcher_->static_prefetch(start, step, num);
+}
+
+template <typename T>
+FORCE_INLINE void FarVector<T>::advise(FarMemManager *manager, uint64_t begin,
+                                       uint64_t end, uint32_t advice) {
+  assert(begin <= end && end <= size_);
+  if (advice & kAdviceRandom) {
+    disable_prefetch();
+    prefetcher_->set_eager(false);
+  }
+  if (advice & kAdviceSequential) {
+    enable_prefetch();
+    prefetcher_->set_eager(true);
+  }
+  if (begin == end) {
+    return;
+  }
+  auto chunk_begin = begin / kChunkNumEntries;
+  auto chunk_end = (end - 1) / kChunkNumEntries + 1;
+  manager->advise(&chunk_ptrs_[chunk_begin], chunk_end - chunk_begin, advice);
+}
+
+} // namespace far_memory
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <algorithm>
+#include <limits>
+
+namespace far_memory {
+
+FORCE_INLINE uint8_t *FrequencySketch::counter(uint32_t hash,
+                                               uint32_t row) const {
+  auto idx = static_cast<uint32_t>((hash * kSeeds[row]) >> (64 - width_shift_));
+  return &counters_[(static_cast<uint64_t>(row) << width_shift_) + idx];
+}
+
+FORCE_INLINE void FrequencySketch::record(uint32_t hash) {
+  for (uint32_t i = 0; i < kNumRows; i++) {
+    auto *c = counter(hash, i);
+    auto val = ACCESS_ONCE(*c);
+    if (likely(val != std::numeric_limits<uint8_t>::max())) {
+      ACCESS_ONCE(*c) = val + 1;
+    }
+  }
+  auto num_records = num_records_.fetch_add(1, std::memory_order_relaxed) + 1;
+  if (unlikely(num_records >= sample_size_)) {
+    start_aging(num_records);
+  }
+  if (unlikely(aging_cursor_.load(std::memory_order_relaxed) < num_counters_)) {
+    age_step();
+  }
+}
+
+FORCE_INLINE uint8_t FrequencySketch::estimate(uint32_t hash) const {
+  auto ret = std::numeric_limits<uint8_t>::max();
+  for (uint32_t i = 0; i < kNumRows; i++) {
+    uint8_t val = ACCESS_ONCE(*counter(hash, i));
+    ret = std::min(ret, val);
+  }
+  return ret;
+}
+
+} // namespace far_memory
@@ -0,0 +1,37 @@
+#pragma once
+
+extern "C" {
+#include <runtime/timer.h>
+}
+
+namespace far_memory {
+
+FORCE_INLINE void GCPacer::on_region_allocated() {
+  auto num_allocated_regions =
+      num_allocated_regions_.fetch_add(1, std::memory_order_relaxed) + 1;
+  if (unlikely(num_allocated_regions % sample_interval_ == 0)) {
+    if (sample_spin_.TryLock()) {
+      sample(microtime());
+      sample_spin_.Unlock();
+    }
+  }
+}
+
+FORCE_INLINE double GCPacer::get_low_thresh() const {
+  return ACCESS_ONCE(low_thresh_);
+}
+
+FORCE_INLINE double GCPacer::get_high_thresh() const {
+  return ACCESS_ONCE(high_thresh_);
+}
+
+FORCE_INLINE void GCPacer::add_stall(uint64_t stall_us) {
+  stats_.num_stalls++;
+  stats_.stall_us += stall_us;
+}
+
+FORCE_INLINE GCPacer::Stats GCPacer::get_stats() const { return stats_; }
+
+FORCE_INLINE void GCPacer::reset_stats() { stats_ = {}; }
+
+} // namespace far_memory
@@ -0,0 +1,276 @@
+#pragma once
+
+extern "C" {
+#include <base/assert.h>
+}
+
+#include "helpers.hpp"
+#include "quantile_sketch.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+namespace far_memory {
+
+template <typename T>
+FORCE_INLINE std::size_t
+HashGrouper<T>::KeyHash::operator()(const std::pair<uint64_t, T> &key) const {
+  return std::hash<T>{}(key.second) ^
+         (key.first * 0x9E3779B97F4A7C15ULL + (key.first >> 7));
+}
+
+template <typename T>
+template <typename GetFn, typename PrevIdFn, typename EmitFn,
+          typename NewGroupFn>
+FORCE_INLINE uint64_t HashGrouper<T>::group(uint64_t size, GetFn get_fn,
+                                            PrevIdFn prev_id_fn, EmitFn emit_fn,
+                                            NewGroupFn new_group_fn) {
+  std::unordered_map<std::pair<uint64_t, T>, uint64_t, KeyHash> table;
+  for (uint64_t i = 0; i < size; i++) {
+    auto key = std::make_pair(static_cast<uint64_t>(prev_id_fn(i)), get_fn(i));
+    auto [iter, inserted] = table.try_emplace(std::move(key), table.size());
+    if (inserted) {
+      new_group_fn(i);
+    }
+    emit_fn(iter->second);
+  }
+  return table.size();
+}
+
+template <typename T>
+template <typename GetFn, typename GroupIdFn, typename EmitFn>
+FORCE_INLINE void
+HashGrouper<T>::aggregate(AggregateOp op, uint64_t size, uint64_t num_groups,
+                          GetFn get_fn, GroupIdFn group_id_fn, EmitFn emit_fn) {
+  switch (op) {
+  case AggFirst:
+  case AggLast: {
+    std::vector<T> values(num_groups);
+    std::vector<bool> seen(num_groups);
+    for (uint64_t i = 0; i < size; i++) {
+      auto group_id = group_id_fn(i);
+      if (op == AggLast || !seen[group_id]) {
+        values[group_id] = get_fn(i);
+        seen[group_id] = true;
+      }
+    }
+    for (auto &value : values) {
+      emit_fn(value);
+    }
+    break;
+  }
+  case AggMin:
+  case AggMax: {
+    std::vector<T> values(num_groups);
+    std::vector<bool> seen(num_groups);
+    for (uint64_t i = 0; i < size; i++) {
+      auto group_id = group_id_fn(i);
+      auto value = get_fn(i);
+      if (!seen[group_id] || (op == AggMin ? value < values[group_id]
+                                           : values[group_id] < value)) {
+        values[group_id] = value;
+        seen[group_id] = true;
+      }
+    }
+    for (auto &value : values) {
+      emit_fn(value);
+    }
+    break;
+  }
+  case AggMedian:
+    median(size, num_groups, get_fn, group_id_fn, emit_fn);
+    break;
+  case AggCount:
+    // The counts are not of type T.
+  case AggQuantile:
+    // Needs q, see quantile().
+    BUG();
+  default:
+    if constexpr (std::is_arithmetic<T>::value) {
+      // Welford's algorithm keeps the variance numerically stable.
+      // Integral sums are accumulated in T to stay exact.
+      using Sum_t =
+          std::conditional<std::is_floating_point<T>::value, double, T>::type;
+      std::vector<uint64_t> counts(num_groups);
+      std::vector<Sum_t> sums(num_groups);
+      std::vector<double> means(num_groups);
+      std::vector<double> m2s(num_groups);
+      for (uint64_t i = 0; i < size; i++) {
+        auto group_id = group_id_fn(i);
+        auto raw_value = get_fn(i);
+        double value = raw_value;
+        auto count = ++counts[group_id];
+        sums[group_id] += raw_value;
+        auto delta = value - means[group_id];
+        means[group_id] += delta / count;
+        m2s[group_id] += delta * (value - means[group_id]);
+      }
+      for (uint64_t i = 0; i < num_groups; i++) {
+        double result;
+        switch (op) {
+        case AggSum:
+          emit_fn(static_cast<T>(sums[i]));
+          continue;
+        case AggMean:
+          result = means[i];
+          break;
+        case AggVar:
+          result = counts[i] > 1 ? m2s[i] / (counts[i] - 1) : 0;
+          break;
+        case AggStd:
+          result = counts[i] > 1 ? std::sqrt(m2s[i] / (counts[i] - 1)) : 0;
+          break;
+        default:
+          BUG();
+        }
+        emit_fn(static_cast<T>(result));
+      }
+    } else {
+      BUG();
+    }
+  }
+}
+
+template <typename T>
+template <typename GroupIdFn, typename EmitFn>
+FORCE_INLINE void HashGrouper<T>::count(uint64_t size, uint64_t num_groups,
+                                        GroupIdFn group_id_fn,
+                                        EmitFn emit_fn) {
+  std::vector<uint64_t> counts(num_groups);
+  for (uint64_t i = 0; i < size; i++) {
+    counts[group_id_fn(i)]++;
+  }
+  for (auto count : counts) {
+    emit_fn(count);
+  }
+}
+
+template <typename T>
+template <typename GetFn, typename GroupIdFn, typename EmitFn>
+FORCE_INLINE void HashGrouper<T>::median(uint64_t size, uint64_t num_groups,
+                                         GetFn get_fn, GroupIdFn group_id_fn,
+                                         EmitFn emit_fn) {
+  constexpr bool kAveraged = helpers::Addable<T> && helpers::DividableByInt<T>;
+  // The median is the value of rank n / 2, averaged with the one of rank
+  // n / 2 - 1 if n is even.
+  auto lo_rank = [&](uint64_t n) {
+    return (kAveraged && n % 2 == 0) ? n / 2 - 1 : n / 2;
+  };
+  auto hi_rank = [&](uint64_t n) { return n / 2; };
+  auto combine = [&](const T &lo, const T &hi) -> T {
+    if constexpr (kAveraged) {
+      return (lo + hi) / 2;
+    } else {
+      return hi;
+    }
+  };
+  select(size, num_groups, /* exact = */ true, lo_rank, hi_rank, combine,
+         get_fn, group_id_fn, emit_fn);
+}
+
+template <typename T>
+template <typename GetFn, typename GroupIdFn, typename EmitFn>
+FORCE_INLINE void HashGrouper<T>::quantile(uint64_t size, uint64_t num_groups,
+                                           double q, bool exact, GetFn get_fn,
+                                           GroupIdFn group_id_fn,
+                                           EmitFn emit_fn) {
+  BUG_ON(q < 0 || q > 1);
+  auto rank = [&](uint64_t n) {
+    return std::min(n - 1, static_cast<uint64_t>(q * n));
+  };
+  auto combine = [&](const T &lo, const T &hi) -> T { return hi; };
+  select(size, num_groups, exact, rank, rank, combine, get_fn, group_id_fn,
+         emit_fn);
+}
+
+template <typename T>
+template <typename LoRankFn, typename HiRankFn, typename CombineFn,
+          typename GetFn, typename GroupIdFn, typename EmitFn>
+FORCE_INLINE void
+HashGrouper<T>::select(uint64_t size, uint64_t num_groups, bool exact,
+                       LoRankFn lo_rank, HiRankFn hi_rank, CombineFn combine,
+                       GetFn get_fn, GroupIdFn group_id_fn, EmitFn emit_fn) {
+  // Pass 1 sketches each group in bounded memory. A group small enough for
+  // its sketch to stay exact is done here, and so is every group if an
+  // approximation is enough.
+  std::vector<QuantileSketch<T>> sketches(num_groups);
+  for (uint64_t i = 0; i < size; i++) {
+    sketches[group_id_fn(i)].add(get_fn(i));
+  }
+  std::vector<T> results(num_groups);
+  std::vector<RankWindow> windows(num_groups);
+  std::vector<bool> done(num_groups);
+  bool has_pending = false;
+  for (uint64_t g = 0; g < num_groups; g++) {
+    auto &sketch = sketches[g];
+    auto n = windows[g].count = sketch.count();
+    if (!n) {
+      done[g] = true;
+    } else if (!exact || sketch.exact()) {
+      results[g] = combine(sketch.at_rank(lo_rank(n)),
+                           sketch.at_rank(hi_rank(n)));
+      done[g] = true;
+    } else {
+      // The window of values whose ranks may fall within the selected ones,
+      // given the rank error of the sketch.
+      auto error = sketch.rank_error();
+      auto &window = windows[g];
+      window.bounded = true;
+      window.lo = sketch.at_rank(lo_rank(n) > error ? lo_rank(n) - error : 0);
+      window.hi = sketch.at_rank(std::min(n - 1, hi_rank(n) + error));
+      has_pending = true;
+    }
+  }
+  std::vector<QuantileSketch<T>>().swap(sketches);
+
+  // Pass 2 collects the windows, and selects the ranks within them. The rare
+  // group whose ranks fell outside of its window is collected again in full.
+  for (uint32_t pass = 0; has_pending; pass++) {
+    BUG_ON(pass > 1);
+    for (uint64_t i = 0; i < size; i++) {
+      auto g = group_id_fn(i);
+      if (done[g]) {
+        continue;
+      }
+      auto &window = windows[g];
+      auto value = get_fn(i);
+      if (window.bounded && value < window.lo) {
+        window.num_below++;
+      } else if (!window.bounded || !(window.hi < value)) {
+        window.values.push_back(std::move(value));
+      }
+    }
+    has_pending = false;
+    for (uint64_t g = 0; g < num_groups; g++) {
+      if (done[g]) {
+        continue;
+      }
+      auto &window = windows[g];
+      auto n = window.count;
+      auto &values = window.values;
+      if (window.num_below <= lo_rank(n) &&
+          hi_rank(n) < window.num_below + values.size()) {
+        auto hi = values.begin() + (hi_rank(n) - window.num_below);
+        std::nth_element(values.begin(), hi, values.end());
+        auto hi_value = *hi;
+        auto lo = values.begin() + (lo_rank(n) - window.num_below);
+        std::nth_element(values.begin(), lo, values.end());
+        results[g] = combine(*lo, hi_value);
+        done[g] = true;
+        std::vector<T>().swap(values);
+      } else {
+        window.bounded = false;
+        window.num_below = 0;
+        values.clear();
+        has_pending = true;
+      }
+    }
+  }
+
+  for (auto &result : results) {
+    emit_fn(result);
+  }
+}
+
+} // namespace far_memory
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "helpers.hpp"
+
+namespace far_memory {
+
+template <typename T>
+template <typename LhsGetFn, typename RhsGetFn, typename EmitFn>
+FORCE_INLINE void HashJoiner<T>::join(uint64_t lhs_size, uint64_t rhs_size,
+                                      LhsGetFn lhs_get_fn, RhsGetFn rhs_get_fn,
+                                      JoinType type, EmitFn emit_fn) {
+  bool build_lhs = lhs_size < rhs_size;
+  auto build_size = build_lhs ? lhs_size : rhs_size;
+  auto probe_size = build_lhs ? rhs_size : lhs_size;
+  bool lhs_outer = (type == LeftJoin || type == OuterJoin);
+  bool rhs_outer = (type == RightJoin || type == OuterJoin);
+  bool build_outer = build_lhs ? lhs_outer : rhs_outer;
+  bool probe_outer = build_lhs ? rhs_outer : lhs_outer;
+  auto build_get = [&](uint64_t idx) -> T {
+    return build_lhs ? lhs_get_fn(idx) : rhs_get_fn(idx);
+  };
+  auto probe_get = [&](uint64_t idx) -> T {
+    return build_lhs ? rhs_get_fn(idx) : lhs_get_fn(idx);
+  };
+  auto emit = [&](uint64_t build_idx, uint64_t probe_idx) {
+    if (build_lhs) {
+      emit_fn(build_idx, probe_idx);
+    } else {
+      emit_fn(probe_idx, build_idx);
+    }
+  };
+
+  // Rows with the same key are chained through next_idx in ascending order;
+  // the table only keeps the (head, tail) of each chain.
+  std::unordered_map<T, std::pair<uint64_t, uint64_t>> table(build_size);
+  std::vector<uint64_t> next_idx(build_size, kJoinNullIdx);
+  for (uint64_t i = 0; i < build_size; i++) {
+    auto [iter, inserted] = table.try_emplace(build_get(i), i, i);
+    if (!inserted) {
+      next_idx[iter->second.second] = i;
+      iter->second.second = i;
+    }
+  }
+
+  std::vector<bool> matched(build_outer ? build_size : 0);
+  for (uint64_t i = 0; i < probe_size; i++) {
+    auto iter = table.find(probe_get(i));
+    if (iter == table.end()) {
+      if (probe_outer) {
+        emit(kJoinNullIdx, i);
+      }
+      continue;
+    }
+    for (auto idx = iter->second.first; idx != kJoinNullIdx;
+         idx = next_idx[idx]) {
+      emit(idx, i);
+      if (build_outer) {
+        matched[idx] = true;
+      }
+    }
+  }
+  if (build_outer) {
+    for (uint64_t i = 0; i < build_size; i++) {
+      if (!matched[i]) {
+        emit(i, kJoinNullIdx);
+      }
+    }
+  }
+}
+
+template <typename T> FORCE_INLINE T HashJoiner<T>::null_value() {
+  if constexpr (std::numeric_limits<T>::has_quiet_NaN) {
+    return std::numeric_limits<T>::quiet_NaN();
+  } else {
+    return T();
+  }
+}
+
+} // namespace far_memory
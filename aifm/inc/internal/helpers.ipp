@@ -246,6 +246,34 @@ static FORCE_INLINE void tcp_write2_until(tcpconn_t *c, const void *buf_0,
   }
 }
 
+static FORCE_INLINE bool tcp_try_read_until(tcpconn_t *c, void *buf,
+                                            size_t expect) {
+  size_t real = 0;
+  while (real < expect) {
+    auto ret =
+        tcp_read(c, reinterpret_cast<uint8_t *>(buf) + real, expect - real);
+    if (unlikely(ret <= 0)) {
+      return false;
+    }
+    real += ret;
+  }
+  return true;
+}
+
+static FORCE_INLINE bool tcp_try_write_until(tcpconn_t *c, const void *buf,
+                                             size_t expect) {
+  size_t real = 0;
+  while (real < expect) {
+    auto ret = tcp_write(c, reinterpret_cast<const uint8_t *>(buf) + real,
+                         expect - real);
+    if (unlikely(ret <= 0)) {
+      return false;
+    }
+    real += ret;
+  }
+  return true;
+}
+
 static FORCE_INLINE constexpr size_t static_log(uint64_t b, uint64_t n) {
   return ((n < b) ? 1 : 1 + static_log(b, n / b));
 }
@@ -0,0 +1,22 @@
+#pragma once
+
+namespace far_memory {
+
+FORCE_INLINE IOAdmission::IOAdmission(IOScheduler *scheduler,
+                                      IOClass io_class)
+    : scheduler_(scheduler), io_class_(io_class),
+      admitted_(!scheduler || scheduler->acquire(io_class)) {}
+
+FORCE_INLINE IOAdmission::~IOAdmission() {
+  if (scheduler_ && admitted_) {
+    scheduler_->release(io_class_, num_bytes_);
+  }
+}
+
+FORCE_INLINE bool IOAdmission::admitted() const { return admitted_; }
+
+FORCE_INLINE void IOAdmission::add_bytes(uint64_t num_bytes) {
+  num_bytes_ += num_bytes;
+}
+
+} // namespace far_memory
@@ -2,6 +2,8 @@
 
 #include "thread.h"
 
+#include "prefetch_service.hpp"
+
 #include <algorithm>
 #include <cstring>
 
@@ -78,28 +80,57 @@ FORCE_INLINE void GenericList::update_chunk_list_addr(const DerefScope &scope,
       reinterpret_cast<ChunkList::ListData *>(chunk_list_data->data));
 }
 
-FORCE_INLINE void GenericList::prefetch_once() {
-  auto *local_node = &(*prefetch_iter_);
+// Grows the window when the consumer reaches a node that is not swapped in
+// yet, i.e., it consumes faster than the prefetches complete, and shrinks it
+// slowly while the prefetches keep up. Returns the number of nodes to
+// prefetch to keep the window.
+FORCE_INLINE uint32_t
+GenericList::adapt_prefetch_window(const LocalNode *local_node) {
   if (unlikely(local_node->is_invalid())) {
-    return;
+    return 1;
   }
-  do_prefetch(local_node);
-  if (prefetch_reversed_) {
-    --prefetch_iter_;
-  } else {
-    ++prefetch_iter_;
+  bool late = ACCESS_ONCE(local_node->swapping_in) ||
+              !local_node->ptr.meta().is_present();
+  if (late) {
+    num_timely_nodes_ = 0;
+    auto old_window = prefetch_window_;
+    prefetch_window_ = std::min(prefetch_window_ * 2, kMaxPrefetchNumNodes);
+    return 1 + prefetch_window_ - old_window;
+  }
+  if (unlikely(++num_timely_nodes_ == kPrefetchShrinkInterval)) {
+    num_timely_nodes_ = 0;
+    if (prefetch_window_ > 1) {
+      prefetch_window_--;
+      return 0;
+    }
   }
+  return 1;
 }
 
-FORCE_INLINE void GenericList::do_prefetch(LocalNode *local_node) {
-  if (likely(!(local_node->swapping_in))) {
+FORCE_INLINE void GenericList::prefetch_nodes(uint32_t num_nodes) {
+  GenericUniquePtr *ptrs[kMaxPrefetchNumNodes];
+  bool *inflights[kMaxPrefetchNumNodes];
+  uint32_t num_ptrs = 0;
+  for (uint32_t i = 0; i < num_nodes; i++) {
+    auto *local_node = &(*prefetch_iter_);
+    if (unlikely(local_node->is_invalid())) {
+      break;
+    }
+    if (prefetch_reversed_) {
+      --prefetch_iter_;
+    } else {
+      ++prefetch_iter_;
+    }
+    if (local_node->swapping_in || local_node->ptr.meta().is_present()) {
+      continue;
+    }
     local_node->swapping_in = true;
-    rt::Thread([=] {
-      local_node->ptr.swap_in(false);
-      barrier();
-      local_node->swapping_in = false;
-    })
-        .Detach();
+    ptrs[num_ptrs] = &local_node->ptr;
+    inflights[num_ptrs++] = &local_node->swapping_in;
+  }
+  if (num_ptrs) {
+    PrefetchService::get()->submit(/* stream = */ nullptr, ptrs, num_ptrs,
+                                   /* nt = */ false, kIOPrefetch, inflights);
   }
 }
 
@@ -107,14 +138,17 @@ template <bool Reverse>
 FORCE_INLINE void GenericList::prefetch_fsm(
     const LocalList<LocalNode>::IteratorImpl<Reverse> &local_iter) {
   if (Reverse == prefetch_reversed_) {
+    auto *local_node = &(*local_iter);
     if (!enable_prefetch_) {
       enable_prefetch_ = true;
       prefetch_iter_ = local_iter;
-      for (uint32_t i = 0; i < kPrefetchNumNodes_; i++) {
-        prefetch_once();
-      }
-    } else {
-      prefetch_once();
+      num_timely_nodes_ = 0;
+      last_consumed_node_ = local_node;
+      prefetch_nodes(prefetch_window_);
+    } else if (local_node != last_consumed_node_) {
+      // Only counts once per node, e.g., not on every erase() of its items.
+      last_consumed_node_ = local_node;
+      prefetch_nodes(adapt_prefetch_window(local_node));
     }
   } else {
     enable_prefetch_ = false;
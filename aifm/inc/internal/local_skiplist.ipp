@@ -2,49 +2,322 @@
 
 namespace far_memory {
 
-template <typename T>
-FORCE_INLINE LocalSkiplist<T>::LocalSkiplist(uint64_t data_size)
-    : GenericLocalSkiplist(sizeof(T), data_size) {
-  // Param a must be the key from the API argument instead of the in-list
-  // pointer.
-  is_equal_ = [&](const void *a, const void *b) -> bool {
-    assert(b != positive_infinite_);
-    if (unlikely(b == negative_infinite_)) {
+template <typename T, typename Compare>
+FORCE_INLINE uint32_t
+LocalSkiplist<T, Compare>::get_node_size(uint32_t height) {
+  return sizeof(Node) - (kMaxLevels - height) * sizeof(std::atomic<uintptr_t>);
+}
+
+template <typename T, typename Compare>
+FORCE_INLINE bool LocalSkiplist<T, Compare>::is_marked(uintptr_t next) {
+  return next & kMarkedBit;
+}
+
+template <typename T, typename Compare>
+FORCE_INLINE LocalSkiplist<T, Compare>::Node *
+LocalSkiplist<T, Compare>::get_node(uintptr_t next) {
+  return reinterpret_cast<Node *>(next & ~kMarkedBit);
+}
+
+template <typename T, typename Compare>
+FORCE_INLINE LocalSkiplist<T, Compare>::LocalSkiplist(uint64_t data_size)
+    : slab_(static_cast<uint8_t *>(helpers::allocate_hugepage(data_size)),
+            data_size),
+      reclaimer_(&slab_) {
+  head_ = reinterpret_cast<Node *>(
+      slab_.allocate(get_node_size(kMaxLevels)));
+  tail_ = reinterpret_cast<Node *>(
+      slab_.allocate(get_node_size(kMaxLevels)));
+  BUG_ON(!head_ || !tail_);
+  head_->height = tail_->height = kMaxLevels;
+  for (uint32_t i = 0; i < kMaxLevels; i++) {
+    head_->next[i].store(reinterpret_cast<uintptr_t>(tail_));
+    tail_->next[i].store(0);
+  }
+  for (uint32_t i = 0; i < helpers::kNumCPUs; i++) {
+    core_randoms_[i].generator.seed(i + 1);
+  }
+}
+
+template <typename T, typename Compare>
+FORCE_INLINE LocalSkiplist<T, Compare>::~LocalSkiplist() {}
+
+template <typename T, typename Compare>
+FORCE_INLINE uint32_t LocalSkiplist<T, Compare>::random_height() {
+  // Invoked with preemption disabled, i.e., within a critical section.
+  auto bits = core_randoms_[get_core_num()].generator();
+  uint32_t height = 1;
+  while (height < kMaxLevels && bits % kProbInv == 0) {
+    height++;
+    bits /= kProbInv;
+  }
+  return height;
+}
+
+template <typename T, typename Compare>
+FORCE_INLINE LocalSkiplist<T, Compare>::Node *
+LocalSkiplist<T, Compare>::allocate_node(const T &key, uint32_t height) {
+  auto *node =
+      reinterpret_cast<Node *>(slab_.allocate(get_node_size(height)));
+  BUG_ON(!node);
+  memcpy(&node->key, &key, sizeof(T));
+  node->height = height;
+  node->refs.store(2, std::memory_order_relaxed);
+  return node;
+}
+
+template <typename T, typename Compare>
+FORCE_INLINE bool LocalSkiplist<T, Compare>::find(const T &key, Node **preds,
+                                                  Node **succs) {
+retry:
+  auto *pred = head_;
+  for (int32_t level = kMaxLevels - 1; level >= 0; level--) {
+    auto *curr = get_node(pred->next[level].load(std::memory_order_acquire));
+    while (curr != tail_) {
+      auto next = curr->next[level].load(std::memory_order_acquire);
+      if (is_marked(next)) {
+        // Helps unlink the removed node, which fails if pred is also removed.
+        auto expected = reinterpret_cast<uintptr_t>(curr);
+        if (!pred->next[level].compare_exchange_strong(expected,
+                                                       next & ~kMarkedBit)) {
+          goto retry;
+        }
+        curr = get_node(next);
+        continue;
+      }
+      if (!comp_(curr->key, key)) {
+        break;
+      }
+      pred = curr;
+      curr = get_node(next);
+    }
+    preds[level] = pred;
+    succs[level] = curr;
+  }
+  return succs[0] != tail_ && !comp_(key, succs[0]->key);
+}
+
+template <typename T, typename Compare>
+FORCE_INLINE LocalSkiplist<T, Compare>::Node *
+LocalSkiplist<T, Compare>::lower_bound(const T &key) {
+  // Never writes; removed nodes are skipped through their frozen next
+  // pointers.
+  auto *pred = head_;
+  Node *curr = nullptr;
+  for (int32_t level = kMaxLevels - 1; level >= 0; level--) {
+    curr = get_node(pred->next[level].load(std::memory_order_acquire));
+    while (curr != tail_) {
+      auto next = curr->next[level].load(std::memory_order_acquire);
+      if (is_marked(next)) {
+        curr = get_node(next);
+        continue;
+      }
+      if (!comp_(curr->key, key)) {
+        break;
+      }
+      pred = curr;
+      curr = get_node(next);
+    }
+  }
+  return curr;
+}
+
+template <typename T, typename Compare>
+FORCE_INLINE LocalSkiplist<T, Compare>::Node *
+LocalSkiplist<T, Compare>::next_node(Node *node) {
+  auto *curr = get_node(node->next[0].load(std::memory_order_acquire));
+  while (curr != tail_) {
+    auto next = curr->next[0].load(std::memory_order_acquire);
+    if (!is_marked(next)) {
+      break;
+    }
+    curr = get_node(next);
+  }
+  return curr;
+}
+
+template <typename T, typename Compare>
+FORCE_INLINE void LocalSkiplist<T, Compare>::release(Node *node) {
+  if (node->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    reclaimer_.retire(reinterpret_cast<uint8_t *>(node),
+                      get_node_size(node->height));
+  }
+}
+
+template <typename T, typename Compare>
+FORCE_INLINE bool LocalSkiplist<T, Compare>::insert(const T &key) {
+  auto guard = reclaimer_.get_guard();
+  Node *preds[kMaxLevels];
+  Node *succs[kMaxLevels];
+  Node *node = nullptr;
+
+  // Linking the lowest level inserts the key.
+  while (true) {
+    if (find(key, preds, succs)) {
+      if (node) {
+        // Never published.
+        slab_.free(reinterpret_cast<uint8_t *>(node),
+                   get_node_size(node->height));
+      }
       return false;
     }
-    return *(reinterpret_cast<const T *>(a)) ==
-           *(reinterpret_cast<const T *>(b));
-  };
-  is_smaller_ = [&](const void *a, const void *b) -> bool {
-    assert(b != negative_infinite_);
-    if (unlikely(b == positive_infinite_)) {
-      return true;
+    if (!node) {
+      node = allocate_node(key, random_height());
+    }
+    for (uint32_t i = 0; i < node->height; i++) {
+      node->next[i].store(reinterpret_cast<uintptr_t>(succs[i]),
+                          std::memory_order_relaxed);
+    }
+    auto expected = reinterpret_cast<uintptr_t>(succs[0]);
+    if (preds[0]->next[0].compare_exchange_strong(
+            expected, reinterpret_cast<uintptr_t>(node))) {
+      break;
     }
-    return *(reinterpret_cast<const T *>(a)) <
-           *(reinterpret_cast<const T *>(b));
-  };
-  is_greater_ = [&](const void *a, const void *b) -> bool {
-    assert(b != positive_infinite_);
-    if (unlikely(b == negative_infinite_)) {
-      return true;
+  }
+
+  // Links the upper levels, and gives up once the key gets removed.
+  for (uint32_t level = 1; level < node->height; level++) {
+    while (true) {
+      auto next = node->next[level].load();
+      auto succ = reinterpret_cast<uintptr_t>(succs[level]);
+      if (is_marked(next) ||
+          (next != succ &&
+           !node->next[level].compare_exchange_strong(next, succ))) {
+        goto linked;
+      }
+      auto expected = succ;
+      if (preds[level]->next[level].compare_exchange_strong(
+              expected, reinterpret_cast<uintptr_t>(node))) {
+        break;
+      }
+      find(key, preds, succs);
+    }
+  }
+
+linked:
+  // A remover may have unlinked it before some level got linked.
+  if (unlikely(is_marked(node->next[0].load()))) {
+    find(key, preds, succs);
+  }
+  release(node);
+  return true;
+}
+
+template <typename T, typename Compare>
+FORCE_INLINE bool LocalSkiplist<T, Compare>::exist(const T &key) {
+  auto guard = reclaimer_.get_guard();
+  auto *node = lower_bound(key);
+  return node != tail_ && !comp_(key, node->key);
+}
+
+template <typename T, typename Compare>
+FORCE_INLINE bool LocalSkiplist<T, Compare>::remove(const T &key) {
+  auto guard = reclaimer_.get_guard();
+  Node *preds[kMaxLevels];
+  Node *succs[kMaxLevels];
+
+  if (!find(key, preds, succs)) {
+    return false;
+  }
+  auto *node = succs[0];
+  for (int32_t level = node->height - 1; level >= 1; level--) {
+    auto next = node->next[level].load();
+    while (!is_marked(next) &&
+           !node->next[level].compare_exchange_weak(next, next | kMarkedBit))
+      ;
+  }
+  // Marking the lowest level removes the key.
+  auto next = node->next[0].load();
+  do {
+    if (is_marked(next)) {
+      return false;
     }
-    return *(reinterpret_cast<const T *>(a)) >
-           *(reinterpret_cast<const T *>(b));
-  };
+  } while (!node->next[0].compare_exchange_weak(next, next | kMarkedBit));
+
+  find(key, preds, succs);
+  release(node);
+  return true;
 }
 
-template <typename T> FORCE_INLINE LocalSkiplist<T>::~LocalSkiplist() {}
+template <typename T, typename Compare>
+FORCE_INLINE LocalSkiplist<T, Compare>::Range
+LocalSkiplist<T, Compare>::range(const T &lo, const T &hi) {
+  return Range(this, lo, hi);
+}
+
+template <typename T, typename Compare>
+template <typename Fn>
+FORCE_INLINE void LocalSkiplist<T, Compare>::scan(const T &lo, const T &hi,
+                                                  Fn &&fn) {
+  for (const auto &key : range(lo, hi)) {
+    if (!fn(key)) {
+      return;
+    }
+  }
+}
+
+template <typename T, typename Compare>
+FORCE_INLINE LocalSkiplist<T, Compare>::Range::Range(LocalSkiplist *list,
+                                                     const T &lo, const T &hi)
+    : list_(list), guard_(list->reclaimer_.get_guard()), hi_(hi) {
+  first_ = bound(list->lower_bound(lo));
+}
+
+template <typename T, typename Compare>
+FORCE_INLINE LocalSkiplist<T, Compare>::Node *
+LocalSkiplist<T, Compare>::Range::bound(Node *node) const {
+  if (node == list_->tail_ || list_->comp_(hi_, node->key)) {
+    return nullptr;
+  }
+  return node;
+}
+
+template <typename T, typename Compare>
+FORCE_INLINE LocalSkiplist<T, Compare>::Range::Iterator
+LocalSkiplist<T, Compare>::Range::begin() const {
+  return Iterator(this, first_);
+}
+
+template <typename T, typename Compare>
+FORCE_INLINE LocalSkiplist<T, Compare>::Range::Iterator
+LocalSkiplist<T, Compare>::Range::end() const {
+  return Iterator(this, nullptr);
+}
+
+template <typename T, typename Compare>
+FORCE_INLINE LocalSkiplist<T, Compare>::Range::Iterator::Iterator(
+    const Range *range, Node *node)
+    : range_(range), node_(node) {}
+
+template <typename T, typename Compare>
+FORCE_INLINE const T &
+LocalSkiplist<T, Compare>::Range::Iterator::operator*() const {
+  return node_->key;
+}
+
+template <typename T, typename Compare>
+FORCE_INLINE const T *
+LocalSkiplist<T, Compare>::Range::Iterator::operator->() const {
+  return &node_->key;
+}
 
-template <typename T> FORCE_INLINE bool LocalSkiplist<T>::insert(const T &key) {
-  return GenericLocalSkiplist::insert(&key);
+template <typename T, typename Compare>
+FORCE_INLINE LocalSkiplist<T, Compare>::Range::Iterator &
+LocalSkiplist<T, Compare>::Range::Iterator::operator++() {
+  node_ = range_->bound(range_->list_->next_node(node_));
+  return *this;
 }
 
-template <typename T> FORCE_INLINE bool LocalSkiplist<T>::exist(const T &key) {
-  return GenericLocalSkiplist::exist(&key);
+template <typename T, typename Compare>
+FORCE_INLINE bool LocalSkiplist<T, Compare>::Range::Iterator::operator==(
+    const Iterator &other) const {
+  return node_ == other.node_;
 }
 
-template <typename T> FORCE_INLINE bool LocalSkiplist<T>::remove(const T &key) {
-  return GenericLocalSkiplist::remove(&key);
+template <typename T, typename Compare>
+FORCE_INLINE bool LocalSkiplist<T, Compare>::Range::Iterator::operator!=(
+    const Iterator &other) const {
+  return node_ != other.node_;
 }
 
 } // namespace far_memory
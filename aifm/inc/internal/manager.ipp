@@ -10,9 +10,13 @@ namespace far_memory {
 extern bool gc_master_active;
 
 FORCE_INLINE Region &
-FarMemManager::RegionManager::core_local_free_region(bool nt) {
+FarMemManager::RegionManager::core_local_free_region(bool nt, uint8_t gen) {
   assert(!preempt_enabled());
   auto core_num = get_core_num();
+  if (unlikely(gen != Region::kGenYoung)) {
+    assert(!nt);
+    return core_local_free_old_gen_regions_[gen - 1][core_num];
+  }
   return nt ? core_local_free_nt_regions_[core_num]
             : core_local_free_regions_[core_num];
 }
@@ -26,12 +30,38 @@ FORCE_INLINE uint32_t FarMemManager::RegionManager::get_num_regions() const {
   return free_regions_.capacity();
 }
 
+FORCE_INLINE bool FarMemManager::RegionManager::is_reserve_full() const {
+  return reserved_regions_.size() >= num_reserved_regions_;
+}
+
 FORCE_INLINE double FarMemManager::get_free_mem_ratio() const {
   return cache_region_manager_.get_free_region_ratio();
 }
 
+FORCE_INLINE bool FarMemManager::is_overloaded() const {
+  return !cache_region_manager_.is_reserve_full();
+}
+
+FORCE_INLINE GCPacer::Stats FarMemManager::get_gc_pacer_stats() const {
+  return gc_pacer_.get_stats();
+}
+
+FORCE_INLINE void
+FarMemManager::set_replacement_policy(uint8_t ds_id, ReplacementPolicy policy) {
+  ACCESS_ONCE(replacement_policies_[ds_id]) = policy;
+}
+
+FORCE_INLINE ReplacementPolicy
+FarMemManager::get_replacement_policy(uint8_t ds_id) const {
+  return ACCESS_ONCE(replacement_policies_[ds_id]);
+}
+
 FORCE_INLINE bool FarMemManager::is_free_cache_low() const {
+#ifdef DISABLE_GC_PACING
   return get_free_mem_ratio() <= kFreeCacheLowThresh;
+#else
+  return get_free_mem_ratio() <= gc_pacer_.get_low_thresh();
+#endif
 }
 
 FORCE_INLINE bool FarMemManager::is_free_cache_almost_empty() const {
@@ -39,15 +69,20 @@ FORCE_INLINE bool FarMemManager::is_free_cache_almost_empty() const {
 }
 
 FORCE_INLINE bool FarMemManager::is_free_cache_high() const {
+#ifdef DISABLE_GC_PACING
   return get_free_mem_ratio() >= kFreeCacheHighThresh;
+#else
+  return get_free_mem_ratio() >= gc_pacer_.get_high_thresh();
+#endif
 }
 
 FORCE_INLINE void FarMemManager::push_cache_free_region(Region &region) {
   cache_region_manager_.push_free_region(region);
 }
 
-FORCE_INLINE std::optional<Region> FarMemManager::pop_cache_used_region() {
-  return cache_region_manager_.pop_used_region();
+FORCE_INLINE std::optional<Region>
+FarMemManager::pop_cache_used_region(uint8_t gen) {
+  return cache_region_manager_.pop_used_region(gen);
 }
 
 template <typename T>
@@ -88,6 +123,17 @@ FORCE_INLINE Array<T, Dims...> *FarMemManager::allocate_array_heap() {
   return new Array<T, Dims...>(this);
 }
 
+template <typename T, uint64_t... Dims>
+FORCE_INLINE PackedArray<T, Dims...> FarMemManager::allocate_packed_array() {
+  return PackedArray<T, Dims...>(this);
+}
+
+template <typename T, uint64_t... Dims>
+FORCE_INLINE PackedArray<T, Dims...> *
+FarMemManager::allocate_packed_array_heap() {
+  return new PackedArray<T, Dims...>(this);
+}
+
 template <typename T>
 FORCE_INLINE List<T> FarMemManager::allocate_list(const DerefScope &scope,
                                                   bool enable_merge) {
@@ -105,14 +151,48 @@ FORCE_INLINE Stack<T> FarMemManager::allocate_stack(const DerefScope &scope) {
 }
 
 template <typename T>
-FORCE_INLINE DataFrameVector<T> FarMemManager::allocate_dataframe_vector() {
-  return DataFrameVector<T>(this);
+FORCE_INLINE ConcurrentQueue<T>
+FarMemManager::allocate_concurrent_queue(const DerefScope &scope) {
+  return ConcurrentQueue<T>(scope);
+}
+
+template <typename T>
+FORCE_INLINE ConcurrentQueue<T> *
+FarMemManager::allocate_concurrent_queue_heap(const DerefScope &scope) {
+  return new ConcurrentQueue<T>(scope);
+}
+
+template <typename T>
+FORCE_INLINE DataFrameVector<T>
+FarMemManager::allocate_dataframe_vector(std::string_view name) {
+  return DataFrameVector<T>(this, name);
 }
 
 template <typename T>
 FORCE_INLINE DataFrameVector<T> *
-FarMemManager::allocate_dataframe_vector_heap() {
-  return new DataFrameVector<T>(this);
+FarMemManager::allocate_dataframe_vector_heap(std::string_view name) {
+  return new DataFrameVector<T>(this, name);
+}
+
+template <typename T>
+FORCE_INLINE FarVector<T> FarMemManager::allocate_far_vector(bool offloaded) {
+  return FarVector<T>(this, offloaded);
+}
+
+template <typename T>
+FORCE_INLINE FarVector<T> *
+FarMemManager::allocate_far_vector_heap(bool offloaded) {
+  return new FarVector<T>(this, offloaded);
+}
+
+template <typename K, typename V>
+FORCE_INLINE BPlusTree<K, V> FarMemManager::allocate_bplus_tree() {
+  return BPlusTree<K, V>();
+}
+
+template <typename K, typename V>
+FORCE_INLINE BPlusTree<K, V> *FarMemManager::allocate_bplus_tree_heap() {
+  return new BPlusTree<K, V>();
 }
 
 FORCE_INLINE FarMemManager *FarMemManagerFactory::get() { return ptr_; }
@@ -131,7 +211,16 @@ FORCE_INLINE void FarMemManager::read_object(uint8_t ds_id, uint8_t obj_id_len,
                                              const uint8_t *obj_id,
                                              uint16_t *data_len,
                                              uint8_t *data_buf) {
+  IOAdmission admission(device_ptr_->get_io_scheduler(), kIODemand);
   device_ptr_->read_object(ds_id, obj_id_len, obj_id, data_len, data_buf);
+  admission.add_bytes(*data_len);
+}
+
+FORCE_INLINE void FarMemManager::read_object_async(
+    uint8_t ds_id, uint8_t obj_id_len, const uint8_t *obj_id,
+    uint16_t *data_len, uint8_t *data_buf, IOCompletion completion) {
+  device_ptr_->read_object_async(ds_id, obj_id_len, obj_id, data_len,
+                                 data_buf, completion);
 }
 
 FORCE_INLINE bool FarMemManager::remove_object(uint64_t ds_id,
@@ -151,6 +240,29 @@ FORCE_INLINE void FarMemManager::destruct(uint8_t ds_id) {
   device_ptr_->destruct(ds_id);
 }
 
+FORCE_INLINE bool FarMemManager::attach(uint8_t ds_type, uint8_t ds_id,
+                                        std::string_view name,
+                                        uint8_t param_len, uint8_t *params,
+                                        uint8_t *meta_len, uint8_t *meta) {
+  BUG_ON(name.empty() ||
+         name.size() > std::numeric_limits<uint8_t>::max());
+  auto status =
+      device_ptr_->attach(ds_type, ds_id, name.size(),
+                          reinterpret_cast<const uint8_t *>(name.data()),
+                          param_len, params, meta_len, meta);
+  // The name must be neither bound to a live DS, e.g., one of another
+  // instance of the client, nor taken by a DS of another type.
+  BUG_ON(status != Server::kAttachConstructed &&
+         status != Server::kAttachReattached);
+  return status == Server::kAttachReattached;
+}
+
+FORCE_INLINE void FarMemManager::detach(uint8_t ds_id, uint8_t meta_len,
+                                        const uint8_t *meta) {
+  free_ds_id(ds_id);
+  device_ptr_->detach(ds_id, meta_len, meta);
+}
+
 FORCE_INLINE uint64_t get_obj_id_fragment(uint8_t obj_id_len,
                                           const uint8_t *obj_id) {
   uint64_t obj_id_fragment;
@@ -183,6 +295,9 @@ FORCE_INLINE void FarMemManager::gc_check() {
   if (unlikely(is_free_cache_low())) {
     Stats::add_free_mem_ratio_record();
     ACCESS_ONCE(almost_empty) = is_free_cache_almost_empty();
+    if (auto io_scheduler = device_ptr_->get_io_scheduler()) {
+      io_scheduler->set_memory_pressure(ACCESS_ONCE(almost_empty));
+    }
 #ifndef STW_GC
     launch_gc_master();
 #endif
@@ -193,19 +308,21 @@ template <typename K, typename V>
 FORCE_INLINE ConcurrentHopscotch<K, V>
 FarMemManager::allocate_concurrent_hopscotch(uint32_t local_num_entries_shift,
                                              uint32_t remote_num_entries_shift,
-                                             uint64_t remote_data_size) {
+                                             uint64_t remote_data_size,
+                                             std::string_view name) {
   return ConcurrentHopscotch<K, V>(allocate_ds_id(), local_num_entries_shift,
-                                   remote_num_entries_shift, remote_data_size);
+                                   remote_num_entries_shift, remote_data_size,
+                                   name);
 }
 
 template <typename K, typename V>
 FORCE_INLINE ConcurrentHopscotch<K, V> *
 FarMemManager::allocate_concurrent_hopscotch_heap(
     uint32_t local_num_entries_shift, uint32_t remote_num_entries_shift,
-    uint64_t remote_data_size) {
+    uint64_t remote_data_size, std::string_view name) {
   return new ConcurrentHopscotch<K, V>(
       allocate_ds_id(), local_num_entries_shift, remote_num_entries_shift,
-      remote_data_size);
+      remote_data_size, name);
 }
 
 } // namespace far_memory
@@ -48,11 +48,22 @@ FORCE_INLINE uint64_t Object::get_addr() const { return addr_; }
 
 FORCE_INLINE bool Object::is_freed() const {
   return (*reinterpret_cast<uint8_t *>(addr_ + kPtrAddrPos + kPtrAddrSize -
-                                       1)) == 0xFF;
+                                       1)) >= kRetiredTag;
 }
 
 FORCE_INLINE void Object::free() {
-  *reinterpret_cast<uint8_t *>(addr_ + kPtrAddrPos + kPtrAddrSize - 1) = 0xFF;
+  *reinterpret_cast<uint8_t *>(addr_ + kPtrAddrPos + kPtrAddrSize - 1) =
+      kFreedTag;
+}
+
+FORCE_INLINE void Object::retire() {
+  *reinterpret_cast<uint8_t *>(addr_ + kPtrAddrPos + kPtrAddrSize - 1) =
+      kRetiredTag;
+}
+
+FORCE_INLINE bool Object::is_retired() const {
+  return (*reinterpret_cast<uint8_t *>(addr_ + kPtrAddrPos + kPtrAddrSize -
+                                       1)) == kRetiredTag;
 }
 
 FORCE_INLINE void Object::set_data_len(uint16_t data_len) {
@@ -0,0 +1,60 @@
+#pragma once
+
+extern "C" {
+#include <base/compiler.h>
+#include <runtime/thread.h>
+}
+
+namespace far_memory {
+
+FORCE_INLINE OptimisticLock::OptimisticLock() {}
+
+FORCE_INLINE uint64_t
+OptimisticLock::read_lock_or_restart(bool &restart) const {
+  auto version = version_.load(std::memory_order_acquire);
+  if (unlikely(version & kLockedBit)) {
+    restart = true;
+  }
+  return version;
+}
+
+FORCE_INLINE void OptimisticLock::check_or_restart(uint64_t version,
+                                                   bool &restart) const {
+  // Orders the preceding data reads before re-reading the version.
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if (unlikely(version_.load(std::memory_order_relaxed) != version)) {
+    restart = true;
+  }
+}
+
+FORCE_INLINE void
+OptimisticLock::upgrade_to_write_lock_or_restart(uint64_t version,
+                                                 bool &restart) {
+  if (unlikely(!version_.compare_exchange_strong(
+          version, version | kLockedBit, std::memory_order_acquire))) {
+    restart = true;
+  }
+}
+
+FORCE_INLINE void OptimisticLock::write_lock() {
+  while (true) {
+    auto version = version_.load(std::memory_order_relaxed);
+    if (likely(!(version & kLockedBit) &&
+               version_.compare_exchange_weak(version, version | kLockedBit,
+                                              std::memory_order_acquire))) {
+      return;
+    }
+    thread_yield();
+  }
+}
+
+FORCE_INLINE void OptimisticLock::write_unlock() {
+  // Clears the locked bit and bumps the version at once.
+  version_.fetch_add(kLockedBit, std::memory_order_release);
+}
+
+FORCE_INLINE bool OptimisticLock::is_write_locked() const {
+  return version_.load(std::memory_order_relaxed) & kLockedBit;
+}
+
+} // namespace far_memory
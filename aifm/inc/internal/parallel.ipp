@@ -18,7 +18,7 @@ FORCE_INLINE Parallelizer<Task>::Parallelizer(uint32_t num_slaves,
     std::cerr << "Error: invalid arguments in Parallelizer." << std::endl;
     exit(-EINVAL);
   }
-  num_slaves_ = num_slaves;
+  num_slaves_ = num_active_slaves_ = num_slaves;
   preempt_disable();
   task_queues_ =
       std::make_unique<std::unique_ptr<CircularBuffer<Task, true>>[]>(
@@ -38,7 +38,7 @@ FORCE_INLINE void Parallelizer<Task>::master_enqueue_task(T &&task) {
     pushed = task_queues_[enqueue_thread_id_]->push_back(task);
     // Dispatch task to workers in a round-robin fashion.
     enqueue_thread_id_++;
-    if (unlikely(enqueue_thread_id_ == num_slaves_)) {
+    if (unlikely(enqueue_thread_id_ == num_active_slaves_)) {
       enqueue_thread_id_ = 0;
     }
   }
@@ -57,7 +57,7 @@ FORCE_INLINE bool Parallelizer<Task>::slave_can_exit(uint32_t tid) {
   }
   if (unlikely(task_queues_[tid]->size() == 0)) {
     // Work stealing.
-    for (uint32_t i = 0; i < num_slaves_; i++) {
+    for (uint32_t i = 0; i < num_active_slaves_; i++) {
       if (i == tid) {
         continue;
       }
@@ -72,7 +72,16 @@ done:
 
 template <typename Task>
 FORCE_INLINE void Parallelizer<Task>::spawn(Status *slaves_status) {
-  for (uint8_t i = 0; i < num_slaves_; i++) {
+  spawn(slaves_status, num_slaves_);
+}
+
+template <typename Task>
+FORCE_INLINE void Parallelizer<Task>::spawn(Status *slaves_status,
+                                            uint32_t num_active_slaves) {
+  BUG_ON(!num_active_slaves || num_active_slaves > num_slaves_);
+  num_active_slaves_ = num_active_slaves;
+  enqueue_thread_id_ = 0;
+  for (uint8_t i = 0; i < num_active_slaves_; i++) {
     threads_[i] =
         std::move(rt::Thread([&, i] { slave_fn(i); },
                              /* round-robin = */ true, slaves_status[i]));
@@ -86,15 +95,36 @@ template <typename Task> FORCE_INLINE void Parallelizer<Task>::execute() {
   master_fn();
   master_done_ = true;
   preempt_enable();
-  for (auto &thread : threads_) {
-    thread.Join();
+  for (uint32_t i = 0; i < num_active_slaves_; i++) {
+    threads_[i].Join();
   }
 #ifdef DEBUG
-  for (uint8_t i = 0; i < num_slaves_; i++) {
+  for (uint8_t i = 0; i < num_active_slaves_; i++) {
     assert(task_queues_[i]->size() == 0);
   }
 #endif
   master_up_ = false;
   master_done_ = false;
 }
+
+template <typename Fn> FORCE_INLINE void parallel_for(uint64_t num, Fn &&fn) {
+  auto num_threads = std::min(static_cast<uint64_t>(helpers::kNumCPUs), num);
+  if (!num_threads) {
+    return;
+  }
+  auto num_tasks_per_thread = (num - 1) / num_threads + 1;
+  std::vector<rt::Thread> threads;
+  for (uint32_t tid = 0; tid < num_threads; tid++) {
+    threads.emplace_back(rt::Thread([&, tid]() {
+      auto left = num_tasks_per_thread * tid;
+      auto right = std::min(left + num_tasks_per_thread, num);
+      for (auto i = left; i < right; i++) {
+        fn(i);
+      }
+    }));
+  }
+  for (auto &thread : threads) {
+    thread.Join();
+  }
+}
 } // namespace far_memory
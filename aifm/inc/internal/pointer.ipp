@@ -90,7 +90,26 @@ FORCE_INLINE bool FarMemPtrMeta::is_hot() const {
 }
 
 FORCE_INLINE void FarMemPtrMeta::clear_hot() {
-  metadata_[kHotPos] = (kHotClear >> (8 * kHotPos)) + (kHotThresh - 1);
+  // One access short of hot, rather than the untouched count, which the
+  // caller may have dereferenced it since.
+  metadata_[kHotPos] = kHotClear >> (8 * kHotPos);
+}
+
+FORCE_INLINE bool FarMemPtrMeta::is_untouched() const {
+  return ACCESS_ONCE(metadata_[kHotPos]) ==
+         (kHotClear >> (8 * kHotPos)) + (kHotThresh - 1);
+}
+
+FORCE_INLINE bool FarMemPtrMeta::mark_evacuation_if_untouched() {
+  auto metadata = to_uint64_t();
+  do {
+    if ((metadata & (kPresentClear | kEvacuationSet)) ||
+        static_cast<uint8_t>(metadata >> (8 * kHotPos)) !=
+            (kHotClear >> (8 * kHotPos)) + (kHotThresh - 1)) {
+      return false;
+    }
+  } while (!compare_exchange(&metadata, metadata | kEvacuationSet));
+  return true;
 }
 
 FORCE_INLINE bool FarMemPtrMeta::is_nt() const {
@@ -106,6 +125,59 @@ FORCE_INLINE void FarMemPtrMeta::set_hot() {
   *reinterpret_cast<uint16_t *>(metadata_) &= (~kHotClear);
 }
 
+template <typename F>
+FORCE_INLINE void FarMemPtrMeta::update_replacement_bits(F &&f) {
+  auto *ptr = &metadata_[kReplacementPos];
+  auto old_val = ACCESS_ONCE(*ptr);
+  uint8_t new_val;
+  do {
+    new_val = (old_val & ~kReplacementMask) |
+              (f(static_cast<uint8_t>(old_val & kReplacementMask)) &
+               kReplacementMask);
+  } while (!__atomic_compare_exchange_n(ptr, &old_val, new_val,
+                                        /* weak = */ false, __ATOMIC_SEQ_CST,
+                                        __ATOMIC_SEQ_CST));
+}
+
+FORCE_INLINE uint8_t FarMemPtrMeta::get_freq() const {
+  return (ACCESS_ONCE(metadata_[kReplacementPos]) & kFreqMask) >> kFreqShift;
+}
+
+FORCE_INLINE void FarMemPtrMeta::inc_freq() {
+  update_replacement_bits([](uint8_t bits) -> uint8_t {
+    return ((bits & kFreqMask) == kFreqMask) ? bits : bits + (1 << kFreqShift);
+  });
+}
+
+FORCE_INLINE void FarMemPtrMeta::age_freq() {
+  update_replacement_bits([](uint8_t bits) -> uint8_t {
+    return (bits & ~kFreqMask) | (((bits & kFreqMask) >> 1) & kFreqMask);
+  });
+}
+
+FORCE_INLINE bool FarMemPtrMeta::is_clock_hot() const {
+  return ACCESS_ONCE(metadata_[kReplacementPos]) & kClockHotMask;
+}
+
+FORCE_INLINE bool FarMemPtrMeta::is_in_test() const {
+  return ACCESS_ONCE(metadata_[kReplacementPos]) & kInTestMask;
+}
+
+FORCE_INLINE void FarMemPtrMeta::set_clock_state(bool clock_hot,
+                                                 bool in_test) {
+  update_replacement_bits([=](uint8_t bits) -> uint8_t {
+    return (bits & kFreqMask) | (clock_hot ? kClockHotMask : 0) |
+           (in_test ? kInTestMask : 0);
+  });
+}
+
+FORCE_INLINE bool FarMemPtrMeta::compare_exchange(uint64_t *expected,
+                                                  uint64_t desired) {
+  return __atomic_compare_exchange_n(reinterpret_cast<uint64_t *>(metadata_),
+                                     expected, desired, /* weak = */ false,
+                                     __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
 FORCE_INLINE uint64_t FarMemPtrMeta::to_uint64_t() const {
   return ACCESS_ONCE(*reinterpret_cast<const uint64_t *>(metadata_));
 }
@@ -119,6 +191,10 @@ FORCE_INLINE void FarMemPtrMeta::set_evacuation() {
   metadata_[kEvacuationPos] |= 1;
 }
 
+FORCE_INLINE void FarMemPtrMeta::clear_evacuation() {
+  metadata_[kEvacuationPos] &= ~1;
+}
+
 FORCE_INLINE bool FarMemPtrMeta::is_evacuation() const {
   return metadata_[kEvacuationPos] & 1;
 }
@@ -199,17 +275,27 @@ retry:
       }
       goto retry;
     }
+    // Sets D and counts the access towards turning hot in a single CAS, as
+    // the replacement bits that share the flags byte are updated by CAS
+    // concurrently, e.g., by inc_freq() and the GC.
+    auto new_metadata = metadata;
     if constexpr (Mut) {
-      // set P and D.
-      if constexpr (!Shared) {
-        __asm__("movb $0, %0"
-                : "=m"(meta().metadata_[FarMemPtrMeta::kPresentPos]));
-      } else {
-        __asm__("movb $2, %0"
-                : "=m"(meta().metadata_[FarMemPtrMeta::kPresentPos]));
-      }
+      new_metadata &= ~static_cast<uint64_t>(FarMemPtrMeta::kDirtyClear);
+    }
+    constexpr uint8_t kHotClearBit =
+        FarMemPtrMeta::kHotClear >> (8 * FarMemPtrMeta::kHotPos);
+    auto hot_byte =
+        static_cast<uint8_t>(metadata >> (8 * FarMemPtrMeta::kHotPos));
+    if (hot_byte & kHotClearBit) {
+      new_metadata -= 1ULL << (8 * FarMemPtrMeta::kHotPos);
+    }
+    if (!meta().compare_exchange(&metadata, new_metadata)) {
+      goto retry;
+    }
+    if (hot_byte == kHotClearBit) {
+      // Just turned hot.
+      meta().inc_freq();
     }
-    meta().metadata_[FarMemPtrMeta::kHotPos]--;
   }
 
   // 4) shrq.
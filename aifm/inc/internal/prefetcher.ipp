@@ -2,47 +2,35 @@
 
 #include "device.hpp"
 
-#include <optional>
-
 namespace far_memory {
 
 template <typename InduceFn, typename InferFn, typename MappingFn>
 FORCE_INLINE Prefetcher<InduceFn, InferFn, MappingFn>::Prefetcher(
     FarMemDevice *device, uint8_t *state, uint32_t object_data_size)
     : kPrefetchWinSize_(device->get_prefetch_win_size() / (object_data_size)),
-      state_(state), object_data_size_(object_data_size) {
+      state_(state), object_data_size_(object_data_size),
+      stream_(
+          this,
+          [](void *owner) {
+            return reinterpret_cast<Prefetcher *>(owner)->run();
+          },
+          [](void *owner) {
+            return reinterpret_cast<Prefetcher *>(owner)->has_pending_traces();
+          }) {
   for (auto &trace : traces_) {
     trace.counter = 0;
   }
-  prefetch_threads_.emplace_back(rt::Thread([&]() { prefetch_master_fn(); }));
-  for (uint32_t i = 0; i < kMaxNumPrefetchSlaveThreads; i++) {
-    auto &status = slave_status_[i].data;
-    status.task = nullptr;
-    status.is_exited = false;
-    wmb();
-    prefetch_threads_.emplace_back(
-        rt::Thread([&, i]() { prefetch_slave_fn(i); }));
-  }
 }
 
 template <typename InduceFn, typename InferFn, typename MappingFn>
 FORCE_INLINE Prefetcher<InduceFn, InferFn, MappingFn>::~Prefetcher() {
-  exit_ = true;
-  wmb();
-  while (!ACCESS_ONCE(master_exited)) {
-    cv_prefetch_master_.Signal();
-    thread_yield();
-  }
-  for (uint32_t i = 0; i < kMaxNumPrefetchSlaveThreads; i++) {
-    auto &status = slave_status_[i].data;
-    while (!ACCESS_ONCE(status.is_exited)) {
-      status.cv.Signal();
-      thread_yield();
-    }
-  }
-  for (auto &thread : prefetch_threads_) {
-    thread.Join();
-  }
+  stream_.unregister();
+}
+
+template <typename InduceFn, typename InferFn, typename MappingFn>
+FORCE_INLINE PrefetchStream *
+Prefetcher<InduceFn, InferFn, MappingFn>::get_stream() {
+  return &stream_;
 }
 
 template <typename InduceFn, typename InferFn, typename MappingFn>
@@ -50,113 +38,70 @@ FORCE_INLINE void
 Prefetcher<InduceFn, InferFn, MappingFn>::generate_prefetch_tasks() {
   InferFn inferer;
   MappingFn mapper;
+  GenericUniquePtr *tasks[kGenTasksBurstSize];
+  uint32_t num_tasks = 0;
   for (uint32_t i = 0; i < kGenTasksBurstSize; i++) {
     if (!num_objs_to_prefetch) {
-      return;
+      break;
     }
     num_objs_to_prefetch--;
     GenericUniquePtr *task = mapper(state_, next_prefetch_idx_);
     next_prefetch_idx_ = inferer(next_prefetch_idx_, pattern_);
-    if (!task) {
-      continue;
-    }
-    bool dispatched = false;
-    std::optional<uint32_t> inactive_slave_id = std::nullopt;
-    for (uint32_t i = 0; i < kMaxNumPrefetchSlaveThreads; i++) {
-      auto &status = slave_status_[i].data;
-      if (status.cv.HasWaiters()) {
-        inactive_slave_id = i;
-        continue;
-      }
-      if (ACCESS_ONCE(status.task) == nullptr) {
-        ACCESS_ONCE(status.task) = task;
-        dispatched = true;
-        break;
-      }
-    }
-    if (!dispatched) {
-      if (likely(inactive_slave_id)) {
-        auto &status = slave_status_[*inactive_slave_id].data;
-        status.task = task;
-        wmb();
-        status.cv.Signal();
-      } else {
-        task->swap_in(nt_);
-      }
+    if (task) {
+      tasks[num_tasks++] = task;
     }
   }
+  if (num_tasks) {
+    PrefetchService::get()->submit(&stream_, tasks, num_tasks, nt_);
+  }
 }
 
 template <typename InduceFn, typename InferFn, typename MappingFn>
-FORCE_INLINE void
-Prefetcher<InduceFn, InferFn, MappingFn>::prefetch_slave_fn(uint32_t tid) {
-  auto &status = slave_status_[tid].data;
-  GenericUniquePtr **task_ptr = &status.task;
-  bool *is_exited = &status.is_exited;
-  rt::CondVar *cv = &status.cv;
-  cv->Wait();
-
-  while (likely(!ACCESS_ONCE(exit_))) {
-    if (likely(ACCESS_ONCE(*task_ptr))) {
-      GenericUniquePtr *task = *task_ptr;
-      ACCESS_ONCE(*task_ptr) = nullptr;
-      task->swap_in(nt_);
-    } else {
-      auto start_us = microtime();
-      while (ACCESS_ONCE(*task_ptr) == nullptr &&
-             microtime() - start_us <= kMaxSlaveWaitUs) {
-        cpu_relax();
-      }
-      if (unlikely(ACCESS_ONCE(*task_ptr) == nullptr)) {
-        cv->Wait();
-      }
-    }
-  }
-  ACCESS_ONCE(*is_exited) = true;
+FORCE_INLINE bool
+Prefetcher<InduceFn, InferFn, MappingFn>::has_pending_traces() {
+  return local_counter_ < ACCESS_ONCE(traces_[traces_head_].counter);
 }
 
 template <typename InduceFn, typename InferFn, typename MappingFn>
-FORCE_INLINE void
-Prefetcher<InduceFn, InferFn, MappingFn>::prefetch_master_fn() {
-  uint64_t local_counter = 0;
+FORCE_INLINE bool Prefetcher<InduceFn, InferFn, MappingFn>::run() {
   InduceFn inducer;
   InferFn inferer;
 
-  while (likely(!ACCESS_ONCE(exit_))) {
+  if (unlikely(cur_hit_times_thresh_ != ACCESS_ONCE(hit_times_thresh_))) {
+    // Relearn the pattern under the new threshold.
+    cur_hit_times_thresh_ = ACCESS_ONCE(hit_times_thresh_);
+    hit_times_ = num_objs_to_prefetch = 0;
+  }
+  // Bounded so that a busy stream cannot starve the others.
+  for (uint32_t i = 0; i < kIdxTracesSize; i++) {
     auto [counter, idx, nt] = traces_[traces_head_];
 
-    if (likely(local_counter < counter)) {
-      local_counter = counter;
-      traces_head_ = (traces_head_ + 1) % kIdxTracesSize;
+    if (local_counter_ >= counter) {
+      break;
+    }
+    local_counter_ = counter;
+    traces_head_ = (traces_head_ + 1) % kIdxTracesSize;
 
-      if (unlikely(idx == last_idx_)) {
-        continue;
-      }
-      auto new_pattern = inducer(last_idx_, idx);
-      if (pattern_ != new_pattern) {
-        hit_times_ = num_objs_to_prefetch = 0;
-      } else if (++hit_times_ >= kHitTimesThresh) {
-        if (unlikely(hit_times_ == kHitTimesThresh)) {
-          next_prefetch_idx_ = inferer(idx, pattern_);
-          num_objs_to_prefetch = kPrefetchWinSize_;
-        } else {
-          num_objs_to_prefetch++;
-        }
-      }
-      pattern_ = new_pattern;
-      last_idx_ = idx;
-      if (unlikely(nt_ != nt)) {
-        // nt_ is shared by all slaves. Use the store instruction only when
-        // neccesary to reduce cache traffic.
-        nt_ = nt;
-      }
-    } else if (!num_objs_to_prefetch) {
-      cv_prefetch_master_.Wait();
+    if (unlikely(idx == last_idx_)) {
       continue;
     }
-    generate_prefetch_tasks();
+    auto new_pattern = inducer(last_idx_, idx);
+    if (pattern_ != new_pattern) {
+      hit_times_ = num_objs_to_prefetch = 0;
+    } else if (++hit_times_ >= cur_hit_times_thresh_) {
+      if (unlikely(hit_times_ == cur_hit_times_thresh_)) {
+        next_prefetch_idx_ = inferer(idx, pattern_);
+        num_objs_to_prefetch = kPrefetchWinSize_;
+      } else {
+        num_objs_to_prefetch++;
+      }
+    }
+    pattern_ = new_pattern;
+    last_idx_ = idx;
+    nt_ = nt;
   }
-  ACCESS_ONCE(master_exited) = true;
+  generate_prefetch_tasks();
+  return num_objs_to_prefetch || has_pending_traces();
 }
 
 template <typename InduceFn, typename InferFn, typename MappingFn>
@@ -169,9 +114,7 @@ Prefetcher<InduceFn, InferFn, MappingFn>::add_trace(bool nt, Index_t idx) {
   traces_[traces_tail_++] = {
       .counter = ++traces_counter_, .idx = idx, .nt = nt};
   traces_tail_ %= kIdxTracesSize;
-  if (unlikely(cv_prefetch_master_.HasWaiters())) {
-    cv_prefetch_master_.Signal();
-  }
+  stream_.schedule();
 }
 
 template <typename InduceFn, typename InferFn, typename MappingFn>
@@ -180,6 +123,7 @@ FORCE_INLINE void Prefetcher<InduceFn, InferFn, MappingFn>::static_prefetch(
   next_prefetch_idx_ = start_idx;
   pattern_ = pattern;
   num_objs_to_prefetch = num;
+  stream_.schedule();
 }
 
 template <typename InduceFn, typename InferFn, typename MappingFn>
@@ -188,4 +132,10 @@ Prefetcher<InduceFn, InferFn, MappingFn>::update_state(uint8_t *state) {
   ACCESS_ONCE(state_) = state;
 }
 
+template <typename InduceFn, typename InferFn, typename MappingFn>
+FORCE_INLINE void
+Prefetcher<InduceFn, InferFn, MappingFn>::set_eager(bool eager) {
+  ACCESS_ONCE(hit_times_thresh_) = eager ? 1 : kHitTimesThresh;
+}
+
 } // namespace far_memory
@@ -0,0 +1,155 @@
+#pragma once
+
+#include "helpers.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace far_memory {
+
+template <typename T>
+FORCE_INLINE QuantileSketch<T>::QuantileSketch(uint32_t k) : k_(k) {
+  BUG_ON(k_ < kMinLevelCapacity);
+  add_level();
+}
+
+template <typename T>
+FORCE_INLINE uint32_t QuantileSketch<T>::level_capacity(uint32_t level) const {
+  // Lower levels get geometrically smaller capacities; the top one gets k_.
+  auto depth = levels_.size() - level - 1;
+  auto capacity =
+      static_cast<uint32_t>(std::ceil(k_ * std::pow(kLevelDecay, depth)));
+  return std::max(capacity, kMinLevelCapacity);
+}
+
+template <typename T> FORCE_INLINE void QuantileSketch<T>::add_level() {
+  levels_.emplace_back();
+  max_num_items_ = 0;
+  for (uint32_t i = 0; i < levels_.size(); i++) {
+    max_num_items_ += level_capacity(i);
+  }
+}
+
+template <typename T> FORCE_INLINE bool QuantileSketch<T>::random_bit() {
+  // xorshift64; deterministic so that offloaded results are reproducible.
+  rand_state_ ^= rand_state_ << 13;
+  rand_state_ ^= rand_state_ >> 7;
+  rand_state_ ^= rand_state_ << 17;
+  return rand_state_ & 1;
+}
+
+template <typename T> FORCE_INLINE void QuantileSketch<T>::compress() {
+  for (uint32_t h = 0; h < levels_.size(); h++) {
+    auto &level = levels_[h];
+    if (level.size() < level_capacity(h)) {
+      continue;
+    }
+    if (h + 1 == levels_.size()) {
+      add_level();
+    }
+    auto &cur = levels_[h];
+    auto &next = levels_[h + 1];
+    std::sort(cur.begin(), cur.end());
+    // An odd leftover item stays at this level so that weights are preserved.
+    T leftover;
+    bool has_leftover = cur.size() % 2;
+    if (has_leftover) {
+      leftover = std::move(cur.back());
+      cur.pop_back();
+    }
+    for (uint64_t i = random_bit(); i < cur.size(); i += 2) {
+      next.push_back(std::move(cur[i]));
+    }
+    num_items_ -= cur.size() / 2;
+    cur.clear();
+    if (has_leftover) {
+      cur.push_back(std::move(leftover));
+    }
+    if (num_items_ < max_num_items_) {
+      break;
+    }
+  }
+}
+
+template <typename T> FORCE_INLINE void QuantileSketch<T>::add(const T &t) {
+  levels_[0].push_back(t);
+  count_++;
+  if (++num_items_ >= max_num_items_) {
+    compress();
+  }
+}
+
+template <typename T>
+FORCE_INLINE void QuantileSketch<T>::merge(const QuantileSketch &other) {
+  while (levels_.size() < other.levels_.size()) {
+    add_level();
+  }
+  for (uint32_t h = 0; h < other.levels_.size(); h++) {
+    auto &level = other.levels_[h];
+    levels_[h].insert(levels_[h].end(), level.begin(), level.end());
+  }
+  count_ += other.count_;
+  num_items_ += other.num_items_;
+  while (num_items_ >= max_num_items_) {
+    auto prev_num_items = num_items_;
+    compress();
+    if (num_items_ == prev_num_items) {
+      break;
+    }
+  }
+}
+
+template <typename T>
+FORCE_INLINE T QuantileSketch<T>::quantile(double q) const {
+  return at_rank(static_cast<uint64_t>(q * count_));
+}
+
+template <typename T>
+FORCE_INLINE T QuantileSketch<T>::at_rank(uint64_t rank) const {
+  BUG_ON(empty());
+  std::vector<std::pair<T, uint64_t>> weighted;
+  weighted.reserve(num_items_);
+  for (uint32_t h = 0; h < levels_.size(); h++) {
+    for (auto &item : levels_[h]) {
+      weighted.emplace_back(item, 1ULL << h);
+    }
+  }
+  std::sort(weighted.begin(), weighted.end(),
+            [](const auto &a, const auto &b) { return a.first < b.first; });
+  uint64_t cumulative = 0;
+  for (auto &[item, weight] : weighted) {
+    cumulative += weight;
+    if (cumulative > rank) {
+      return item;
+    }
+  }
+  return weighted.back().first;
+}
+
+template <typename T>
+FORCE_INLINE uint64_t QuantileSketch<T>::rank_error() const {
+  return exact() ? 0
+                 : static_cast<uint64_t>(std::ceil(count_ * kRankErrorFactor /
+                                                   k_));
+}
+
+template <typename T> FORCE_INLINE bool QuantileSketch<T>::exact() const {
+  return num_items_ == count_;
+}
+
+template <typename T> FORCE_INLINE uint64_t QuantileSketch<T>::count() const {
+  return count_;
+}
+
+template <typename T> FORCE_INLINE bool QuantileSketch<T>::empty() const {
+  return count_ == 0;
+}
+
+template <typename T> FORCE_INLINE void QuantileSketch<T>::clear() {
+  levels_.clear();
+  count_ = num_items_ = 0;
+  add_level();
+}
+
+} // namespace far_memory
@@ -18,6 +18,8 @@ FORCE_INLINE void Region::reset() {
   first_free_byte_idx_ = kObjectPos;
   num_boundaries_ = 0;
   clear_nt();
+  clear_advice();
+  set_gen(kGenYoung);
 }
 
 FORCE_INLINE bool Region::is_local() const { return buf_ptr_; }
@@ -81,4 +83,43 @@ FORCE_INLINE void Region::set_nt() {
 FORCE_INLINE void Region::clear_nt() {
   ACCESS_ONCE(*reinterpret_cast<uint8_t *>(buf_ptr_ + kNtPos)) = 0;
 }
+
+FORCE_INLINE bool Region::is_dontneed() const {
+  return ACCESS_ONCE(*reinterpret_cast<uint8_t *>(buf_ptr_ + kAdvicePos)) &
+         kDontNeedMask;
+}
+
+FORCE_INLINE void Region::clear_advice() {
+  auto advice_ptr = buf_ptr_ + kAdvicePos;
+  __atomic_fetch_and(advice_ptr, static_cast<uint8_t>(~kDontNeedMask),
+                     __ATOMIC_SEQ_CST);
+}
+
+FORCE_INLINE uint8_t Region::get_gen() const {
+  return ACCESS_ONCE(*reinterpret_cast<uint8_t *>(buf_ptr_ + kAdvicePos)) &
+         kGenMask;
+}
+
+FORCE_INLINE uint8_t Region::get_gen(uint64_t object_addr) {
+  auto region_addr = (object_addr) & (~(Region::kSize - 1));
+  return ACCESS_ONCE(*(reinterpret_cast<uint8_t *>(region_addr) + kAdvicePos)) &
+         kGenMask;
+}
+
+// Shares the byte with DontNeed, which advise() may set concurrently.
+FORCE_INLINE void Region::set_gen(uint8_t gen) {
+  auto advice_ptr = buf_ptr_ + kAdvicePos;
+  auto advice = ACCESS_ONCE(*advice_ptr);
+  while (!__atomic_compare_exchange_n(
+      advice_ptr, &advice, static_cast<uint8_t>((advice & ~kGenMask) | gen),
+      /* weak = */ true, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST))
+    ;
+}
+
+FORCE_INLINE bool Region::set_dontneed(uint64_t object_addr) {
+  auto region_addr = (object_addr) & (~(Region::kSize - 1));
+  auto advice_ptr = reinterpret_cast<uint8_t *>(region_addr) + kAdvicePos;
+  return !(__atomic_fetch_or(advice_ptr, kDontNeedMask, __ATOMIC_SEQ_CST) &
+           kDontNeedMask);
+}
 } // namespace far_memory
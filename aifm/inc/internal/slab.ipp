@@ -12,4 +12,30 @@ FORCE_INLINE uint32_t Slab::get_slab_idx(uint32_t size) {
 FORCE_INLINE uint32_t Slab::get_slab_size(uint32_t idx) {
   return (1 << (kMinSlabClassShift + idx));
 }
+
+FORCE_INLINE uint32_t Slab::get_magazine_size(uint32_t idx) {
+  return std::clamp(kMaxMagazineBytes / get_slab_size(idx), kMinMagazineSize,
+                    kMaxMagazineSize);
+}
+
+FORCE_INLINE uint64_t Slab::get_span_num_pages(uint32_t idx) {
+  return std::max(kMinSpanSize, kMinNumObjectsPerSpan * get_slab_size(idx)) /
+         helpers::kPageSize;
+}
+
+FORCE_INLINE uint8_t *Slab::get_page_addr(uint64_t page) const {
+  return base_.get() + (page << helpers::kPageShift);
+}
+
+FORCE_INLINE uint64_t Slab::get_page(uint64_t addr) const {
+  auto base = reinterpret_cast<uint64_t>(base_.get());
+  return (addr - base) >> helpers::kPageShift;
+}
+
+FORCE_INLINE Slab::Span *Slab::get_span(const uint8_t *ptr) const {
+  auto page = static_cast<uint64_t>(ptr - base_.get()) >> helpers::kPageShift;
+  assert(page < num_pages_);
+  return page_map_[page];
+}
+
 } // namespace far_memory
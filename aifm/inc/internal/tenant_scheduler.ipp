@@ -0,0 +1,19 @@
+#pragma once
+
+namespace far_memory {
+
+FORCE_INLINE TenantAdmission::TenantAdmission(TenantScheduler *scheduler,
+                                              uint32_t tenant_id)
+    : scheduler_(scheduler), tenant_id_(tenant_id) {
+  if (scheduler_) {
+    scheduler_->acquire(tenant_id_);
+  }
+}
+
+FORCE_INLINE TenantAdmission::~TenantAdmission() {
+  if (scheduler_) {
+    scheduler_->release(tenant_id_);
+  }
+}
+
+} // namespace far_memory
@@ -0,0 +1,115 @@
+#pragma once
+
+#include "sync.h"
+
+#include "helpers.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+
+namespace far_memory {
+
+// Listed in the order of priority.
+enum IOClass : uint8_t {
+  kIODemand = 0,  // Swap-ins on the critical path of the mutator.
+  kIOWriteBack,   // Write-backs of dirty objects, e.g., during evacuation.
+  kIOPrefetch,    // Speculative swap-ins issued by the prefetcher.
+  kNumIOClasses
+};
+
+// Admits the data-plane requests of a device in priority order so that a
+// demand miss never queues behind a burst of write-backs or prefetches.
+//   1. Demand requests always go first.
+//   2. Under memory pressure, write-backs go before prefetches, since the
+//      mutators are waiting for the evacuation to free the cache.
+//   3. Otherwise write-backs and prefetches share the slots by kWeights.
+// A prefetch that has waited longer than kPrefetchStaleUs is cancelled rather
+// than issued, as the mutator has most likely gone past it. The last
+// num_reserved_slots_ slots are reserved for write-backs: a swap-in may block
+// for free cache while holding its slot, and the evacuation that frees the
+// cache must still be able to make progress.
+//
+// While nothing is queued, acquire() and release() only touch atomic counters
+// and per-core stats, so an uncontended demand miss never takes the mutex.
+class IOScheduler {
+public:
+  struct Stats {
+    uint64_t num_ops;
+    uint64_t num_bytes;
+    uint64_t num_cancelled;
+    uint64_t total_wait_us;
+    uint64_t max_wait_us;
+  };
+
+private:
+  struct Waiter {
+    rt::CondVar cv;
+    uint64_t enqueue_us;
+    bool granted;
+    bool cancelled;
+  };
+
+  // The stats counted on the fast paths.
+  struct alignas(64) CoreStats {
+    uint64_t num_ops[kNumIOClasses];
+    uint64_t num_bytes[kNumIOClasses];
+  };
+
+  constexpr static uint32_t kWeights[kNumIOClasses] = {0, 2, 1};
+  constexpr static uint64_t kStrideBase = 1 << 10;
+  constexpr static uint64_t kPrefetchStaleUs = 200;
+
+  std::atomic<uint32_t> num_free_slots_;
+  // Requests that are queued or about to be. The fast path of acquire() is
+  // only taken when there are none, so that it never overtakes them.
+  std::atomic<uint32_t> num_waiters_ = 0;
+  uint32_t num_reserved_slots_;
+  CoreStats core_stats_[helpers::kNumCPUs] = {};
+  // The fields below are guarded by mutex_.
+  rt::Mutex mutex_;
+  std::deque<Waiter *> queues_[kNumIOClasses];
+  uint64_t passes_[kNumIOClasses] = {};
+  uint64_t global_pass_ = 0;
+  bool memory_pressure_ = false;
+  Stats stats_[kNumIOClasses] = {};
+
+  bool has_free_slot(IOClass io_class, uint32_t num_free_slots) const;
+  bool try_take_slot(IOClass io_class);
+  void dispatch();
+  bool grant(IOClass io_class);
+  CoreStats &get_core_stats();
+
+public:
+  IOScheduler(uint32_t num_slots);
+  NOT_COPYABLE(IOScheduler);
+  NOT_MOVEABLE(IOScheduler);
+  // Blocks until a slot is granted. Returns false if the request (which must
+  // be a prefetch) was cancelled as stale.
+  bool acquire(IOClass io_class);
+  void release(IOClass io_class, uint64_t num_bytes);
+  void set_memory_pressure(bool memory_pressure);
+  Stats get_stats(IOClass io_class);
+};
+
+// Holds a slot of the scheduler during its lifetime. A null scheduler (e.g.,
+// for devices without contention) admits everything.
+class IOAdmission {
+private:
+  IOScheduler *scheduler_;
+  IOClass io_class_;
+  bool admitted_;
+  uint64_t num_bytes_ = 0;
+
+public:
+  IOAdmission(IOScheduler *scheduler, IOClass io_class);
+  ~IOAdmission();
+  NOT_COPYABLE(IOAdmission);
+  NOT_MOVEABLE(IOAdmission);
+  bool admitted() const;
+  void add_bytes(uint64_t num_bytes);
+};
+
+} // namespace far_memory
+
+#include "internal/io_scheduler.ipp"
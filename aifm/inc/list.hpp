@@ -57,6 +57,7 @@ private:
     GenericUniquePtr ptr;
     ChunkList chunk_list;
     uint8_t cnt = 0;
+    // Set while a prefetch of ptr is in flight.
     bool swapping_in = false;
     uint8_t paddings[6];
 
@@ -99,6 +100,9 @@ private:
   constexpr static uint16_t kInvalidCnt = kMaxNumNodesPerChunk + 1;
   constexpr static uint16_t kDefaultChunkSize = 4096;
   constexpr static double kMergeThreshRatio = 0.75;
+  constexpr static uint32_t kMaxPrefetchNumNodes = 64;
+  // The consecutive nodes found swapped in after which the window shrinks.
+  constexpr static uint32_t kPrefetchShrinkInterval = 16;
 
   const uint16_t kItemSize_;
   const uint16_t kNumNodesPerChunk_;
@@ -113,7 +117,12 @@ private:
   bool customized_split_; // Customized for Queue and Stack.
   bool enable_prefetch_ = false;
   bool prefetch_reversed_ = true;
+  // The next node to prefetch, which is prefetch_window_ nodes ahead of the
+  // consumer.
   LocalList<LocalNode>::Iterator prefetch_iter_;
+  uint32_t prefetch_window_;
+  uint32_t num_timely_nodes_ = 0;
+  const LocalNode *last_consumed_node_ = nullptr;
 
   template <typename T> friend class List;
   friend class FarMemTest;
@@ -147,8 +156,8 @@ private:
   template <bool Reverse>
   void
   prefetch_fsm(const LocalList<LocalNode>::IteratorImpl<Reverse> &local_iter);
-  void prefetch_once();
-  void do_prefetch(LocalNode *local_node);
+  uint32_t adapt_prefetch_window(const LocalNode *local_node);
+  void prefetch_nodes(uint32_t num_nodes);
 
 public:
   GenericIterator begin(const DerefScope &scope) const;
@@ -1,71 +1,117 @@
 #pragma once
 
-#include "sync.h"
-
+#include "epoch.hpp"
 #include "helpers.hpp"
 #include "slab.hpp"
 
+#include <atomic>
 #include <cstdint>
 #include <functional>
-#include <limits>
 #include <random>
+#include <type_traits>
 
 namespace far_memory {
 
-class GenericLocalSkiplist {
-protected:
-#pragma pack(push, 1)
-  struct Entry {
-    using Width = uint32_t;
-
-    Width width;
-    Entry *up;
-    Entry *down;
-    Entry *left;
-    Entry *right;
-    void *key;
-    rt::Spin lock;
-  };
-#pragma pack(pop)
+// A lock-free ordered set of unique keys in local memory. Each key is a
+// tower of next pointers linked by CAS; a key is removed by marking the
+// lowest bit of its next pointers from the top down, after which any
+// traversal helps unlink it. Nodes live in a Slab and are recycled through
+// epoch-based reclamation, so readers never take locks. The comparator is a
+// template parameter and gets inlined.
+template <typename T, typename Compare = std::less<T>> class LocalSkiplist {
+private:
+  static_assert(std::is_trivially_copyable_v<T>);
 
   constexpr static uint32_t kProbInv = 4;
-  constexpr static uint64_t kMaxEntries =
-      std::numeric_limits<Entry::Width>::max();
-  constexpr static uint64_t kMaxLevels =
-      helpers::static_log(kProbInv, kMaxEntries);
-
-  uint32_t item_size_;
-  void *negative_infinite_;
-  void *positive_infinite_;
+  constexpr static uint32_t kMaxLevels = 16;
+  constexpr static uintptr_t kMarkedBit = 1;
+
+  struct Node {
+    T key;
+    uint32_t height;
+    // Held by the inserter while it links the upper levels, and by the
+    // existence of the key; the last one to drop it retires the node.
+    std::atomic<uint32_t> refs;
+    // Only the lowest height ones are allocated.
+    std::atomic<uintptr_t> next[kMaxLevels];
+  };
+  static_assert(sizeof(Node) <= Slab::kMaxSlabClassSize);
+
+  struct alignas(64) CoreRandom {
+    std::minstd_rand generator;
+  };
+
   Slab slab_;
-  std::default_random_engine generator_;
-  std::uniform_int_distribution<int> distribution_{0, kProbInv};
-  Entry *head_;
-  Entry *tail_;
-  uint32_t levels_ = 0;
-  std::function<bool(const void *, const void *)> is_equal_;
-  std::function<bool(const void *, const void *)> is_smaller_;
-  std::function<bool(const void *, const void *)> is_greater_;
-
-  GenericLocalSkiplist(uint32_t item_size, uint64_t data_size);
-  Entry *_find_closest(const void *key, Entry **level_traces = nullptr);
-  bool should_bubble_up();
-  void bubble_up(Entry *down_ptr, Entry **level_traces);
-  void prune_empty_level(Entry *left_boudary, Entry *right_boundary);
-  bool insert(const void *key);
-  bool exist(const void *key);
-  bool remove(const void *key);
-};
+  EpochReclaimer reclaimer_;
+  Compare comp_;
+  Node *head_;
+  Node *tail_;
+  CoreRandom core_randoms_[helpers::kNumCPUs];
+  friend class FarMemTest;
+
+  static uint32_t get_node_size(uint32_t height);
+  static bool is_marked(uintptr_t next);
+  static Node *get_node(uintptr_t next);
+  uint32_t random_height();
+  Node *allocate_node(const T &key, uint32_t height);
+  // Fills in the predecessors and successors of key at each level,
+  // unlinking the removed nodes on the way, and returns whether key exists.
+  bool find(const T &key, Node **preds, Node **succs);
+  // Returns the first node whose key is not smaller than key.
+  Node *lower_bound(const T &key);
+  Node *next_node(Node *node);
+  void release(Node *node);
 
-template <typename T> class LocalSkiplist : public GenericLocalSkiplist {
 public:
+  // Iterates over the keys within [lo, hi] in order, skipping the removed
+  // ones. Keeps an epoch critical section, i.e., preemption is disabled
+  // throughout its lifetime, so it must not block.
+  class Range {
+  public:
+    class Iterator {
+    private:
+      const Range *range_;
+      Node *node_;
+      friend class Range;
+
+      Iterator(const Range *range, Node *node);
+
+    public:
+      const T &operator*() const;
+      const T *operator->() const;
+      Iterator &operator++();
+      bool operator==(const Iterator &other) const;
+      bool operator!=(const Iterator &other) const;
+    };
+
+  private:
+    LocalSkiplist *list_;
+    EpochGuard guard_;
+    T hi_;
+    Node *first_;
+    friend class LocalSkiplist;
+
+    Range(LocalSkiplist *list, const T &lo, const T &hi);
+    Node *bound(Node *node) const;
+
+  public:
+    NOT_COPYABLE(Range);
+    NOT_MOVEABLE(Range);
+    Iterator begin() const;
+    Iterator end() const;
+  };
+
   LocalSkiplist(uint64_t data_size);
   ~LocalSkiplist();
+  NOT_COPYABLE(LocalSkiplist);
+  NOT_MOVEABLE(LocalSkiplist);
   bool insert(const T &key);
   bool exist(const T &key);
   bool remove(const T &key);
-  uint32_t rank(const T &key);
-  T select(uint32_t rank);
+  Range range(const T &lo, const T &hi);
+  // Invokes fn(key) on the keys within [lo, hi] in order until it returns
+  // false.
+  template <typename Fn> void scan(const T &lo, const T &hi, Fn &&fn);
 };
 
 } // namespace far_memory
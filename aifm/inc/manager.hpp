@@ -2,10 +2,13 @@
 
 #include "sync.h"
 
+#include "advice.hpp"
 #include "array.hpp"
 #include "cb.hpp"
 #include "concurrent_hopscotch.hpp"
+#include "concurrent_queue.hpp"
 #include "device.hpp"
+#include "gc_pacer.hpp"
 #include "helpers.hpp"
 #include "internal/ds_info.hpp"
 #include "list.hpp"
@@ -14,19 +17,27 @@
 #include "pointer.hpp"
 #include "queue.hpp"
 #include "region.hpp"
+#include "replacement.hpp"
 #include "stack.hpp"
 
 #include <atomic>
 #include <functional>
+#include <limits>
 #include <memory>
 #include <optional>
 #include <queue>
+#include <string_view>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
 namespace far_memory {
 
+class PrefetchStream;
+
 template <typename T> class DataFrameVector;
+template <typename T> class FarVector;
+template <typename K, typename V> class BPlusTree;
 
 // A GCTask is an interval of (to be GCed) local region.
 using GCTask = std::pair<uint64_t, uint64_t>;
@@ -55,6 +66,17 @@ public:
                         std::vector<Region> *from_regions);
 };
 
+// A swap-in submitted by FarMemManager::swap_in_async(). It lives in the
+// caller's storage until done runs, on a thread of the device, once the object
+// is present.
+struct AsyncSwapIn {
+  IOCompletion done;
+  GenericFarMemPtr *ptr;
+  uint64_t obj_addr;
+  uint64_t obj_id;
+  uint16_t obj_data_len;
+};
+
 class FarMemManager {
 private:
   constexpr static double kFreeCacheAlmostEmptyThresh = 0.03;
@@ -64,33 +86,95 @@ private:
   constexpr static uint32_t kMaxNumRegionsPerGCRound = 128;
   constexpr static double kMaxRatioRegionsPerGCRound = 0.1;
   constexpr static double kMinRatioRegionsPerGCRound = 0.03;
+  constexpr static uint32_t kNumAdvisedObjectsPerScope = 1024;
+  // Every kSurvivorGCInterval-th GC round also collects the survivor regions,
+  // and every kOldGCInterval-th round the old ones.
+  constexpr static uint32_t kSurvivorGCInterval = 4;
+  constexpr static uint32_t kOldGCInterval = 16;
+  // The frequency from which kReplaceLFU keeps cold objects.
+  constexpr static uint8_t kLFUMinKeepFreq = 2;
+
+  constexpr static uint32_t kMaxNumDirectReclaimScans = 64;
+  // The regions whose untouched objects a direct reclaim evicts per attempt.
+  constexpr static uint32_t kMaxNumDirectEvictRegions = 4;
+  // After which a blocked direct reclaim warns once, and keeps waiting.
+  constexpr static uint64_t kDirectReclaimWarnUs = 1000 * 1000;
 
   class RegionManager {
   private:
     constexpr static double kPickRegionMaxRetryTimes = 3;
+    constexpr static double kReservedRegionsRatio = 0.01;
 
     std::unique_ptr<uint8_t> local_cache_ptr_;
     CircularBuffer<Region, false> free_regions_;
     CircularBuffer<Region, false> used_regions_;
     CircularBuffer<Region, false> nt_used_regions_;
+    // The temporal used regions of the survivor and old generations;
+    // used_regions_ holds the young ones.
+    CircularBuffer<Region, false> old_gen_used_regions_[Region::kNumGens - 1];
+    // Only handed out to allocations within a DerefScope, which cannot wait
+    // for the GC. Refilled before free_regions_.
+    CircularBuffer<Region, false> reserved_regions_;
+    uint32_t num_reserved_regions_ = 0;
     rt::Spin region_spin_;
     Region core_local_free_regions_[helpers::kNumCPUs];
     Region core_local_free_nt_regions_[helpers::kNumCPUs];
+    // Only the GC copies objects into these. They are set aside up front like
+    // the ones above, and refilled from free_regions_ once full.
+    Region core_local_free_old_gen_regions_[Region::kNumGens - 1]
+                                           [helpers::kNumCPUs];
     friend class FarMemTest;
 
+    CircularBuffer<Region, false> &local_used_regions(const Region &region);
+    bool pop_gcable_region(CircularBuffer<Region, false> *used_regions,
+                           bool requeue_front, Region *region);
+
   public:
     RegionManager(uint64_t size, bool is_local);
     void push_free_region(Region &region);
-    std::optional<Region> pop_used_region();
-    bool try_refill_core_local_free_region(bool nt, Region *full_region);
-    Region &core_local_free_region(bool nt);
+    // The young generation includes the non-temporal regions.
+    std::optional<Region> pop_used_region(uint8_t gen = Region::kGenYoung);
+    void pop_dontneed_regions(uint32_t max_num, std::vector<Region> *regions);
+    bool try_refill_core_local_free_region(bool nt, Region *full_region,
+                                           bool use_reserve = false,
+                                           uint8_t gen = Region::kGenYoung);
+    void push_used_region(Region &region);
+    // Recycles the used regions whose objects have all been freed, scanning
+    // up to max_num_scans of them. Returns the number of recycled regions.
+    uint32_t reclaim_dead_regions(uint32_t max_num_scans);
+    static bool is_dead(const Region &region);
+    Region &core_local_free_region(bool nt, uint8_t gen = Region::kGenYoung);
     double get_free_region_ratio() const;
     uint32_t get_num_regions() const;
+    bool is_reserve_full() const;
   };
 
   RegionManager cache_region_manager_;
   RegionManager far_mem_region_manager_;
+  GCPacer gc_pacer_;
+  // The GC threads used by the current round, chosen by gc_pacer_.
+  uint32_t num_active_gc_threads_;
+  uint64_t num_gc_rounds_ = 0;
   std::atomic<uint32_t> pending_gcs_{0};
+  bool dontneed_pending_ = false;
+  // The pin counts set by advise(). They are keyed by the pointer, as the GC
+  // moves the pinned objects around.
+  rt::Spin pin_spin_;
+  std::unordered_map<const GenericFarMemPtr *, uint32_t> pin_cnts_;
+  // The size of pin_cnts_, read without the lock to skip the lookups when
+  // nothing is pinned.
+  uint64_t num_pinned_ptrs_ = 0;
+  // The threads blocked in mutator_direct_reclaim() per DerefScope status, and
+  // the status the GC master is waiting to drain (OutofScope if none). Both
+  // are protected by direct_reclaim_spin_.
+  rt::Spin direct_reclaim_spin_;
+  int32_t num_direct_reclaimers_[GC] = {};
+  Status waiting_status_ = OutofScope;
+  // Set for a GC round that went ahead while the threads left in the old
+  // status were all blocked in direct reclaim. Such a round only evicts the
+  // objects not dereferenced since they were last placed, as the blocked
+  // threads may still use the others.
+  bool in_place_round_ = false;
   bool gc_master_spawned_;
   std::unique_ptr<FarMemDevice> device_ptr_;
   rt::CondVar mutator_cache_condvar_;
@@ -106,6 +190,7 @@ private:
   friend class FarMemTest;
   friend class FarMemManagerFactory;
   friend class GenericFarMemPtr;
+  friend class GenericUniquePtr;
   friend class FarMemPtrMeta;
   friend class GenericArray;
   friend class GCParallelWriteBacker;
@@ -113,25 +198,56 @@ private:
   friend class GenericDataFrameVector;
   friend class GenericConcurrentHopscotch;
   template <typename T> friend class DataFrameVector;
+  template <typename T> friend class FarVector;
+  template <typename T, bool Mut, bool Nt> friend class DerefAwaiter;
 
   FarMemManager(uint64_t cache_size, uint64_t far_mem_size,
                 uint32_t num_gc_threads, FarMemDevice *device);
   bool is_free_cache_almost_empty() const;
   bool is_free_cache_low() const;
   bool is_free_cache_high() const;
-  std::optional<Region> pop_cache_used_region();
+  std::optional<Region> pop_cache_used_region(uint8_t gen);
   void push_cache_free_region(Region &region);
-  void swap_in(bool nt, GenericFarMemPtr *ptr);
-  void swap_out(GenericFarMemPtr *ptr, Object obj);
+  void swap_in(bool nt, GenericFarMemPtr *ptr, IOClass io_class = kIODemand);
+  // Allocates the local copy and sends its read without waiting for it.
+  // Returns false, leaving done uncalled, if the object turned out present.
+  bool swap_in_async(bool nt, GenericFarMemPtr *ptr, AsyncSwapIn *swap_in);
+  static void finish_swap_in_async(void *arg);
+  // Publishes the object just read into obj_addr to all the owners.
+  void set_swapped_in(GenericFarMemPtr *ptr, uint64_t obj_addr,
+                      uint16_t obj_data_len, uint64_t obj_id);
+  // Returns false if the object is left in place.
+  bool swap_out(GenericFarMemPtr *ptr, Object obj);
+  // Writes back the object if dirty and marks the pointer absent. Requires the
+  // object lock.
+  bool evict(GenericFarMemPtr *ptr, Object obj, bool dirty);
+  // Evicts the untouched, unpinned objects of up to kMaxNumDirectEvictRegions
+  // used regions, which no DerefScope can be using. Returns the number of
+  // regions freed.
+  uint32_t direct_evict();
+  bool should_keep(FarMemPtrMeta &meta, uint8_t ds_id);
+  // Both cover all the owners of a shared object.
+  static bool is_untouched(GenericFarMemPtr *ptr);
+  static void clear_evacuation(GenericFarMemPtr *ptr);
+  bool is_pinned(const GenericFarMemPtr *ptr);
+  // Moves the pins of from to to, or drops them if to is null.
+  void transfer_pins(const GenericFarMemPtr *from, const GenericFarMemPtr *to);
   void launch_gc_master();
   void gc_cache();
   void gc_far_mem();
   uint64_t allocate_local_object(bool nt, uint16_t object_size);
-  std::optional<uint64_t> allocate_local_object_nb(bool nt,
-                                                   uint16_t object_size);
+  std::optional<uint64_t>
+  allocate_local_object_nb(bool nt, uint16_t object_size,
+                           uint8_t gen = Region::kGenYoung);
   uint64_t allocate_remote_object(bool nt, uint16_t object_size);
   void mutator_wait_for_gc_far_mem();
+  void mutator_direct_reclaim();
+  // Moves a thread blocked in direct reclaim into the expected status, unless
+  // the GC master is waiting for its current one. Requires
+  // direct_reclaim_spin_.
+  void renew_direct_reclaimer_status();
   void pick_from_regions();
+  void pick_from_regions_in_gen(uint8_t gen, uint32_t max_num);
   void mark_fm_ptrs(auto *preempt_guard);
   void wait_mutators_observation();
   void write_back_regions();
@@ -149,10 +265,16 @@ public:
   uint32_t num_gc_threads_;
   EvacNotifier evac_notifiers_[kMaxNumDSIDs];
   CopyNotifier copy_notifiers_[kMaxNumDSIDs];
+  ReplacementPolicy replacement_policies_[kMaxNumDSIDs];
 
   ~FarMemManager();
   FarMemDevice *get_device() const { return device_ptr_.get(); }
   double get_free_mem_ratio() const;
+  // Whether allocations within DerefScopes have dipped into the emergency
+  // reserve, i.e., the GC cannot keep up. Callers may shed load until it
+  // clears.
+  bool is_overloaded() const;
+  GCPacer::Stats get_gc_pacer_stats() const;
   bool allocate_generic_unique_ptr_nb(
       GenericUniquePtr *ptr, uint8_t ds_id, uint16_t item_size,
       std::optional<uint8_t> optional_id_len = {},
@@ -172,39 +294,88 @@ public:
   template <typename T, uint64_t... Dims> Array<T, Dims...> allocate_array();
   template <typename T, uint64_t... Dims>
   Array<T, Dims...> *allocate_array_heap();
+  template <typename T, uint64_t... Dims>
+  PackedArray<T, Dims...> allocate_packed_array();
+  template <typename T, uint64_t... Dims>
+  PackedArray<T, Dims...> *allocate_packed_array_heap();
+  // A named data structure persists on the remote side across client
+  // sessions: it is detached rather than destructed on destruction, and a
+  // later allocation with the same name reattaches it (see set_persistent()).
+  // Only a detached one persists. If the client is gone before destructing
+  // it, e.g., on a crash, its dirty local data and its metadata never reach
+  // the server, so the server drops it along with the session.
   GenericConcurrentHopscotch
   allocate_concurrent_hopscotch(uint32_t local_num_entries_shift,
                                 uint32_t remote_num_entries_shift,
-                                uint64_t remote_data_size);
+                                uint64_t remote_data_size,
+                                std::string_view name = {});
   GenericConcurrentHopscotch *
   allocate_concurrent_hopscotch_heap(uint32_t local_num_entries_shift,
                                      uint32_t remote_num_entries_shift,
-                                     uint64_t remote_data_size);
+                                     uint64_t remote_data_size,
+                                     std::string_view name = {});
   template <typename K, typename V>
   ConcurrentHopscotch<K, V>
   allocate_concurrent_hopscotch(uint32_t local_num_entries_shift,
                                 uint32_t remote_num_entries_shift,
-                                uint64_t remote_data_size);
+                                uint64_t remote_data_size,
+                                std::string_view name = {});
   template <typename K, typename V>
   ConcurrentHopscotch<K, V> *
   allocate_concurrent_hopscotch_heap(uint32_t local_num_entries_shift,
                                      uint32_t remote_num_entries_shift,
-                                     uint64_t remote_data_size);
-  template <typename T> DataFrameVector<T> allocate_dataframe_vector();
-  template <typename T> DataFrameVector<T> *allocate_dataframe_vector_heap();
+                                     uint64_t remote_data_size,
+                                     std::string_view name = {});
+  template <typename T>
+  DataFrameVector<T> allocate_dataframe_vector(std::string_view name = {});
+  template <typename T>
+  DataFrameVector<T> *
+  allocate_dataframe_vector_heap(std::string_view name = {});
+  template <typename T>
+  FarVector<T> allocate_far_vector(bool offloaded = false);
+  template <typename T>
+  FarVector<T> *allocate_far_vector_heap(bool offloaded = false);
+  template <typename K, typename V> BPlusTree<K, V> allocate_bplus_tree();
+  template <typename K, typename V> BPlusTree<K, V> *allocate_bplus_tree_heap();
   template <typename T>
   List<T> allocate_list(const DerefScope &scope, bool enable_merge = false);
   template <typename T> Queue<T> allocate_queue(const DerefScope &scope);
   template <typename T> Stack<T> allocate_stack(const DerefScope &scope);
+  template <typename T>
+  ConcurrentQueue<T> allocate_concurrent_queue(const DerefScope &scope);
+  template <typename T>
+  ConcurrentQueue<T> *allocate_concurrent_queue_heap(const DerefScope &scope);
   void register_eval_notifier(uint8_t ds_id, EvacNotifier notifier);
   void register_copy_notifier(uint8_t ds_id, CopyNotifier notifier);
+  void set_replacement_policy(uint8_t ds_id, ReplacementPolicy policy);
+  ReplacementPolicy get_replacement_policy(uint8_t ds_id) const;
   void read_object(uint8_t ds_id, uint8_t obj_id_len, const uint8_t *obj_id,
                    uint16_t *data_len, uint8_t *data_buf);
+  // See FarMemDevice::read_object_async().
+  void read_object_async(uint8_t ds_id, uint8_t obj_id_len,
+                         const uint8_t *obj_id, uint16_t *data_len,
+                         uint8_t *data_buf, IOCompletion completion);
   bool remove_object(uint64_t ds_id, uint8_t obj_id_len, const uint8_t *obj_id);
   void construct(uint8_t ds_type, uint8_t ds_id, uint32_t param_len,
                  uint8_t *params);
   void destruct(uint8_t ds_id);
+  // Returns whether the DS existed, in which case the metadata it was
+  // detached with is returned; otherwise it is constructed with the params.
+  bool attach(uint8_t ds_type, uint8_t ds_id, std::string_view name,
+              uint8_t param_len, uint8_t *params, uint8_t *meta_len,
+              uint8_t *meta);
+  void detach(uint8_t ds_id, uint8_t meta_len, const uint8_t *meta);
   void mutator_wait_for_gc_cache();
+  // Applies the Advice flags to the objects of ptrs[0, num). The swap-ins of
+  // kAdviceWillNeed and kAdvicePin are queued on stream, which the owner of
+  // ptrs must unregister before freeing them; that cancels the pending ones.
+  void advise(GenericUniquePtr *ptrs, uint64_t num, uint32_t advice,
+              PrefetchStream *stream = nullptr);
+  // Keeps the object of ptr local until as many unpin()s: the GC copies it
+  // rather than evicting it, unless there is no free cache left for the copy.
+  // The pins go away with the object.
+  void pin(const GenericFarMemPtr *ptr);
+  void unpin(const GenericFarMemPtr *ptr);
   static void lock_object(uint8_t obj_id_len, const uint8_t *obj_id);
   static void unlock_object(uint8_t obj_id_len, const uint8_t *obj_id);
 };
@@ -29,6 +29,10 @@ private:
   constexpr static uint32_t kDataLenPos = 6;
   constexpr static uint32_t kDSIDPos = 8;
   constexpr static uint32_t kIDLenPos = 9;
+  // Stored in the top byte of ptr_addr, which is never set in a user-space
+  // address.
+  constexpr static uint8_t kFreedTag = 0xFF;
+  constexpr static uint8_t kRetiredTag = 0xFE;
   // It stores the address of the object (which is stored in the local region).
   uint64_t addr_;
 
@@ -66,8 +70,14 @@ public:
   void set_obj_id(const uint8_t *id, uint8_t id_len);
   void set_obj_id_len(uint8_t id_len);
   uint16_t size() const;
+  // Also true for a retired object.
   bool is_freed() const;
   void free();
+  // Frees an object that has been moved away, while its old copy may still be
+  // in use by a thread blocked in direct reclaim, which keeps its region from
+  // being recycled by an in-place GC round.
+  void retire();
+  bool is_retired() const;
 };
 
 } // namespace far_memory
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "helpers.hpp"
+
+#include <atomic>
+#include <cstdint>
+
+namespace far_memory {
+
+// A version lock for optimistic lock coupling. Readers do not write to the
+// lock: they remember the version, read, and validate that the version is
+// unchanged afterwards, restarting otherwise. Writers bump the version when
+// unlocking. Suited for read-mostly structures whose readers must not touch
+// shared cachelines, e.g., the inner nodes of BPlusTree.
+class OptimisticLock {
+private:
+  constexpr static uint64_t kLockedBit = 1;
+
+  // The lowest bit is set while write-locked.
+  std::atomic<uint64_t> version_{0};
+
+public:
+  OptimisticLock();
+  NOT_COPYABLE(OptimisticLock);
+  NOT_MOVEABLE(OptimisticLock);
+  // Returns the current version. Sets restart if it is write-locked.
+  uint64_t read_lock_or_restart(bool &restart) const;
+  // Sets restart if the version is no longer the one read before.
+  void check_or_restart(uint64_t version, bool &restart) const;
+  // Write-locks if the version is still the one read before, and sets
+  // restart otherwise.
+  void upgrade_to_write_lock_or_restart(uint64_t version, bool &restart);
+  void write_lock();
+  void write_unlock();
+  bool is_write_locked() const;
+};
+
+} // namespace far_memory
+
+#include "internal/optimistic_lock.ipp"
@@ -3,7 +3,9 @@
 #include "thread.h"
 
 #include "cb.hpp"
+#include "helpers.hpp"
 
+#include <algorithm>
 #include <atomic>
 #include <cstdint>
 #include <memory>
@@ -19,6 +21,8 @@ private:
   std::vector<rt::Thread> threads_;
   uint32_t enqueue_thread_id_ = 0;
   uint32_t num_slaves_;
+  // The slaves spawned for the current execution, no more than num_slaves_.
+  uint32_t num_active_slaves_;
 
 public:
   NOT_COPYABLE(Parallelizer);
@@ -31,9 +35,16 @@ public:
   bool slave_dequeue_task(uint32_t tid, Task *task);
   bool slave_can_exit(uint32_t tid);
   void spawn(Status *slaves_status);
+  // Spawns only the first num_active_slaves slaves.
+  void spawn(Status *slaves_status, uint32_t num_active_slaves);
   void execute();
 };
 
+// Splits [0, num) into contiguous shares, one per thread on up to
+// helpers::kNumCPUs threads, calls fn(i) for every index of each share and
+// joins the threads.
+template <typename Fn> void parallel_for(uint64_t num, Fn &&fn);
+
 } // namespace far_memory
 
 #include "internal/parallel.ipp"
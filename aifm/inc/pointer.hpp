@@ -1,17 +1,23 @@
 #pragma once
 
 #include "deref_scope.hpp"
+#include "io_scheduler.hpp"
 #include "object.hpp"
 
 namespace far_memory {
 
+template <typename T, bool Mut, bool Nt> class DerefAwaiter;
+
 // Format:
-//  I) |XXXXXXX !H(1b)|  0   S(1b)!D(1b)00000|E(1b)|  Object Data Addr(47b)  |
+//  I) |XXXXXXX !H(1b)|0 S(1b)!D(1b)C(1b)T(1b)F(3b)|E(1b)| Object Data Addr(47b) |
 // II) |   DS_ID(8b)  |!P(1b)S(1b)| Object Size(16b) |      ObjectID(38b)    |
 //
 //                  D: dirty bit.
 //                  P: present.
 //                  H: hot bits.
+//               C, T: the hot status and the test period of CLOCK-Pro, see
+//                     ReplacementPolicy.
+//                  F: the saturating access frequency counter of LFU.
 //                  S: shared bits, meaning the pointer is a UniquePtr or a
 //                     SharedPtr.
 //                  E: The pointed data is being evacuated.
@@ -41,6 +47,13 @@ private:
   constexpr static uint32_t kHotThresh = 2;
   constexpr static uint32_t kDSIDPos = 0;
   constexpr static uint32_t kSharedBitPos = 9;
+  constexpr static uint32_t kReplacementPos = 1;
+  constexpr static uint8_t kClockHotMask = 0x08;
+  constexpr static uint8_t kInTestMask = 0x10;
+  constexpr static uint8_t kFreqShift = 5;
+  constexpr static uint8_t kFreqMask = 0xE0;
+  constexpr static uint8_t kReplacementMask =
+      kClockHotMask | kInTestMask | kFreqMask;
 
   uint8_t metadata_[kSize];
   friend class FarMemManager;
@@ -48,8 +61,15 @@ private:
 
   FarMemPtrMeta();
   void init(bool shared, uint64_t object_addr);
+  // The replacement bits may race with the dirty bit, which shares the byte,
+  // so they are updated atomically.
+  template <typename F> void update_replacement_bits(F &&f);
+  // Replaces the whole metadata if it is still *expected, otherwise loads it
+  // into *expected.
+  bool compare_exchange(uint64_t *expected, uint64_t desired);
 
 public:
+  constexpr static uint8_t kMaxFreq = kFreqMask >> kFreqShift;
   constexpr static uint64_t kNull = kPresentClear;
   constexpr static uint64_t kNullMask =
       ((~static_cast<uint64_t>(0)) << (8 * kPresentPos));
@@ -63,11 +83,25 @@ public:
   void clear_dirty();
   bool is_hot() const;
   bool is_nt() const;
+  // Makes it cold, but never untouched.
   void clear_hot();
+  // Whether it has not been dereferenced since the object was last placed.
+  bool is_untouched() const;
+  // Marks an untouched object for evacuation. The deref slow path counts the
+  // access by a CAS on the whole metadata, so either that CAS fails and the
+  // dereference retries into the evacuation path, or this one fails.
+  bool mark_evacuation_if_untouched();
   void set_hot();
+  uint8_t get_freq() const;
+  void inc_freq();
+  void age_freq();
+  bool is_clock_hot() const;
+  bool is_in_test() const;
+  void set_clock_state(bool clock_hot, bool in_test);
   bool is_present() const;
   void set_present(uint64_t object_addr);
   void set_evacuation();
+  void clear_evacuation();
   bool is_evacuation() const;
   bool is_shared() const;
   void set_shared();
@@ -94,9 +128,14 @@ private:
 
 protected:
   friend class GenericDataFrameVector;
+  friend class GenericFarVector;
+  template <typename K, typename V> friend class BPlusTree;
   friend class GenericConcurrentHopscotch;
+  friend class GenericConcurrentQueue;
+  friend class GenericList;
   friend class FarMemManager;
   friend class GCParallelMarker;
+  template <typename T, bool Mut, bool Nt> friend class DerefAwaiter;
 
   GenericFarMemPtr();
   GenericFarMemPtr(bool shared, uint64_t object_addr);
@@ -112,7 +151,7 @@ protected:
 public:
   void nullify();
   bool is_null() const;
-  void swap_in(bool nt);
+  void swap_in(bool nt, IOClass io_class = kIODemand);
   void flush();
   void move(GenericFarMemPtr &other, uint64_t reset_value);
 };
@@ -156,6 +195,9 @@ public:
   NOT_COPYABLE(UniquePtr);
   template <bool Nt = false> const T *deref(const DerefScope &scope);
   template <bool Nt = false> T *deref_mut(const DerefScope &scope);
+  // Awaitable versions of deref() and deref_mut(), see async.hpp.
+  DerefAwaiter<const T, false, false> deref_async(const DerefScope &scope);
+  DerefAwaiter<T, true, false> deref_mut_async(const DerefScope &scope);
   template <bool Nt = false> T read();
   template <bool Nt = false, typename U> void write(U &&u);
   void free();
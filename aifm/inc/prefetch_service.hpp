@@ -0,0 +1,129 @@
+#pragma once
+
+#include "sync.h"
+
+#include "helpers.hpp"
+#include "io_scheduler.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+
+namespace far_memory {
+
+class GenericUniquePtr;
+class PrefetchService;
+
+// The per-container state of the prefetch service, i.e., one stream of
+// accesses whose pattern is learned independently of the others. It is a
+// plain member (rather than a base class) of its owner to keep the owner's
+// layout standard.
+class PrefetchStream {
+private:
+  // Invoked by a worker of the service, never concurrently with itself.
+  // Consumes the new traces and submits a burst of prefetch tasks. Returns
+  // true if there is still work left.
+  using RunFn = bool (*)(void *owner);
+  // Whether there are traces that RunFn has not consumed yet.
+  using HasPendingTracesFn = bool (*)(void *owner);
+
+  void *owner_;
+  RunFn run_fn_;
+  HasPendingTracesFn has_pending_traces_fn_;
+  // Queued or running. Set by whoever wins the exchange in schedule(), and
+  // cleared by the worker, which then re-checks for traces (see
+  // PrefetchService::worker_fn()).
+  std::atomic<bool> scheduled_ = false;
+  // All guarded by PrefetchService::mutex_.
+  bool running_ = false;
+  bool unregistered_ = false;
+  uint32_t num_inflight_tasks_ = 0;
+  friend class PrefetchService;
+
+public:
+  PrefetchStream(void *owner, RunFn run_fn,
+                 HasPendingTracesFn has_pending_traces_fn);
+  ~PrefetchStream();
+  NOT_COPYABLE(PrefetchStream);
+  NOT_MOVEABLE(PrefetchStream);
+  // Asks the service to invoke run_fn soon. Cheap if already scheduled.
+  void schedule();
+  // Must be invoked by the owner's destructor so that no worker touches the
+  // owner afterwards.
+  void unregister();
+};
+
+// A process-wide pool of threads serving the prefetch streams of all
+// containers, so that creating a container no longer spawns threads. It also
+// runs offloaded blocking calls (see offload()) ahead of any prefetch work.
+// The pool starts with kNumWorkers threads and only grows, up to
+// kMaxNumWorkers, when offloaded jobs find no idle worker; beyond that they
+// queue.
+class PrefetchService {
+private:
+  struct Task {
+    GenericUniquePtr *ptr;
+    PrefetchStream *stream;
+    bool nt;
+    IOClass io_class;
+    bool *inflight;
+  };
+
+  struct OffloadJob {
+    void (*fn)(void *arg);
+    void *arg;
+  };
+
+  constexpr static uint32_t kNumWorkers = 16;
+  // Each blocked job pins a worker, while the device serves only as many
+  // requests at once as it has connections, so more workers would just queue
+  // in its IOScheduler.
+  constexpr static uint32_t kMaxNumWorkers = 4 * kNumWorkers;
+  // Beyond which the submitter swaps in the objects by itself.
+  constexpr static uint32_t kMaxNumQueuedTasks = 1024;
+
+  rt::Mutex mutex_;
+  rt::CondVar cv_worker_;
+  rt::CondVar cv_stream_idle_;
+  std::deque<PrefetchStream *> streams_;
+  std::deque<Task> tasks_;
+  std::deque<OffloadJob> offload_jobs_;
+  uint32_t num_workers_ = 0;
+  uint32_t num_idle_workers_ = 0;
+  bool started_ = false;
+
+  void spawn_worker();
+  void worker_fn();
+
+public:
+  static PrefetchService *get();
+  void start();
+  // Queues a stream whose scheduled_ the caller has just set.
+  void schedule(PrefetchStream *stream);
+  void unregister(PrefetchStream *stream);
+  // The stream is null for swap-ins that no container waits for, e.g., the
+  // ones requested by FarMemManager::advise(). If inflights is given, the
+  // service clears *inflights[i] once ptrs[i] is swapped in, which lets the
+  // caller track the completion per object.
+  void submit(PrefetchStream *stream, GenericUniquePtr **ptrs, uint32_t num,
+              bool nt, IOClass io_class = kIOPrefetch,
+              bool **inflights = nullptr);
+  // Runs the blocking call fn(arg) in a worker, so that the caller can go on
+  // meanwhile. This is a thread offload rather than asynchronous I/O, as the
+  // device API is synchronous: every job in flight occupies a worker until it
+  // returns, and at most kMaxNumWorkers of them run at once.
+  void offload(void (*fn)(void *arg), void *arg);
+};
+
+FORCE_INLINE void PrefetchStream::schedule() {
+  // Orders the caller's new trace before the load of scheduled_. Pairs with
+  // the fence in PrefetchService::worker_fn(), so that either the worker sees
+  // the trace or the caller sees scheduled_ cleared.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (!scheduled_.load(std::memory_order_relaxed) &&
+      !scheduled_.exchange(true)) {
+    PrefetchService::get()->schedule(this);
+  }
+}
+
+} // namespace far_memory
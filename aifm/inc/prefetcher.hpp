@@ -5,6 +5,7 @@
 
 #include "helpers.hpp"
 #include "pointer.hpp"
+#include "prefetch_service.hpp"
 
 #include <functional>
 #include <type_traits>
@@ -13,6 +14,8 @@ namespace far_memory {
 
 class FarMemDevice;
 
+// Learns the access pattern of one container from its traces and prefetches
+// along it. The work is done by the shared PrefetchService.
 template <typename InduceFn, typename InferFn, typename MappingFn>
 class Prefetcher {
 private:
@@ -56,17 +59,9 @@ private:
     bool nt;
   };
 
-  struct SlaveStatus {
-    GenericUniquePtr *task;
-    bool is_exited;
-    rt::CondVar cv;
-  };
-
   constexpr static uint32_t kIdxTracesSize = 256;
   constexpr static uint32_t kHitTimesThresh = 8;
   constexpr static uint32_t kGenTasksBurstSize = 8;
-  constexpr static uint32_t kMaxSlaveWaitUs = 5;
-  constexpr static uint32_t kMaxNumPrefetchSlaveThreads = 16;
 
   const uint32_t kPrefetchWinSize_; // In terms of number of objects.
   uint8_t *state_;
@@ -74,6 +69,8 @@ private:
   uint32_t object_data_size_;
   Index_t last_idx_;
   uint64_t hit_times_ = 0;
+  uint32_t hit_times_thresh_ = kHitTimesThresh;     // Set by set_eager().
+  uint32_t cur_hit_times_thresh_ = kHitTimesThresh; // Used by run().
   uint32_t num_objs_to_prefetch = 0;
   Index_t next_prefetch_idx_;
   bool nt_ = false;
@@ -81,15 +78,12 @@ private:
   uint32_t traces_head_ = 0;
   uint32_t traces_tail_ = 0;
   uint64_t traces_counter_ = 0;
-  std::vector<rt::Thread> prefetch_threads_;
-  CachelineAligned(SlaveStatus) slave_status_[kMaxNumPrefetchSlaveThreads];
-  rt::CondVar cv_prefetch_master_;
-  bool master_exited = false;
-  bool exit_ = false;
+  uint64_t local_counter_ = 0;
+  PrefetchStream stream_;
 
   void generate_prefetch_tasks();
-  void prefetch_master_fn();
-  void prefetch_slave_fn(uint32_t tid);
+  bool run();
+  bool has_pending_traces();
 
 public:
   Prefetcher(FarMemDevice *device, uint8_t *state, uint32_t object_data_size);
@@ -99,6 +93,11 @@ public:
   void add_trace(bool nt, Index_t idx);
   void static_prefetch(Index_t start_idx, Pattern_t pattern, uint32_t num);
   void update_state(uint8_t *state);
+  // Starts prefetching as soon as a stride repeats rather than after
+  // kHitTimesThresh hits, e.g., when the accesses are known to be sequential.
+  void set_eager(bool eager);
+  // For the other work of the owner that must not outlive it.
+  PrefetchStream *get_stream();
 };
 } // namespace far_memory
 
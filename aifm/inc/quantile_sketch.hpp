@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace far_memory {
+
+// A KLL quantile sketch. It keeps O(k) items regardless of the stream length;
+// level h holds items of weight 2^h which are compacted (sorted, then every
+// other item promoted) once the level is full. The sketch is exact until the
+// first compaction, and two sketches can be merged, e.g., to combine partial
+// per-thread states. T only needs to be copyable and ordered by operator<.
+template <typename T> class QuantileSketch {
+private:
+  constexpr static uint32_t kDefaultK = 200;
+  constexpr static uint32_t kMinLevelCapacity = 2;
+  constexpr static double kLevelDecay = 2.0 / 3;
+  // The normalized rank error is about 1.65 / k with 99% confidence; this
+  // leaves a margin over it.
+  constexpr static double kRankErrorFactor = 4.0;
+
+  uint32_t k_;
+  uint64_t count_ = 0;
+  uint64_t num_items_ = 0;
+  uint64_t max_num_items_ = 0;
+  uint64_t rand_state_ = 0x9E3779B97F4A7C15ULL;
+  std::vector<std::vector<T>> levels_;
+
+  uint32_t level_capacity(uint32_t level) const;
+  void add_level();
+  void compress();
+  bool random_bit();
+
+public:
+  QuantileSketch(uint32_t k = kDefaultK);
+  void add(const T &t);
+  void merge(const QuantileSketch &other);
+  // Returns the item of rank floor(q * count()), q in [0, 1]. Must not be
+  // empty.
+  T quantile(double q) const;
+  // Returns the item of the rank (< count()). It is off by at most
+  // rank_error() ranks with high probability, and by none if exact().
+  T at_rank(uint64_t rank) const;
+  uint64_t rank_error() const;
+  // True if no compaction has happened, i.e., quantile() is exact.
+  bool exact() const;
+  uint64_t count() const;
+  bool empty() const;
+  void clear();
+};
+
+} // namespace far_memory
+
+#include "internal/quantile_sketch.ipp"
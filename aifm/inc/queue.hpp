@@ -9,6 +9,7 @@ private:
 
   List<T> list_;
   friend class FarMemManager;
+  friend class FarMemTest;
 
 public:
   bool empty() const;
@@ -9,16 +9,30 @@ namespace far_memory {
 
 class Region {
   // Format:
-  // |ref_cnt(4B)|Nt(1B)|Resv(1B)|objects|
+  // |ref_cnt(4B)|Nt(1B)|Advice(1B)|objects|
   //
   //    ref_cnt: The region can only be GCed when the ref_cnt goes to 0.
   //         Nt: is this region a non-temporal?
-  //    objects: objects stored within the region.
+  //     Advice: |DontNeed(1b)|0(5b)|Gen(2b)|. DontNeed is set through
+  //             FarMemManager::advise(), and the GC picks such regions first.
+  //             Gen is the generation of the objects. New objects are young;
+  //             the GC copies the hot objects it evacuates one generation up,
+  //             and collects the older generations less often.
+  //    objects: objects stored within the region. The header keeps them at
+  //             the same alignment as the object headers expect.
 public:
   constexpr static uint32_t kRefCntPos = 0;
   constexpr static uint32_t kRefCntSize = 4;
   constexpr static uint32_t kNtPos = 4;
   constexpr static uint32_t kNtSize = 1;
+  constexpr static uint32_t kAdvicePos = 5;
+  constexpr static uint32_t kAdviceSize = 1;
+  constexpr static uint8_t kDontNeedMask = 0x80;
+  constexpr static uint8_t kGenMask = 0x03;
+  constexpr static uint8_t kGenYoung = 0;
+  constexpr static uint8_t kGenSurvivor = 1;
+  constexpr static uint8_t kGenOld = 2;
+  constexpr static uint8_t kNumGens = 3;
   constexpr static uint64_t kShift = 20;
   constexpr static uint64_t kSize = (1 << kShift);
   constexpr static uint8_t kGCParallelism = 2;
@@ -26,6 +40,7 @@ public:
   constexpr static uint32_t kHeaderSize = 6;
   constexpr static uint32_t kObjectPos = kHeaderSize;
 
+  static_assert(kNumGens - 1 <= kGenMask);
   static_assert(kSize <= helpers::kHugepageSize);
   static_assert(helpers::kHugepageSize % kSize == 0);
 
@@ -53,6 +68,10 @@ public:
   bool is_nt() const;
   void set_nt();
   void clear_nt();
+  bool is_dontneed() const;
+  void clear_advice();
+  uint8_t get_gen() const;
+  void set_gen(uint8_t gen);
   uint32_t get_ref_cnt() const;
   void clear_ref_cnt();
   bool is_gcable() const;
@@ -60,7 +79,10 @@ public:
   std::pair<uint64_t, uint64_t> get_boundary(uint8_t idx) const;
   void atomic_inc_ref_cnt(int32_t delta);
   static bool is_nt(uint64_t buf_ptr_addr);
+  static uint8_t get_gen(uint64_t object_addr);
   static void atomic_inc_ref_cnt(uint64_t object_addr, int32_t delta);
+  // Returns whether the region was not marked before.
+  static bool set_dontneed(uint64_t object_addr);
 };
 
 } // namespace far_memory
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+
+namespace far_memory {
+
+// How the GC decides which objects of a data structure (i.e., of a ds_id) stay
+// local when it evacuates their regions. Set through
+// FarMemManager::set_replacement_policy().
+enum ReplacementPolicy : uint8_t {
+  // Keep the objects that are hot, i.e., accessed at least kHotThresh times
+  // since they were swapped in or last copied by the GC.
+  kReplaceHotBit = 0,
+  // Also keep the cold objects that were hot in recent evacuations. A
+  // saturating counter, incremented whenever the object turns hot and halved
+  // whenever the marker visits it cold, tracks the frequency.
+  kReplaceLFU,
+  // CLOCK-Pro style. A cold object that is kept for being hot enters its test
+  // period, and is promoted to hot status if it is hot again by the next
+  // evacuation. An object in hot status is demoted rather than evicted when
+  // found cold. Objects touched by a one-off scan are thus evicted after at
+  // most one evacuation, while the frequent ones survive a missed period.
+  kReplaceClockPro,
+};
+
+} // namespace far_memory
@@ -1,23 +1,93 @@
 #pragma once
 
+#include "sync.h"
+
+#include "helpers.hpp"
 #include "internal/ds_info.hpp"
 #include "server_ds.hpp"
 
+#include <atomic>
 #include <functional>
 #include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 namespace far_memory {
 class Server {
 private:
-  ServerDSFactory *registered_server_ds_factorys_[kMaxNumDSTypes];
-  static std::unique_ptr<ServerDS> server_ds_ptrs_[kMaxNumDSIDs];
+  // A named DS that outlives the client session which detached it.
+  struct DetachedDS {
+    uint8_t ds_type;
+    std::unique_ptr<ServerDS> ptr;
+    std::vector<uint8_t> meta;
+    // Still charged to the far memory quota.
+    uint64_t committed_bytes;
+  };
+
+  // Each client namespace (see tcp_device_server.cpp) has its own Server, so
+  // the ds_ids and the detached names of different clients never collide.
+  ServerDSFactory *registered_server_ds_factorys_[kMaxNumDSTypes] = {};
+  std::unique_ptr<ServerDS> server_ds_ptrs_[kMaxNumDSIDs];
+  uint8_t server_ds_types_[kMaxNumDSIDs];
+  // The vanilla far memory of each DS, charged to the quota.
+  uint64_t server_ds_committed_bytes_[kMaxNumDSIDs] = {};
+  uint64_t far_mem_quota_ = 0;
+  std::atomic<uint64_t> committed_bytes_{0};
+  // Empty for the unnamed ones.
+  std::string server_ds_names_[kMaxNumDSIDs];
+  // The two below are guarded by ds_names_mutex_.
+  std::unordered_map<std::string, DetachedDS> detached_ds_;
+  // The names bound to live ds_ids, which cannot be attached again.
+  std::unordered_set<std::string> bound_ds_names_;
+  rt::Mutex ds_names_mutex_;
+
+  void unbind_name(uint8_t ds_id);
+  bool commit(uint64_t num_bytes);
+  void uncommit(uint8_t ds_id);
 
 public:
+  // The attach status.
+  constexpr static uint8_t kAttachConstructed = 0;
+  constexpr static uint8_t kAttachReattached = 1;
+  constexpr static uint8_t kAttachNameInUse = 2;
+  constexpr static uint8_t kAttachTypeMismatch = 3;
+  // The ds_id or the name is invalid, or constructing the DS failed.
+  constexpr static uint8_t kAttachRefused = 4;
+
   Server();
+  NOT_COPYABLE(Server);
+  NOT_MOVEABLE(Server);
   void register_ds(uint8_t ds_type, ServerDSFactory *factory);
-  void construct(uint8_t ds_type, uint8_t ds_id, uint8_t param_len,
+  // Caps the vanilla far memory of the namespace, which is committed by
+  // constructing the vanilla DSes and stays so while they are detached. 0 for
+  // unlimited.
+  void set_far_mem_quota(uint64_t quota);
+  uint64_t get_committed_bytes() const;
+  // Returns false, leaving ds_id unbound, if the ds_id is invalid or bound
+  // already, the ds_type is unknown, or the DS is over the quota.
+  bool construct(uint8_t ds_type, uint8_t ds_id, uint8_t param_len,
                  uint8_t *params);
-  void destruct(uint8_t ds_id);
+  // Returns false if ds_id is not bound.
+  bool destruct(uint8_t ds_id);
+  // Destructs the DSes still bound when a client session ends, e.g., the ones
+  // the client leaked, or all of them if the client crashed. That includes
+  // the named ones, which the client has not detached: without the writeback
+  // and the metadata of the detach they cannot be reattached consistently.
+  // The detached ones are kept.
+  void reset();
+  // Binds the DS detached under the name to ds_id and returns its metadata,
+  // or constructs a new one with the params if there is none. Fails, leaving
+  // ds_id unbound, if the name is already bound or the detached DS is of
+  // another type.
+  uint8_t attach(uint8_t ds_type, uint8_t ds_id, uint8_t name_len,
+              const uint8_t *name, uint8_t param_len, uint8_t *params,
+              uint8_t *meta_len, uint8_t *meta);
+  // Unbinds the named DS from ds_id, and keeps it along with the client
+  // metadata until it is attached again. Returns false if ds_id is not bound
+  // to a named DS.
+  bool detach(uint8_t ds_id, uint8_t meta_len, const uint8_t *meta);
   void read_object(uint8_t ds_id, uint8_t obj_id_len, const uint8_t *obj_id,
                    uint16_t *data_len, uint8_t *data_buf);
   void write_object(uint8_t ds_id, uint8_t obj_id_len, const uint8_t *obj_id,
@@ -26,6 +96,11 @@ public:
   void compute(uint8_t ds_id, uint8_t opcode, uint16_t input_len,
                const uint8_t *input_buf, uint16_t *output_len,
                uint8_t *output_buf);
-  static ServerDS *get_server_ds(uint8_t ds_id);
+  // Null if ds_id is not bound.
+  ServerDS *get_server_ds(uint8_t ds_id);
+  // The DS serving the objects of ds_id: the bound DS, or the vanilla DS for
+  // unbound ds_ids. Null if neither is bound; read_object(), write_object()
+  // and remove_object() must not be called for such a ds_id.
+  ServerDS *get_object_ds(uint8_t ds_id);
 };
 } // namespace far_memory
@@ -27,13 +27,19 @@ private:
                                    uint16_t *output_len, uint8_t *output_buf);
   void compute_assign(uint16_t input_len, const uint8_t *input_buf,
                       uint16_t *output_len, uint8_t *output_buf);
+  void compute_hash_join(uint16_t input_len, const uint8_t *input_buf,
+                         uint16_t *output_len, uint8_t *output_buf);
+  void compute_hash_group(uint16_t input_len, const uint8_t *input_buf,
+                          uint16_t *output_len, uint8_t *output_buf);
+  void compute_aggregate_by_group(uint16_t input_len, const uint8_t *input_buf,
+                                  uint16_t *output_len, uint8_t *output_buf);
   void compute_aggregate(uint8_t opcode, uint16_t input_len,
                          const uint8_t *input_buf, uint16_t *output_len,
                          uint8_t *output_buf);
   template <typename Key_t>
   std::pair<uint64_t, uint64_t>
   _compute_aggregate(uint8_t opcode, uint8_t result_ds, uint8_t key_ds,
-                     uint64_t size);
+                     uint64_t size, double quantile, bool exact);
   template <typename U>
   void _compute_unique(uint64_t vec_size, std::vector<U> &unique_vec);
 
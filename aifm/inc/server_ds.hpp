@@ -2,7 +2,17 @@
 
 #include <cstdint>
 
+namespace far_memory {
+class Server;
+}
+
 class ServerDS {
+protected:
+  // The server (i.e., the client namespace) that owns the DS, through which
+  // the compute ops reach the other DSes by their ds_ids.
+  far_memory::Server *server_ = nullptr;
+  friend class far_memory::Server;
+
 public:
   virtual ~ServerDS() {}
   virtual void read_object(uint8_t obj_id_len, const uint8_t *obj_id,
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "helpers.hpp"
+#include "reader_writer_lock.hpp"
+#include "server.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace far_memory {
+
+// The remote side of an offloaded FarVector. It is type-erased: the elements
+// are opaque items of item_size_ bytes, laid out back to back so that chunk i
+// (the object with id i) is the byte range [i, i + 1) * chunk_size_.
+class ServerFarVector : public ServerDS {
+private:
+  uint32_t item_size_;
+  uint32_t chunk_num_entries_;
+  uint32_t chunk_size_;
+  ReaderWriterLock lock_;
+  // Always a multiple of chunk_size_.
+  std::vector<uint8_t> buf_;
+  friend class ServerFarVectorFactory;
+
+  uint64_t capacity() const;
+  void grow_to(uint64_t num);
+  void compute_reserve(uint16_t input_len, const uint8_t *input_buf,
+                       uint16_t *output_len, uint8_t *output_buf);
+  void compute_assign(uint16_t input_len, const uint8_t *input_buf,
+                      uint16_t *output_len, uint8_t *output_buf);
+
+public:
+  ServerFarVector(uint32_t item_size, uint32_t chunk_num_entries);
+  ~ServerFarVector();
+  void read_object(uint8_t obj_id_len, const uint8_t *obj_id,
+                   uint16_t *data_len, uint8_t *data_buf);
+  void write_object(uint8_t obj_id_len, const uint8_t *obj_id,
+                    uint16_t data_len, const uint8_t *data_buf);
+  bool remove_object(uint8_t obj_id_len, const uint8_t *obj_id);
+  void compute(uint8_t opcode, uint16_t input_len, const uint8_t *input_buf,
+               uint16_t *output_len, uint8_t *output_buf);
+};
+
+class ServerFarVectorFactory : public ServerDSFactory {
+public:
+  ServerDS *build(uint32_t param_len, uint8_t *params);
+};
+
+}; // namespace far_memory
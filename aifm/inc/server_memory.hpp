@@ -0,0 +1,51 @@
+#pragma once
+
+#include "thread.h"
+
+#include "helpers.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+namespace far_memory {
+
+// Anonymous memory backing the server-side data structures. It is mapped in
+// chunks with 2 MiB pages from hugetlbfs, falling back to transparent huge
+// pages once the hugetlbfs pool is exhausted, and is either interleaved
+// across the NUMA nodes or placed on a preferred one. Pages are populated
+// on demand, so mapping is instant; unless DISABLE_SERVER_MEM_PREFAULT is
+// defined, background threads also prefault them in parallel, so that later
+// accesses do not take page faults.
+class ServerMemory {
+public:
+  constexpr static int kInterleaved = -1;
+  constexpr static uint64_t kMapChunkSize = (1ULL << 30);
+  constexpr static uint32_t kNumPrefaultThreads = helpers::kNumCPUs;
+
+private:
+  uint8_t *addr_;
+  uint64_t len_;
+  uint64_t num_hugetlb_bytes_ = 0;
+  std::atomic<bool> stop_prefaulting_{false};
+  std::vector<rt::Thread> prefault_threads_;
+
+  void map_chunks();
+  void set_numa_policy(int numa_node);
+  void prefault(uint64_t begin, uint64_t end);
+
+public:
+  ServerMemory(uint64_t len, int numa_node = kInterleaved);
+  ~ServerMemory();
+  NOT_COPYABLE(ServerMemory);
+  NOT_MOVEABLE(ServerMemory);
+  uint8_t *get() const;
+  uint64_t size() const;
+  // The bytes backed by hugetlbfs rather than transparent huge pages.
+  uint64_t get_num_hugetlb_bytes() const;
+  static int get_num_numa_nodes();
+  // The NUMA node of the core that the caller currently runs on.
+  static int get_numa_node();
+};
+
+} // namespace far_memory
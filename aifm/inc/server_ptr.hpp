@@ -1,13 +1,15 @@
 #pragma once
 
 #include "server_ds.hpp"
+#include "server_memory.hpp"
 
 #include <memory>
 
 namespace far_memory {
 class ServerPtr : public ServerDS {
 private:
-  std::unique_ptr<uint8_t> buf_;
+  std::unique_ptr<ServerMemory> mem_;
+  uint8_t *buf_;
   friend class ServerPtrFactory;
 
 public:
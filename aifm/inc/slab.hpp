@@ -3,37 +3,122 @@
 #include "helpers.hpp"
 #include "sync.h"
 
+#include <algorithm>
+#include <map>
 #include <memory>
+#include <set>
+#include <utility>
 #include <vector>
 
 namespace far_memory {
 
+// Carves a memory region into objects, following the magazine and depot
+// design. Each core caches the free objects of each size class in two
+// magazines; full and empty magazines are exchanged through the per-class
+// depot, so that objects freed on one core get reused by the others. The
+// depot keeps a bounded number of full magazines and returns the excess
+// objects to their spans. Spans without any live object, as well as large
+// objects, go back to a coalescing page heap, which releases the memory of
+// the hugepages that become entirely free.
 class Slab {
 public:
-  constexpr static uint8_t kNumSlabClasses = 7;
+  constexpr static uint8_t kNumSlabClasses = 12;
   constexpr static uint32_t kMinSlabClassShift = 5;
   constexpr static uint32_t kMinSlabClassSize = (1 << kMinSlabClassShift);
   constexpr static uint32_t kMaxSlabClassSize =
       (kMinSlabClassSize << (kNumSlabClasses - 1));
-  constexpr static uint32_t kReplenishChunkSize = 512;
+  constexpr static uint32_t kMinMagazineSize = 4;
+  constexpr static uint32_t kMaxMagazineSize = 64;
+  constexpr static uint32_t kMaxMagazineBytes = (256 << 10);
+  constexpr static uint32_t kMaxNumDepotMagazines = 16;
+  constexpr static uint32_t kMinSpanSize = (64 << 10);
+  constexpr static uint32_t kMinNumObjectsPerSpan = 8;
 
 private:
+  // The slab index of the spans holding a single large object.
+  constexpr static uint32_t kLargeObjectIdx = kNumSlabClasses;
+
+  struct Magazine {
+    uint32_t num = 0;
+    uint8_t *objs[kMaxMagazineSize];
+  };
+
+  struct Span {
+    uint64_t first_page;
+    uint64_t num_pages;
+    uint32_t slab_idx;
+    // The number of objects handed out to the magazines or the users.
+    uint32_t num_used = 0;
+    // The number of objects ever carved out of the span.
+    uint32_t num_carved = 0;
+    uint8_t *free_list = nullptr;
+    // Links the spans that have free objects.
+    Span *prev = nullptr;
+    Span *next = nullptr;
+    bool is_partial = false;
+  };
+
+  struct alignas(64) CoreCache {
+    Magazine *loaded;
+    Magazine *prev;
+  };
+
+  struct alignas(64) SlabClass {
+    rt::Spin spin;
+    std::vector<Magazine *> full_magazines;
+    std::vector<Magazine *> empty_magazines;
+    Span *partial_spans = nullptr;
+  };
+
   std::unique_ptr<uint8_t> base_;
   uint64_t len_;
-  uint8_t *cur_;
-  rt::Spin spin_;
-  std::vector<uint8_t *> slabs_[helpers::kNumCPUs][kNumSlabClasses];
+  uint64_t num_pages_;
+  // Maps each page to the span covering it.
+  std::unique_ptr<Span *[]> page_map_;
+  CoreCache core_caches_[helpers::kNumCPUs][kNumSlabClasses];
+  SlabClass slab_classes_[kNumSlabClasses];
+  rt::Spin page_heap_spin_;
+  // Free page extents, by their first pages and by their sizes.
+  std::map<uint64_t, uint64_t> free_extents_;
+  std::set<std::pair<uint64_t, uint64_t>> free_extents_by_size_;
+  uint64_t num_free_pages_;
   friend class FarMemTest;
 
   static uint32_t get_slab_idx(uint32_t size);
   static uint32_t get_slab_size(uint32_t idx);
-  void replenish(uint32_t slab_idx);
+  static uint32_t get_magazine_size(uint32_t idx);
+  static uint64_t get_span_num_pages(uint32_t idx);
+  uint8_t *get_page_addr(uint64_t page) const;
+  uint64_t get_page(uint64_t addr) const;
+  Span *get_span(const uint8_t *ptr) const;
+  void add_free_extent(uint64_t first_page, uint64_t num_pages);
+  void remove_free_extent(uint64_t first_page, uint64_t num_pages);
+  // Merges the neighboring free extents into the given one, which is not in
+  // the heap yet.
+  void coalesce_free_extent(uint64_t *first_page, uint64_t *num_pages);
+  Span *allocate_span(uint64_t num_pages, uint32_t slab_idx);
+  void free_span(Span *span);
+  void link_partial(SlabClass *slab_class, Span *span);
+  void unlink_partial(SlabClass *slab_class, Span *span);
+  // The following ones are invoked with the class spin lock held.
+  void refill(uint32_t slab_idx, Magazine *magazine);
+  void drain(uint32_t slab_idx, Magazine *magazine,
+             std::vector<Span *> *empty_spans);
+  bool reload(uint32_t slab_idx, CoreCache *cache);
+  void unload(uint32_t slab_idx, CoreCache *cache);
+  uint8_t *allocate_large(uint64_t size);
+  void free_large(uint8_t *ptr);
 
 public:
   Slab(uint8_t *base, uint64_t len);
   ~Slab();
+  NOT_COPYABLE(Slab);
+  NOT_MOVEABLE(Slab);
+  // Sizes beyond kMaxSlabClassSize are served from the page heap directly.
   uint8_t *allocate(uint32_t size);
   void free(uint8_t *ptr, uint32_t size);
+  // The bytes of the region that are not in the page heap.
+  uint64_t get_footprint();
 };
 
 } // namespace far_memory
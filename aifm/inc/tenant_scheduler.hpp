@@ -0,0 +1,96 @@
+#pragma once
+
+#include "sync.h"
+
+#include "helpers.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+
+namespace far_memory {
+
+// Shares the request processing slots of the memory server fairly across its
+// tenants (i.e., the clients it serves concurrently, see
+// tcp_device_server.cpp). A tenant that floods the server with requests over
+// many connections gets the same share of the slots under contention as one
+// that has a single request outstanding at a time. The slots go to the
+// backlogged tenant with the fewest grants (its pass), and a tenant that has
+// been idle for a while starts from the passes of the others, rather than
+// claiming the slots it did not use.
+//
+// While nothing is queued, acquire() and release() only touch atomic
+// counters, like in IOScheduler, and the grants they make still advance the
+// passes.
+class TenantScheduler {
+public:
+  constexpr static uint32_t kMaxNumTenants = 1024;
+
+  struct Stats {
+    uint64_t num_ops;
+    uint64_t total_wait_us;
+    uint64_t max_wait_us;
+  };
+
+private:
+  struct Waiter {
+    rt::CondVar cv;
+    bool granted;
+  };
+
+  struct Tenant {
+    std::atomic<uint64_t> pass{0};
+    std::atomic<uint64_t> num_ops{0};
+    // The fields below are guarded by mutex_.
+    std::deque<Waiter *> queue;
+    uint64_t total_wait_us = 0;
+    uint64_t max_wait_us = 0;
+  };
+
+  std::atomic<uint32_t> num_free_slots_;
+  // Requests that are queued or about to be. The fast path of acquire() is
+  // only taken when there are none, so that it never overtakes them.
+  std::atomic<uint32_t> num_waiters_ = 0;
+  // The pass of the latest grant.
+  std::atomic<uint64_t> global_pass_ = 0;
+  // The fields below are guarded by mutex_. The tenants are never removed,
+  // so that the fast path can look them up by id without the mutex.
+  rt::Mutex mutex_;
+  std::unique_ptr<Tenant> tenants_[kMaxNumTenants];
+  uint32_t num_tenants_ = 0;
+
+  bool try_take_slot();
+  void advance_pass(Tenant *tenant);
+  void dispatch();
+  bool grant(Tenant *tenant);
+
+public:
+  TenantScheduler(uint32_t num_slots);
+  NOT_COPYABLE(TenantScheduler);
+  NOT_MOVEABLE(TenantScheduler);
+  // Returns false if there are kMaxNumTenants already.
+  bool add_tenant(uint32_t *tenant_id);
+  // Blocks until a slot is granted to the tenant.
+  void acquire(uint32_t tenant_id);
+  void release(uint32_t tenant_id);
+  Stats get_stats(uint32_t tenant_id);
+};
+
+// Holds a slot of the scheduler for the tenant during its lifetime. A null
+// scheduler admits everything.
+class TenantAdmission {
+private:
+  TenantScheduler *scheduler_;
+  uint32_t tenant_id_;
+
+public:
+  TenantAdmission(TenantScheduler *scheduler, uint32_t tenant_id);
+  ~TenantAdmission();
+  NOT_COPYABLE(TenantAdmission);
+  NOT_MOVEABLE(TenantAdmission);
+};
+
+} // namespace far_memory
+
+#include "internal/tenant_scheduler.ipp"
@@ -35,4 +35,18 @@ void GenericArray::static_prefetch(Index_t start, Index_t step, uint32_t num) {
   prefetcher_.static_prefetch(start, step, num);
 }
 
+void GenericArray::advise(Index_t start, Index_t num, uint32_t advice) {
+  BUG_ON(start + num > kNumItems_);
+  if (advice & kAdviceRandom) {
+    disable_prefetch();
+    prefetcher_.set_eager(false);
+  }
+  if (advice & kAdviceSequential) {
+    enable_prefetch();
+    prefetcher_.set_eager(true);
+  }
+  FarMemManagerFactory::get()->advise(&ptrs_[start], num, advice,
+                                      prefetcher_.get_stream());
+}
+
 } // namespace far_memory
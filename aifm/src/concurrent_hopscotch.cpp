@@ -10,15 +10,17 @@ extern "C" {
 #include "manager.hpp"
 
 #include <cstring>
+#include <limits>
 
 namespace far_memory {
 
 GenericConcurrentHopscotch::GenericConcurrentHopscotch(
     uint8_t ds_id, uint32_t local_num_entries_shift,
-    uint32_t remote_num_entries_shift, uint64_t remote_data_size)
+    uint32_t remote_num_entries_shift, uint64_t remote_data_size,
+    std::string_view name)
     : kHashMask_((1 << local_num_entries_shift) - 1),
       kNumEntries_((1 << local_num_entries_shift) + kNeighborhood),
-      ds_id_(ds_id) {
+      ds_id_(ds_id), name_(name) {
   // Check overflow.
   BUG_ON(((kHashMask_ + 1) >> local_num_entries_shift) != 1);
 
@@ -38,8 +40,22 @@ GenericConcurrentHopscotch::GenericConcurrentHopscotch(
                    sizeof(remote_num_entries_shift));
   __builtin_memcpy(&params[sizeof(remote_num_entries_shift)], &remote_data_size,
                    sizeof(remote_data_size));
-  FarMemManagerFactory::get()->construct(kHashTableDSType, ds_id,
-                                         sizeof(params), params);
+  if (name_.empty()) {
+    FarMemManagerFactory::get()->construct(kHashTableDSType, ds_id,
+                                           sizeof(params), params);
+  } else {
+    // The local buckets of an attached table are refilled lazily, as the
+    // misses swap the entries in from the remote side.
+    uint8_t meta_len;
+    uint8_t meta[std::numeric_limits<uint8_t>::max()];
+    attached_ = FarMemManagerFactory::get()->attach(
+        kHashTableDSType, ds_id, name_, sizeof(params), params, &meta_len,
+        meta);
+    if (attached_) {
+      BUG_ON(meta_len != sizeof(persisted_size_));
+      __builtin_memcpy(&persisted_size_, meta, sizeof(persisted_size_));
+    }
+  }
 
   // Register evac notifier.
   FarMemManager::EvacNotifier evac_notifier_fn =
@@ -52,6 +68,10 @@ GenericConcurrentHopscotch::GenericConcurrentHopscotch(
 }
 
 GenericConcurrentHopscotch::~GenericConcurrentHopscotch() {
+  if (!name_.empty() && persistent_) {
+    detach();
+    return;
+  }
   // Free local data.
   for (uint32_t i = 0; i < kNumEntries_; i++) {
     auto &ptr = buckets_[i].ptr;
@@ -64,6 +84,48 @@ GenericConcurrentHopscotch::~GenericConcurrentHopscotch() {
   FarMemManagerFactory::get()->destruct(ds_id_);
 }
 
+void GenericConcurrentHopscotch::detach() {
+  auto *manager = FarMemManagerFactory::get();
+  auto *device = manager->get_device();
+  for (uint32_t i = 0; i < kNumEntries_; i++) {
+    auto &ptr = buckets_[i].ptr;
+    DerefScope scope;
+  restart:
+    FarMemPtrMeta meta_snapshot = ptr.meta();
+    if (!meta_snapshot.is_present()) {
+      // Either empty or already on the remote side.
+      continue;
+    }
+    if (meta_snapshot.is_dirty()) {
+      auto obj = meta_snapshot.object();
+      auto obj_id_len = obj.get_obj_id_len();
+      auto *obj_id = obj.get_obj_id();
+      {
+        FarMemManager::lock_object(obj_id_len, obj_id);
+        auto guard = helpers::finally(
+            [&]() { FarMemManager::unlock_object(obj_id_len, obj_id); });
+        if (unlikely(ptr.meta() != meta_snapshot)) {
+          goto restart;
+        }
+        // The same write-back as the eviction, so the remote side ends up
+        // holding every entry.
+        IOAdmission admission(device->get_io_scheduler(), kIOWriteBack);
+        auto data_len = obj.get_data_len() - sizeof(EvacNotifierMeta);
+        device->write_object(
+            ds_id_, obj_id_len, obj_id, data_len,
+            reinterpret_cast<const uint8_t *>(obj.get_data_addr()));
+        admission.add_bytes(data_len);
+        ptr.meta().clear_dirty();
+      }
+    }
+    ptr.free();
+  }
+
+  auto meta_len = static_cast<uint8_t>(sizeof(persisted_size_));
+  manager->detach(ds_id_, meta_len,
+                  reinterpret_cast<const uint8_t *>(&persisted_size_));
+}
+
 void GenericConcurrentHopscotch::do_evac_notifier(EvacNotifierMeta meta) {
   auto *bucket =
       reinterpret_cast<BucketEntry *>(static_cast<uint64_t>(meta.anchor_addr));
@@ -84,10 +146,87 @@ void GenericConcurrentHopscotch::do_evac_notifier(EvacNotifierMeta meta) {
 void GenericConcurrentHopscotch::forward_get(uint8_t key_len,
                                              const uint8_t *key,
                                              uint16_t *val_len, uint8_t *val) {
+  if (!may_exist_remotely(key_len, key)) {
+    *val_len = 0;
+    return;
+  }
   // Cannot find the key locally, so forward the request to the remote agent.
   FarMemManagerFactory::get()->read_object(ds_id_, key_len, key, val_len, val);
-  if (*val_len) {
-    _put(key_len, key, *val_len, val, /* swap_in = */ true);
+  cache_forwarded(key_len, key, *val_len, val);
+}
+
+bool GenericConcurrentHopscotch::may_exist_remotely(uint8_t key_len,
+                                                    const uint8_t *key) {
+  return !negative_filter_ ||
+         negative_filter_->may_contain(
+             hash_32(static_cast<const void *>(key), key_len));
+}
+
+void GenericConcurrentHopscotch::cache_forwarded(uint8_t key_len,
+                                                 const uint8_t *key,
+                                                 uint16_t val_len,
+                                                 const uint8_t *val) {
+  if (!val_len) {
+    return;
+  }
+  if (admission_filter_ &&
+      !admit(hash_32(static_cast<const void *>(key), key_len))) {
+    return;
+  }
+  _put(key_len, key, val_len, val, /* swap_in = */ true);
+}
+
+bool GenericConcurrentHopscotch::admit(uint32_t hash) {
+  admission_filter_->record(hash);
+  auto candidate_freq = admission_filter_->estimate(hash);
+
+  // The GC evicts the cold objects, so the victim is taken as the least
+  // frequent key of the candidate's bucket. The scan is lockless, like the
+  // fast path of __get(); a racing update at worst picks a different victim.
+  // It peeks at the metadata rather than dereferencing the neighbours, which
+  // would swap them in and count as accesses towards their recency.
+  auto bucket_idx = hash & kHashMask_;
+  uint32_t bitmap = load_acquire(&(buckets_[bucket_idx].bitmap));
+  bool has_victim = false;
+  while (bitmap) {
+    auto offset = helpers::bsf_32(bitmap);
+    bitmap ^= (1 << offset);
+    FarMemPtrMeta meta_snapshot = buckets_[bucket_idx + offset].ptr.meta();
+    if (unlikely(meta_snapshot.is_null())) {
+      continue;
+    }
+    if (!meta_snapshot.is_present() || meta_snapshot.is_evacuation()) {
+      // Not taking local memory, or being evacuated; either way not a victim.
+      continue;
+    }
+    auto obj = Object(meta_snapshot.get_object_addr());
+    auto victim_hash = hash_32(static_cast<const void *>(obj.get_obj_id()),
+                               obj.get_obj_id_len());
+    if (admission_filter_->estimate(victim_hash) < candidate_freq) {
+      return true;
+    }
+    has_victim = true;
+  }
+  return !has_victim;
+}
+
+void GenericConcurrentHopscotch::set_admission_filter(
+    uint64_t num_cached_keys) {
+  if (num_cached_keys) {
+    admission_filter_.reset(new FrequencySketch(num_cached_keys));
+  } else {
+    admission_filter_.reset();
+  }
+}
+
+void GenericConcurrentHopscotch::set_negative_filter(
+    uint64_t expected_num_keys) {
+  if (expected_num_keys) {
+    // It would filter out the keys that only exist remotely.
+    BUG_ON(attached_);
+    negative_filter_.reset(new CountingBloomFilter(expected_num_keys));
+  } else {
+    negative_filter_.reset();
   }
 }
 
@@ -104,6 +243,13 @@ bool GenericConcurrentHopscotch::_put(uint8_t key_len, const uint8_t *key,
                                       bool swap_in) {
   uint32_t hash = hash_32(static_cast<const void *>(key), key_len);
   uint32_t bucket_idx = hash & kHashMask_;
+  // Added before the key becomes visible (and thus evictable) and taken back
+  // if the key turns out to exist, so that a racing lookup never sees a false
+  // negative.
+  bool filtered = negative_filter_ && !swap_in;
+  if (filtered) {
+    negative_filter_->add(hash);
+  }
 retry:
   auto *bucket = &(buckets_[bucket_idx]);
   auto orig_bucket_idx = bucket_idx;
@@ -160,6 +306,9 @@ retry:
         } else {
           memcpy(obj_val_ptr, val, val_len);
         }
+        if (filtered) {
+          negative_filter_->remove(hash);
+        }
         return true;
       }
     }
@@ -286,7 +435,12 @@ retry:
   // Ensure there's no copy at remote. Ideally we can make this happen
   // asynchronously and check completion before returning to client.
   if (!swap_in) {
-    FarMemManagerFactory::get()->remove_object(ds_id_, key_len, key);
+    if (FarMemManagerFactory::get()->remove_object(ds_id_, key_len, key)) {
+      if (filtered) {
+        negative_filter_->remove(hash);
+      }
+      return true;
+    }
   }
   return false;
 }
@@ -326,6 +480,9 @@ retry:
         bucket->bitmap ^= (1 << offset);
         ptr.free(/* race = */ true);
 #ifdef HASHTABLE_EXCLUSIVE
+        if (negative_filter_) {
+          negative_filter_->remove(hash);
+        }
         return true;
 #else
         removed = true;
@@ -337,9 +494,15 @@ retry:
   }
   spin_guard.reset();
 
+  if (!removed && negative_filter_ && !negative_filter_->may_contain(hash)) {
+    return false;
+  }
   // Forward the request to the remote agent.
-  return FarMemManagerFactory::get()->remove_object(ds_id_, key_len, key) ||
-         removed;
+  removed |= FarMemManagerFactory::get()->remove_object(ds_id_, key_len, key);
+  if (removed && negative_filter_) {
+    negative_filter_->remove(hash);
+  }
+  return removed;
 }
 
 } // namespace far_memory
@@ -0,0 +1,202 @@
+extern "C" {
+#include <runtime/thread.h>
+}
+
+#include "concurrent_queue.hpp"
+#include "internal/ds_info.hpp"
+#include "manager.hpp"
+#include "prefetch_service.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace far_memory {
+
+GenericConcurrentQueue::GenericConcurrentQueue(const DerefScope &scope,
+                                               uint16_t item_size,
+                                               uint32_t num_items_per_segment)
+    : kItemSize_(item_size), kNumItemsPerSegment_(num_items_per_segment) {
+  head_ = tail_ = allocate_segment(scope);
+  // Pinned once as the tail and once as the head.
+  pin(scope, head_);
+}
+
+GenericConcurrentQueue::~GenericConcurrentQueue() {
+  DerefScope scope;
+  unpin(head_);
+  unpin(tail_);
+  auto *segment = head_;
+  while (segment) {
+    auto *next = segment->next;
+    free_segment(segment);
+    segment = next;
+  }
+}
+
+GenericConcurrentQueue::Segment *
+GenericConcurrentQueue::allocate_segment(const DerefScope &scope) {
+  auto *segment = new Segment();
+  segment->ptr =
+      std::move(FarMemManagerFactory::get()->allocate_generic_unique_ptr(
+          kVanillaPtrDSID, kItemSize_ * kNumItemsPerSegment_));
+  pin(scope, segment);
+  return segment;
+}
+
+void GenericConcurrentQueue::free_segment(Segment *segment) {
+  while (unlikely(load_acquire(&segment->inflight))) {
+    thread_yield();
+  }
+  delete segment;
+}
+
+void GenericConcurrentQueue::pin(const DerefScope &scope, Segment *segment) {
+  segment->ptr.deref(scope);
+  FarMemManagerFactory::get()->pin(&segment->ptr);
+}
+
+void GenericConcurrentQueue::unpin(Segment *segment) {
+  FarMemManagerFactory::get()->unpin(&segment->ptr);
+}
+
+bool GenericConcurrentQueue::try_set_inflight(Segment *segment) {
+  return !__atomic_exchange_n(&segment->inflight, true, __ATOMIC_ACQUIRE);
+}
+
+void GenericConcurrentQueue::spill_fn(void *arg) {
+  auto *segment = reinterpret_cast<Segment *>(arg);
+  FarMemManagerFactory::get()->advise(&segment->ptr, 1, kAdviceDontNeed);
+  store_release(&segment->inflight, false);
+}
+
+void GenericConcurrentQueue::seal(const DerefScope &scope, Segment *segment) {
+  unpin(segment);
+  // Far from the consumers; evict it now rather than letting it compete with
+  // the hot data for the cache.
+  if (depth() > kSpillAheadDepth && try_set_inflight(segment)) {
+    PrefetchService::get()->offload(spill_fn, segment);
+  }
+}
+
+void GenericConcurrentQueue::fetch_ahead(Segment *segment) {
+  GenericUniquePtr *ptrs[kMaxNumFetchAheadSegments];
+  bool *inflights[kMaxNumFetchAheadSegments];
+  uint32_t num_ptrs = 0;
+  auto num_segments =
+      std::min(depth() - 1, static_cast<uint64_t>(kMaxNumFetchAheadSegments));
+  for (uint32_t i = 0; i < num_segments; i++) {
+    segment = load_acquire(&segment->next);
+    if (!segment) {
+      break;
+    }
+    if (segment->ptr.meta().is_present() || !try_set_inflight(segment)) {
+      continue;
+    }
+    ptrs[num_ptrs] = &segment->ptr;
+    inflights[num_ptrs++] = &segment->inflight;
+  }
+  if (num_ptrs) {
+    PrefetchService::get()->submit(/* stream = */ nullptr, ptrs, num_ptrs,
+                                   /* nt = */ false, kIOPrefetch, inflights);
+  }
+}
+
+void GenericConcurrentQueue::push_n(const DerefScope &scope,
+                                    const uint8_t *items, uint32_t num) {
+  Segment *spare = nullptr;
+  uint32_t num_pushed = 0;
+  while (num_pushed < num) {
+    while (unlikely(!tail_spin_.TryLockWp())) {
+      thread_yield();
+    }
+    auto *tail = tail_;
+    if (unlikely(tail->num_pushed == kNumItemsPerSegment_)) {
+      if (!spare) {
+        // Allocates without the lock held as it may wait for the GC.
+        tail_spin_.UnlockWp();
+        spare = allocate_segment(scope);
+        continue;
+      }
+      tail_ = spare;
+      spare = nullptr;
+      ACCESS_ONCE(tail_seq_) = tail_seq_ + 1;
+      seal(scope, tail);
+      // The consumers may free the sealed segment from now on.
+      store_release(&tail->next, tail_);
+      tail = tail_;
+    }
+    auto n =
+        std::min(num - num_pushed, kNumItemsPerSegment_ - tail->num_pushed);
+    auto *data = static_cast<uint8_t *>(tail->ptr.deref_mut(scope));
+    memcpy(data + tail->num_pushed * kItemSize_,
+           items + num_pushed * kItemSize_, n * kItemSize_);
+    store_release(&tail->num_pushed, tail->num_pushed + n);
+    ACCESS_ONCE(num_pushed_) = num_pushed_ + n;
+    num_pushed += n;
+    tail_spin_.UnlockWp();
+  }
+  if (unlikely(spare)) {
+    // Another producer has moved on to a new segment in the meantime.
+    unpin(spare);
+    free_segment(spare);
+  }
+}
+
+uint32_t GenericConcurrentQueue::pop_n(const DerefScope &scope, uint8_t *items,
+                                       uint32_t num) {
+  uint32_t num_popped = 0;
+  while (unlikely(!head_spin_.TryLockWp())) {
+    thread_yield();
+  }
+  auto guard = helpers::finally([&]() { head_spin_.UnlockWp(); });
+  while (num_popped < num) {
+    auto *head = head_;
+    auto num_pushed = load_acquire(&head->num_pushed);
+    if (head->num_popped == num_pushed) {
+      auto *next = load_acquire(&head->next);
+      if (!next) {
+        break;
+      }
+      if (unlikely(!next->ptr.meta().is_present())) {
+        // Swaps it in with the lock dropped so that the other consumers are
+        // not stalled behind the I/O. It is only touched again under the
+        // lock, as another consumer may move past and free it meanwhile.
+        // Consumers wait for it, so it is a demand rather than a prefetch,
+        // which would be cancelled once stale. If a prefetch of it is still
+        // in flight, the next round resubmits it in case that one is
+        // cancelled.
+        if (try_set_inflight(next)) {
+          GenericUniquePtr *ptr = &next->ptr;
+          bool *inflight = &next->inflight;
+          PrefetchService::get()->submit(/* stream = */ nullptr, &ptr, 1,
+                                         /* nt = */ false, kIODemand,
+                                         &inflight);
+        }
+        fetch_ahead(next);
+        head_spin_.UnlockWp();
+        thread_yield();
+        while (unlikely(!head_spin_.TryLockWp())) {
+          thread_yield();
+        }
+        continue;
+      }
+      pin(scope, next);
+      head_ = next;
+      ACCESS_ONCE(head_seq_) = head_seq_ + 1;
+      unpin(head);
+      free_segment(head);
+      fetch_ahead(next);
+      continue;
+    }
+    auto n = std::min(num - num_popped, num_pushed - head->num_popped);
+    auto *data = static_cast<const uint8_t *>(head->ptr.deref(scope));
+    memcpy(items + num_popped * kItemSize_,
+           data + head->num_popped * kItemSize_, n * kItemSize_);
+    head->num_popped += n;
+    num_popped += n;
+  }
+  ACCESS_ONCE(num_popped_) = num_popped_ + num_popped;
+  return num_popped;
+}
+
+} // namespace far_memory
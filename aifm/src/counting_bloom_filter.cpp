@@ -0,0 +1,18 @@
+#include "counting_bloom_filter.hpp"
+
+namespace far_memory {
+
+CountingBloomFilter::CountingBloomFilter(uint64_t expected_num_keys) {
+  auto num_blocks = expected_num_keys * kNumCountersPerKey / kBlockSize;
+  num_blocks_shift_ = 1;
+  while ((1ULL << num_blocks_shift_) < num_blocks) {
+    num_blocks_shift_++;
+  }
+  auto size = kBlockSize << num_blocks_shift_;
+  counters_mem_.reset(new uint8_t[size + kBlockSize]());
+  auto addr = reinterpret_cast<uint64_t>(counters_mem_.get());
+  auto mask = static_cast<uint64_t>(kBlockSize) - 1;
+  counters_ = reinterpret_cast<uint8_t *>((addr + mask) & ~mask);
+}
+
+} // namespace far_memory
@@ -2,46 +2,77 @@
 #include "internal/ds_info.hpp"
 #include "manager.hpp"
 
+#include <limits>
+
 namespace far_memory {
 GenericDataFrameVector::GenericDataFrameVector(const uint32_t chunk_size,
                                                const uint32_t chunk_num_entries,
-                                               uint8_t ds_id, uint8_t dt_id)
+                                               uint8_t ds_id, uint8_t dt_id,
+                                               std::string_view name)
     : chunk_size_(chunk_size), chunk_num_entries_(chunk_num_entries),
-      device_(FarMemManagerFactory::get()->get_device()), ds_id_(ds_id) {
-  FarMemManagerFactory::get()->construct(kDataFrameVectorDSType, ds_id,
-                                         sizeof(dt_id), &dt_id);
+      device_(FarMemManagerFactory::get()->get_device()), ds_id_(ds_id),
+      dt_id_(dt_id), name_(name) {
+  if (name_.empty()) {
+    FarMemManagerFactory::get()->construct(kDataFrameVectorDSType, ds_id,
+                                           sizeof(dt_id), &dt_id);
+  } else {
+    attach();
+  }
   // DataFrameVector essentially stores a std::vector of GenericUniquePtrs, so
   // it does not need a notifier.
 }
 
 GenericDataFrameVector::~GenericDataFrameVector() { cleanup(); }
 
+void GenericDataFrameVector::attach() {
+  uint8_t meta_len;
+  PersistedMeta meta;
+  static_assert(sizeof(meta) <= std::numeric_limits<uint8_t>::max());
+  attached_ = FarMemManagerFactory::get()->attach(
+      kDataFrameVectorDSType, ds_id_, name_, sizeof(dt_id_), &dt_id_,
+      &meta_len, reinterpret_cast<uint8_t *>(&meta));
+  if (!attached_) {
+    return;
+  }
+  BUG_ON(meta_len != sizeof(meta));
+  BUG_ON(meta.dt_id != dt_id_ || meta.chunk_size != chunk_size_);
+  size_ = meta.size;
+  remote_vec_capacity_ = meta.remote_vec_capacity;
+  // Only rebuilds the pointers, which refer to the remote chunks by their
+  // object IDs, i.e., the chunk indices.
+  expand_no_alloc(meta.num_chunks);
+}
+
+void GenericDataFrameVector::detach() {
+  parallel_for(chunk_ptrs_.size(),
+               [&](uint64_t i) { chunk_ptrs_[i].flush(); });
+
+  PersistedMeta meta{.dt_id = dt_id_,
+                     .chunk_size = chunk_size_,
+                     .size = size_,
+                     .num_chunks = chunk_ptrs_.size(),
+                     .remote_vec_capacity = remote_vec_capacity_};
+  FarMemManagerFactory::get()->detach(ds_id_, sizeof(meta),
+                                      reinterpret_cast<uint8_t *>(&meta));
+}
+
 void GenericDataFrameVector::cleanup() {
   auto writer_lock = lock_.get_writer_lock();
   if (!moved_) {
-    FarMemManagerFactory::get()->destruct(ds_id_);
-  }
-  std::vector<rt::Thread> threads;
-  for (uint32_t tid = 0; tid < helpers::kNumCPUs; tid++) {
-    threads.emplace_back(rt::Thread([&, tid]() {
-      auto num_tasks_per_threads =
-          (chunk_ptrs_.size() == 0)
-              ? 0
-              : (chunk_ptrs_.size() - 1) / helpers::kNumCPUs + 1;
-      auto left = num_tasks_per_threads * tid;
-      auto right = std::min(left + num_tasks_per_threads, chunk_ptrs_.size());
-      for (uint64_t i = left; i < right; i++) {
-        chunk_ptrs_[i].free();
-      }
-    }));
-  }
-  for (auto &thread : threads) {
-    thread.Join();
+    if (!name_.empty() && persistent_) {
+      detach();
+    } else {
+      FarMemManagerFactory::get()->destruct(ds_id_);
+    }
   }
+  parallel_for(chunk_ptrs_.size(), [&](uint64_t i) { chunk_ptrs_[i].free(); });
 }
 
 void GenericDataFrameVector::reserve_remote(uint64_t num) {
   if (num > remote_vec_capacity_) {
+    // Grow geometrically so that a stream of appends only issues a logarithmic
+    // number of reserve requests.
+    num = std::max(num, remote_vec_capacity_ * 2);
     uint16_t output_len;
     device_->compute(ds_id_, OpCode::Reserve, sizeof(num),
                      reinterpret_cast<const uint8_t *>(&num), &output_len,
@@ -57,28 +88,36 @@ void GenericDataFrameVector::expand(uint64_t num) {
   auto writer_lock = lock_.get_writer_lock();
   chunk_ptrs_.resize(old_chunk_ptrs_size + num);
 
-  std::vector<rt::Thread> threads;
-  for (uint32_t tid = 0; tid < helpers::kNumCPUs; tid++) {
-    threads.emplace_back(rt::Thread([&, tid]() {
-      auto num_tasks_per_threads =
-          (num == 0) ? 0 : (num - 1) / helpers::kNumCPUs + 1;
-      auto left = num_tasks_per_threads * tid;
-      auto right = std::min(left + num_tasks_per_threads, num);
-      for (uint64_t i = left; i < right; i++) {
-        uint64_t obj_id = i + old_chunk_ptrs_size;
-        auto &new_chunk_ptr = chunk_ptrs_[obj_id];
-        while (unlikely(
-            !FarMemManagerFactory::get()->allocate_generic_unique_ptr_nb(
-                &new_chunk_ptr, ds_id_, chunk_size_, sizeof(obj_id),
-                reinterpret_cast<uint8_t *>(&obj_id)))) {
-          FarMemManagerFactory::get()->mutator_wait_for_gc_cache();
-        }
-      }
-    }));
+  auto *manager = FarMemManagerFactory::get();
+  parallel_for(num, [&](uint64_t i) {
+    uint64_t obj_id = i + old_chunk_ptrs_size;
+    auto &new_chunk_ptr = chunk_ptrs_[obj_id];
+    while (unlikely(!manager->allocate_generic_unique_ptr_nb(
+        &new_chunk_ptr, ds_id_, chunk_size_, sizeof(obj_id),
+        reinterpret_cast<uint8_t *>(&obj_id)))) {
+      manager->mutator_wait_for_gc_cache();
+    }
+  });
+}
+
+void GenericDataFrameVector::swap_in_chunks(uint64_t begin, uint64_t end) {
+  std::vector<GenericUniquePtr *> missing_chunks;
+  for (auto i = begin; i < end; i++) {
+    if (!chunk_ptrs_[i].meta().is_present()) {
+      missing_chunks.push_back(&chunk_ptrs_[i]);
+    }
   }
-  for (auto &thread : threads) {
-    thread.Join();
+  if (missing_chunks.size() <= 1) {
+    for (auto *chunk_ptr : missing_chunks) {
+      chunk_ptr->swap_in(/* nt = */ false);
+    }
+    return;
   }
+
+  // Keep multiple device reads in flight.
+  parallel_for(missing_chunks.size(), [&](uint64_t i) {
+    missing_chunks[i]->swap_in(/* nt = */ false);
+  });
 }
 
 void GenericDataFrameVector::expand_no_alloc(uint64_t num) {
@@ -87,23 +126,10 @@ void GenericDataFrameVector::expand_no_alloc(uint64_t num) {
   chunk_ptrs_.resize(old_chunk_ptrs_size + num);
 
   const auto obj_size = Object::kHeaderSize + chunk_size_ + sizeof(uint64_t);
-  std::vector<rt::Thread> threads;
-  for (uint32_t tid = 0; tid < helpers::kNumCPUs; tid++) {
-    threads.emplace_back(rt::Thread([&, tid]() {
-      auto num_tasks_per_threads =
-          (num == 0) ? 0 : (num - 1) / helpers::kNumCPUs + 1;
-      auto left = num_tasks_per_threads * tid;
-      auto right = std::min(left + num_tasks_per_threads, num);
-      for (uint64_t i = left; i < right; i++) {
-        uint64_t obj_id = i + old_chunk_ptrs_size;
-        auto &new_chunk_ptr = chunk_ptrs_[obj_id];
-        new_chunk_ptr.meta().gc_wb(ds_id_, obj_size, obj_id);
-      }
-    }));
-  }
-  for (auto &thread : threads) {
-    thread.Join();
-  }
+  parallel_for(num, [&](uint64_t i) {
+    uint64_t obj_id = i + old_chunk_ptrs_size;
+    chunk_ptrs_[obj_id].meta().gc_wb(ds_id_, obj_size, obj_id);
+  });
 }
 
 void GenericDataFrameVector::flush() {
@@ -112,23 +138,8 @@ void GenericDataFrameVector::flush() {
       return;
     }
     dirty_ = false;
-    std::vector<rt::Thread> threads;
-    for (uint32_t tid = 0; tid < helpers::kNumCPUs; tid++) {
-      threads.emplace_back(rt::Thread([&, tid]() {
-        auto num_tasks_per_threads =
-            (chunk_ptrs_.size() == 0)
-                ? 0
-                : (chunk_ptrs_.size() - 1) / helpers::kNumCPUs + 1;
-        auto left = num_tasks_per_threads * tid;
-        auto right = std::min(left + num_tasks_per_threads, chunk_ptrs_.size());
-        for (uint64_t i = left; i < right; i++) {
-          chunk_ptrs_[i].flush();
-        }
-      }));
-    }
-    for (auto &thread : threads) {
-      thread.Join();
-    }
+    parallel_for(chunk_ptrs_.size(),
+                 [&](uint64_t i) { chunk_ptrs_[i].flush(); });
   }
 }
 
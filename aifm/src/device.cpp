@@ -8,16 +8,27 @@ extern "C" {
 #include "stats.hpp"
 
 #include <cstring>
+#include <limits>
 
 namespace far_memory {
 
 FarMemDevice::FarMemDevice(uint64_t far_mem_size, uint32_t prefetch_win_size)
     : far_mem_size_(far_mem_size), prefetch_win_size_(prefetch_win_size) {}
 
+void FarMemDevice::read_object_async(uint8_t ds_id, uint8_t obj_id_len,
+                                     const uint8_t *obj_id, uint16_t *data_len,
+                                     uint8_t *data_buf,
+                                     IOCompletion completion) {
+  read_object(ds_id, obj_id_len, obj_id, data_len, data_buf);
+  completion.fn(completion.arg);
+}
+
 FakeDevice::FakeDevice(uint64_t far_mem_size)
     : FarMemDevice(far_mem_size, kPrefetchWinSize), server_() {
-  server_.construct(kVanillaPtrDSType, kVanillaPtrDSID, sizeof(far_mem_size),
-                    reinterpret_cast<uint8_t *>(&far_mem_size));
+  server_.set_far_mem_quota(far_mem_size);
+  BUG_ON(!server_.construct(kVanillaPtrDSType, kVanillaPtrDSID,
+                            sizeof(far_mem_size),
+                            reinterpret_cast<uint8_t *>(&far_mem_size)));
 }
 
 FakeDevice::~FakeDevice() { destruct(kVanillaPtrDSID); }
@@ -41,10 +52,21 @@ bool FakeDevice::remove_object(uint64_t ds_id, uint8_t obj_id_len,
 
 void FakeDevice::construct(uint8_t ds_type, uint8_t ds_id, uint8_t param_len,
                            uint8_t *params) {
-  server_.construct(ds_type, ds_id, param_len, params);
+  BUG_ON(!server_.construct(ds_type, ds_id, param_len, params));
+}
+
+void FakeDevice::destruct(uint8_t ds_id) { BUG_ON(!server_.destruct(ds_id)); }
+
+uint8_t FakeDevice::attach(uint8_t ds_type, uint8_t ds_id, uint8_t name_len,
+                           const uint8_t *name, uint8_t param_len,
+                           uint8_t *params, uint8_t *meta_len, uint8_t *meta) {
+  return server_.attach(ds_type, ds_id, name_len, name, param_len, params,
+                        meta_len, meta);
 }
 
-void FakeDevice::destruct(uint8_t ds_id) { server_.destruct(ds_id); }
+void FakeDevice::detach(uint8_t ds_id, uint8_t meta_len, const uint8_t *meta) {
+  BUG_ON(!server_.detach(ds_id, meta_len, meta));
+}
 
 void FakeDevice::compute(uint8_t ds_id, uint8_t opcode, uint16_t input_len,
                          const uint8_t *input_buf, uint16_t *output_len,
@@ -53,34 +75,78 @@ void FakeDevice::compute(uint8_t ds_id, uint8_t opcode, uint16_t input_len,
 }
 
 // Request:
-//     |OpCode = Init (1B)|Far Mem Size (8B)|
+//     |OpCode = Init (1B)|Far Mem Size (8B)|tenant_len (1B)|tenant|
 // Response:
-//     |Ack (1B)|
+//     |status (1B)|session_id (4B)|
+// Then for each slave connection:
+// Request:
+//     |OpCode = Join (1B)|session_id (4B)|
+// Response:
+//     |ok (1B)|
 TCPDevice::TCPDevice(netaddr raddr, uint32_t num_connections,
-                     uint64_t far_mem_size)
+                     uint64_t far_mem_size, std::string_view tenant)
     : FarMemDevice(far_mem_size, kPrefetchWinSize),
       shared_pool_(num_connections) {
+  io_scheduler_.reset(new IOScheduler(num_connections));
+  BUG_ON(tenant.size() > std::numeric_limits<uint8_t>::max());
+
   // Initialize the master connection.
   netaddr laddr = {.ip = MAKE_IP_ADDR(0, 0, 0, 0), .port = 0};
   BUG_ON(tcp_dial(laddr, raddr, &remote_master_) != 0);
-  char req[kOpcodeSize + sizeof(far_mem_size)];
+  uint8_t tenant_len = tenant.size();
+  char req[kOpcodeSize + sizeof(far_mem_size) + sizeof(tenant_len) +
+           std::numeric_limits<uint8_t>::max()];
   __builtin_memcpy(req, &kOpInit, kOpcodeSize);
   __builtin_memcpy(req + kOpcodeSize, &far_mem_size, sizeof(far_mem_size));
-  helpers::tcp_write_until(remote_master_, req, sizeof(req));
-  uint8_t ack;
-  helpers::tcp_read_until(remote_master_, &ack, sizeof(ack));
+  __builtin_memcpy(req + kOpcodeSize + sizeof(far_mem_size), &tenant_len,
+                   sizeof(tenant_len));
+  memcpy(req + kOpcodeSize + sizeof(far_mem_size) + sizeof(tenant_len),
+         tenant.data(), tenant_len);
+  helpers::tcp_write_until(remote_master_, req,
+                           kOpcodeSize + sizeof(far_mem_size) +
+                               sizeof(tenant_len) + tenant_len);
+  uint8_t status;
+  uint32_t session_id;
+  helpers::tcp_read_until(remote_master_, &status, sizeof(status));
+  helpers::tcp_read_until(remote_master_, &session_id, sizeof(session_id));
+  // Over the quota of the tenant, the tenant is serving another client, the
+  // server has too many tenants, or the request is invalid. The server closes
+  // the session, so report it to the caller rather than taking it down.
+  if (status != kInitOK) {
+    tcp_close(remote_master_);
+    throw TCPDeviceInitError(status);
+  }
 
-  // Initialize slave connections.
-  tcpconn_t *remote_slave;
+  // Initialize slave connections, which join the session of the master.
   for (uint32_t i = 0; i < num_connections; i++) {
-    BUG_ON(tcp_dial(laddr, raddr, &remote_slave) != 0);
-    shared_pool_.push(remote_slave);
+    shared_pool_.push(join(raddr, session_id));
+  }
+  for (uint32_t i = 0; i < kNumPipelinedConnections; i++) {
+    auto *pipelined_conn = new PipelinedConnection();
+    pipelined_conn->conn = join(raddr, session_id);
+    pipelined_conn->receiver =
+        rt::Thread([this, pipelined_conn]() { receive_fn(pipelined_conn); });
+    pipelined_conns_.emplace_back(pipelined_conn);
   }
 
   construct(kVanillaPtrDSType, kVanillaPtrDSID, sizeof(far_mem_size),
             reinterpret_cast<uint8_t *>(&far_mem_size));
 }
 
+tcpconn_t *TCPDevice::join(netaddr raddr, uint32_t session_id) {
+  netaddr laddr = {.ip = MAKE_IP_ADDR(0, 0, 0, 0), .port = 0};
+  tcpconn_t *remote_slave;
+  BUG_ON(tcp_dial(laddr, raddr, &remote_slave) != 0);
+  char join_req[kOpcodeSize + sizeof(session_id)];
+  __builtin_memcpy(join_req, &kOpJoin, kOpcodeSize);
+  __builtin_memcpy(join_req + kOpcodeSize, &session_id, sizeof(session_id));
+  helpers::tcp_write_until(remote_slave, join_req, sizeof(join_req));
+  bool ok;
+  helpers::tcp_read_until(remote_slave, &ok, sizeof(ok));
+  BUG_ON(!ok);
+  return remote_slave;
+}
+
 // Request:
 //     |Opcode = Shutdown (1B)|
 // Response:
@@ -88,6 +154,13 @@ TCPDevice::TCPDevice(netaddr raddr, uint32_t num_connections,
 TCPDevice::~TCPDevice() {
   destruct(kVanillaPtrDSID);
 
+  // The receivers exit once their connections are shut down.
+  for (auto &pipelined_conn : pipelined_conns_) {
+    tcp_shutdown(pipelined_conn->conn, SHUT_RDWR);
+    pipelined_conn->receiver.Join();
+    tcp_close(pipelined_conn->conn);
+  }
+
   helpers::tcp_write_until(remote_master_, &kOpShutdown, kOpcodeSize);
   uint8_t ack;
   helpers::tcp_read_until(remote_master_, &ack, sizeof(ack));
@@ -103,6 +176,48 @@ void TCPDevice::read_object(uint8_t ds_id, uint8_t obj_id_len,
   shared_pool_.push(remote_slave);
 }
 
+void TCPDevice::read_object_async(uint8_t ds_id, uint8_t obj_id_len,
+                                  const uint8_t *obj_id, uint16_t *data_len,
+                                  uint8_t *data_buf, IOCompletion completion) {
+  auto &pipelined_conn =
+      *pipelined_conns_[next_pipelined_conn_++ % kNumPipelinedConnections];
+  uint8_t req[kOpcodeSize + Object::kDSIDSize + Object::kIDLenSize +
+              Object::kMaxObjectIDSize];
+  auto req_len = fill_read_object_req(req, ds_id, obj_id_len, obj_id);
+
+  rt::ScopedLock<rt::Mutex> lock(&pipelined_conn.send_mutex);
+  {
+    rt::ScopedLock<rt::Mutex> lock(&pipelined_conn.pending_mutex);
+    pipelined_conn.pending.push_back({.data_len = data_len,
+                                      .data_buf = data_buf,
+                                      .completion = completion});
+  }
+  helpers::tcp_write_until(pipelined_conn.conn, req, req_len);
+}
+
+void TCPDevice::receive_fn(PipelinedConnection *pipelined_conn) {
+  auto *conn = pipelined_conn->conn;
+  uint16_t data_len;
+  while (helpers::tcp_try_read_until(conn, &data_len, sizeof(data_len))) {
+    PendingRead read;
+    {
+      rt::ScopedLock<rt::Mutex> lock(&pipelined_conn->pending_mutex);
+      BUG_ON(pipelined_conn->pending.empty());
+      read = pipelined_conn->pending.front();
+      pipelined_conn->pending.pop_front();
+    }
+    *read.data_len = data_len;
+    if (data_len) {
+      BUG_ON(!helpers::tcp_try_read_until(conn, read.data_buf, data_len));
+    }
+    read.completion.fn(read.completion.arg);
+  }
+  // Either shut down by the destructor, which waits for all the requests, or
+  // the server is gone.
+  rt::ScopedLock<rt::Mutex> lock(&pipelined_conn->pending_mutex);
+  BUG_ON(!pipelined_conn->pending.empty());
+}
+
 void TCPDevice::write_object(uint8_t ds_id, uint8_t obj_id_len,
                              const uint8_t *obj_id, uint16_t data_len,
                              const uint8_t *data_buf) {
@@ -133,6 +248,23 @@ void TCPDevice::destruct(uint8_t ds_id) {
   shared_pool_.push(remote_slave);
 }
 
+uint8_t TCPDevice::attach(uint8_t ds_type, uint8_t ds_id, uint8_t name_len,
+                          const uint8_t *name, uint8_t param_len,
+                          uint8_t *params, uint8_t *meta_len, uint8_t *meta) {
+  auto remote_slave = shared_pool_.pop();
+  auto ret = _attach(remote_slave, ds_type, ds_id, name_len, name, param_len,
+                     params, meta_len, meta);
+  shared_pool_.push(remote_slave);
+
+  return ret;
+}
+
+void TCPDevice::detach(uint8_t ds_id, uint8_t meta_len, const uint8_t *meta) {
+  auto remote_slave = shared_pool_.pop();
+  _detach(remote_slave, ds_id, meta_len, meta);
+  shared_pool_.push(remote_slave);
+}
+
 void TCPDevice::compute(uint8_t ds_id, uint8_t opcode, uint16_t input_len,
                         const uint8_t *input_buf, uint16_t *output_len,
                         uint8_t *output_buf) {
@@ -146,24 +278,27 @@ void TCPDevice::compute(uint8_t ds_id, uint8_t opcode, uint16_t input_len,
 // |Opcode = KOpReadObject(1B) | ds_id(1B) | obj_id_len(1B) | obj_id |
 // Response:
 // |data_len(2B)|data_buf(data_len B)|
-void TCPDevice::_read_object(tcpconn_t *remote_slave, uint8_t ds_id,
-                             uint8_t obj_id_len, const uint8_t *obj_id,
-                             uint16_t *data_len, uint8_t *data_buf) {
-  Stats::start_measure_read_object_cycles();
-  
-  uint8_t req[kOpcodeSize + Object::kDSIDSize + Object::kIDLenSize +
-              Object::kMaxObjectIDSize];
-
+uint32_t TCPDevice::fill_read_object_req(uint8_t *req, uint8_t ds_id,
+                                         uint8_t obj_id_len,
+                                         const uint8_t *obj_id) {
   __builtin_memcpy(&req[0], &kOpReadObject, sizeof(kOpReadObject));
   __builtin_memcpy(&req[kOpcodeSize], &ds_id, Object::kDSIDSize);
   __builtin_memcpy(&req[kOpcodeSize + Object::kDSIDSize], &obj_id_len,
                    Object::kIDLenSize);
   memcpy(&req[kOpcodeSize + Object::kDSIDSize + Object::kIDLenSize], obj_id,
          obj_id_len);
+  return kOpcodeSize + Object::kDSIDSize + Object::kIDLenSize + obj_id_len;
+}
 
-  helpers::tcp_write_until(remote_slave, req,
-                           kOpcodeSize + Object::kDSIDSize +
-                               Object::kIDLenSize + obj_id_len);
+void TCPDevice::_read_object(tcpconn_t *remote_slave, uint8_t ds_id,
+                             uint8_t obj_id_len, const uint8_t *obj_id,
+                             uint16_t *data_len, uint8_t *data_buf) {
+  Stats::start_measure_read_object_cycles();
+  
+  uint8_t req[kOpcodeSize + Object::kDSIDSize + Object::kIDLenSize +
+              Object::kMaxObjectIDSize];
+  auto req_len = fill_read_object_req(req, ds_id, obj_id_len, obj_id);
+  helpers::tcp_write_until(remote_slave, req, req_len);
 
   helpers::tcp_read_until(remote_slave, data_len, sizeof(*data_len));
   if (*data_len) {
@@ -249,7 +384,7 @@ bool TCPDevice::_remove_object(tcpconn_t *remote_slave, uint64_t ds_id,
 // |Opcode = kOpConstruct (1B)|ds_type(1B)|ds_id(1B)|
 // |param_len(1B)|params(param_len B)|
 // Response:
-// |Ack (1B)|
+// |ok (1B)|
 void TCPDevice::_construct(tcpconn_t *remote_slave, uint8_t ds_type,
                            uint8_t ds_id, uint8_t param_len, uint8_t *params) {
   uint8_t req[kOpcodeSize + sizeof(ds_type) + Object::kDSIDSize +
@@ -270,14 +405,15 @@ void TCPDevice::_construct(tcpconn_t *remote_slave, uint8_t ds_type,
                            kOpcodeSize + sizeof(ds_type) + Object::kDSIDSize +
                                sizeof(param_len) + param_len);
 
-  uint8_t ack;
-  helpers::tcp_read_until(remote_slave, &ack, sizeof(ack));
+  bool ok;
+  helpers::tcp_read_until(remote_slave, &ok, sizeof(ok));
+  BUG_ON(!ok);
 }
 
 // Request:
 // |Opcode = kOpDeconstruct (1B)|ds_id(1B)|
 // Response:
-// |Ack (1B)|
+// |ok (1B)|
 void TCPDevice::_destruct(tcpconn_t *remote_slave, uint8_t ds_id) {
   uint8_t req[kOpcodeSize + Object::kDSIDSize];
 
@@ -286,8 +422,70 @@ void TCPDevice::_destruct(tcpconn_t *remote_slave, uint8_t ds_id) {
 
   helpers::tcp_write_until(remote_slave, req, kOpcodeSize + Object::kDSIDSize);
 
-  uint8_t ack;
-  helpers::tcp_read_until(remote_slave, &ack, sizeof(ack));
+  bool ok;
+  helpers::tcp_read_until(remote_slave, &ok, sizeof(ok));
+  BUG_ON(!ok);
+}
+
+// Request:
+// |Opcode = kOpAttach (1B)|ds_type(1B)|ds_id(1B)|name_len(1B)|param_len(1B)|
+// |name(name_len B)|params(param_len B)|
+// Response:
+// |status (1B)|meta_len(1B)|meta(meta_len B)|
+uint8_t TCPDevice::_attach(tcpconn_t *remote_slave, uint8_t ds_type,
+                           uint8_t ds_id, uint8_t name_len, const uint8_t *name,
+                           uint8_t param_len, uint8_t *params,
+                           uint8_t *meta_len, uint8_t *meta) {
+  constexpr auto kHeaderSize = kOpcodeSize + sizeof(ds_type) +
+                               Object::kDSIDSize + sizeof(name_len) +
+                               sizeof(param_len);
+  uint8_t req[kHeaderSize + 2 * std::numeric_limits<uint8_t>::max()];
+
+  __builtin_memcpy(&req[0], &kOpAttach, sizeof(kOpAttach));
+  __builtin_memcpy(&req[kOpcodeSize], &ds_type, sizeof(ds_type));
+  __builtin_memcpy(&req[kOpcodeSize + sizeof(ds_type)], &ds_id,
+                   Object::kDSIDSize);
+  __builtin_memcpy(&req[kOpcodeSize + sizeof(ds_type) + Object::kDSIDSize],
+                   &name_len, sizeof(name_len));
+  __builtin_memcpy(&req[kOpcodeSize + sizeof(ds_type) + Object::kDSIDSize +
+                        sizeof(name_len)],
+                   &param_len, sizeof(param_len));
+  memcpy(&req[kHeaderSize], name, name_len);
+  memcpy(&req[kHeaderSize + name_len], params, param_len);
+  helpers::tcp_write_until(remote_slave, req,
+                           kHeaderSize + name_len + param_len);
+
+  uint8_t status;
+  helpers::tcp_read_until(remote_slave, &status, sizeof(status));
+  helpers::tcp_read_until(remote_slave, meta_len, sizeof(*meta_len));
+  if (*meta_len) {
+    helpers::tcp_read_until(remote_slave, meta, *meta_len);
+  }
+  return status;
+}
+
+// Request:
+// |Opcode = kOpDetach (1B)|ds_id(1B)|meta_len(1B)|meta(meta_len B)|
+// Response:
+// |ok (1B)|
+void TCPDevice::_detach(tcpconn_t *remote_slave, uint8_t ds_id,
+                        uint8_t meta_len, const uint8_t *meta) {
+  uint8_t req[kOpcodeSize + Object::kDSIDSize + sizeof(meta_len) +
+              std::numeric_limits<decltype(meta_len)>::max()];
+
+  __builtin_memcpy(&req[0], &kOpDetach, sizeof(kOpDetach));
+  __builtin_memcpy(&req[kOpcodeSize], &ds_id, Object::kDSIDSize);
+  __builtin_memcpy(&req[kOpcodeSize + Object::kDSIDSize], &meta_len,
+                   sizeof(meta_len));
+  memcpy(&req[kOpcodeSize + Object::kDSIDSize + sizeof(meta_len)], meta,
+         meta_len);
+  helpers::tcp_write_until(remote_slave, req,
+                           kOpcodeSize + Object::kDSIDSize + sizeof(meta_len) +
+                               meta_len);
+
+  bool ok;
+  helpers::tcp_read_until(remote_slave, &ok, sizeof(ok));
+  BUG_ON(!ok);
 }
 
 // Request:
@@ -0,0 +1,51 @@
+#include "epoch.hpp"
+
+namespace far_memory {
+
+EpochReclaimer::EpochReclaimer(Slab *slab) : slab_(slab) {}
+
+EpochReclaimer::~EpochReclaimer() {
+  for (auto &state : core_states_) {
+    BUG_ON(state.nesting);
+    for (auto &retired : state.limbo) {
+      slab_->free(retired.ptr, retired.size);
+    }
+  }
+}
+
+bool EpochReclaimer::try_advance() {
+  auto epoch = global_epoch_.load(std::memory_order_acquire);
+  for (auto &state : core_states_) {
+    auto core_epoch = state.epoch.load(std::memory_order_acquire);
+    if (core_epoch != kQuiescent && core_epoch != epoch) {
+      return false;
+    }
+  }
+  return global_epoch_.compare_exchange_strong(epoch, epoch + 1);
+}
+
+void EpochReclaimer::reclaim(CoreState *state) {
+  // A core may lag one epoch behind the global one, so anything retired two
+  // epochs ago is unreachable.
+  auto epoch = global_epoch_.load(std::memory_order_acquire);
+  while (!state->limbo.empty() && state->limbo.front().epoch + 2 <= epoch) {
+    auto &retired = state->limbo.front();
+    slab_->free(retired.ptr, retired.size);
+    state->limbo.pop_front();
+  }
+}
+
+void EpochReclaimer::retire(uint8_t *ptr, uint32_t size) {
+  assert(is_in_critical_section());
+  auto &state = core_states_[get_core_num()];
+  state.limbo.push_back(
+      Retired{.ptr = ptr,
+              .size = size,
+              .epoch = global_epoch_.load(std::memory_order_acquire)});
+  if (++state.num_retires % kNumRetiresPerAdvance == 0) {
+    try_advance();
+    reclaim(&state);
+  }
+}
+
+} // namespace far_memory
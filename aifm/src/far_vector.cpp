@@ -0,0 +1,247 @@
+#include "far_vector.hpp"
+#include "internal/ds_info.hpp"
+#include "manager.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace far_memory {
+
+GenericFarVector::GenericFarVector(uint32_t chunk_size,
+                                   uint32_t chunk_num_entries, uint8_t ds_id,
+                                   bool offloaded)
+    : chunk_size_(chunk_size), chunk_num_entries_(chunk_num_entries),
+      item_size_(chunk_size / chunk_num_entries),
+      device_(FarMemManagerFactory::get()->get_device()), ds_id_(ds_id),
+      offloaded_(offloaded) {
+  if (offloaded_) {
+    uint32_t params[] = {item_size_, chunk_num_entries_};
+    FarMemManagerFactory::get()->construct(kFarVectorDSType, ds_id_,
+                                           sizeof(params),
+                                           reinterpret_cast<uint8_t *>(params));
+  }
+  // Like DataFrameVector, it essentially stores a std::vector of
+  // GenericUniquePtrs, so it does not need a notifier.
+}
+
+GenericFarVector::~GenericFarVector() { cleanup(); }
+
+void GenericFarVector::cleanup() {
+  auto writer_lock = lock_.get_writer_lock();
+  if (offloaded_ && !moved_) {
+    FarMemManagerFactory::get()->destruct(ds_id_);
+  }
+  free_chunks();
+}
+
+void GenericFarVector::free_chunks() {
+  parallel_for(chunk_ptrs_.size(), [&](uint64_t i) { chunk_ptrs_[i].free(); });
+  chunk_ptrs_.clear();
+}
+
+void GenericFarVector::reserve_remote(uint64_t num) {
+  if (!offloaded_ || num <= remote_capacity_) {
+    return;
+  }
+  // Grow geometrically so that a stream of appends only issues a logarithmic
+  // number of reserve requests.
+  num = std::max(num, remote_capacity_ * 2);
+  uint16_t output_len;
+  device_->compute(ds_id_, OpCode::Reserve, sizeof(num),
+                   reinterpret_cast<const uint8_t *>(&num), &output_len,
+                   reinterpret_cast<uint8_t *>(&remote_capacity_));
+  assert(output_len == sizeof(remote_capacity_));
+}
+
+void GenericFarVector::expand(uint64_t num) {
+  auto old_chunk_ptrs_size = chunk_ptrs_.size();
+  reserve_remote((old_chunk_ptrs_size + num) * chunk_num_entries_);
+  auto writer_lock = lock_.get_writer_lock();
+  chunk_ptrs_.resize(old_chunk_ptrs_size + num);
+
+  auto *manager = FarMemManagerFactory::get();
+  parallel_for(num, [&](uint64_t i) {
+    uint64_t obj_id = i + old_chunk_ptrs_size;
+    auto *new_chunk_ptr = &chunk_ptrs_[obj_id];
+    // Vanilla chunks get their remote objects from the manager instead.
+    while (unlikely(offloaded_ ? !manager->allocate_generic_unique_ptr_nb(
+                                     new_chunk_ptr, ds_id_, chunk_size_,
+                                     sizeof(obj_id),
+                                     reinterpret_cast<uint8_t *>(&obj_id))
+                               : !manager->allocate_generic_unique_ptr_nb(
+                                     new_chunk_ptr, ds_id_, chunk_size_))) {
+      manager->mutator_wait_for_gc_cache();
+    }
+  });
+}
+
+void GenericFarVector::expand_no_alloc(uint64_t num) {
+  assert(offloaded_);
+  auto old_chunk_ptrs_size = chunk_ptrs_.size();
+  auto writer_lock = lock_.get_writer_lock();
+  chunk_ptrs_.resize(old_chunk_ptrs_size + num);
+
+  const auto obj_size = Object::kHeaderSize + chunk_size_ + sizeof(uint64_t);
+  for (uint64_t obj_id = old_chunk_ptrs_size; obj_id < chunk_ptrs_.size();
+       obj_id++) {
+    chunk_ptrs_[obj_id].meta().gc_wb(ds_id_, obj_size, obj_id);
+  }
+}
+
+void GenericFarVector::grow() {
+  // Doubles the capacity, but bounds the step since every new chunk occupies
+  // the local cache until it gets evicted.
+  uint64_t min_num = (kMinSizePerExpansion - 1) / chunk_size_ + 1;
+  uint64_t max_num = (kMaxSizePerExpansion - 1) / chunk_size_ + 1;
+  expand(std::clamp(static_cast<uint64_t>(chunk_ptrs_.size()), min_num,
+                    max_num));
+}
+
+void GenericFarVector::reserve(uint64_t count) {
+  if (count > capacity()) {
+    expand((count - capacity() - 1) / chunk_num_entries_ + 1);
+  }
+}
+
+void GenericFarVector::resize(uint64_t count) {
+  reserve(count);
+  size_ = count;
+}
+
+void GenericFarVector::swap_in_chunks(uint64_t begin, uint64_t end) {
+  std::vector<GenericUniquePtr *> missing_chunks;
+  for (auto i = begin; i < end; i++) {
+    if (!chunk_ptrs_[i].meta().is_present()) {
+      missing_chunks.push_back(&chunk_ptrs_[i]);
+    }
+  }
+  if (missing_chunks.size() <= 1) {
+    for (auto *chunk_ptr : missing_chunks) {
+      chunk_ptr->swap_in(/* nt = */ false);
+    }
+    return;
+  }
+
+  // Keep multiple device reads in flight.
+  parallel_for(missing_chunks.size(), [&](uint64_t i) {
+    missing_chunks[i]->swap_in(/* nt = */ false);
+  });
+}
+
+void GenericFarVector::read_range(uint64_t begin, uint64_t num, uint8_t *out) {
+  assert(!DerefScope::is_in_deref_scope());
+  assert(begin + num <= size_);
+  auto end = begin + num;
+  while (begin < end) {
+    auto chunk_begin = begin / chunk_num_entries_;
+    auto chunk_end = std::min((end - 1) / chunk_num_entries_ + 1,
+                              chunk_begin + kNumChunksPerRangeBatch);
+    // Fetch all missing chunks of the batch concurrently before copying.
+    swap_in_chunks(chunk_begin, chunk_end);
+    DerefScope scope;
+    for (auto chunk_idx = chunk_begin; chunk_idx < chunk_end; chunk_idx++) {
+      auto chunk_offset = begin % chunk_num_entries_;
+      auto len = std::min(end - begin, chunk_num_entries_ - chunk_offset);
+      auto *raw_ptr = chunk_ptrs_[chunk_idx].deref(scope);
+      memcpy(out,
+             reinterpret_cast<const uint8_t *>(raw_ptr) +
+                 chunk_offset * item_size_,
+             len * item_size_);
+      out += len * item_size_;
+      begin += len;
+      scope.renew();
+    }
+  }
+}
+
+void GenericFarVector::write_range(uint64_t begin, uint64_t num,
+                                   const uint8_t *in) {
+  assert(!DerefScope::is_in_deref_scope());
+  assert(begin + num <= size_);
+  auto end = begin + num;
+  while (begin < end) {
+    auto chunk_begin = begin / chunk_num_entries_;
+    auto chunk_end = std::min((end - 1) / chunk_num_entries_ + 1,
+                              chunk_begin + kNumChunksPerRangeBatch);
+    swap_in_chunks(chunk_begin, chunk_end);
+    DerefScope scope;
+    for (auto chunk_idx = chunk_begin; chunk_idx < chunk_end; chunk_idx++) {
+      auto chunk_offset = begin % chunk_num_entries_;
+      auto len = std::min(end - begin, chunk_num_entries_ - chunk_offset);
+      auto *raw_mut_ptr = chunk_ptrs_[chunk_idx].deref_mut(scope);
+      memcpy(reinterpret_cast<uint8_t *>(raw_mut_ptr) +
+                 chunk_offset * item_size_,
+             in, len * item_size_);
+      in += len * item_size_;
+      begin += len;
+      scope.renew();
+    }
+  }
+  dirty_ = true;
+}
+
+void GenericFarVector::assign(GenericFarVector *other, uint64_t begin,
+                              uint64_t end) {
+  assert(!DerefScope::is_in_deref_scope());
+  assert(begin <= end && end <= other->size_);
+  assert(item_size_ == other->item_size_);
+  if (offloaded_ && other->offloaded_) {
+    assign_remotely(other, begin, end);
+  } else {
+    assign_locally(other, begin, end);
+  }
+}
+
+void GenericFarVector::assign_locally(GenericFarVector *other, uint64_t begin,
+                                      uint64_t end) {
+  auto num = end - begin;
+  if (num > size_) {
+    resize(num);
+  }
+  auto batch_num = kNumChunksPerRangeBatch * chunk_num_entries_;
+  std::unique_ptr<uint8_t[]> buf(new uint8_t[batch_num * item_size_]);
+  // Copying forward also works when other is this, as the destination never
+  // runs ahead of the source.
+  for (uint64_t i = 0; i < num; i += batch_num) {
+    auto len = std::min(batch_num, num - i);
+    other->read_range(begin + i, len, buf.get());
+    write_range(i, len, buf.get());
+  }
+  size_ = num;
+}
+
+void GenericFarVector::assign_remotely(GenericFarVector *other, uint64_t begin,
+                                       uint64_t end) {
+  // The server reads other's remote copy.
+  other->flush();
+  uint8_t input_data[sizeof(ds_id_) + sizeof(begin) + sizeof(end)];
+  __builtin_memcpy(input_data, &other->ds_id_, sizeof(ds_id_));
+  __builtin_memcpy(input_data + sizeof(ds_id_), &begin, sizeof(begin));
+  __builtin_memcpy(input_data + sizeof(ds_id_) + sizeof(begin), &end,
+                   sizeof(end));
+  {
+    // The cached chunks are stale once the server overwrites the data.
+    auto writer_lock = lock_.get_writer_lock();
+    free_chunks();
+  }
+  uint16_t output_len;
+  device_->compute(ds_id_, OpCode::Assign, sizeof(input_data), input_data,
+                   &output_len,
+                   reinterpret_cast<uint8_t *>(&remote_capacity_));
+  assert(output_len == sizeof(remote_capacity_));
+  size_ = end - begin;
+  dirty_ = false;
+  // The chunks are then swapped in from the server on demand.
+  expand_no_alloc(remote_capacity_ / chunk_num_entries_);
+}
+
+void GenericFarVector::flush() {
+  if (!dirty_) {
+    return;
+  }
+  dirty_ = false;
+  parallel_for(chunk_ptrs_.size(),
+               [&](uint64_t i) { chunk_ptrs_[i].flush(); });
+}
+
+} // namespace far_memory
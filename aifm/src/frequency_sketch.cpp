@@ -0,0 +1,38 @@
+#include "frequency_sketch.hpp"
+
+namespace far_memory {
+
+FrequencySketch::FrequencySketch(uint32_t width) {
+  width_shift_ = 1;
+  while ((1ULL << width_shift_) < width) {
+    width_shift_++;
+  }
+  num_counters_ = static_cast<uint64_t>(kNumRows) << width_shift_;
+  counters_.reset(new uint8_t[num_counters_]());
+  sample_size_ = kSampleSizeFactor << width_shift_;
+  aging_cursor_.store(num_counters_, std::memory_order_relaxed);
+}
+
+void FrequencySketch::start_aging(uint64_t num_records) {
+  // Only the record that wins the reset starts the new aging pass.
+  if (num_records_.compare_exchange_strong(num_records, 0,
+                                           std::memory_order_relaxed)) {
+    aging_cursor_.store(0, std::memory_order_relaxed);
+  }
+}
+
+void FrequencySketch::age_step() {
+  static_assert(kNumCountersPerAgingStep % sizeof(uint64_t) == 0);
+  auto begin = aging_cursor_.fetch_add(kNumCountersPerAgingStep,
+                                       std::memory_order_relaxed);
+  auto end = std::min(begin + kNumCountersPerAgingStep, num_counters_);
+  // Halve eight counters per word; the mask drops the bit that each counter
+  // would otherwise shift into its lower neighbour.
+  for (auto i = begin; i < end; i += sizeof(uint64_t)) {
+    auto *word = reinterpret_cast<uint64_t *>(&counters_[i]);
+    auto val = ACCESS_ONCE(*word);
+    ACCESS_ONCE(*word) = (val >> 1) & 0x7F7F7F7F7F7F7F7FULL;
+  }
+}
+
+} // namespace far_memory
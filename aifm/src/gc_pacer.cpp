@@ -0,0 +1,138 @@
+extern "C" {
+#include <runtime/timer.h>
+}
+
+#include "gc_pacer.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace far_memory {
+
+GCPacer::GCPacer(uint32_t num_regions, uint32_t max_num_gc_threads,
+                 double almost_empty_thresh, double low_thresh,
+                 double high_thresh, double min_ratio_per_round)
+    : num_regions_(num_regions), max_num_gc_threads_(max_num_gc_threads),
+      almost_empty_thresh_(almost_empty_thresh),
+      static_low_thresh_(low_thresh), static_high_thresh_(high_thresh),
+      min_ratio_per_round_(min_ratio_per_round),
+      sample_interval_(std::max(num_regions / kNumSamplesPerCache, 1U)),
+      low_thresh_(low_thresh), high_thresh_(high_thresh) {
+  BUG_ON(!num_regions_ || !max_num_gc_threads_);
+}
+
+void GCPacer::sample(uint64_t now_us) {
+  auto num_allocated_regions =
+      num_allocated_regions_.load(std::memory_order_relaxed);
+  if (unlikely(now_us == last_sample_us_)) {
+    return;
+  }
+  if (likely(last_sample_us_)) {
+    auto rate =
+        static_cast<double>(num_allocated_regions -
+                            last_num_allocated_regions_) /
+        (now_us - last_sample_us_);
+    ACCESS_ONCE(alloc_rate_) =
+        kEWMAWeight * rate + (1 - kEWMAWeight) * alloc_rate_;
+    update_thresholds();
+  }
+  last_num_allocated_regions_ = num_allocated_regions;
+  ACCESS_ONCE(last_sample_us_) = now_us;
+}
+
+void GCPacer::update_thresholds() {
+  auto reclaim_rate_per_thread = ACCESS_ONCE(reclaim_rate_per_thread_);
+  if (unlikely(!adaptive_ || !reclaim_rate_per_thread)) {
+    return;
+  }
+  // The duration of the smallest round with all the GC threads, and the free
+  // regions the mutators consume meanwhile.
+  auto round_us = min_ratio_per_round_ * num_regions_ /
+                  (reclaim_rate_per_thread * max_num_gc_threads_);
+  auto headroom = kSafetyFactor * ACCESS_ONCE(alloc_rate_) * round_us /
+                  num_regions_;
+  auto low_thresh = std::clamp(almost_empty_thresh_ + headroom, kMinLowThresh,
+                               kMaxLowThresh);
+  auto high_thresh =
+      low_thresh + std::clamp(headroom, min_ratio_per_round_,
+                              static_high_thresh_ - static_low_thresh_);
+  ACCESS_ONCE(low_thresh_) = low_thresh;
+  ACCESS_ONCE(high_thresh_) = high_thresh;
+}
+
+void GCPacer::on_gc_round_start(double free_ratio) {
+  round_start_us_ = microtime();
+  round_start_free_ratio_ = free_ratio;
+  stats_.num_rounds++;
+  stats_.num_early_rounds += (free_ratio > static_low_thresh_);
+}
+
+void GCPacer::on_gc_round_end(uint32_t num_regions, uint32_t num_gc_threads) {
+  auto round_us = microtime() - round_start_us_;
+  if (unlikely(!num_regions || !round_us)) {
+    return;
+  }
+  auto rate = static_cast<double>(num_regions) / round_us / num_gc_threads;
+  auto reclaim_rate_per_thread = ACCESS_ONCE(reclaim_rate_per_thread_);
+  ACCESS_ONCE(reclaim_rate_per_thread_) =
+      reclaim_rate_per_thread
+          ? kEWMAWeight * rate + (1 - kEWMAWeight) * reclaim_rate_per_thread
+          : rate;
+
+  // Had the round started at the static low threshold instead, the mutators
+  // would have stalled for whatever part of it outlasted the drain of the
+  // free regions down to the almost-empty threshold.
+  auto alloc_rate = ACCESS_ONCE(alloc_rate_);
+  if (round_start_free_ratio_ > static_low_thresh_ && alloc_rate) {
+    auto drain_us =
+        (static_low_thresh_ - almost_empty_thresh_) * num_regions_ / alloc_rate;
+    if (round_us > drain_us) {
+      stats_.avoided_stall_us += round_us - drain_us;
+    }
+  }
+
+  sample_spin_.Lock();
+  update_thresholds();
+  sample_spin_.Unlock();
+}
+
+void GCPacer::set_adaptive(bool adaptive) {
+  sample_spin_.Lock();
+  adaptive_ = adaptive;
+  if (adaptive_) {
+    update_thresholds();
+  } else {
+    ACCESS_ONCE(low_thresh_) = static_low_thresh_;
+    ACCESS_ONCE(high_thresh_) = static_high_thresh_;
+  }
+  sample_spin_.Unlock();
+}
+
+double GCPacer::get_ratio_per_round(double free_ratio,
+                                    double max_ratio) const {
+  return std::max(min_ratio_per_round_,
+                  std::min(max_ratio, get_high_thresh() - free_ratio));
+}
+
+uint32_t GCPacer::get_num_gc_threads(double free_ratio,
+                                     uint32_t num_regions) const {
+  auto alloc_rate = ACCESS_ONCE(alloc_rate_);
+  auto reclaim_rate_per_thread = ACCESS_ONCE(reclaim_rate_per_thread_);
+  if (!reclaim_rate_per_thread || free_ratio <= almost_empty_thresh_) {
+    return max_num_gc_threads_;
+  }
+  if (!alloc_rate) {
+    return 1;
+  }
+  // Finish the round within 1 / kSafetyFactor of the time left before the
+  // cache is almost empty.
+  auto budget_us =
+      (free_ratio - almost_empty_thresh_) * num_regions_ / alloc_rate;
+  auto num_threads = std::ceil(kSafetyFactor * num_regions /
+                               (reclaim_rate_per_thread * budget_us));
+  return std::clamp(static_cast<uint32_t>(std::min(
+                        num_threads, static_cast<double>(max_num_gc_threads_))),
+                    1U, max_num_gc_threads_);
+}
+
+} // namespace far_memory
@@ -0,0 +1,153 @@
+extern "C" {
+#include <runtime/preempt.h>
+#include <runtime/thread.h>
+#include <runtime/timer.h>
+}
+
+#include "io_scheduler.hpp"
+
+#include <algorithm>
+
+namespace far_memory {
+
+IOScheduler::IOScheduler(uint32_t num_slots)
+    : num_free_slots_(num_slots),
+      num_reserved_slots_(std::max(1U, num_slots / 8)) {
+  BUG_ON(num_slots <= num_reserved_slots_);
+}
+
+bool IOScheduler::has_free_slot(IOClass io_class,
+                                uint32_t num_free_slots) const {
+  return io_class == kIOWriteBack ? num_free_slots
+                                  : num_free_slots > num_reserved_slots_;
+}
+
+bool IOScheduler::try_take_slot(IOClass io_class) {
+  auto num_free_slots = num_free_slots_.load(std::memory_order_relaxed);
+  do {
+    if (!has_free_slot(io_class, num_free_slots)) {
+      return false;
+    }
+  } while (!num_free_slots_.compare_exchange_weak(num_free_slots,
+                                                  num_free_slots - 1));
+  return true;
+}
+
+IOScheduler::CoreStats &IOScheduler::get_core_stats() {
+  return core_stats_[get_core_num()];
+}
+
+bool IOScheduler::grant(IOClass io_class) {
+  auto &queue = queues_[io_class];
+  auto *waiter = queue.front();
+  if (io_class == kIOPrefetch &&
+      microtime() - waiter->enqueue_us > kPrefetchStaleUs) {
+    waiter->cancelled = true;
+    stats_[io_class].num_cancelled++;
+  } else if (try_take_slot(io_class)) {
+    waiter->granted = true;
+    if (kWeights[io_class]) {
+      passes_[io_class] += kStrideBase / kWeights[io_class];
+      global_pass_ = passes_[io_class];
+    }
+  } else {
+    // Taken by a fast-path acquire() that raced with the enqueue.
+    return false;
+  }
+  queue.pop_front();
+  num_waiters_--;
+  waiter->cv.Signal();
+  return true;
+}
+
+void IOScheduler::dispatch() {
+  while (true) {
+    auto num_free_slots = num_free_slots_.load();
+    if (!num_free_slots) {
+      break;
+    }
+    bool can_read = has_free_slot(kIODemand, num_free_slots);
+    auto &write_backs = queues_[kIOWriteBack];
+    auto &prefetches = queues_[kIOPrefetch];
+    if (can_read && !queues_[kIODemand].empty()) {
+      grant(kIODemand);
+    } else if (!write_backs.empty() &&
+               (!can_read || prefetches.empty() || memory_pressure_ ||
+                passes_[kIOWriteBack] <= passes_[kIOPrefetch])) {
+      grant(kIOWriteBack);
+    } else if (can_read && !prefetches.empty()) {
+      grant(kIOPrefetch);
+    } else {
+      break;
+    }
+  }
+}
+
+bool IOScheduler::acquire(IOClass io_class) {
+  if (likely(!num_waiters_.load() && try_take_slot(io_class))) {
+    preempt_disable();
+    get_core_stats().num_ops[io_class]++;
+    preempt_enable();
+    return true;
+  }
+
+  rt::ScopedLock<rt::Mutex> lock(&mutex_);
+  Waiter waiter;
+  waiter.enqueue_us = microtime();
+  waiter.granted = waiter.cancelled = false;
+  auto &queue = queues_[io_class];
+  if (queue.empty()) {
+    // Do not let a class that has been idle for a while claim the slots it
+    // did not use.
+    passes_[io_class] = std::max(passes_[io_class], global_pass_);
+  }
+  // Pairs with release(): either it sees the waiter, or dispatch() sees the
+  // slot it freed.
+  num_waiters_++;
+  queue.push_back(&waiter);
+  dispatch();
+  while (!waiter.granted && !waiter.cancelled) {
+    waiter.cv.Wait(&mutex_);
+  }
+
+  auto &stats = stats_[io_class];
+  auto wait_us = microtime() - waiter.enqueue_us;
+  stats.total_wait_us += wait_us;
+  stats.max_wait_us = std::max(stats.max_wait_us, wait_us);
+  if (waiter.cancelled) {
+    return false;
+  }
+  stats.num_ops++;
+  return true;
+}
+
+void IOScheduler::release(IOClass io_class, uint64_t num_bytes) {
+  preempt_disable();
+  get_core_stats().num_bytes[io_class] += num_bytes;
+  preempt_enable();
+  num_free_slots_++;
+  if (unlikely(num_waiters_.load())) {
+    rt::ScopedLock<rt::Mutex> lock(&mutex_);
+    dispatch();
+  }
+}
+
+void IOScheduler::set_memory_pressure(bool memory_pressure) {
+  if (ACCESS_ONCE(memory_pressure_) == memory_pressure) {
+    return;
+  }
+  rt::ScopedLock<rt::Mutex> lock(&mutex_);
+  memory_pressure_ = memory_pressure;
+}
+
+IOScheduler::Stats IOScheduler::get_stats(IOClass io_class) {
+  rt::ScopedLock<rt::Mutex> lock(&mutex_);
+  auto stats = stats_[io_class];
+  FOR_ALL_SOCKET0_CORES(i) {
+    stats.num_ops += ACCESS_ONCE(core_stats_[i].num_ops[io_class]);
+    stats.num_bytes += ACCESS_ONCE(core_stats_[i].num_bytes[io_class]);
+  }
+  return stats;
+}
+
+} // namespace far_memory
@@ -7,6 +7,8 @@ extern "C" {
 #include "list.hpp"
 #include "manager.hpp"
 
+#include <algorithm>
+
 namespace far_memory {
 
 GenericList::GenericList(const DerefScope &scope, const uint16_t kItemSize,
@@ -23,7 +25,9 @@ GenericList::GenericList(const DerefScope &scope, const uint16_t kItemSize,
       kPrefetchNumNodes_(
           FarMemManagerFactory::get()->get_device()->get_prefetch_win_size() /
           kChunkSize_),
-      enable_merge_(enable_merge), customized_split_(customized_split) {
+      enable_merge_(enable_merge), customized_split_(customized_split),
+      prefetch_window_(std::clamp(kPrefetchNumNodes_, static_cast<uint32_t>(1),
+                                  kMaxPrefetchNumNodes)) {
   local_list_.push_back(LocalNode());
   local_list_.push_back(LocalNode());
   init_local_node(scope, &local_list_.front());
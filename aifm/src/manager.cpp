@@ -12,6 +12,7 @@ extern "C" {
 
 #include "deref_scope.hpp"
 #include "manager.hpp"
+#include "prefetch_service.hpp"
 
 #include <algorithm>
 #include <cassert>
@@ -51,7 +52,11 @@ void GCParallelizer::master_fn() {
 FarMemManager::FarMemManager(uint64_t cache_size, uint64_t far_mem_size,
                              uint32_t num_gc_threads, FarMemDevice *device)
     : cache_region_manager_(cache_size, true),
-      far_mem_region_manager_(far_mem_size, false), device_ptr_(device),
+      far_mem_region_manager_(far_mem_size, false),
+      gc_pacer_(cache_region_manager_.get_num_regions(), num_gc_threads,
+                kFreeCacheAlmostEmptyThresh, kFreeCacheLowThresh,
+                kFreeCacheHighThresh, kMinRatioRegionsPerGCRound),
+      num_active_gc_threads_(num_gc_threads), device_ptr_(device),
       parallel_marker_(num_gc_threads, kGCSlaveThreadTaskQueueDepth,
                        &from_regions_),
       parallel_write_backer_(num_gc_threads, kGCSlaveThreadTaskQueueDepth,
@@ -65,6 +70,8 @@ FarMemManager::FarMemManager(uint64_t cache_size, uint64_t far_mem_size,
     LOG_PRINTF("%s\n", "Warn: fail to open /dev/ksched.");
   }
   memset(evac_notifiers_, 0, sizeof(evac_notifiers_));
+  std::fill(std::begin(replacement_policies_), std::end(replacement_policies_),
+            kReplaceHotBit);
 
   for (uint8_t ds_id =
            std::numeric_limits<decltype(available_ds_ids_)::value_type>::min();
@@ -136,71 +143,175 @@ GenericUniquePtr FarMemManager::allocate_generic_unique_ptr(
 void FarMemManager::RegionManager::push_free_region(Region &region) {
   region_spin_.Lock();
   region.reset();
-  BUG_ON(!free_regions_.push_back(region));
+  if (unlikely(reserved_regions_.size() < num_reserved_regions_)) {
+    BUG_ON(!reserved_regions_.push_back(region));
+  } else {
+    BUG_ON(!free_regions_.push_back(region));
+  }
   region_spin_.Unlock();
 }
 
-std::optional<Region> FarMemManager::RegionManager::pop_used_region() {
-  Region region;
-  region_spin_.Lock();
+CircularBuffer<Region, false> &
+FarMemManager::RegionManager::local_used_regions(const Region &region) {
+  if (region.is_nt()) {
+    return nt_used_regions_;
+  }
+  auto gen = region.get_gen();
+  return gen == Region::kGenYoung ? used_regions_
+                                  : old_gen_used_regions_[gen - 1];
+}
+
+bool FarMemManager::RegionManager::pop_gcable_region(
+    CircularBuffer<Region, false> *used_regions, bool requeue_front,
+    Region *region) {
   int retry_times = 0;
-nt_retry:
-  bool success = nt_used_regions_.pop_front(&region);
-  if (unlikely(success && !region.is_gcable())) {
+retry:
+  bool success = used_regions->pop_front(region);
+  if (unlikely(success && !region->is_gcable())) {
     // This is very rare and can only happen when the device is
     // very slow and we only have very few available DRAM Region.
     success = false;
-    nt_used_regions_.push_back(region);
+    if (requeue_front) {
+      used_regions->push_front(*region);
+    } else {
+      used_regions->push_back(*region);
+    }
     if (retry_times++ <= kPickRegionMaxRetryTimes) {
-      goto nt_retry;
-    }
-  }
-  if (!success) {
-    retry_times = 0;
-  t_retry:
-    success = used_regions_.pop_front(&region);
-    if (unlikely(success && !region.is_gcable())) {
-      // Ditto.
-      success = false;
-      used_regions_.push_front(region);
-      if (retry_times++ <= kPickRegionMaxRetryTimes) {
-        goto t_retry;
-      }
+      goto retry;
     }
   }
+  return success;
+}
+
+std::optional<Region>
+FarMemManager::RegionManager::pop_used_region(uint8_t gen) {
+  Region region;
+  region_spin_.Lock();
+  bool success;
+  if (gen == Region::kGenYoung) {
+    success = pop_gcable_region(&nt_used_regions_, /* requeue_front = */ false,
+                                &region) ||
+              pop_gcable_region(&used_regions_, /* requeue_front = */ true,
+                                &region);
+  } else {
+    success = pop_gcable_region(&old_gen_used_regions_[gen - 1],
+                                /* requeue_front = */ true, &region);
+  }
   region_spin_.Unlock();
   return success ? std::make_optional(std::move(region)) : std::nullopt;
 }
 
+void FarMemManager::RegionManager::pop_dontneed_regions(
+    uint32_t max_num, std::vector<Region> *regions) {
+  region_spin_.Lock();
+  auto guard = helpers::finally([&] { region_spin_.Unlock(); });
+
+  for (auto *used_regions :
+       {&nt_used_regions_, &used_regions_, &old_gen_used_regions_[0],
+        &old_gen_used_regions_[1]}) {
+    // A full round keeps the order of the remaining regions.
+    auto size = used_regions->size();
+    for (uint32_t i = 0; i < size; i++) {
+      Region region;
+      BUG_ON(!used_regions->pop_front(&region));
+      if (region.is_dontneed() && region.is_gcable() &&
+          regions->size() < max_num) {
+        regions->push_back(std::move(region));
+      } else {
+        BUG_ON(!used_regions->push_back(region));
+      }
+    }
+  }
+}
+
 bool FarMemManager::RegionManager::try_refill_core_local_free_region(
-    bool nt, Region *full_region) {
+    bool nt, Region *full_region, bool use_reserve, uint8_t gen) {
   region_spin_.Lock();
   auto guard = helpers::finally([&] { region_spin_.Unlock(); });
 
   bool success = true;
   if (full_region) {
     if (!full_region->is_invalid()) {
-      success =
-          (full_region->is_local() &&
-           full_region
-               ->is_nt()) // is_nt() can only be called by the local region
-                          // since it uses the runtime's Region space.
-              ? nt_used_regions_.push_back(*full_region)
-              : used_regions_.push_back(*full_region);
+      // is_nt() and get_gen() can only be called by the local region since
+      // they use the runtime's Region space.
+      success = full_region->is_local()
+                    ? local_used_regions(*full_region).push_back(*full_region)
+                    : used_regions_.push_back(*full_region);
       BUG_ON(!success);
     }
   }
-  auto &core_local_region = core_local_free_region(nt);
+  auto &core_local_region = core_local_free_region(nt, gen);
   if (core_local_region.is_invalid()) {
     success = free_regions_.pop_front(&core_local_region);
+    if (unlikely(!success && use_reserve)) {
+      success = reserved_regions_.pop_front(&core_local_region);
+    }
     if (nt) {
       core_local_region.set_nt();
     }
+    if (success && gen != Region::kGenYoung) {
+      core_local_region.set_gen(gen);
+    }
   }
 
   return success;
 }
 
+uint32_t
+FarMemManager::RegionManager::reclaim_dead_regions(uint32_t max_num_scans) {
+  std::vector<Region> candidates;
+  region_spin_.Lock();
+  for (auto *used_regions :
+       {&nt_used_regions_, &used_regions_, &old_gen_used_regions_[0],
+        &old_gen_used_regions_[1]}) {
+    while (candidates.size() < max_num_scans) {
+      Region region;
+      if (!used_regions->pop_front(&region)) {
+        break;
+      }
+      candidates.push_back(std::move(region));
+    }
+  }
+  region_spin_.Unlock();
+
+  // Only the regions without any live object are recycled here. The live
+  // ones are left to direct_evict() and the GC.
+  uint32_t num_reclaimed = 0;
+  for (auto &region : candidates) {
+    if (is_dead(region)) {
+      push_free_region(region);
+      num_reclaimed++;
+    } else {
+      push_used_region(region);
+    }
+  }
+  return num_reclaimed;
+}
+
+void FarMemManager::RegionManager::push_used_region(Region &region) {
+  region_spin_.Lock();
+  BUG_ON(!local_used_regions(region).push_back(region));
+  region_spin_.Unlock();
+}
+
+bool FarMemManager::RegionManager::is_dead(const Region &region) {
+  if (!region.is_gcable()) {
+    return false;
+  }
+  for (uint8_t i = 0; i < region.get_num_boundaries(); i++) {
+    auto [left, right] = region.get_boundary(i);
+    auto cur = left;
+    while (cur + Object::kHeaderSize < right) {
+      auto obj = Object(cur);
+      if (!obj.is_freed() || obj.is_retired()) {
+        return false;
+      }
+      cur += helpers::align_to(obj.size(), sizeof(FarMemPtrMeta));
+    }
+  }
+  return true;
+}
+
 FarMemManager *
 FarMemManagerFactory::build(uint64_t cache_size,
                             std::optional<uint32_t> optional_num_gc_threads,
@@ -221,7 +332,11 @@ FarMemManagerFactory::build(uint64_t cache_size,
 
 FarMemManager::RegionManager::RegionManager(uint64_t size, bool is_local) {
   auto free_regions_count = ceil(size / static_cast<double>(Region::kSize));
-  if (free_regions_count <= 2 * helpers::kNumSocket1CPUs) {
+  // Each core owns a young and a non-temporal region, plus, in the local
+  // cache, one region per older generation for the GC to copy into.
+  auto num_core_local_regions =
+      (is_local ? 2 + (Region::kNumGens - 1) : 2) * helpers::kNumSocket1CPUs;
+  if (free_regions_count <= num_core_local_regions) {
     LOG_PRINTF("%s\n", "Error: two few available regions.");
     exit(-ENOSPC);
   }
@@ -229,11 +344,14 @@ FarMemManager::RegionManager::RegionManager(uint64_t size, bool is_local) {
   used_regions_ = std::move(CircularBuffer<Region, false>(free_regions_count));
   nt_used_regions_ =
       std::move(CircularBuffer<Region, false>(free_regions_count));
+  for (auto &used_regions : old_gen_used_regions_) {
+    used_regions = std::move(CircularBuffer<Region, false>(free_regions_count));
+  }
   if (is_local) {
     local_cache_ptr_.reset(reinterpret_cast<uint8_t *>(
         helpers::allocate_hugepage(free_regions_count * Region::kSize)));
   }
-  free_regions_count -= 2 * helpers::kNumSocket1CPUs;
+  free_regions_count -= num_core_local_regions;
 
   uint32_t idx = 0;
   auto new_region_fn = [&](bool nt) {
@@ -245,14 +363,34 @@ FarMemManager::RegionManager::RegionManager(uint64_t size, bool is_local) {
   FOR_ALL_SOCKET0_CORES(core_id) {
     core_local_free_regions_[core_id] = new_region_fn(false);
     core_local_free_nt_regions_[core_id] = new_region_fn(true);
+    if (is_local) {
+      for (uint8_t gen = 1; gen < Region::kNumGens; gen++) {
+        auto &region = core_local_free_old_gen_regions_[gen - 1][core_id];
+        region = new_region_fn(false);
+        region.set_gen(gen);
+      }
+    }
   }
 
   for (uint64_t i = 0; i < free_regions_count; i++) {
     BUG_ON(!free_regions_.push_back(new_region_fn(false)));
   }
+
+  if (is_local) {
+    num_reserved_regions_ =
+        std::max(1.0, ceil(free_regions_count * kReservedRegionsRatio));
+    reserved_regions_ =
+        std::move(CircularBuffer<Region, false>(num_reserved_regions_));
+    for (uint32_t i = 0; i < num_reserved_regions_; i++) {
+      Region region;
+      BUG_ON(!free_regions_.pop_front(&region));
+      BUG_ON(!reserved_regions_.push_back(region));
+    }
+  }
 }
 
-void FarMemManager::swap_in(bool nt, GenericFarMemPtr *ptr) {
+void FarMemManager::swap_in(bool nt, GenericFarMemPtr *ptr,
+                            IOClass io_class) {
   assert(preempt_enabled());
 
   auto &meta = ptr->meta();
@@ -262,6 +400,13 @@ void FarMemManager::swap_in(bool nt, GenericFarMemPtr *ptr) {
     return;
   }
 
+  // Admitted before locking the object, so that a demand swap-in of the same
+  // object never waits for a queued prefetch.
+  IOAdmission admission(device_ptr_->get_io_scheduler(), io_class);
+  if (unlikely(!admission.admitted())) {
+    return;
+  }
+
   FarMemManager::lock_object(sizeof(obj_id),
                              reinterpret_cast<const uint8_t *>(&obj_id));
   auto guard = helpers::finally([&]() {
@@ -278,32 +423,141 @@ void FarMemManager::swap_in(bool nt, GenericFarMemPtr *ptr) {
     device_ptr_->read_object(ds_id, sizeof(obj_id),
                              reinterpret_cast<uint8_t *>(&obj_id),
                              &obj_data_len, obj_data_addr);
-    wmb();
-    obj.init(ds_id, obj_data_len, sizeof(obj_id),
-             reinterpret_cast<uint8_t *>(&obj_id));
-    if (!meta.is_shared()) {
-      meta.set_present(obj_addr);
-    } else {
-      reinterpret_cast<GenericSharedPtr *>(ptr)->traverse(
-          [=](GenericFarMemPtr *ptr) { ptr->meta().set_present(obj_addr); });
+    admission.add_bytes(obj_data_len);
+    set_swapped_in(ptr, obj_addr, obj_data_len, obj_id);
+  }
+}
+
+void FarMemManager::set_swapped_in(GenericFarMemPtr *ptr, uint64_t obj_addr,
+                                   uint16_t obj_data_len, uint64_t obj_id) {
+  auto &meta = ptr->meta();
+  wmb();
+  Object(obj_addr).init(meta.get_ds_id(), obj_data_len, sizeof(obj_id),
+                        reinterpret_cast<uint8_t *>(&obj_id));
+  if (!meta.is_shared()) {
+    meta.set_present(obj_addr);
+  } else {
+    reinterpret_cast<GenericSharedPtr *>(ptr)->traverse(
+        [=](GenericFarMemPtr *ptr) { ptr->meta().set_present(obj_addr); });
+  }
+  Region::atomic_inc_ref_cnt(obj_addr, -1);
+}
+
+bool FarMemManager::swap_in_async(bool nt, GenericFarMemPtr *ptr,
+                                  AsyncSwapIn *swap_in) {
+  auto &meta = ptr->meta();
+  auto obj_id = meta.get_object_id();
+  rmb();
+  if (unlikely(meta.is_present())) {
+    return false;
+  }
+
+  // Held until finish_swap_in_async(), which keeps the synchronous swap-ins
+  // of the object waiting for this one.
+  FarMemManager::lock_object(sizeof(obj_id),
+                             reinterpret_cast<const uint8_t *>(&obj_id));
+  if (unlikely(meta.is_present())) {
+    FarMemManager::unlock_object(sizeof(obj_id),
+                                 reinterpret_cast<const uint8_t *>(&obj_id));
+    return false;
+  }
+  swap_in->ptr = ptr;
+  swap_in->obj_id = obj_id;
+  // The reference it holds on its region keeps the GC off until it is set.
+  swap_in->obj_addr = allocate_local_object(nt, meta.get_object_size());
+  auto obj_data_addr =
+      reinterpret_cast<uint8_t *>(Object(swap_in->obj_addr).get_data_addr());
+  device_ptr_->read_object_async(
+      meta.get_ds_id(), sizeof(obj_id), reinterpret_cast<uint8_t *>(&obj_id),
+      &swap_in->obj_data_len, obj_data_addr,
+      {.fn = finish_swap_in_async, .arg = swap_in});
+  return true;
+}
+
+void FarMemManager::finish_swap_in_async(void *arg) {
+  auto *swap_in = reinterpret_cast<AsyncSwapIn *>(arg);
+  auto obj_id = swap_in->obj_id;
+  FarMemManagerFactory::get()->set_swapped_in(
+      swap_in->ptr, swap_in->obj_addr, swap_in->obj_data_len, obj_id);
+  FarMemManager::unlock_object(sizeof(obj_id),
+                               reinterpret_cast<const uint8_t *>(&obj_id));
+  // Must be the last touch, as it may free swap_in.
+  swap_in->done.fn(swap_in->done.arg);
+}
+
+bool FarMemManager::is_untouched(GenericFarMemPtr *ptr) {
+  if (!ptr->meta().is_shared()) {
+    return ptr->meta().is_untouched();
+  }
+  bool untouched = true;
+  reinterpret_cast<GenericSharedPtr *>(ptr)->traverse(
+      [&untouched](GenericFarMemPtr *ptr) {
+        untouched &= ptr->meta().is_untouched();
+      });
+  return untouched;
+}
+
+void FarMemManager::clear_evacuation(GenericFarMemPtr *ptr) {
+  if (!ptr->meta().is_shared()) {
+    ptr->meta().clear_evacuation();
+  } else {
+    reinterpret_cast<GenericSharedPtr *>(ptr)->traverse(
+        [](GenericFarMemPtr *ptr) { ptr->meta().clear_evacuation(); });
+  }
+}
+
+bool FarMemManager::should_keep(FarMemPtrMeta &meta, uint8_t ds_id) {
+  bool hot = meta.is_hot();
+  switch (get_replacement_policy(ds_id)) {
+  case kReplaceLFU:
+    // The frequency has been aged by the marker.
+    return hot || meta.get_freq() >= kLFUMinKeepFreq;
+  case kReplaceClockPro: {
+    bool clock_hot = meta.is_clock_hot();
+    bool in_test = meta.is_in_test();
+    if (hot) {
+      // Hot again within its test period, so it gets promoted.
+      meta.set_clock_state(/* clock_hot = */ clock_hot || in_test,
+                           /* in_test = */ !clock_hot && !in_test);
+      return true;
     }
-    Region::atomic_inc_ref_cnt(obj_addr, -1);
+    if (clock_hot) {
+      // Demoted, but kept for another period.
+      meta.set_clock_state(/* clock_hot = */ false, /* in_test = */ true);
+      return true;
+    }
+    return false;
+  }
+  default:
+    return hot;
   }
 }
 
-void FarMemManager::swap_out(GenericFarMemPtr *ptr, Object obj) {
+bool FarMemManager::swap_out(GenericFarMemPtr *ptr, Object obj) {
   assert(preempt_enabled());
 
   auto &meta = ptr->meta();
 #ifndef STW_GC
   if (unlikely(!meta.is_evacuation())) {
-    return;
+    // Migrated by a mutator, or left in place by one in an in-place round.
+    return meta.get_object_addr() != obj.get_addr();
+  }
+  if (unlikely(ACCESS_ONCE(in_place_round_))) {
+    // A thread blocked in direct reclaim may still hold the raw pointer of an
+    // object it dereferenced before the marking. Every dereference leaves a
+    // trace in the hot bits, which only placing the object resets, so only
+    // the untouched objects are safe to move.
+    if (!is_untouched(ptr)) {
+      clear_evacuation(ptr);
+      return false;
+    }
   }
 #endif
 
-  bool hot, nt, dirty;
+  bool hot, nt, dirty, pinned = false;
   if (!meta.is_shared()) {
-    hot = meta.is_hot();
+    pinned = is_pinned(ptr);
+    hot = pinned || should_keep(meta, obj.get_ds_id());
     nt = meta.is_nt();
     dirty = meta.is_dirty();
   } else {
@@ -317,9 +571,16 @@ void FarMemManager::swap_out(GenericFarMemPtr *ptr, Object obj) {
         });
   }
 
-  if (hot && !nt && !ACCESS_ONCE(almost_empty)) {
+  // The pinned objects are copied even when the cache is almost empty.
+  if (hot && (pinned || (!nt && !ACCESS_ONCE(almost_empty)))) {
     auto obj_size = obj.size();
-    auto optional_local_object_addr = allocate_local_object_nb(false, obj_size);
+    // Promoted into the next generation, so that the long-lived hot objects
+    // end up in the rarely collected old regions.
+    auto gen = std::min(
+        static_cast<uint8_t>(Region::get_gen(obj.get_addr()) + 1),
+        Region::kGenOld);
+    auto optional_local_object_addr =
+        allocate_local_object_nb(false, obj_size, gen);
     if (likely(optional_local_object_addr)) {
       auto new_local_object_addr = *optional_local_object_addr;
       if (auto copy_notifier = copy_notifiers_[obj.get_ds_id()]) {
@@ -341,10 +602,15 @@ void FarMemManager::swap_out(GenericFarMemPtr *ptr, Object obj) {
             });
       }
       Region::atomic_inc_ref_cnt(new_local_object_addr, -1);
-      return;
+      return true;
     }
   }
 
+  return evict(ptr, obj, dirty);
+}
+
+bool FarMemManager::evict(GenericFarMemPtr *ptr, Object obj, bool dirty) {
+  auto &meta = ptr->meta();
   auto obj_id = obj.get_obj_id();
   auto obj_id_len = obj.get_obj_id_len();
   auto obj_size = obj.size();
@@ -353,13 +619,15 @@ void FarMemManager::swap_out(GenericFarMemPtr *ptr, Object obj) {
 
   auto write_object_fn = [&](uint32_t data_len) {
     if (dirty) {
+      IOAdmission admission(device_ptr_->get_io_scheduler(), kIOWriteBack);
       device_ptr_->write_object(ds_id, obj_id_len, obj_id, data_len, data_ptr);
+      admission.add_bytes(data_len);
     }
   };
 
   if (auto evac_notifier = evac_notifiers_[ds_id]) {
     if (evac_notifier(obj, write_object_fn)) { // Ptr removed.
-      return;
+      return true;
     }
   } else {
     write_object_fn(obj.get_data_len());
@@ -374,31 +642,69 @@ void FarMemManager::swap_out(GenericFarMemPtr *ptr, Object obj) {
                             *reinterpret_cast<const uint64_t *>(obj_id));
         });
   }
+  return true;
 }
 
 /*
-  A naive from-region picker according to the simple round-robin order.
+  A generational from-region picker, which follows the simple round-robin order
+  within each generation.
  */
 void FarMemManager::pick_from_regions() {
   from_regions_.clear();
+  if (ACCESS_ONCE(dontneed_pending_)) {
+    ACCESS_ONCE(dontneed_pending_) = false;
+    cache_region_manager_.pop_dontneed_regions(kMaxNumRegionsPerGCRound,
+                                               &from_regions_);
+    if (!is_free_cache_low()) {
+      // A proactive round that only reclaims the advised regions.
+      return;
+    }
+  }
+  auto free_ratio = cache_region_manager_.get_free_region_ratio();
+#ifdef DISABLE_GC_PACING
   auto ratio_per_gc_round =
       std::max(kMinRatioRegionsPerGCRound,
                std::min(kMaxRatioRegionsPerGCRound,
-                        kFreeCacheHighThresh -
-                            cache_region_manager_.get_free_region_ratio()));
+                        kFreeCacheHighThresh - free_ratio));
+#else
+  auto ratio_per_gc_round =
+      gc_pacer_.get_ratio_per_round(free_ratio, kMaxRatioRegionsPerGCRound);
+#endif
   auto num_regions_per_gc_round =
       std::min(kMaxNumRegionsPerGCRound,
                static_cast<uint32_t>(ratio_per_gc_round *
                                      cache_region_manager_.get_num_regions()));
-  do {
-    auto optional_region = pop_cache_used_region();
+#ifndef DISABLE_GC_PACING
+  num_active_gc_threads_ =
+      gc_pacer_.get_num_gc_threads(free_ratio, num_regions_per_gc_round);
+#endif
+
+  auto round = num_gc_rounds_++;
+  auto oldest_gen = (round % kOldGCInterval == 0)        ? Region::kGenOld
+                    : (round % kSurvivorGCInterval == 0) ? Region::kGenSurvivor
+                                                         : Region::kGenYoung;
+  // Up to half of the round goes to the oldest generation due, so that it is
+  // collected even when there are plenty of young regions.
+  if (oldest_gen != Region::kGenYoung) {
+    pick_from_regions_in_gen(oldest_gen, num_regions_per_gc_round / 2);
+  }
+  pick_from_regions_in_gen(Region::kGenYoung, num_regions_per_gc_round);
+  // Falls back to the older generations when the young one runs out.
+  for (uint8_t gen = Region::kGenSurvivor; gen < Region::kNumGens; gen++) {
+    pick_from_regions_in_gen(gen, num_regions_per_gc_round);
+  }
+}
+
+void FarMemManager::pick_from_regions_in_gen(uint8_t gen, uint32_t max_num) {
+  while (from_regions_.size() < max_num) {
+    auto optional_region = pop_cache_used_region(gen);
     if (unlikely(!optional_region)) {
       break;
     }
     preempt_disable();
     from_regions_.push_back(std::move(*optional_region));
     preempt_enable();
-  } while (from_regions_.size() < num_regions_per_gc_round);
+  }
 }
 
 GCParallelizer::GCParallelizer(uint32_t num_slaves, uint32_t task_queues_depth,
@@ -420,6 +726,7 @@ void GCParallelMarker::slave_fn(uint32_t tid) {
     if (slave_dequeue_task(tid, &task)) {
       auto [left, right] = task;
       auto cur = left;
+      auto *manager = FarMemManagerFactory::get();
       while (cur + Object::kHeaderSize < right) {
         auto obj = Object(cur);
         if (!obj.is_freed()) {
@@ -432,6 +739,11 @@ void GCParallelMarker::slave_fn(uint32_t tid) {
             auto *ptr =
                 reinterpret_cast<GenericFarMemPtr *>(obj.get_ptr_addr());
             if (!ptr->meta().is_shared()) {
+              if (manager->get_replacement_policy(obj.get_ds_id()) ==
+                      kReplaceLFU &&
+                  !ptr->meta().is_hot()) {
+                ptr->meta().age_freq();
+              }
               ptr->meta().set_evacuation();
             } else {
               reinterpret_cast<GenericSharedPtr *>(ptr)->traverse(
@@ -446,11 +758,11 @@ void GCParallelMarker::slave_fn(uint32_t tid) {
 }
 
 void FarMemManager::mark_fm_ptrs(auto *preempt_guard) {
-  Status slaves_status[num_gc_threads_];
-  for (uint32_t i = 0; i < num_gc_threads_; i++) {
+  Status slaves_status[num_active_gc_threads_];
+  for (uint32_t i = 0; i < num_active_gc_threads_; i++) {
     slaves_status[i] = GC;
   }
-  parallel_marker_.spawn(slaves_status);
+  parallel_marker_.spawn(slaves_status, num_active_gc_threads_);
   start_prioritizing(GC);
   // Now we can safely enable the preemption of GC master thread, since it
   // has been prioritized
@@ -461,16 +773,42 @@ void FarMemManager::mark_fm_ptrs(auto *preempt_guard) {
 void FarMemManager::wait_mutators_observation() {
   auto old_status = load_acquire(&expected_status);
 #ifndef STW_GC
-  store_release(&expected_status, DerefScope::flip_status(old_status));
+  auto new_status = DerefScope::flip_status(old_status);
+  // The threads left behind by an in-place round move out of the new status
+  // as soon as they leave or retry direct reclaim.
+  while (DerefScope::get_num_threads(new_status)) {
+    thread_yield();
+  }
+  direct_reclaim_spin_.Lock();
+  store_release(&expected_status, new_status);
+  waiting_status_ = old_status;
+  direct_reclaim_spin_.Unlock();
   set_self_th_status(old_status);
   start_prioritizing(old_status);
-#endif
+
+  // Wait all mutator threads swicth to the new status, or get blocked in
+  // direct reclaim, where they cannot be in the middle of a dereference.
+  while (true) {
+    direct_reclaim_spin_.Lock();
+    auto num_threads = DerefScope::get_num_threads(old_status);
+    bool done = !num_threads ||
+                num_threads <= num_direct_reclaimers_[old_status];
+    if (done) {
+      ACCESS_ONCE(in_place_round_) = (num_threads > 0);
+      waiting_status_ = OutofScope;
+    }
+    direct_reclaim_spin_.Unlock();
+    if (done) {
+      break;
+    }
+    thread_yield();
+  }
+  set_self_th_status(GC);
+#else
   // Wait all mutator threads swicth to the new status.
   while (DerefScope::get_num_threads(old_status)) {
     thread_yield();
   }
-#ifndef STW_GC
-  set_self_th_status(GC);
 #endif
 }
 
@@ -500,7 +838,10 @@ void GCParallelWriteBacker::slave_fn(uint32_t tid) {
           if (likely(!obj.is_freed())) {
             auto *ptr =
                 reinterpret_cast<GenericFarMemPtr *>(obj.get_ptr_addr());
-            manager->swap_out(ptr, obj);
+            if (manager->swap_out(ptr, obj)) {
+              // Tells an in-place round that the object has left the region.
+              obj.free();
+            }
           }
         }
         cur += helpers::align_to(obj.size(), sizeof(FarMemPtrMeta));
@@ -510,11 +851,11 @@ void GCParallelWriteBacker::slave_fn(uint32_t tid) {
 }
 
 void FarMemManager::write_back_regions() {
-  Status slaves_status[num_gc_threads_];
-  for (uint32_t i = 0; i < num_gc_threads_; i++) {
+  Status slaves_status[num_active_gc_threads_];
+  for (uint32_t i = 0; i < num_active_gc_threads_; i++) {
     slaves_status[i] = GC;
   }
-  parallel_write_backer_.spawn(slaves_status);
+  parallel_write_backer_.spawn(slaves_status, num_active_gc_threads_);
 #ifndef STW_GC
   start_prioritizing(GC);
 #endif
@@ -553,7 +894,7 @@ void FarMemManager::gc_cache() {
 #endif
   start_gc_us[get_core_num()].c = microtime();
 
-  if (unlikely(!is_free_cache_low())) {
+  if (unlikely(!is_free_cache_low() && !ACCESS_ONCE(dontneed_pending_))) {
     return;
   }
 
@@ -567,17 +908,25 @@ void FarMemManager::gc_cache() {
              cache_region_manager_.get_free_region_ratio());
 #endif
 
-  while (!is_free_cache_high()) {
+  // A proactive round (see advise()) only reclaims the advised regions.
+  bool proactive = !is_free_cache_low();
+  while (proactive ? ACCESS_ONCE(dontneed_pending_) : !is_free_cache_high()) {
     // Phase 1. Pick regions to be GCed.
 #ifdef GC_LOG
     ts[0] = std::chrono::steady_clock::now();
 #endif
+    auto free_ratio = cache_region_manager_.get_free_region_ratio();
     pick_from_regions();
     if (unlikely(!from_regions_.size())) {
+      if (proactive) {
+        // The advised regions are still being filled.
+        break;
+      }
       LOG_PRINTF("%s\n", "Warn: GC cannot find any from_regions.");
       thread_yield();
       continue;
     }
+    gc_pacer_.on_gc_round_start(free_ratio);
 
     // Phase 2. Mark the far memory pointers within the picked regions.
 #ifdef GC_LOG
@@ -603,12 +952,25 @@ void FarMemManager::gc_cache() {
 #ifdef GC_LOG
     ts[4] = std::chrono::steady_clock::now();
 #endif
+    uint32_t num_freed_regions = 0;
     for (auto &from_region : from_regions_) {
+      if (unlikely(ACCESS_ONCE(in_place_round_)) &&
+          !RegionManager::is_dead(from_region)) {
+        // Still holds the objects used by the threads in direct reclaim.
+        cache_region_manager_.push_used_region(from_region);
+        continue;
+      }
       push_cache_free_region(from_region);
+      num_freed_regions++;
     }
+    ACCESS_ONCE(in_place_round_) = false;
+    gc_pacer_.on_gc_round_end(num_freed_regions, num_active_gc_threads_);
     gc_lock_.Lock();
     if (!is_free_cache_almost_empty()) {
       ACCESS_ONCE(almost_empty) = false;
+      if (auto io_scheduler = device_ptr_->get_io_scheduler()) {
+        io_scheduler->set_memory_pressure(false);
+      }
 #ifndef STW_GC
       mutator_cache_condvar_.SignalAll();
 #endif
@@ -665,19 +1027,25 @@ retry_allocate_local:
     return *optional_local_addr;
   } else {
     bool success = cache_region_manager_.try_refill_core_local_free_region(
-        nt, &free_local_region);
+        nt, &free_local_region,
+        /* use_reserve = */ DerefScope::is_in_deref_scope());
     per_core_local_region_refilled = true;
     if (unlikely(!success)) {
       preempt_enable();
       mutator_wait_for_gc_cache();
       preempt_disable();
+    } else {
+      // Only the mutators' own refills count towards the alloc rate; those
+      // of allocate_local_object_nb() are GC copies and migrations.
+      gc_pacer_.on_region_allocated();
     }
     goto retry_allocate_local;
   }
 }
 
 std::optional<uint64_t>
-FarMemManager::allocate_local_object_nb(bool nt, uint16_t object_size) {
+FarMemManager::allocate_local_object_nb(bool nt, uint16_t object_size,
+                                        uint8_t gen) {
   preempt_disable();
   std::optional<uint64_t> optional_local_addr;
   bool per_core_local_region_refilled = false;
@@ -688,14 +1056,15 @@ FarMemManager::allocate_local_object_nb(bool nt, uint16_t object_size) {
     preempt_enable();
   });
 retry_allocate_local:
-  auto &free_local_region = cache_region_manager_.core_local_free_region(nt);
+  auto &free_local_region =
+      cache_region_manager_.core_local_free_region(nt, gen);
   optional_local_addr = free_local_region.allocate_object(object_size);
 
   if (likely(optional_local_addr)) {
     return *optional_local_addr;
   } else {
     bool success = cache_region_manager_.try_refill_core_local_free_region(
-        nt, &free_local_region);
+        nt, &free_local_region, /* use_reserve = */ false, gen);
     per_core_local_region_refilled = true;
     if (unlikely(!success)) {
       return std::nullopt;
@@ -732,22 +1101,129 @@ void FarMemManager::mutator_wait_for_gc_cache() {
     return;
   }
   if (unlikely(DerefScope::is_in_deref_scope())) {
-    LOG_PRINTF("%s\n", "Error: runs out of space with an unexpected status.");
-    Stats::print_free_mem_ratio_records();
-    exit(-ENOSPC);
+    // Waiting for the GC here would deadlock, as the GC waits for the scope
+    // to end.
+    guard.reset();
+    mutator_direct_reclaim();
+    return;
   }
 #ifdef STW_GC
   launch_gc_master();
 #endif
+  auto start_us = microtime();
   do {
     mutator_cache_condvar_.Wait(&gc_lock_);
   } while (ACCESS_ONCE(almost_empty));
+  gc_pacer_.add_stall(microtime() - start_us);
   guard.reset();
 #ifdef DEBUG
   LOG_PRINTF("%s\n", "Warn: mutator paused due to insufficient memory.");
 #endif
 }
 
+void FarMemManager::mutator_direct_reclaim() {
+  direct_reclaim_spin_.Lock();
+  num_direct_reclaimers_[get_self_th_status()]++;
+  direct_reclaim_spin_.Unlock();
+  auto guard = helpers::finally([&]() {
+    direct_reclaim_spin_.Lock();
+    renew_direct_reclaimer_status();
+    num_direct_reclaimers_[get_self_th_status()]--;
+    direct_reclaim_spin_.Unlock();
+  });
+
+  auto start_us = microtime();
+  bool warned = false;
+  while (!cache_region_manager_.reclaim_dead_regions(
+             kMaxNumDirectReclaimScans) &&
+         !direct_evict()) {
+    // Freed by the GC, which evicts the cold objects in place while this
+    // thread holds it back.
+    if (cache_region_manager_.get_free_region_ratio() > 0) {
+      return;
+    }
+    if (unlikely(!warned && microtime() - start_us > kDirectReclaimWarnUs)) {
+      // Every object left is in use by some DerefScope. Waiting lets those
+      // scopes end, or free their objects.
+      LOG_PRINTF("%s\n", "Warn: direct reclaim is stalled by in-use objects.");
+      Stats::print_free_mem_ratio_records();
+      warned = true;
+    }
+    direct_reclaim_spin_.Lock();
+    renew_direct_reclaimer_status();
+    direct_reclaim_spin_.Unlock();
+#ifndef STW_GC
+    preempt_disable();
+    launch_gc_master();
+    preempt_enable();
+#endif
+    // Other threads may free objects or end their scopes in the meantime.
+    thread_yield();
+  }
+}
+
+uint32_t FarMemManager::direct_evict() {
+  uint32_t num_freed_regions = 0;
+  for (uint32_t i = 0; i < kMaxNumDirectEvictRegions; i++) {
+    // Owned by this thread until pushed back, so that the GC does not pick it.
+    auto optional_region = cache_region_manager_.pop_used_region();
+    if (!optional_region) {
+      break;
+    }
+    auto &region = *optional_region;
+    for (uint8_t j = 0; j < region.get_num_boundaries(); j++) {
+      auto [left, right] = region.get_boundary(j);
+      auto cur = left;
+      while (cur + Object::kHeaderSize < right) {
+        auto obj = Object(cur);
+        cur += helpers::align_to(obj.size(), sizeof(FarMemPtrMeta));
+        if (obj.is_freed()) {
+          continue;
+        }
+        auto obj_id_len = obj.get_obj_id_len();
+        auto *obj_id = obj.get_obj_id();
+        FarMemManager::lock_object(obj_id_len, obj_id);
+        auto guard = helpers::finally(
+            [&]() { FarMemManager::unlock_object(obj_id_len, obj_id); });
+        if (unlikely(obj.is_freed())) {
+          continue;
+        }
+        auto *ptr = reinterpret_cast<GenericFarMemPtr *>(obj.get_ptr_addr());
+        auto &meta = ptr->meta();
+        // Untouched since placed, hence cold and not held by any scope. The
+        // mark makes the racing dereferences wait for the object lock.
+        if (meta.is_shared() || is_pinned(ptr) ||
+            !meta.mark_evacuation_if_untouched()) {
+          continue;
+        }
+        if (evict(ptr, obj, meta.is_dirty())) {
+          obj.free();
+        }
+      }
+    }
+    if (RegionManager::is_dead(region)) {
+      push_cache_free_region(region);
+      num_freed_regions++;
+    } else {
+      cache_region_manager_.push_used_region(region);
+    }
+  }
+  return num_freed_regions;
+}
+
+void FarMemManager::renew_direct_reclaimer_status() {
+  auto status = get_self_th_status();
+  auto new_status = ACCESS_ONCE(expected_status);
+  if (status == new_status || status == waiting_status_) {
+    return;
+  }
+  // The GC round that flipped the status has gone ahead in place, so its
+  // successor must wait for this thread in turn.
+  num_direct_reclaimers_[status]--;
+  num_direct_reclaimers_[new_status]++;
+  DerefScope::switch_status(new_status);
+}
+
 void FarMemManager::mutator_wait_for_gc_far_mem() {
   LOG_PRINTF("%s\n", "Warn: GCing far mem has not been implemented yet.");
 }
@@ -778,6 +1254,109 @@ uint8_t FarMemManager::allocate_ds_id() {
 
 void FarMemManager::free_ds_id(uint8_t ds_id) { available_ds_ids_.push(ds_id); }
 
+void FarMemManager::pin(const GenericFarMemPtr *ptr) {
+  rt::ScopedLock<rt::Spin> lock(&pin_spin_);
+  pin_cnts_[ptr]++;
+  ACCESS_ONCE(num_pinned_ptrs_) = pin_cnts_.size();
+}
+
+void FarMemManager::unpin(const GenericFarMemPtr *ptr) {
+  rt::ScopedLock<rt::Spin> lock(&pin_spin_);
+  auto iter = pin_cnts_.find(ptr);
+  if (iter != pin_cnts_.end() && !--iter->second) {
+    pin_cnts_.erase(iter);
+    ACCESS_ONCE(num_pinned_ptrs_) = pin_cnts_.size();
+  }
+}
+
+bool FarMemManager::is_pinned(const GenericFarMemPtr *ptr) {
+  if (likely(!ACCESS_ONCE(num_pinned_ptrs_))) {
+    return false;
+  }
+  rt::ScopedLock<rt::Spin> lock(&pin_spin_);
+  return pin_cnts_.count(ptr);
+}
+
+void FarMemManager::transfer_pins(const GenericFarMemPtr *from,
+                                  const GenericFarMemPtr *to) {
+  if (likely(!ACCESS_ONCE(num_pinned_ptrs_))) {
+    return;
+  }
+  rt::ScopedLock<rt::Spin> lock(&pin_spin_);
+  auto iter = pin_cnts_.find(from);
+  if (iter == pin_cnts_.end()) {
+    return;
+  }
+  auto pin_cnt = iter->second;
+  pin_cnts_.erase(iter);
+  if (to) {
+    pin_cnts_[to] += pin_cnt;
+  }
+  ACCESS_ONCE(num_pinned_ptrs_) = pin_cnts_.size();
+}
+
+void FarMemManager::advise(GenericUniquePtr *ptrs, uint64_t num,
+                           uint32_t advice, PrefetchStream *stream) {
+  assert(!DerefScope::is_in_deref_scope());
+
+  if (advice & (kAdviceWillNeed | kAdvicePin)) {
+    BUG_ON(!stream);
+    std::vector<GenericUniquePtr *> missing_ptrs;
+    for (uint64_t i = 0; i < num; i++) {
+      if (!ptrs[i].is_null() && !ptrs[i].meta().is_present()) {
+        missing_ptrs.push_back(&ptrs[i]);
+      }
+    }
+    // Issued as demand reads since they are known to be needed; a prefetch
+    // would be dropped after waiting for a slot for a while.
+    PrefetchService::get()->submit(stream, missing_ptrs.data(),
+                                   missing_ptrs.size(), /* nt = */ false,
+                                   kIODemand);
+  }
+
+  if (!(advice & (kAdviceDontNeed | kAdvicePin | kAdviceUnpin))) {
+    return;
+  }
+  bool dontneed_marked = false;
+  {
+    // Keeps the regions from being reclaimed while their headers are updated.
+    DerefScope scope;
+    for (uint64_t i = 0; i < num; i++) {
+      auto &ptr = ptrs[i];
+      if (ptr.is_null()) {
+        continue;
+      }
+      if (advice & kAdvicePin) {
+        // Waits for the swap-in issued above.
+        ptr._deref</* Mut = */ false, /* Nt = */ false>();
+        pin(&ptr);
+      }
+      if (advice & kAdviceUnpin) {
+        unpin(&ptr);
+      }
+      if ((advice & kAdviceDontNeed) && ptr.meta().is_present()) {
+        // So that the GC evicts the object rather than copying it.
+        ptr.meta().clear_hot();
+        dontneed_marked |=
+            Region::set_dontneed(ptr.meta().get_object_addr());
+      }
+      if ((i + 1) % kNumAdvisedObjectsPerScope == 0) {
+        scope.renew();
+      }
+    }
+  }
+
+  if (dontneed_marked) {
+    ACCESS_ONCE(dontneed_pending_) = true;
+#ifndef STW_GC
+    // Reclaims the advised regions now rather than at the next GC.
+    preempt_disable();
+    launch_gc_master();
+    preempt_enable();
+#endif
+  }
+}
+
 bool FarMemManager::reallocate_generic_unique_ptr_nb(const DerefScope &scope,
                                                      GenericUniquePtr *ptr,
                                                      uint16_t new_item_size,
@@ -819,17 +1398,19 @@ bool FarMemManager::reallocate_generic_unique_ptr_nb(const DerefScope &scope,
 GenericConcurrentHopscotch
 FarMemManager::allocate_concurrent_hopscotch(uint32_t local_num_entries_shift,
                                              uint32_t remote_num_entries_shift,
-                                             uint64_t remote_data_size) {
+                                             uint64_t remote_data_size,
+                                             std::string_view name) {
   return GenericConcurrentHopscotch(allocate_ds_id(), local_num_entries_shift,
-                                    remote_num_entries_shift, remote_data_size);
+                                    remote_num_entries_shift, remote_data_size,
+                                    name);
 }
 
 GenericConcurrentHopscotch *FarMemManager::allocate_concurrent_hopscotch_heap(
     uint32_t local_num_entries_shift, uint32_t remote_num_entries_shift,
-    uint64_t remote_data_size) {
+    uint64_t remote_data_size, std::string_view name) {
   return new GenericConcurrentHopscotch(
       allocate_ds_id(), local_num_entries_shift, remote_num_entries_shift,
-      remote_data_size);
+      remote_data_size, name);
 }
 
 } // namespace far_memory
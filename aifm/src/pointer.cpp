@@ -54,8 +54,8 @@ void FarMemPtrMeta::gc_wb(uint8_t ds_id, uint16_t object_size,
   from_uint64_t(new_metadata);
 }
 
-void GenericFarMemPtr::swap_in(bool nt) {
-  FarMemManagerFactory::get()->swap_in(nt, this);
+void GenericFarMemPtr::swap_in(bool nt, IOClass io_class) {
+  FarMemManagerFactory::get()->swap_in(nt, this, io_class);
 }
 
 bool GenericFarMemPtr::mutator_migrate_object() {
@@ -77,6 +77,13 @@ bool GenericFarMemPtr::mutator_migrate_object() {
     return false;
   }
 
+  bool untouched = FarMemManager::is_untouched(this);
+  if (unlikely(ACCESS_ONCE(manager->in_place_round_)) && !untouched) {
+    // Left in place by the GC round, see FarMemManager::swap_out().
+    FarMemManager::clear_evacuation(this);
+    return true;
+  }
+
   bool nt = meta().is_nt();
   auto object_size = object.size();
 
@@ -106,6 +113,13 @@ bool GenericFarMemPtr::mutator_migrate_object() {
           ptr->meta().mutator_copy(new_local_object_addr);
         });
   }
+  // The region outlives an in-place GC round, which must not recycle it while
+  // the old copy may be in use.
+  if (untouched) {
+    object.free();
+  } else {
+    object.retire();
+  }
   return true;
 }
 
@@ -130,9 +144,12 @@ restart:
       }
     }
 
-    FarMemManagerFactory::get()->get_device()->write_object(
-        obj.get_ds_id(), obj_id_len, obj_id_ptr, obj.get_data_len(),
-        reinterpret_cast<const uint8_t *>(obj.get_data_addr()));
+    auto device = FarMemManagerFactory::get()->get_device();
+    IOAdmission admission(device->get_io_scheduler(), kIOWriteBack);
+    device->write_object(obj.get_ds_id(), obj_id_len, obj_id_ptr,
+                         obj.get_data_len(),
+                         reinterpret_cast<const uint8_t *>(obj.get_data_addr()));
+    admission.add_bytes(obj.get_data_len());
     if (!meta_snapshot.is_shared()) {
       meta().clear_dirty();
     } else {
@@ -180,6 +197,7 @@ retry:
     }
     other_object.set_ptr_addr(reinterpret_cast<uint64_t>(this));
   }
+  FarMemManagerFactory::get()->transfer_pins(&other, this);
   __builtin_memcpy(reinterpret_cast<uint64_t *>(&other.meta()), &reset_value,
                    sizeof(reset_value));
 }
@@ -197,6 +215,7 @@ void GenericUniquePtr::_free() {
 
   object().free();
   meta().nullify();
+  FarMemManagerFactory::get()->transfer_pins(this, nullptr);
 }
 
 void GenericUniquePtr::free(bool race) {
@@ -0,0 +1,176 @@
+#include "thread.h"
+
+#include "pointer.hpp"
+#include "prefetch_service.hpp"
+
+#include <algorithm>
+
+namespace far_memory {
+
+PrefetchStream::PrefetchStream(void *owner, RunFn run_fn,
+                               HasPendingTracesFn has_pending_traces_fn)
+    : owner_(owner), run_fn_(run_fn),
+      has_pending_traces_fn_(has_pending_traces_fn) {
+  PrefetchService::get()->start();
+}
+
+PrefetchStream::~PrefetchStream() { BUG_ON(!unregistered_); }
+
+void PrefetchStream::unregister() { PrefetchService::get()->unregister(this); }
+
+PrefetchService *PrefetchService::get() {
+  static PrefetchService service;
+  return &service;
+}
+
+void PrefetchService::start() {
+  if (likely(ACCESS_ONCE(started_))) {
+    return;
+  }
+  rt::ScopedLock<rt::Mutex> lock(&mutex_);
+  if (started_) {
+    return;
+  }
+  for (uint32_t i = 0; i < kNumWorkers; i++) {
+    spawn_worker();
+  }
+  ACCESS_ONCE(started_) = true;
+}
+
+void PrefetchService::spawn_worker() {
+  num_workers_++;
+  rt::Spawn([&]() { worker_fn(); });
+}
+
+void PrefetchService::worker_fn() {
+  mutex_.Lock();
+  while (true) {
+    if (!offload_jobs_.empty()) {
+      auto job = offload_jobs_.front();
+      offload_jobs_.pop_front();
+      mutex_.Unlock();
+      job.fn(job.arg);
+      mutex_.Lock();
+    } else if (!tasks_.empty()) {
+      auto task = tasks_.front();
+      tasks_.pop_front();
+      mutex_.Unlock();
+      task.ptr->swap_in(task.nt, task.io_class);
+      if (task.inflight) {
+        store_release(task.inflight, false);
+      }
+      mutex_.Lock();
+      auto stream = task.stream;
+      if (stream && !--stream->num_inflight_tasks_ && stream->unregistered_) {
+        cv_stream_idle_.SignalAll();
+      }
+    } else if (!streams_.empty()) {
+      auto stream = streams_.front();
+      streams_.pop_front();
+      stream->running_ = true;
+      mutex_.Unlock();
+      bool has_work = stream->run_fn_(stream->owner_);
+      mutex_.Lock();
+      stream->running_ = false;
+      if (unlikely(stream->unregistered_)) {
+        stream->scheduled_ = false;
+        cv_stream_idle_.SignalAll();
+      } else if (has_work) {
+        // Round robin among the busy streams.
+        streams_.push_back(stream);
+      } else {
+        // A schedule() racing with the clear may have seen scheduled_ still
+        // set and skipped queuing, so the traces are checked again afterwards.
+        stream->scheduled_ = false;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (stream->has_pending_traces_fn_(stream->owner_) &&
+            !stream->scheduled_.exchange(true)) {
+          streams_.push_back(stream);
+        }
+      }
+    } else {
+      num_idle_workers_++;
+      cv_worker_.Wait(&mutex_);
+      num_idle_workers_--;
+    }
+  }
+}
+
+void PrefetchService::schedule(PrefetchStream *stream) {
+  rt::ScopedLock<rt::Mutex> lock(&mutex_);
+  if (stream->unregistered_) {
+    return;
+  }
+  streams_.push_back(stream);
+  cv_worker_.Signal();
+}
+
+void PrefetchService::submit(PrefetchStream *stream, GenericUniquePtr **ptrs,
+                             uint32_t num, bool nt, IOClass io_class,
+                             bool **inflights) {
+  start();
+  uint32_t num_queued = 0;
+  {
+    rt::ScopedLock<rt::Mutex> lock(&mutex_);
+    while (num_queued < num && tasks_.size() < kMaxNumQueuedTasks) {
+      auto i = num_queued++;
+      tasks_.push_back({.ptr = ptrs[i],
+                        .stream = stream,
+                        .nt = nt,
+                        .io_class = io_class,
+                        .inflight = inflights ? inflights[i] : nullptr});
+      if (stream) {
+        stream->num_inflight_tasks_++;
+      }
+      cv_worker_.Signal();
+    }
+  }
+  // The workers are saturated; do it in the current thread instead.
+  for (uint32_t i = num_queued; i < num; i++) {
+    ptrs[i]->swap_in(nt, io_class);
+    if (inflights) {
+      store_release(inflights[i], false);
+    }
+  }
+}
+
+void PrefetchService::offload(void (*fn)(void *arg), void *arg) {
+  start();
+  rt::ScopedLock<rt::Mutex> lock(&mutex_);
+  offload_jobs_.push_back({.fn = fn, .arg = arg});
+  if (num_idle_workers_) {
+    cv_worker_.Signal();
+  } else if (num_workers_ < kMaxNumWorkers) {
+    spawn_worker();
+  }
+}
+
+void PrefetchService::unregister(PrefetchStream *stream) {
+  rt::ScopedLock<rt::Mutex> lock(&mutex_);
+  stream->unregistered_ = true;
+  // A scheduled stream might not be queued yet, see schedule().
+  auto iter = std::find(streams_.begin(), streams_.end(), stream);
+  if (iter != streams_.end()) {
+    streams_.erase(iter);
+    stream->scheduled_ = false;
+  }
+  auto num_tasks = tasks_.size();
+  tasks_.erase(std::remove_if(tasks_.begin(), tasks_.end(),
+                              [&](const Task &task) {
+                                if (task.stream != stream) {
+                                  return false;
+                                }
+                                if (task.inflight) {
+                                  store_release(task.inflight, false);
+                                }
+                                return true;
+                              }),
+               tasks_.end());
+  stream->num_inflight_tasks_ -= num_tasks - tasks_.size();
+  // Only waits for the work that is being executed right now.
+  while (stream->running_ || stream->num_inflight_tasks_) {
+    cv_stream_idle_.Wait(&mutex_);
+  }
+}
+
+} // namespace far_memory
@@ -7,73 +7,198 @@ extern "C" {
 
 #include "server.hpp"
 #include "server_dataframe_vector.hpp"
+#include "server_far_vector.hpp"
 #include "server_hashtable.hpp"
 #include "server_ptr.hpp"
 
-namespace far_memory {
+#include <cstring>
 
-std::unique_ptr<ServerDS> Server::server_ds_ptrs_[kMaxNumDSIDs];
+namespace far_memory {
 
 Server::Server() {
   register_ds(kVanillaPtrDSType, new ServerPtrFactory());
   register_ds(kHashTableDSType, new ServerHashTableFactory());
   register_ds(kDataFrameVectorDSType, new ServerDataFrameVectorFactory());
+  register_ds(kFarVectorDSType, new ServerFarVectorFactory());
 }
 
 void Server::register_ds(uint8_t ds_type, ServerDSFactory *factory) {
   registered_server_ds_factorys_[ds_type] = factory;
 }
 
-void Server::construct(uint8_t ds_type, uint8_t ds_id, uint8_t param_len,
+void Server::set_far_mem_quota(uint64_t quota) { far_mem_quota_ = quota; }
+
+uint64_t Server::get_committed_bytes() const { return committed_bytes_; }
+
+bool Server::commit(uint64_t num_bytes) {
+  auto committed = committed_bytes_.load();
+  do {
+    if (far_mem_quota_ && (committed > far_mem_quota_ ||
+                           num_bytes > far_mem_quota_ - committed)) {
+      return false;
+    }
+  } while (!committed_bytes_.compare_exchange_weak(committed,
+                                                   committed + num_bytes));
+  return true;
+}
+
+void Server::uncommit(uint8_t ds_id) {
+  committed_bytes_ -= server_ds_committed_bytes_[ds_id];
+  server_ds_committed_bytes_[ds_id] = 0;
+}
+
+bool Server::construct(uint8_t ds_type, uint8_t ds_id, uint8_t param_len,
                        uint8_t *params) {
+  if (ds_id >= kMaxNumDSIDs || ds_type >= kMaxNumDSTypes ||
+      server_ds_ptrs_[ds_id]) {
+    return false;
+  }
   auto factory = registered_server_ds_factorys_[ds_type];
-  BUG_ON(server_ds_ptrs_[ds_id]);
+  if (!factory) {
+    return false;
+  }
+  uint64_t num_bytes = 0;
+  if (ds_type == kVanillaPtrDSType) {
+    // Its param is the size of the far memory it maps.
+    if (param_len != sizeof(num_bytes)) {
+      return false;
+    }
+    memcpy(&num_bytes, params, sizeof(num_bytes));
+    if (!commit(num_bytes)) {
+      return false;
+    }
+  }
   server_ds_ptrs_[ds_id].reset(factory->build(param_len, params));
+  server_ds_ptrs_[ds_id]->server_ = this;
+  server_ds_types_[ds_id] = ds_type;
+  server_ds_committed_bytes_[ds_id] = num_bytes;
+  return true;
+}
+
+void Server::unbind_name(uint8_t ds_id) {
+  auto &ds_name = server_ds_names_[ds_id];
+  if (!ds_name.empty()) {
+    rt::ScopedLock<rt::Mutex> lock(&ds_names_mutex_);
+    bound_ds_names_.erase(ds_name);
+    ds_name.clear();
+  }
 }
 
-void Server::destruct(uint8_t ds_id) {
-  BUG_ON(!server_ds_ptrs_[ds_id]);
+bool Server::destruct(uint8_t ds_id) {
+  if (!get_server_ds(ds_id)) {
+    return false;
+  }
   server_ds_ptrs_[ds_id].reset();
+  uncommit(ds_id);
+  // Destructing a named DS drops it for good.
+  unbind_name(ds_id);
+  return true;
+}
+
+void Server::reset() {
+  for (uint32_t ds_id = 0; ds_id < kMaxNumDSIDs; ds_id++) {
+    server_ds_ptrs_[ds_id].reset();
+    uncommit(ds_id);
+    unbind_name(ds_id);
+  }
+}
+
+uint8_t Server::attach(uint8_t ds_type, uint8_t ds_id, uint8_t name_len,
+                       const uint8_t *name, uint8_t param_len, uint8_t *params,
+                       uint8_t *meta_len, uint8_t *meta) {
+  *meta_len = 0;
+  if (!name_len || ds_id >= kMaxNumDSIDs || server_ds_ptrs_[ds_id]) {
+    return kAttachRefused;
+  }
+  std::string ds_name(reinterpret_cast<const char *>(name), name_len);
+
+  rt::ScopedLock<rt::Mutex> lock(&ds_names_mutex_);
+  if (bound_ds_names_.count(ds_name)) {
+    return kAttachNameInUse;
+  }
+  uint8_t status;
+  auto iter = detached_ds_.find(ds_name);
+  if (iter == detached_ds_.end()) {
+    if (!construct(ds_type, ds_id, param_len, params)) {
+      return kAttachRefused;
+    }
+    status = kAttachConstructed;
+  } else {
+    auto &detached = iter->second;
+    if (detached.ds_type != ds_type) {
+      return kAttachTypeMismatch;
+    }
+    server_ds_ptrs_[ds_id] = std::move(detached.ptr);
+    server_ds_types_[ds_id] = ds_type;
+    server_ds_committed_bytes_[ds_id] = detached.committed_bytes;
+    *meta_len = detached.meta.size();
+    memcpy(meta, detached.meta.data(), *meta_len);
+    detached_ds_.erase(iter);
+    status = kAttachReattached;
+  }
+  bound_ds_names_.insert(ds_name);
+  server_ds_names_[ds_id] = std::move(ds_name);
+  return status;
+}
+
+bool Server::detach(uint8_t ds_id, uint8_t meta_len, const uint8_t *meta) {
+  if (!get_server_ds(ds_id) || server_ds_names_[ds_id].empty()) {
+    return false;
+  }
+  auto &ds_name = server_ds_names_[ds_id];
+
+  rt::ScopedLock<rt::Mutex> lock(&ds_names_mutex_);
+  bound_ds_names_.erase(ds_name);
+  // A name is either bound or detached, never both.
+  auto &detached = detached_ds_[std::move(ds_name)];
+  BUG_ON(detached.ptr);
+  detached.ds_type = server_ds_types_[ds_id];
+  detached.ptr = std::move(server_ds_ptrs_[ds_id]);
+  detached.meta.assign(meta, meta + meta_len);
+  detached.committed_bytes = server_ds_committed_bytes_[ds_id];
+  server_ds_committed_bytes_[ds_id] = 0;
+  ds_name.clear();
+  return true;
 }
 
 void Server::read_object(uint8_t ds_id, uint8_t obj_id_len,
                          const uint8_t *obj_id, uint16_t *data_len,
                          uint8_t *data_buf) {
-  auto ds_ptr = server_ds_ptrs_[ds_id].get();
-  if (!ds_ptr) {
-    ds_ptr = server_ds_ptrs_[kVanillaPtrDSID].get();
-  }
+  auto ds_ptr = get_object_ds(ds_id);
+  BUG_ON(!ds_ptr);
   ds_ptr->read_object(obj_id_len, obj_id, data_len, data_buf);
 }
 
 void Server::write_object(uint8_t ds_id, uint8_t obj_id_len,
                           const uint8_t *obj_id, uint16_t data_len,
                           const uint8_t *data_buf) {
-  auto ds_ptr = server_ds_ptrs_[ds_id].get();
-  if (!ds_ptr) {
-    ds_ptr = server_ds_ptrs_[kVanillaPtrDSID].get();
-  }
+  auto ds_ptr = get_object_ds(ds_id);
+  BUG_ON(!ds_ptr);
   ds_ptr->write_object(obj_id_len, obj_id, data_len, data_buf);
 }
 
 bool Server::remove_object(uint64_t ds_id, uint8_t obj_id_len,
                            const uint8_t *obj_id) {
-  auto ds_ptr = server_ds_ptrs_[ds_id].get();
-  if (!ds_ptr) {
-    ds_ptr = server_ds_ptrs_[kVanillaPtrDSID].get();
-  }
+  auto ds_ptr = get_object_ds(ds_id);
+  BUG_ON(!ds_ptr);
   return ds_ptr->remove_object(obj_id_len, obj_id);
 }
 
 void Server::compute(uint8_t ds_id, uint8_t opcode, uint16_t input_len,
                      const uint8_t *input_buf, uint16_t *output_len,
                      uint8_t *output_buf) {
-  auto ds_ptr = server_ds_ptrs_[ds_id].get();
+  auto ds_ptr = get_server_ds(ds_id);
+  BUG_ON(!ds_ptr);
   return ds_ptr->compute(opcode, input_len, input_buf, output_len, output_buf);
 }
 
 ServerDS *Server::get_server_ds(uint8_t ds_id) {
-  return server_ds_ptrs_[ds_id].get();
+  return ds_id < kMaxNumDSIDs ? server_ds_ptrs_[ds_id].get() : nullptr;
+}
+
+ServerDS *Server::get_object_ds(uint8_t ds_id) {
+  auto ds_ptr = get_server_ds(ds_id);
+  return ds_ptr ? ds_ptr : server_ds_ptrs_[kVanillaPtrDSID].get();
 }
 
 } // namespace far_memory
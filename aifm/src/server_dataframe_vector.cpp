@@ -7,6 +7,8 @@ extern "C" {
 #include "../DataFrame/AIFM/include/simple_time.hpp"
 #include "aggregator.hpp"
 #include "dataframe_vector.hpp"
+#include "groupby.hpp"
+#include "hash_join.hpp"
 #include "internal/dataframe_types.hpp"
 #include "server_dataframe_vector.hpp"
 
@@ -89,7 +91,7 @@ void ServerDataFrameVector<T>::compute_unique(uint16_t input_len,
   local_vec_size = *reinterpret_cast<const decltype(local_vec_size) *>(
       input_buf + sizeof(ds_id));
   auto *unique_dataframe_vec = reinterpret_cast<ServerDataFrameVector<T> *>(
-      Server::get_server_ds(ds_id));
+      server_->get_server_ds(ds_id));
   auto &unique_stl_vec = unique_dataframe_vec->vec_;
   _compute_unique(local_vec_size, unique_stl_vec);
   *output_len = 2 * sizeof(uint64_t);
@@ -130,14 +132,16 @@ void ServerDataFrameVector<T>::compute_copy_data_by_idx(
   uint8_t idx_vec_ds_id = input_buf[1];
   uint64_t idx_vec_size = *reinterpret_cast<const uint64_t *>(input_buf + 2);
   auto &ret_vec = reinterpret_cast<ServerDataFrameVector<T> *>(
-                      Server::get_server_ds(ret_ds_id))
+                      server_->get_server_ds(ret_ds_id))
                       ->vec_;
   auto &idx_vec = reinterpret_cast<ServerDataFrameVector<unsigned long long> *>(
-                      Server::get_server_ds(idx_vec_ds_id))
+                      server_->get_server_ds(idx_vec_ds_id))
                       ->vec_;
   ret_vec.reserve(idx_vec_size);
   for (uint64_t i = 0; i < idx_vec_size; i++) {
-    ret_vec.push_back(vec_[idx_vec[i]]);
+    auto idx = idx_vec[i];
+    ret_vec.push_back((idx == kJoinNullIdx) ? HashJoiner<T>::null_value()
+                                            : vec_[idx]);
   }
   *output_len = sizeof(uint64_t);
   *reinterpret_cast<uint64_t *>(output_buf) = ret_vec.capacity();
@@ -151,10 +155,10 @@ void ServerDataFrameVector<T>::compute_shuffle_data_by_idx(
   uint8_t idx_vec_ds_id = input_buf[1];
   uint64_t idx_vec_size = *reinterpret_cast<const uint64_t *>(input_buf + 2);
   auto &ret_vec = reinterpret_cast<ServerDataFrameVector<T> *>(
-                      Server::get_server_ds(ret_ds_id))
+                      server_->get_server_ds(ret_ds_id))
                       ->vec_;
   auto &idx_vec = reinterpret_cast<ServerDataFrameVector<unsigned long long> *>(
-                      Server::get_server_ds(idx_vec_ds_id))
+                      server_->get_server_ds(idx_vec_ds_id))
                       ->vec_;
   ret_vec.reserve(idx_vec_size);
   for (uint64_t i = 0; i < idx_vec_size; i++) {
@@ -176,7 +180,7 @@ void ServerDataFrameVector<T>::compute_assign(uint16_t input_len,
       input_buf + sizeof(from_vec_ds_id) + sizeof(from_vec_begin_idx));
   auto size = from_vec_end_idx - from_vec_begin_idx;
   auto &from_vec = reinterpret_cast<ServerDataFrameVector<T> *>(
-                       Server::get_server_ds(from_vec_ds_id))
+                       server_->get_server_ds(from_vec_ds_id))
                        ->vec_;
   vec_.resize(size);
   memcpy(vec_.data(), from_vec.data() + from_vec_begin_idx, size * sizeof(T));
@@ -184,6 +188,133 @@ void ServerDataFrameVector<T>::compute_assign(uint16_t input_len,
   *reinterpret_cast<uint64_t *>(output_buf) = vec_.capacity();
 }
 
+template <typename T>
+void ServerDataFrameVector<T>::compute_hash_join(uint16_t input_len,
+                                                 const uint8_t *input_buf,
+                                                 uint16_t *output_len,
+                                                 uint8_t *output_buf) {
+  uint8_t lhs_idx_ds_id = input_buf[0];
+  uint8_t rhs_idx_ds_id = input_buf[1];
+  uint8_t rhs_ds_id = input_buf[2];
+  auto join_type = static_cast<JoinType>(input_buf[3]);
+  uint64_t lhs_size = *reinterpret_cast<const uint64_t *>(input_buf + 4);
+  uint64_t rhs_size = *reinterpret_cast<const uint64_t *>(
+      input_buf + 4 + sizeof(lhs_size));
+  auto &lhs_idx_vec =
+      reinterpret_cast<ServerDataFrameVector<unsigned long long> *>(
+          server_->get_server_ds(lhs_idx_ds_id))
+          ->vec_;
+  auto &rhs_idx_vec =
+      reinterpret_cast<ServerDataFrameVector<unsigned long long> *>(
+          server_->get_server_ds(rhs_idx_ds_id))
+          ->vec_;
+  auto &rhs_vec = reinterpret_cast<ServerDataFrameVector<T> *>(
+                      server_->get_server_ds(rhs_ds_id))
+                      ->vec_;
+  HashJoiner<T>::join(
+      lhs_size, rhs_size, [&](uint64_t idx) -> T { return vec_[idx]; },
+      [&](uint64_t idx) -> T { return rhs_vec[idx]; }, join_type,
+      [&](unsigned long long lhs_idx, unsigned long long rhs_idx) {
+        lhs_idx_vec.push_back(lhs_idx);
+        rhs_idx_vec.push_back(rhs_idx);
+      });
+  *output_len = 3 * sizeof(uint64_t);
+  *reinterpret_cast<uint64_t *>(output_buf) = lhs_idx_vec.size();
+  *(reinterpret_cast<uint64_t *>(output_buf) + 1) = lhs_idx_vec.capacity();
+  *(reinterpret_cast<uint64_t *>(output_buf) + 2) = rhs_idx_vec.capacity();
+}
+
+template <typename T>
+void ServerDataFrameVector<T>::compute_hash_group(uint16_t input_len,
+                                                  const uint8_t *input_buf,
+                                                  uint16_t *output_len,
+                                                  uint8_t *output_buf) {
+  uint8_t group_ids_ds_id = input_buf[0];
+  uint8_t first_idx_ds_id = input_buf[1];
+  bool has_prev = input_buf[2];
+  uint8_t prev_ds_id = input_buf[3];
+  uint64_t size = *reinterpret_cast<const uint64_t *>(input_buf + 4);
+  auto &group_ids =
+      reinterpret_cast<ServerDataFrameVector<unsigned long long> *>(
+          server_->get_server_ds(group_ids_ds_id))
+          ->vec_;
+  auto &first_idx =
+      reinterpret_cast<ServerDataFrameVector<unsigned long long> *>(
+          server_->get_server_ds(first_idx_ds_id))
+          ->vec_;
+  const unsigned long long *prev_group_ids =
+      has_prev ? reinterpret_cast<ServerDataFrameVector<unsigned long long> *>(
+                     server_->get_server_ds(prev_ds_id))
+                     ->vec_.data()
+               : nullptr;
+  group_ids.reserve(size);
+  auto num_groups = HashGrouper<T>::group(
+      size, [&](uint64_t idx) -> T { return vec_[idx]; },
+      [&](uint64_t idx) -> unsigned long long {
+        return prev_group_ids ? prev_group_ids[idx] : 0;
+      },
+      [&](unsigned long long group_id) { group_ids.push_back(group_id); },
+      [&](unsigned long long idx) { first_idx.push_back(idx); });
+  *output_len = 3 * sizeof(uint64_t);
+  *reinterpret_cast<uint64_t *>(output_buf) = num_groups;
+  *(reinterpret_cast<uint64_t *>(output_buf) + 1) = group_ids.capacity();
+  *(reinterpret_cast<uint64_t *>(output_buf) + 2) = first_idx.capacity();
+}
+
+template <typename T>
+void ServerDataFrameVector<T>::compute_aggregate_by_group(
+    uint16_t input_len, const uint8_t *input_buf, uint16_t *output_len,
+    uint8_t *output_buf) {
+  uint8_t result_ds_id = input_buf[0];
+  uint8_t group_ids_ds_id = input_buf[1];
+  auto op = static_cast<AggregateOp>(input_buf[2]);
+  uint64_t num_groups = *reinterpret_cast<const uint64_t *>(input_buf + 3);
+  uint64_t size = *reinterpret_cast<const uint64_t *>(input_buf + 3 +
+                                                      sizeof(num_groups));
+  double q;
+  __builtin_memcpy(&q, input_buf + 3 + sizeof(num_groups) + sizeof(size),
+                   sizeof(q));
+  bool exact = input_buf[3 + sizeof(num_groups) + sizeof(size) + sizeof(q)];
+  auto &group_ids =
+      reinterpret_cast<ServerDataFrameVector<unsigned long long> *>(
+          server_->get_server_ds(group_ids_ds_id))
+          ->vec_;
+  auto group_id_fn = [&](uint64_t idx) -> unsigned long long {
+    return group_ids[idx];
+  };
+  uint64_t result_size, result_capacity;
+  if (op == AggCount) {
+    auto &result_vec =
+        reinterpret_cast<ServerDataFrameVector<unsigned long long> *>(
+            server_->get_server_ds(result_ds_id))
+            ->vec_;
+    result_vec.reserve(num_groups);
+    HashGrouper<T>::count(size, num_groups, group_id_fn,
+                          [&](uint64_t count) { result_vec.push_back(count); });
+    result_size = result_vec.size();
+    result_capacity = result_vec.capacity();
+  } else {
+    auto &result_vec = reinterpret_cast<ServerDataFrameVector<T> *>(
+                           server_->get_server_ds(result_ds_id))
+                           ->vec_;
+    result_vec.reserve(num_groups);
+    auto get_fn = [&](uint64_t idx) -> T { return vec_[idx]; };
+    auto emit_fn = [&](const T &value) { result_vec.push_back(value); };
+    if (op == AggQuantile) {
+      HashGrouper<T>::quantile(size, num_groups, q, exact, get_fn, group_id_fn,
+                               emit_fn);
+    } else {
+      HashGrouper<T>::aggregate(op, size, num_groups, get_fn, group_id_fn,
+                                emit_fn);
+    }
+    result_size = result_vec.size();
+    result_capacity = result_vec.capacity();
+  }
+  *output_len = 2 * sizeof(uint64_t);
+  *reinterpret_cast<uint64_t *>(output_buf) = result_size;
+  *(reinterpret_cast<uint64_t *>(output_buf) + 1) = result_capacity;
+}
+
 template <typename T>
 void ServerDataFrameVector<T>::compute_aggregate(uint8_t opcode,
                                                  uint16_t input_len,
@@ -197,51 +328,58 @@ void ServerDataFrameVector<T>::compute_aggregate(uint8_t opcode,
       input_buf + sizeof(result_ds) + sizeof(key_ds));
   uint8_t key_dt_id =
       input_buf[sizeof(result_ds) + sizeof(key_ds) + sizeof(size)];
+  double quantile;
+  __builtin_memcpy(&quantile,
+                   input_buf + sizeof(result_ds) + sizeof(key_ds) +
+                       sizeof(size) + sizeof(key_dt_id),
+                   sizeof(quantile));
+  bool exact = input_buf[sizeof(result_ds) + sizeof(key_ds) + sizeof(size) +
+                         sizeof(key_dt_id) + sizeof(quantile)];
   uint64_t result_size, result_capacity;
   switch (key_dt_id) {
   case DataFrameTypeID::Char:
-    std::tie(result_size, result_capacity) =
-        _compute_aggregate<char>(opcode, result_ds, key_ds, size);
+    std::tie(result_size, result_capacity) = _compute_aggregate<char>(
+        opcode, result_ds, key_ds, size, quantile, exact);
     break;
   case DataFrameTypeID::Short:
-    std::tie(result_size, result_capacity) =
-        _compute_aggregate<short>(opcode, result_ds, key_ds, size);
+    std::tie(result_size, result_capacity) = _compute_aggregate<short>(
+        opcode, result_ds, key_ds, size, quantile, exact);
     break;
   case DataFrameTypeID::Int:
-    std::tie(result_size, result_capacity) =
-        _compute_aggregate<int>(opcode, result_ds, key_ds, size);
+    std::tie(result_size, result_capacity) = _compute_aggregate<int>(
+        opcode, result_ds, key_ds, size, quantile, exact);
     break;
   case DataFrameTypeID::UnsignedInt:
-    std::tie(result_size, result_capacity) =
-        _compute_aggregate<unsigned int>(opcode, result_ds, key_ds, size);
+    std::tie(result_size, result_capacity) = _compute_aggregate<unsigned int>(
+        opcode, result_ds, key_ds, size, quantile, exact);
     break;
   case DataFrameTypeID::Long:
-    std::tie(result_size, result_capacity) =
-        _compute_aggregate<long>(opcode, result_ds, key_ds, size);
+    std::tie(result_size, result_capacity) = _compute_aggregate<long>(
+        opcode, result_ds, key_ds, size, quantile, exact);
     break;
   case DataFrameTypeID::UnsignedLong:
-    std::tie(result_size, result_capacity) =
-        _compute_aggregate<unsigned long>(opcode, result_ds, key_ds, size);
+    std::tie(result_size, result_capacity) = _compute_aggregate<unsigned long>(
+        opcode, result_ds, key_ds, size, quantile, exact);
     break;
   case DataFrameTypeID::LongLong:
-    std::tie(result_size, result_capacity) =
-        _compute_aggregate<long long>(opcode, result_ds, key_ds, size);
+    std::tie(result_size, result_capacity) = _compute_aggregate<long long>(
+        opcode, result_ds, key_ds, size, quantile, exact);
     break;
   case DataFrameTypeID::UnsignedLongLong:
-    std::tie(result_size, result_capacity) =
-        _compute_aggregate<unsigned long long>(opcode, result_ds, key_ds, size);
+    std::tie(result_size, result_capacity) = _compute_aggregate<unsigned long long>(
+        opcode, result_ds, key_ds, size, quantile, exact);
     break;
   case DataFrameTypeID::Float:
-    std::tie(result_size, result_capacity) =
-        _compute_aggregate<float>(opcode, result_ds, key_ds, size);
+    std::tie(result_size, result_capacity) = _compute_aggregate<float>(
+        opcode, result_ds, key_ds, size, quantile, exact);
     break;
   case DataFrameTypeID::Double:
-    std::tie(result_size, result_capacity) =
-        _compute_aggregate<double>(opcode, result_ds, key_ds, size);
+    std::tie(result_size, result_capacity) = _compute_aggregate<double>(
+        opcode, result_ds, key_ds, size, quantile, exact);
     break;
   case DataFrameTypeID::Time:
-    std::tie(result_size, result_capacity) =
-        _compute_aggregate<SimpleTime>(opcode, result_ds, key_ds, size);
+    std::tie(result_size, result_capacity) = _compute_aggregate<SimpleTime>(
+        opcode, result_ds, key_ds, size, quantile, exact);
     break;
   default:
     BUG();
@@ -255,15 +393,17 @@ template <typename T>
 template <typename Key_t>
 std::pair<uint64_t, uint64_t>
 ServerDataFrameVector<T>::_compute_aggregate(uint8_t opcode, uint8_t result_ds,
-                                             uint8_t key_ds, uint64_t size) {
+                                             uint8_t key_ds, uint64_t size,
+                                             double quantile, bool exact) {
   auto &result_vec = reinterpret_cast<ServerDataFrameVector<T> *>(
-                         Server::get_server_ds(result_ds))
+                         server_->get_server_ds(result_ds))
                          ->vec_;
   auto &key_vec = reinterpret_cast<ServerDataFrameVector<Key_t> *>(
-                      Server::get_server_ds(key_ds))
+                      server_->get_server_ds(key_ds))
                       ->vec_;
   std::unique_ptr<Aggregator<T>> aggregator(
-      AggregatorFactory<T>::build(opcode, /* limited_mem */ false, nullptr));
+      AggregatorFactory<T>::build(opcode, /* limited_mem */ false, nullptr,
+                                  quantile, exact));
   DerefScope *scope =
       nullptr; // Never used. Just for complying with add()'s interface.
   Key_t last_key = key_vec[0];
@@ -303,8 +443,18 @@ void ServerDataFrameVector<T>::compute(uint8_t opcode, uint16_t input_len,
   case GenericDataFrameVector::OpCode::AggregateMax:
   case GenericDataFrameVector::OpCode::AggregateMin:
   case GenericDataFrameVector::OpCode::AggregateMedian:
+  case GenericDataFrameVector::OpCode::AggregateQuantile:
     compute_aggregate(opcode, input_len, input_buf, output_len, output_buf);
     break;
+  case GenericDataFrameVector::OpCode::HashJoin:
+    compute_hash_join(input_len, input_buf, output_len, output_buf);
+    break;
+  case GenericDataFrameVector::OpCode::HashGroup:
+    compute_hash_group(input_len, input_buf, output_len, output_buf);
+    break;
+  case GenericDataFrameVector::OpCode::AggregateByGroup:
+    compute_aggregate_by_group(input_len, input_buf, output_len, output_buf);
+    break;
   default:
     BUG();
   }
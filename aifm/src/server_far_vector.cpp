@@ -0,0 +1,144 @@
+extern "C" {
+#include <base/assert.h>
+#include <base/compiler.h>
+#include <base/stddef.h>
+}
+
+#include "far_vector.hpp"
+#include "server_far_vector.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace far_memory {
+
+ServerFarVector::ServerFarVector(uint32_t item_size,
+                                 uint32_t chunk_num_entries)
+    : item_size_(item_size), chunk_num_entries_(chunk_num_entries),
+      chunk_size_(item_size * chunk_num_entries) {}
+
+ServerFarVector::~ServerFarVector() {}
+
+uint64_t ServerFarVector::capacity() const { return buf_.size() / item_size_; }
+
+void ServerFarVector::grow_to(uint64_t num) {
+  auto num_chunks = (num == 0) ? 0 : (num - 1) / chunk_num_entries_ + 1;
+  if (num_chunks * chunk_size_ > buf_.size()) {
+    buf_.resize(num_chunks * chunk_size_);
+  }
+}
+
+void ServerFarVector::read_object(uint8_t obj_id_len, const uint8_t *obj_id,
+                                  uint16_t *data_len, uint8_t *data_buf) {
+  auto reader_lock = lock_.get_reader_lock();
+  uint64_t index;
+  assert(obj_id_len == sizeof(index));
+  index = *reinterpret_cast<const uint64_t *>(obj_id);
+  assert((index + 1) * chunk_size_ <= buf_.size());
+  *data_len = chunk_size_;
+  __builtin_memcpy(data_buf, buf_.data() + index * chunk_size_, chunk_size_);
+}
+
+void ServerFarVector::write_object(uint8_t obj_id_len, const uint8_t *obj_id,
+                                   uint16_t data_len,
+                                   const uint8_t *data_buf) {
+  auto reader_lock = lock_.get_reader_lock();
+  uint64_t index;
+  assert(obj_id_len == sizeof(index));
+  index = *reinterpret_cast<const uint64_t *>(obj_id);
+  assert(data_len == chunk_size_);
+  assert((index + 1) * chunk_size_ <= buf_.size());
+  __builtin_memcpy(buf_.data() + index * chunk_size_, data_buf, chunk_size_);
+}
+
+bool ServerFarVector::remove_object(uint8_t obj_id_len,
+                                    const uint8_t *obj_id) {
+  // This should never be called.
+  BUG();
+}
+
+void ServerFarVector::compute_reserve(uint16_t input_len,
+                                      const uint8_t *input_buf,
+                                      uint16_t *output_len,
+                                      uint8_t *output_buf) {
+  auto writer_lock_np = lock_.get_writer_lock_np();
+  uint64_t new_capacity;
+  assert(input_len == sizeof(new_capacity));
+  new_capacity = *reinterpret_cast<const uint64_t *>(input_buf);
+  grow_to(new_capacity);
+  *output_len = sizeof(uint64_t);
+  *reinterpret_cast<uint64_t *>(output_buf) = capacity();
+}
+
+void ServerFarVector::compute_assign(uint16_t input_len,
+                                     const uint8_t *input_buf,
+                                     uint16_t *output_len,
+                                     uint8_t *output_buf) {
+  uint8_t from_ds_id;
+  uint64_t begin_idx, end_idx;
+  assert(input_len ==
+         sizeof(from_ds_id) + sizeof(begin_idx) + sizeof(end_idx));
+  from_ds_id = input_buf[0];
+  begin_idx =
+      *reinterpret_cast<const uint64_t *>(input_buf + sizeof(from_ds_id));
+  end_idx = *reinterpret_cast<const uint64_t *>(
+      input_buf + sizeof(from_ds_id) + sizeof(begin_idx));
+  auto *from_vec =
+      reinterpret_cast<ServerFarVector *>(server_->get_server_ds(from_ds_id));
+  BUG_ON(from_vec->item_size_ != item_size_);
+  auto len = (end_idx - begin_idx) * item_size_;
+
+  // Holds from_vec's reader lock so that it cannot be resized under the copy.
+  // The two locks are taken in address order, which keeps two assigns in
+  // opposite directions from deadlocking. Either may yield, so neither lock
+  // disables preemption.
+  if (from_vec == this) {
+    lock_.lock_writer();
+  } else if (this < from_vec) {
+    lock_.lock_writer();
+    from_vec->lock_.lock_reader();
+  } else {
+    from_vec->lock_.lock_reader();
+    lock_.lock_writer();
+  }
+  auto unlock_guard = helpers::finally([&] {
+    if (from_vec != this) {
+      from_vec->lock_.unlock_reader();
+    }
+    lock_.unlock_writer();
+  });
+  if (from_vec == this) {
+    memmove(buf_.data(), buf_.data() + begin_idx * item_size_, len);
+  } else {
+    grow_to(end_idx - begin_idx);
+    memcpy(buf_.data(), from_vec->buf_.data() + begin_idx * item_size_, len);
+  }
+  *output_len = sizeof(uint64_t);
+  *reinterpret_cast<uint64_t *>(output_buf) = capacity();
+}
+
+void ServerFarVector::compute(uint8_t opcode, uint16_t input_len,
+                              const uint8_t *input_buf, uint16_t *output_len,
+                              uint8_t *output_buf) {
+  switch (opcode) {
+  case GenericFarVector::OpCode::Reserve:
+    compute_reserve(input_len, input_buf, output_len, output_buf);
+    break;
+  case GenericFarVector::OpCode::Assign:
+    compute_assign(input_len, input_buf, output_len, output_buf);
+    break;
+  default:
+    BUG();
+  }
+}
+
+ServerDS *ServerFarVectorFactory::build(uint32_t param_len, uint8_t *params) {
+  uint32_t item_size, chunk_num_entries;
+  BUG_ON(param_len != sizeof(item_size) + sizeof(chunk_num_entries));
+  item_size = *reinterpret_cast<uint32_t *>(params);
+  chunk_num_entries =
+      *reinterpret_cast<uint32_t *>(params + sizeof(item_size));
+  return new ServerFarVector(item_size, chunk_num_entries);
+}
+
+}; // namespace far_memory
@@ -0,0 +1,148 @@
+extern "C" {
+#include <base/assert.h>
+#include <base/compiler.h>
+}
+
+#include "server_memory.hpp"
+
+#include <algorithm>
+#include <linux/mempolicy.h>
+#include <linux/mman.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace far_memory {
+
+ServerMemory::ServerMemory(uint64_t len, int numa_node)
+    : len_(helpers::round_to_hugepage_size(len)) {
+  // Reserves the address range first, aligned for huge pages.
+  auto reserved_len = len_ + helpers::kHugepageSize;
+  auto *reserved = static_cast<uint8_t *>(
+      mmap(nullptr, reserved_len, PROT_NONE,
+           MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0));
+  BUG_ON(reserved == MAP_FAILED);
+  addr_ = reinterpret_cast<uint8_t *>(
+      helpers::round_to_hugepage_size(reinterpret_cast<uint64_t>(reserved)));
+  if (addr_ != reserved) {
+    BUG_ON(munmap(reserved, addr_ - reserved));
+  }
+  auto tail_len = reserved + reserved_len - (addr_ + len_);
+  if (tail_len) {
+    BUG_ON(munmap(addr_ + len_, tail_len));
+  }
+
+  map_chunks();
+  set_numa_policy(numa_node);
+
+#ifndef DISABLE_SERVER_MEM_PREFAULT
+  auto num_threads = std::min(static_cast<uint64_t>(kNumPrefaultThreads),
+                              len_ / helpers::kHugepageSize);
+  for (uint32_t tid = 0; tid < num_threads; tid++) {
+    // Splits at huge page boundaries.
+    auto begin = len_ / helpers::kHugepageSize * tid / num_threads *
+                 helpers::kHugepageSize;
+    auto end = len_ / helpers::kHugepageSize * (tid + 1) / num_threads *
+               helpers::kHugepageSize;
+    prefault_threads_.emplace_back(
+        rt::Thread([&, begin, end]() { prefault(begin, end); }));
+  }
+#endif
+}
+
+ServerMemory::~ServerMemory() {
+  stop_prefaulting_ = true;
+  for (auto &thread : prefault_threads_) {
+    thread.Join();
+  }
+  BUG_ON(munmap(addr_, len_));
+}
+
+void ServerMemory::map_chunks() {
+  bool hugetlb_exhausted = false;
+  for (uint64_t offset = 0; offset < len_; offset += kMapChunkSize) {
+    auto *chunk = addr_ + offset;
+    auto chunk_len = std::min(kMapChunkSize, len_ - offset);
+    if (!hugetlb_exhausted) {
+      // Fails if the hugetlbfs pool cannot reserve the whole chunk.
+      auto *ret = mmap(chunk, chunk_len, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED | MAP_HUGETLB |
+                           MAP_HUGE_2MB,
+                       -1, 0);
+      if (ret != MAP_FAILED) {
+        num_hugetlb_bytes_ += chunk_len;
+        continue;
+      }
+      hugetlb_exhausted = true;
+    }
+    auto *ret = mmap(chunk, chunk_len, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED | MAP_NORESERVE,
+                     -1, 0);
+    BUG_ON(ret == MAP_FAILED);
+    BUG_ON(madvise(chunk, chunk_len, MADV_HUGEPAGE));
+  }
+}
+
+void ServerMemory::set_numa_policy(int numa_node) {
+  auto num_nodes = get_num_numa_nodes();
+  if (num_nodes <= 1) {
+    return;
+  }
+  unsigned long mask;
+  int mode;
+  if (numa_node == kInterleaved) {
+    mask = (num_nodes >= 64) ? ~0UL : ((1UL << num_nodes) - 1);
+    mode = MPOL_INTERLEAVE;
+  } else {
+    BUG_ON(numa_node < 0 || numa_node >= std::min(num_nodes, 64));
+    mask = (1UL << numa_node);
+    // Not MPOL_BIND, which would raise SIGBUS on faults once the node runs
+    // out of huge pages.
+    mode = MPOL_PREFERRED;
+  }
+  // Applies to the pages faulted in afterwards.
+  BUG_ON(syscall(SYS_mbind, addr_, len_, mode, &mask, sizeof(mask) * 8 + 1,
+                 0));
+}
+
+void ServerMemory::prefault(uint64_t begin, uint64_t end) {
+  for (auto offset = begin; offset < end && !stop_prefaulting_;
+       offset += helpers::kPageSize) {
+    // An atomic no-op write, which faults the page in without racing with
+    // concurrent writers.
+    __atomic_fetch_add(addr_ + offset, 0, __ATOMIC_RELAXED);
+    if (offset % helpers::kHugepageSize == 0) {
+      thread_yield();
+    }
+  }
+}
+
+uint8_t *ServerMemory::get() const { return addr_; }
+
+uint64_t ServerMemory::size() const { return len_; }
+
+uint64_t ServerMemory::get_num_hugetlb_bytes() const {
+  return num_hugetlb_bytes_;
+}
+
+int ServerMemory::get_num_numa_nodes() {
+  static int num_nodes = []() {
+    int num = 0;
+    while (access(("/sys/devices/system/node/node" + std::to_string(num))
+                      .c_str(),
+                  F_OK) == 0) {
+      num++;
+    }
+    return std::max(num, 1);
+  }();
+  return num_nodes;
+}
+
+int ServerMemory::get_numa_node() {
+  unsigned cpu, node;
+  BUG_ON(syscall(SYS_getcpu, &cpu, &node, nullptr));
+  return node;
+}
+
+} // namespace far_memory
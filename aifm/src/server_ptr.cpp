@@ -14,7 +14,9 @@ ServerPtr::ServerPtr(uint32_t param_len, uint8_t *params) {
   uint64_t size;
   BUG_ON(param_len != sizeof(decltype(size)));
   size = *(reinterpret_cast<decltype(size) *>(params));
-  buf_.reset(reinterpret_cast<uint8_t *>(malloc(size)));
+  // Shared by all connections, whose threads migrate across the cores.
+  mem_.reset(new ServerMemory(size, ServerMemory::kInterleaved));
+  buf_ = mem_->get();
 }
 
 ServerPtr::~ServerPtr() {}
@@ -23,7 +25,7 @@ void ServerPtr::read_object(uint8_t obj_id_len, const uint8_t *obj_id,
                             uint16_t *data_len, uint8_t *data_buf) {
   const uint64_t &object_id = *(reinterpret_cast<const uint64_t *>(obj_id));
   assert(obj_id_len == sizeof(decltype(object_id)));
-  auto remote_object_addr = reinterpret_cast<uint64_t>(buf_.get()) + object_id;
+  auto remote_object_addr = reinterpret_cast<uint64_t>(buf_) + object_id;
   Object remote_object(remote_object_addr);
   *data_len = remote_object.get_data_len();
   memcpy(data_buf, reinterpret_cast<uint8_t *>(remote_object.get_data_addr()),
@@ -34,7 +36,7 @@ void ServerPtr::write_object(uint8_t obj_id_len, const uint8_t *obj_id,
                              uint16_t data_len, const uint8_t *data_buf) {
   const uint64_t &object_id = *(reinterpret_cast<const uint64_t *>(obj_id));
   assert(obj_id_len == sizeof(decltype(object_id)));
-  auto remote_object_addr = reinterpret_cast<uint64_t>(buf_.get()) + object_id;
+  auto remote_object_addr = reinterpret_cast<uint64_t>(buf_) + object_id;
   Object remote_object(remote_object_addr);
   memcpy(reinterpret_cast<uint8_t *>(remote_object.get_data_addr()), data_buf,
          data_len);
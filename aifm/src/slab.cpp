@@ -1,46 +1,349 @@
 #include "slab.hpp"
 
+#include <sys/mman.h>
+
+#include <algorithm>
+
 namespace far_memory {
 
-Slab::Slab(uint8_t *base, uint64_t len) : base_(base), len_(len), cur_(base) {}
+Slab::Slab(uint8_t *base, uint64_t len)
+    : base_(base), len_(len), num_pages_(len >> helpers::kPageShift),
+      page_map_(new Span *[num_pages_]()), num_free_pages_(0) {
+  BUG_ON(reinterpret_cast<uint64_t>(base) % helpers::kPageSize);
+  for (auto &per_core_caches : core_caches_) {
+    for (auto &cache : per_core_caches) {
+      cache.loaded = new Magazine();
+      cache.prev = new Magazine();
+    }
+  }
+  if (num_pages_) {
+    add_free_extent(0, num_pages_);
+  }
+}
+
+Slab::~Slab() {
+  for (auto &per_core_caches : core_caches_) {
+    for (auto &cache : per_core_caches) {
+      delete cache.loaded;
+      delete cache.prev;
+    }
+  }
+  for (auto &slab_class : slab_classes_) {
+    for (auto *magazine : slab_class.full_magazines) {
+      delete magazine;
+    }
+    for (auto *magazine : slab_class.empty_magazines) {
+      delete magazine;
+    }
+  }
+  for (uint64_t page = 0; page < num_pages_;) {
+    auto *span = page_map_[page];
+    if (span) {
+      page += span->num_pages;
+      delete span;
+    } else {
+      page++;
+    }
+  }
+}
+
+void Slab::add_free_extent(uint64_t first_page, uint64_t num_pages) {
+  free_extents_.emplace(first_page, num_pages);
+  free_extents_by_size_.emplace(num_pages, first_page);
+  num_free_pages_ += num_pages;
+}
+
+void Slab::remove_free_extent(uint64_t first_page, uint64_t num_pages) {
+  free_extents_.erase(first_page);
+  free_extents_by_size_.erase(std::make_pair(num_pages, first_page));
+  num_free_pages_ -= num_pages;
+}
+
+Slab::Span *Slab::allocate_span(uint64_t num_pages, uint32_t slab_idx) {
+  Span *span;
+  {
+    page_heap_spin_.Lock();
+    auto guard = helpers::finally([&]() { page_heap_spin_.Unlock(); });
+
+    // Best fit, and the lowest address among the equally good ones.
+    auto iter = free_extents_by_size_.lower_bound(std::make_pair(num_pages, 0));
+    if (unlikely(iter == free_extents_by_size_.end())) {
+      return nullptr;
+    }
+    auto [extent_num_pages, first_page] = *iter;
+    remove_free_extent(first_page, extent_num_pages);
+    if (extent_num_pages > num_pages) {
+      add_free_extent(first_page + num_pages, extent_num_pages - num_pages);
+    }
+    span = new Span{
+        .first_page = first_page, .num_pages = num_pages, .slab_idx = slab_idx};
+  }
+  for (uint64_t i = 0; i < num_pages; i++) {
+    page_map_[span->first_page + i] = span;
+  }
+  return span;
+}
+
+void Slab::coalesce_free_extent(uint64_t *first_page, uint64_t *num_pages) {
+  auto next = free_extents_.lower_bound(*first_page);
+  if (next != free_extents_.end() && next->first == *first_page + *num_pages) {
+    auto next_num_pages = next->second;
+    remove_free_extent(next->first, next_num_pages);
+    *num_pages += next_num_pages;
+  }
+  auto prev = free_extents_.lower_bound(*first_page);
+  if (prev != free_extents_.begin()) {
+    prev--;
+    if (prev->first + prev->second == *first_page) {
+      auto prev_first_page = prev->first;
+      auto prev_num_pages = prev->second;
+      remove_free_extent(prev_first_page, prev_num_pages);
+      *first_page = prev_first_page;
+      *num_pages += prev_num_pages;
+    }
+  }
+}
+
+void Slab::free_span(Span *span) {
+  auto first_page = span->first_page;
+  auto num_pages = span->num_pages;
+  for (uint64_t i = 0; i < num_pages; i++) {
+    page_map_[first_page + i] = nullptr;
+  }
+  delete span;
+
+  // Only the hugepages that the span has just made entirely free get their
+  // physical memory released, since splitting a transparent hugepage to
+  // release a part of it is way more expensive than the syscall itself. The
+  // other entirely free hugepages in the extent were released before.
+  auto span_begin = reinterpret_cast<uint64_t>(get_page_addr(first_page));
+  auto span_end = span_begin + (num_pages << helpers::kPageShift);
+  uint64_t release_begin, release_end;
+  {
+    page_heap_spin_.Lock();
+    auto guard = helpers::finally([&]() { page_heap_spin_.Unlock(); });
+
+    coalesce_free_extent(&first_page, &num_pages);
+    auto extent_begin = reinterpret_cast<uint64_t>(get_page_addr(first_page));
+    auto extent_end = extent_begin + (num_pages << helpers::kPageShift);
+    constexpr uint64_t kHugepageSize = helpers::kHugepageSize;
+    release_begin = std::max(helpers::align_to(extent_begin, kHugepageSize),
+                             span_begin & ~(kHugepageSize - 1));
+    release_end = std::min(extent_end & ~(kHugepageSize - 1),
+                           helpers::align_to(span_end, kHugepageSize));
+    if (release_begin >= release_end) {
+      add_free_extent(first_page, num_pages);
+      return;
+    }
+    // The released hugepages stay out of the heap until the syscall is done,
+    // so that nobody reuses them in the meantime.
+    auto release_first_page = get_page(release_begin);
+    auto release_end_page = get_page(release_end);
+    if (first_page < release_first_page) {
+      add_free_extent(first_page, release_first_page - first_page);
+    }
+    if (release_end_page < first_page + num_pages) {
+      add_free_extent(release_end_page,
+                      first_page + num_pages - release_end_page);
+    }
+  }
+
+  // Releases the physical memory, which is zero-filled on the next touch.
+  BUG_ON(madvise(reinterpret_cast<void *>(release_begin),
+                 release_end - release_begin, MADV_DONTNEED) != 0);
 
-Slab::~Slab() {}
+  first_page = get_page(release_begin);
+  num_pages = (release_end - release_begin) >> helpers::kPageShift;
+  page_heap_spin_.Lock();
+  auto guard = helpers::finally([&]() { page_heap_spin_.Unlock(); });
+  coalesce_free_extent(&first_page, &num_pages);
+  add_free_extent(first_page, num_pages);
+}
 
-void Slab::replenish(uint32_t slab_idx) {
-  spin_.Lock();
-  auto guard = helpers::finally([&]() { spin_.Unlock(); });
+void Slab::link_partial(SlabClass *slab_class, Span *span) {
+  assert(!span->is_partial);
+  span->is_partial = true;
+  span->prev = nullptr;
+  span->next = slab_class->partial_spans;
+  if (span->next) {
+    span->next->prev = span;
+  }
+  slab_class->partial_spans = span;
+}
 
+void Slab::unlink_partial(SlabClass *slab_class, Span *span) {
+  assert(span->is_partial);
+  span->is_partial = false;
+  if (span->prev) {
+    span->prev->next = span->next;
+  } else {
+    slab_class->partial_spans = span->next;
+  }
+  if (span->next) {
+    span->next->prev = span->prev;
+  }
+}
+
+void Slab::refill(uint32_t slab_idx, Magazine *magazine) {
+  auto *slab_class = &slab_classes_[slab_idx];
   auto slab_size = get_slab_size(slab_idx);
-  for (uint32_t i = 0;
-       i < kReplenishChunkSize && cur_ + slab_size <= base_.get() + len_;
-       i++, cur_ += slab_size) {
-    slabs_[get_core_num()][slab_idx].push_back(cur_);
+  auto magazine_size = get_magazine_size(slab_idx);
+
+  while (magazine->num < magazine_size) {
+    auto *span = slab_class->partial_spans;
+    if (!span) {
+      span = allocate_span(get_span_num_pages(slab_idx), slab_idx);
+      if (unlikely(!span)) {
+        return;
+      }
+      link_partial(slab_class, span);
+    }
+    auto num_objs = (span->num_pages << helpers::kPageShift) / slab_size;
+    while (magazine->num < magazine_size && span->num_used < num_objs) {
+      uint8_t *obj;
+      if (span->free_list) {
+        obj = span->free_list;
+        span->free_list = *reinterpret_cast<uint8_t **>(obj);
+      } else {
+        obj = get_page_addr(span->first_page) + span->num_carved * slab_size;
+        span->num_carved++;
+      }
+      span->num_used++;
+      magazine->objs[magazine->num++] = obj;
+    }
+    if (span->num_used == num_objs) {
+      unlink_partial(slab_class, span);
+    }
+  }
+}
+
+void Slab::drain(uint32_t slab_idx, Magazine *magazine,
+                 std::vector<Span *> *empty_spans) {
+  auto *slab_class = &slab_classes_[slab_idx];
+
+  while (magazine->num) {
+    auto *obj = magazine->objs[--magazine->num];
+    auto *span = get_span(obj);
+    assert(span && span->slab_idx == slab_idx);
+    *reinterpret_cast<uint8_t **>(obj) = span->free_list;
+    span->free_list = obj;
+    if (!span->is_partial) {
+      link_partial(slab_class, span);
+    }
+    if (--span->num_used == 0) {
+      unlink_partial(slab_class, span);
+      empty_spans->push_back(span);
+    }
+  }
+}
+
+bool Slab::reload(uint32_t slab_idx, CoreCache *cache) {
+  auto *slab_class = &slab_classes_[slab_idx];
+  slab_class->spin.Lock();
+  auto guard = helpers::finally([&]() { slab_class->spin.Unlock(); });
+
+  if (!slab_class->full_magazines.empty()) {
+    slab_class->empty_magazines.push_back(cache->prev);
+    cache->prev = cache->loaded;
+    cache->loaded = slab_class->full_magazines.back();
+    slab_class->full_magazines.pop_back();
+    return true;
   }
+  refill(slab_idx, cache->loaded);
+  return cache->loaded->num;
+}
+
+void Slab::unload(uint32_t slab_idx, CoreCache *cache) {
+  auto *slab_class = &slab_classes_[slab_idx];
+  std::vector<Span *> empty_spans;
+  {
+    slab_class->spin.Lock();
+    auto guard = helpers::finally([&]() { slab_class->spin.Unlock(); });
+
+    auto *full = cache->prev;
+    cache->prev = cache->loaded;
+    if (slab_class->empty_magazines.empty()) {
+      cache->loaded = new Magazine();
+    } else {
+      cache->loaded = slab_class->empty_magazines.back();
+      slab_class->empty_magazines.pop_back();
+    }
+    if (slab_class->full_magazines.size() < kMaxNumDepotMagazines) {
+      slab_class->full_magazines.push_back(full);
+      return;
+    }
+    // The depot is full, so the objects go back to their spans.
+    drain(slab_idx, full, &empty_spans);
+    if (slab_class->empty_magazines.size() < kMaxNumDepotMagazines) {
+      slab_class->empty_magazines.push_back(full);
+    } else {
+      delete full;
+    }
+  }
+  // Out of the class lock, as releasing the memory takes a syscall.
+  for (auto *span : empty_spans) {
+    free_span(span);
+  }
+}
+
+uint8_t *Slab::allocate_large(uint64_t size) {
+  auto num_pages = (size - 1) / helpers::kPageSize + 1;
+  auto *span = allocate_span(num_pages, kLargeObjectIdx);
+  return span ? get_page_addr(span->first_page) : nullptr;
+}
+
+void Slab::free_large(uint8_t *ptr) {
+  auto *span = get_span(ptr);
+  BUG_ON(!span || span->slab_idx != kLargeObjectIdx ||
+         get_page_addr(span->first_page) != ptr);
+  free_span(span);
 }
 
 uint8_t *Slab::allocate(uint32_t size) {
+  if (unlikely(size > kMaxSlabClassSize)) {
+    return allocate_large(size);
+  }
+
   preempt_disable();
   auto guard = helpers::finally([&]() { preempt_enable(); });
 
   auto slab_idx = get_slab_idx(size);
-  auto &slab = slabs_[get_core_num()][slab_idx];
-  if (unlikely(slab.empty())) {
-    replenish(slab_idx);
-    if (unlikely(slab.empty())) {
+  auto *cache = &core_caches_[get_core_num()][slab_idx];
+  if (unlikely(!cache->loaded->num)) {
+    if (cache->prev->num) {
+      std::swap(cache->loaded, cache->prev);
+    } else if (unlikely(!reload(slab_idx, cache))) {
       return nullptr;
     }
   }
-  auto ret = slab.back();
-  slab.pop_back();
-  return ret;
+  return cache->loaded->objs[--cache->loaded->num];
 }
 
 void Slab::free(uint8_t *ptr, uint32_t size) {
+  if (unlikely(size > kMaxSlabClassSize)) {
+    free_large(ptr);
+    return;
+  }
+
   preempt_disable();
   auto guard = helpers::finally([&]() { preempt_enable(); });
 
   auto slab_idx = get_slab_idx(size);
-  slabs_[get_core_num()][slab_idx].push_back(ptr);
+  auto *cache = &core_caches_[get_core_num()][slab_idx];
+  if (unlikely(cache->loaded->num == get_magazine_size(slab_idx))) {
+    if (!cache->prev->num) {
+      std::swap(cache->loaded, cache->prev);
+    } else {
+      unload(slab_idx, cache);
+    }
+  }
+  cache->loaded->objs[cache->loaded->num++] = ptr;
+}
+
+uint64_t Slab::get_footprint() {
+  page_heap_spin_.Lock();
+  auto guard = helpers::finally([&]() { page_heap_spin_.Unlock(); });
+  return (num_pages_ - num_free_pages_) << helpers::kPageShift;
 }
 
 } // namespace far_memory
@@ -10,82 +10,199 @@ extern "C" {
 #include "helpers.hpp"
 #include "object.hpp"
 #include "server.hpp"
+#include "tenant_scheduler.hpp"
 
-#include <atomic>
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
 #include <limits>
 #include <memory>
-#include <vector>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
 
 using namespace far_memory;
 
-std::vector<rt::Thread> slave_threads;
-std::unique_ptr<uint8_t> far_mem;
+// A tenant owns a separate namespace on the server, i.e., its own ds_ids and
+// named DSes, and serves one client session at a time. The sessions of the
+// same tenant are thus the restarts of its client, which reattach the named
+// DSes left by the previous ones.
+struct Tenant {
+  // Caps the far memory committed by the session, see process_init().
+  Server server;
+  uint32_t sched_id;
+  // The slave connections of the session.
+  rt::WaitGroup slaves;
+  // The fields below are guarded by tenants_mutex.
+  std::unordered_set<tcpconn_t *> slave_conns;
+  bool in_session = false;
+  uint32_t session_id;
+};
+
+// The far memory quota of each tenant in bytes, 0 for unlimited. Read-only
+// after startup.
+uint64_t default_tenant_quota;
+std::unordered_map<std::string, uint64_t> tenant_quotas;
+
+std::unique_ptr<TenantScheduler> tenant_scheduler;
+rt::Mutex tenants_mutex;
+std::unordered_map<std::string, std::unique_ptr<Tenant>> tenants;
+std::unordered_map<uint32_t, Tenant *> sessions;
+uint32_t next_session_id = 1;
+
+// Multiple clients may dial in at the same time.
+constexpr static uint32_t kListenBacklog = 64;
+
+uint64_t get_tenant_quota(const std::string &name) {
+  auto iter = tenant_quotas.find(name);
+  return iter != tenant_quotas.end() ? iter->second : default_tenant_quota;
+}
+
+// Ends the session of the tenant once its slave connections are gone. The
+// slaves of a client that is gone without shutting down are shut down rather
+// than waited for.
+void end_session(Tenant *tenant, bool shutdown_slaves) {
+  {
+    rt::ScopedLock<rt::Mutex> lock(&tenants_mutex);
+    // No more slaves can join.
+    sessions.erase(tenant->session_id);
+    if (shutdown_slaves) {
+      for (auto *c : tenant->slave_conns) {
+        tcp_shutdown(c, SHUT_RDWR);
+      }
+    }
+  }
+  tenant->slaves.Wait();
+  // Drops whatever the client left behind but the detached DSes, i.e., the
+  // named DSes of a crashed client are lost as well (see Server::reset()).
+  tenant->server.reset();
 
-std::atomic<bool> has_shutdown{true};
-rt::Thread master_thread;
-Server server;
+  rt::ScopedLock<rt::Mutex> lock(&tenants_mutex);
+  tenant->in_session = false;
+}
 
 // Request:
-//     |OpCode = Init (1B)|Far Mem Size (8B)|
+//     |OpCode = Init (1B)|Far Mem Size (8B)|tenant_len (1B)|tenant|
 // Response:
-//     |Ack (1B)|
-void process_init(tcpconn_t *c) {
-  uint64_t *far_mem_size;
-  uint8_t req[sizeof(decltype(*far_mem_size))];
-  helpers::tcp_read_until(c, req, sizeof(req));
-
-  far_mem_size = reinterpret_cast<uint64_t *>(req);
-  *far_mem_size = ((*far_mem_size - 1) / helpers::kHugepageSize + 1) *
-                  helpers::kHugepageSize;
-  auto far_mem_ptr =
-      static_cast<uint8_t *>(helpers::allocate_hugepage(*far_mem_size));
-  BUG_ON(far_mem_ptr == nullptr);
-  far_mem.reset(far_mem_ptr);
-
-  barrier();
-  uint8_t ack;
-  helpers::tcp_write_until(c, &ack, sizeof(ack));
+//     |status (1B)|session_id (4B)|
+// Returns the tenant of the new session, or null if it is refused.
+Tenant *process_init(tcpconn_t *c) {
+  uint64_t far_mem_size;
+  uint8_t tenant_len;
+  char tenant_name[std::numeric_limits<decltype(tenant_len)>::max()];
+  if (!helpers::tcp_try_read_until(c, &far_mem_size, sizeof(far_mem_size)) ||
+      !helpers::tcp_try_read_until(c, &tenant_len, sizeof(tenant_len)) ||
+      !helpers::tcp_try_read_until(c, tenant_name, tenant_len)) {
+    return nullptr;
+  }
+  // The far memory space itself is mapped lazily by the vanilla pointer DS
+  // (see ServerPtr), so nothing is allocated or faulted in here.
+  std::string name(tenant_name, tenant_len);
+  auto quota = get_tenant_quota(name);
+
+  uint8_t status = TCPDevice::kInitOK;
+  uint32_t session_id = 0;
+  Tenant *tenant;
+  {
+    rt::ScopedLock<rt::Mutex> lock(&tenants_mutex);
+    auto iter = tenants.find(name);
+    if (iter == tenants.end()) {
+      std::unique_ptr<Tenant> new_tenant(new Tenant());
+      if (tenant_scheduler->add_tenant(&new_tenant->sched_id)) {
+        iter = tenants.emplace(name, std::move(new_tenant)).first;
+      }
+    }
+    tenant = iter != tenants.end() ? iter->second.get() : nullptr;
+    if (!tenant) {
+      status = TCPDevice::kInitTooManyTenants;
+    } else if (!far_mem_size) {
+      status = TCPDevice::kInitInvalid;
+    } else if (tenant->in_session) {
+      status = TCPDevice::kInitTenantBusy;
+    } else if (quota && far_mem_size > quota) {
+      status = TCPDevice::kInitOverQuota;
+    } else {
+      tenant->in_session = true;
+      // Covers the vanilla DSes of all the sessions, including the ones
+      // still detached from the previous sessions.
+      tenant->server.set_far_mem_quota(far_mem_size);
+      tenant->session_id = session_id = next_session_id++;
+      sessions[session_id] = tenant;
+    }
+  }
+
+  if (!helpers::tcp_try_write_until(c, &status, sizeof(status)) ||
+      !helpers::tcp_try_write_until(c, &session_id, sizeof(session_id))) {
+    if (status == TCPDevice::kInitOK) {
+      end_session(tenant, /* shutdown_slaves = */ true);
+    }
+    return nullptr;
+  }
+  return status == TCPDevice::kInitOK ? tenant : nullptr;
 }
 
 // Request:
-//     |Opcode = Shutdown (1B)|
+//     |Opcode = Join (1B)|session_id (4B)|
 // Response:
-//     |Ack (1B)|
-void process_shutdown(tcpconn_t *c) {
-  far_mem.reset();
-
-  uint8_t ack;
-  helpers::tcp_write_until(c, &ack, sizeof(ack));
+//     |ok (1B)|
+// Returns the tenant of the session, or null if there is no such session.
+Tenant *process_join(tcpconn_t *c) {
+  uint32_t session_id;
+  if (!helpers::tcp_try_read_until(c, &session_id, sizeof(session_id))) {
+    return nullptr;
+  }
 
-  for (auto &thread : slave_threads) {
-    thread.Join();
+  Tenant *tenant = nullptr;
+  {
+    rt::ScopedLock<rt::Mutex> lock(&tenants_mutex);
+    auto iter = sessions.find(session_id);
+    if (iter != sessions.end()) {
+      tenant = iter->second;
+      tenant->slaves.Add(1);
+      tenant->slave_conns.insert(c);
+    }
   }
-  slave_threads.clear();
+
+  uint8_t ok = tenant != nullptr;
+  helpers::tcp_try_write_until(c, &ok, sizeof(ok));
+  return tenant;
 }
 
+// The process_*() functions below return false if the connection has to be
+// closed, i.e., if it is broken or the request is invalid, so that a faulty
+// client never takes the server down.
+
 // Request:
 // |Opcode = KOpReadObject(1B) | ds_id(1B) | obj_id_len(1B) | obj_id |
 // Response:
 // |data_len(2B)|data_buf(data_len B)|
-void process_read_object(tcpconn_t *c) {
+bool process_read_object(tcpconn_t *c, Tenant *tenant) {
   uint8_t
       req[Object::kDSIDSize + Object::kIDLenSize + Object::kMaxObjectIDSize];
   uint8_t resp[Object::kDataLenSize + Object::kMaxObjectDataSize];
 
-  helpers::tcp_read_until(c, req, Object::kDSIDSize + Object::kIDLenSize);
+  if (!helpers::tcp_try_read_until(c, req,
+                                   Object::kDSIDSize + Object::kIDLenSize)) {
+    return false;
+  }
   auto ds_id = *const_cast<uint8_t *>(&req[0]);
   auto object_id_len = *const_cast<uint8_t *>(&req[Object::kDSIDSize]);
   auto *object_id = &req[Object::kDSIDSize + Object::kIDLenSize];
-  helpers::tcp_read_until(c, object_id, object_id_len);
+  if (!helpers::tcp_try_read_until(c, object_id, object_id_len)) {
+    return false;
+  }
 
   auto *data_len = reinterpret_cast<uint16_t *>(&resp);
   auto *data_buf = &resp[Object::kDataLenSize];
-  server.read_object(ds_id, object_id_len, object_id, data_len, data_buf);
+  if (!tenant->server.get_object_ds(ds_id)) {
+    return false;
+  }
+  TenantAdmission admission(tenant_scheduler.get(), tenant->sched_id);
+  tenant->server.read_object(ds_id, object_id_len, object_id, data_len,
+                             data_buf);
 
-  helpers::tcp_write_until(c, resp, Object::kDataLenSize + *data_len);
+  return helpers::tcp_try_write_until(c, resp,
+                                      Object::kDataLenSize + *data_len);
 }
 
 // Request:
@@ -93,21 +210,30 @@ void process_read_object(tcpconn_t *c) {
 // |obj_id(obj_id_len B)|data_buf(data_len)|
 // Response:
 // |Ack (1B)|
-void process_write_object(tcpconn_t *c) {
+bool process_write_object(tcpconn_t *c, Tenant *tenant) {
   uint8_t req[Object::kDSIDSize + Object::kIDLenSize + Object::kDataLenSize +
               Object::kMaxObjectIDSize + Object::kMaxObjectDataSize];
 
-  helpers::tcp_read_until(
-      c, req, Object::kDSIDSize + Object::kIDLenSize + Object::kDataLenSize);
+  if (!helpers::tcp_try_read_until(c, req,
+                                   Object::kDSIDSize + Object::kIDLenSize +
+                                       Object::kDataLenSize)) {
+    return false;
+  }
 
   auto ds_id = *const_cast<uint8_t *>(&req[0]);
   auto object_id_len = *const_cast<uint8_t *>(&req[Object::kDSIDSize]);
   auto data_len = *reinterpret_cast<uint16_t *>(
       &req[Object::kDSIDSize + Object::kIDLenSize]);
+  if (data_len > Object::kMaxObjectDataSize) {
+    return false;
+  }
 
-  helpers::tcp_read_until(
-      c, &req[Object::kDSIDSize + Object::kIDLenSize + Object::kDataLenSize],
-      object_id_len + data_len);
+  if (!helpers::tcp_try_read_until(
+          c,
+          &req[Object::kDSIDSize + Object::kIDLenSize + Object::kDataLenSize],
+          object_id_len + data_len)) {
+    return false;
+  }
 
   auto *object_id = const_cast<uint8_t *>(
       &req[Object::kDSIDSize + Object::kIDLenSize + Object::kDataLenSize]);
@@ -115,40 +241,56 @@ void process_write_object(tcpconn_t *c) {
       const_cast<uint8_t *>(&req[Object::kDSIDSize + Object::kIDLenSize +
                                  Object::kDataLenSize + object_id_len]);
 
-  server.write_object(ds_id, object_id_len, object_id, data_len, data_buf);
+  if (!tenant->server.get_object_ds(ds_id)) {
+    return false;
+  }
+  TenantAdmission admission(tenant_scheduler.get(), tenant->sched_id);
+  tenant->server.write_object(ds_id, object_id_len, object_id, data_len,
+                              data_buf);
 
   uint8_t ack;
-  helpers::tcp_write_until(c, &ack, sizeof(ack));
+  return helpers::tcp_try_write_until(c, &ack, sizeof(ack));
 }
 
 // Request:
 // |Opcode = kOpRemoveObject (1B)|ds_id(1B)|obj_id_len(1B)|obj_id(obj_id_len B)|
 // Response:
 // |exists (1B)|
-void process_remove_object(tcpconn_t *c) {
+bool process_remove_object(tcpconn_t *c, Tenant *tenant) {
   uint8_t
       req[Object::kDSIDSize + Object::kIDLenSize + Object::kMaxObjectIDSize];
 
-  helpers::tcp_read_until(c, req, Object::kDSIDSize + Object::kIDLenSize);
+  if (!helpers::tcp_try_read_until(c, req,
+                                   Object::kDSIDSize + Object::kIDLenSize)) {
+    return false;
+  }
   auto ds_id = *const_cast<uint8_t *>(&req[0]);
   auto obj_id_len = *const_cast<uint8_t *>(&req[Object::kDSIDSize]);
 
-  helpers::tcp_read_until(c, &req[Object::kDSIDSize + Object::kIDLenSize],
-                          obj_id_len);
+  if (!helpers::tcp_try_read_until(
+          c, &req[Object::kDSIDSize + Object::kIDLenSize], obj_id_len)) {
+    return false;
+  }
 
   auto *obj_id =
       const_cast<uint8_t *>(&req[Object::kDSIDSize + Object::kIDLenSize]);
-  bool exists = server.remove_object(ds_id, obj_id_len, obj_id);
+  if (!tenant->server.get_object_ds(ds_id)) {
+    return false;
+  }
+  TenantAdmission admission(tenant_scheduler.get(), tenant->sched_id);
+  bool exists = tenant->server.remove_object(ds_id, obj_id_len, obj_id);
 
-  helpers::tcp_write_until(c, &exists, sizeof(exists));
+  return helpers::tcp_try_write_until(c, &exists, sizeof(exists));
 }
 
 // Request:
 // |Opcode = kOpConstruct (1B)|ds_type(1B)|ds_id(1B)|
 // |param_len(1B)|params(param_len B)|
 // Response:
-// |Ack (1B)|
-void process_construct(tcpconn_t *c) {
+// |ok (1B)|
+// A refused construct, e.g., over the far memory quota of the tenant, also
+// closes the connection.
+bool process_construct(tcpconn_t *c, Tenant *tenant) {
   uint8_t ds_type;
   uint8_t ds_id;
   uint8_t param_len;
@@ -156,36 +298,112 @@ void process_construct(tcpconn_t *c) {
   uint8_t req[sizeof(ds_type) + Object::kDSIDSize + sizeof(param_len) +
               std::numeric_limits<decltype(param_len)>::max()];
 
-  helpers::tcp_read_until(
-      c, req, sizeof(ds_type) + Object::kDSIDSize + sizeof(param_len));
+  if (!helpers::tcp_try_read_until(
+          c, req, sizeof(ds_type) + Object::kDSIDSize + sizeof(param_len))) {
+    return false;
+  }
   ds_type = *const_cast<uint8_t *>(&req[0]);
   ds_id = *const_cast<uint8_t *>(&req[sizeof(ds_type)]);
   param_len = *const_cast<uint8_t *>(&req[sizeof(ds_type) + Object::kDSIDSize]);
-  helpers::tcp_read_until(
-      c, &req[sizeof(ds_type) + Object::kDSIDSize + sizeof(param_len)],
-      param_len);
+  if (!helpers::tcp_try_read_until(
+          c, &req[sizeof(ds_type) + Object::kDSIDSize + sizeof(param_len)],
+          param_len)) {
+    return false;
+  }
   params = const_cast<uint8_t *>(
       &req[sizeof(ds_type) + Object::kDSIDSize + sizeof(param_len)]);
 
-  server.construct(ds_type, ds_id, param_len, params);
+  TenantAdmission admission(tenant_scheduler.get(), tenant->sched_id);
+  uint8_t ok = tenant->server.construct(ds_type, ds_id, param_len, params);
 
-  uint8_t ack;
-  helpers::tcp_write_until(c, &ack, sizeof(ack));
+  return helpers::tcp_try_write_until(c, &ok, sizeof(ok)) && ok;
 }
 
 // Request:
 // |Opcode = kOpDeconstruct (1B)|ds_id(1B)|
 // Response:
-// |Ack (1B)|
-void process_destruct(tcpconn_t *c) {
+// |ok (1B)|
+bool process_destruct(tcpconn_t *c, Tenant *tenant) {
   uint8_t ds_id;
 
-  helpers::tcp_read_until(c, &ds_id, Object::kDSIDSize);
+  if (!helpers::tcp_try_read_until(c, &ds_id, Object::kDSIDSize)) {
+    return false;
+  }
 
-  server.destruct(ds_id);
+  TenantAdmission admission(tenant_scheduler.get(), tenant->sched_id);
+  uint8_t ok = tenant->server.destruct(ds_id);
 
-  uint8_t ack;
-  helpers::tcp_write_until(c, &ack, sizeof(ack));
+  return helpers::tcp_try_write_until(c, &ok, sizeof(ok)) && ok;
+}
+
+// Request:
+// |Opcode = kOpAttach (1B)|ds_type(1B)|ds_id(1B)|name_len(1B)|param_len(1B)|
+// |name(name_len B)|params(param_len B)|
+// Response:
+// |status (1B)|meta_len(1B)|meta(meta_len B)|
+bool process_attach(tcpconn_t *c, Tenant *tenant) {
+  uint8_t ds_type;
+  uint8_t ds_id;
+  uint8_t name_len;
+  uint8_t param_len;
+  constexpr auto kHeaderSize = sizeof(ds_type) + Object::kDSIDSize +
+                               sizeof(name_len) + sizeof(param_len);
+  uint8_t req[kHeaderSize + 2 * std::numeric_limits<uint8_t>::max()];
+
+  if (!helpers::tcp_try_read_until(c, req, kHeaderSize)) {
+    return false;
+  }
+  ds_type = req[0];
+  ds_id = req[sizeof(ds_type)];
+  name_len = req[sizeof(ds_type) + Object::kDSIDSize];
+  param_len = req[sizeof(ds_type) + Object::kDSIDSize + sizeof(name_len)];
+  if (!helpers::tcp_try_read_until(c, &req[kHeaderSize],
+                                   name_len + param_len)) {
+    return false;
+  }
+  auto *name = &req[kHeaderSize];
+  auto *params = &req[kHeaderSize + name_len];
+
+  uint8_t *meta_len;
+  uint8_t resp[sizeof(uint8_t) + sizeof(*meta_len) +
+               std::numeric_limits<uint8_t>::max()];
+  meta_len = &resp[sizeof(uint8_t)];
+  auto *meta = &resp[sizeof(uint8_t) + sizeof(*meta_len)];
+  TenantAdmission admission(tenant_scheduler.get(), tenant->sched_id);
+  resp[0] = tenant->server.attach(ds_type, ds_id, name_len, name, param_len,
+                                  params, meta_len, meta);
+
+  return helpers::tcp_try_write_until(c, resp, sizeof(uint8_t) +
+                                                   sizeof(*meta_len) +
+                                                   *meta_len);
+}
+
+// Request:
+// |Opcode = kOpDetach (1B)|ds_id(1B)|meta_len(1B)|meta(meta_len B)|
+// Response:
+// |ok (1B)|
+bool process_detach(tcpconn_t *c, Tenant *tenant) {
+  uint8_t ds_id;
+  uint8_t meta_len;
+  uint8_t req[Object::kDSIDSize + sizeof(meta_len) +
+              std::numeric_limits<decltype(meta_len)>::max()];
+
+  if (!helpers::tcp_try_read_until(c, req,
+                                   Object::kDSIDSize + sizeof(meta_len))) {
+    return false;
+  }
+  ds_id = req[0];
+  meta_len = req[Object::kDSIDSize];
+  if (!helpers::tcp_try_read_until(
+          c, &req[Object::kDSIDSize + sizeof(meta_len)], meta_len)) {
+    return false;
+  }
+
+  TenantAdmission admission(tenant_scheduler.get(), tenant->sched_id);
+  uint8_t ok = tenant->server.detach(
+      ds_id, meta_len, &req[Object::kDSIDSize + sizeof(meta_len)]);
+
+  return helpers::tcp_try_write_until(c, &ok, sizeof(ok)) && ok;
 }
 
 // Request:
@@ -193,14 +411,16 @@ void process_destruct(tcpconn_t *c) {
 // |input_buf(input_len)|
 // Response:
 // |output_len(2B)|output_buf(output_len B)|
-void process_compute(tcpconn_t *c) {
+bool process_compute(tcpconn_t *c, Tenant *tenant) {
   uint8_t opcode;
   uint16_t input_len;
   uint8_t req[Object::kDSIDSize + sizeof(opcode) + sizeof(input_len) +
               TCPDevice::kMaxComputeDataLen];
 
-  helpers::tcp_read_until(
-      c, req, Object::kDSIDSize + sizeof(opcode) + sizeof(input_len));
+  if (!helpers::tcp_try_read_until(
+          c, req, Object::kDSIDSize + sizeof(opcode) + sizeof(input_len))) {
+    return false;
+  }
 
   auto ds_id = *reinterpret_cast<uint8_t *>(&req[0]);
   opcode = *reinterpret_cast<uint8_t *>(&req[Object::kDSIDSize]);
@@ -208,10 +428,13 @@ void process_compute(tcpconn_t *c) {
       *reinterpret_cast<uint16_t *>(&req[Object::kDSIDSize + sizeof(opcode)]);
   assert(input_len <= TCPDevice::kMaxComputeDataLen);
 
-  if (input_len) {
-    helpers::tcp_read_until(
-        c, &req[Object::kDSIDSize + sizeof(opcode) + sizeof(input_len)],
-        input_len);
+  if (!helpers::tcp_try_read_until(
+          c, &req[Object::kDSIDSize + sizeof(opcode) + sizeof(input_len)],
+          input_len)) {
+    return false;
+  }
+  if (!tenant->server.get_server_ds(ds_id)) {
+    return false;
   }
 
   auto *input_buf = const_cast<uint8_t *>(
@@ -221,69 +444,114 @@ void process_compute(tcpconn_t *c) {
   uint8_t resp[sizeof(*output_len) + TCPDevice::kMaxComputeDataLen];
   output_len = reinterpret_cast<uint16_t *>(&resp[0]);
   uint8_t *output_buf = &resp[sizeof(*output_len)];
-  server.compute(ds_id, opcode, input_len, input_buf, output_len, output_buf);
+  TenantAdmission admission(tenant_scheduler.get(), tenant->sched_id);
+  tenant->server.compute(ds_id, opcode, input_len, input_buf, output_len,
+                         output_buf);
 
-  helpers::tcp_write_until(c, resp, sizeof(*output_len) + *output_len);
+  return helpers::tcp_try_write_until(c, resp,
+                                      sizeof(*output_len) + *output_len);
+}
+
+bool process_request(tcpconn_t *c, Tenant *tenant, uint8_t opcode) {
+  switch (opcode) {
+  case TCPDevice::kOpReadObject:
+    return process_read_object(c, tenant);
+  case TCPDevice::kOpWriteObject:
+    return process_write_object(c, tenant);
+  case TCPDevice::kOpRemoveObject:
+    return process_remove_object(c, tenant);
+  case TCPDevice::kOpConstruct:
+    return process_construct(c, tenant);
+  case TCPDevice::kOpDeconstruct:
+    return process_destruct(c, tenant);
+  case TCPDevice::kOpCompute:
+    return process_compute(c, tenant);
+  case TCPDevice::kOpAttach:
+    return process_attach(c, tenant);
+  case TCPDevice::kOpDetach:
+    return process_detach(c, tenant);
+  default:
+    return false;
+  }
 }
 
-void slave_fn(tcpconn_t *c) {
+void slave_fn(tcpconn_t *c, Tenant *tenant) {
   // Run event loop.
   uint8_t opcode;
-  int ret;
-  while ((ret = tcp_read(c, &opcode, TCPDevice::kOpcodeSize)) > 0) {
-    BUG_ON(ret != TCPDevice::kOpcodeSize);
-    switch (opcode) {
-    case TCPDevice::kOpReadObject:
-      process_read_object(c);
-      break;
-    case TCPDevice::kOpWriteObject:
-      process_write_object(c);
-      break;
-    case TCPDevice::kOpRemoveObject:
-      process_remove_object(c);
-      break;
-    case TCPDevice::kOpConstruct:
-      process_construct(c);
-      break;
-    case TCPDevice::kOpDeconstruct:
-      process_destruct(c);
+  while (helpers::tcp_try_read_until(c, &opcode, TCPDevice::kOpcodeSize)) {
+    if (!process_request(c, tenant, opcode)) {
       break;
-    case TCPDevice::kOpCompute:
-      process_compute(c);
-      break;
-    default:
-      BUG();
     }
   }
+  {
+    rt::ScopedLock<rt::Mutex> lock(&tenants_mutex);
+    tenant->slave_conns.erase(c);
+  }
   tcp_close(c);
+  tenant->slaves.Done();
 }
 
+// Request:
+//     |Opcode = Shutdown (1B)|
+// Response:
+//     |Ack (1B)|
+// The session also ends if the master connection breaks, e.g., when the
+// client is gone.
 void master_fn(tcpconn_t *c) {
-  uint8_t opcode;
-  helpers::tcp_read_until(c, &opcode, TCPDevice::kOpcodeSize);
-  BUG_ON(opcode != TCPDevice::kOpInit);
-  process_init(c);
+  auto *tenant = process_init(c);
+  if (!tenant) {
+    tcp_close(c);
+    return;
+  }
 
-  helpers::tcp_read_until(c, &opcode, TCPDevice::kOpcodeSize);
-  BUG_ON(opcode != TCPDevice::kOpShutdown);
-  process_shutdown(c);
+  uint8_t opcode;
+  if (!helpers::tcp_try_read_until(c, &opcode, TCPDevice::kOpcodeSize) ||
+      opcode != TCPDevice::kOpShutdown) {
+    end_session(tenant, /* shutdown_slaves = */ true);
+    tcp_close(c);
+    return;
+  }
+  uint8_t ack;
+  helpers::tcp_try_write_until(c, &ack, sizeof(ack));
+  end_session(tenant, /* shutdown_slaves = */ false);
   tcp_close(c);
-  has_shutdown = true;
+}
+
+// A connection is either the master of a new session, or a slave that joins
+// an existing one.
+void conn_fn(tcpconn_t *c) {
+  uint8_t opcode;
+  if (!helpers::tcp_try_read_until(c, &opcode, TCPDevice::kOpcodeSize)) {
+    tcp_close(c);
+    return;
+  }
+  switch (opcode) {
+  case TCPDevice::kOpInit:
+    master_fn(c);
+    break;
+  case TCPDevice::kOpJoin:
+    if (auto *tenant = process_join(c)) {
+      slave_fn(c, tenant);
+    } else {
+      tcp_close(c);
+    }
+    break;
+  default:
+    tcp_close(c);
+  }
 }
 
 void do_work(uint16_t port) {
+  // Each request holds a slot while being processed.
+  tenant_scheduler.reset(new TenantScheduler(runtime_max_cores()));
+
   tcpqueue_t *q;
   struct netaddr server_addr = {.ip = 0, .port = port};
-  tcp_listen(server_addr, 1, &q);
+  tcp_listen(server_addr, kListenBacklog, &q);
 
   tcpconn_t *c;
   while (tcp_accept(q, &c) == 0) {
-    if (has_shutdown) {
-      master_thread = rt::Thread([c]() { master_fn(c); });
-      has_shutdown = false;
-    } else {
-      slave_threads.emplace_back(rt::Thread([c]() { slave_fn(c); }));
-    }
+    rt::Spawn([c]() { conn_fn(c); });
   }
 }
 
@@ -292,6 +560,15 @@ int argc;
 void my_main(void *arg) {
   char **argv = static_cast<char **>(arg);
   int port = atoi(argv[1]);
+  if (argc > 2) {
+    default_tenant_quota = atoll(argv[2]) << 20;
+  }
+  // The per-tenant overrides, as [tenant]=[quota_mb].
+  for (int i = 3; i < argc; i++) {
+    auto *sep = strchr(argv[i], '=');
+    BUG_ON(!sep);
+    tenant_quotas[std::string(argv[i], sep - argv[i])] = atoll(sep + 1) << 20;
+  }
   do_work(port);
 }
 
@@ -299,7 +576,9 @@ int main(int _argc, char *argv[]) {
   int ret;
 
   if (_argc < 3) {
-    std::cerr << "usage: [cfg_file] [port]" << std::endl;
+    std::cerr << "usage: [cfg_file] [port] [tenant_quota_mb] "
+                 "[tenant=quota_mb ...]"
+              << std::endl;
     return -EINVAL;
   }
 
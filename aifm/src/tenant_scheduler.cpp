@@ -0,0 +1,124 @@
+extern "C" {
+#include <runtime/timer.h>
+}
+
+#include "tenant_scheduler.hpp"
+
+#include <algorithm>
+
+namespace far_memory {
+
+TenantScheduler::TenantScheduler(uint32_t num_slots)
+    : num_free_slots_(num_slots) {
+  BUG_ON(!num_slots);
+}
+
+bool TenantScheduler::add_tenant(uint32_t *tenant_id) {
+  rt::ScopedLock<rt::Mutex> lock(&mutex_);
+  if (num_tenants_ == kMaxNumTenants) {
+    return false;
+  }
+  tenants_[num_tenants_].reset(new Tenant());
+  *tenant_id = num_tenants_++;
+  return true;
+}
+
+bool TenantScheduler::try_take_slot() {
+  auto num_free_slots = num_free_slots_.load(std::memory_order_relaxed);
+  do {
+    if (!num_free_slots) {
+      return false;
+    }
+  } while (!num_free_slots_.compare_exchange_weak(num_free_slots,
+                                                  num_free_slots - 1));
+  return true;
+}
+
+void TenantScheduler::advance_pass(Tenant *tenant) {
+  auto pass = tenant->pass.fetch_add(1, std::memory_order_relaxed) + 1;
+  global_pass_.store(pass, std::memory_order_relaxed);
+}
+
+bool TenantScheduler::grant(Tenant *tenant) {
+  if (!try_take_slot()) {
+    // Taken by a fast-path acquire() that raced with the enqueue.
+    return false;
+  }
+  auto *waiter = tenant->queue.front();
+  tenant->queue.pop_front();
+  num_waiters_--;
+  advance_pass(tenant);
+  waiter->granted = true;
+  waiter->cv.Signal();
+  return true;
+}
+
+void TenantScheduler::dispatch() {
+  while (num_free_slots_.load() && num_waiters_.load()) {
+    Tenant *next = nullptr;
+    for (uint32_t i = 0; i < num_tenants_; i++) {
+      auto *tenant = tenants_[i].get();
+      if (!tenant->queue.empty() &&
+          (!next || tenant->pass.load(std::memory_order_relaxed) <
+                        next->pass.load(std::memory_order_relaxed))) {
+        next = tenant;
+      }
+    }
+    if (!next || !grant(next)) {
+      break;
+    }
+  }
+}
+
+void TenantScheduler::acquire(uint32_t tenant_id) {
+  auto *tenant = tenants_[tenant_id].get();
+  tenant->num_ops.fetch_add(1, std::memory_order_relaxed);
+  if (likely(!num_waiters_.load() && try_take_slot())) {
+    advance_pass(tenant);
+    return;
+  }
+
+  rt::ScopedLock<rt::Mutex> lock(&mutex_);
+  Waiter waiter;
+  waiter.granted = false;
+  auto enqueue_us = microtime();
+  if (tenant->queue.empty()) {
+    // Catches up with the others, racing with the fast-path grants of the
+    // tenant itself.
+    auto global_pass = global_pass_.load(std::memory_order_relaxed);
+    auto pass = tenant->pass.load(std::memory_order_relaxed);
+    while (pass < global_pass &&
+           !tenant->pass.compare_exchange_weak(pass, global_pass)) {
+    }
+  }
+  // Pairs with release(): either it sees the waiter, or dispatch() sees the
+  // slot it freed.
+  num_waiters_++;
+  tenant->queue.push_back(&waiter);
+  dispatch();
+  while (!waiter.granted) {
+    waiter.cv.Wait(&mutex_);
+  }
+
+  auto wait_us = microtime() - enqueue_us;
+  tenant->total_wait_us += wait_us;
+  tenant->max_wait_us = std::max(tenant->max_wait_us, wait_us);
+}
+
+void TenantScheduler::release(uint32_t tenant_id) {
+  num_free_slots_++;
+  if (unlikely(num_waiters_.load())) {
+    rt::ScopedLock<rt::Mutex> lock(&mutex_);
+    dispatch();
+  }
+}
+
+TenantScheduler::Stats TenantScheduler::get_stats(uint32_t tenant_id) {
+  rt::ScopedLock<rt::Mutex> lock(&mutex_);
+  auto *tenant = tenants_[tenant_id].get();
+  return Stats{.num_ops = tenant->num_ops.load(),
+               .total_wait_us = tenant->total_wait_us,
+               .max_wait_us = tenant->max_wait_us};
+}
+
+} // namespace far_memory
@@ -0,0 +1,159 @@
+extern "C" {
+#include <runtime/runtime.h>
+#include <runtime/timer.h>
+}
+
+#include "array.hpp"
+#include "deref_scope.hpp"
+#include "device.hpp"
+#include "helpers.hpp"
+#include "manager.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+
+using namespace far_memory;
+using namespace std;
+
+#define DEFINE_DATA_TYPE(width)                                                \
+  struct Data_##width {                                                        \
+    uint8_t buf[width];                                                        \
+  };                                                                           \
+  using Data_t = Data_##width;
+
+DEFINE_DATA_TYPE(4096);
+
+constexpr uint64_t kCacheSize = 256 * Region::kSize;
+constexpr uint64_t kFarMemSize = 8ULL << 30;
+constexpr uint64_t kArraySize = 1ULL << 30;
+constexpr uint64_t kNumGCThreads = 12;
+constexpr uint64_t kNumEntries = kArraySize / sizeof(Data_t);
+constexpr uint64_t kNumPinnedEntries = 4096; // 16 MiB.
+constexpr uint64_t kNumScans = 4;
+// An object in a core-local region that is still being filled is only
+// evicted once its region is full, so DONTNEED may leave up to a region's worth
+// of objects behind on each core the test thread ran on.
+constexpr uint64_t kNumObjsPerRegion = Region::kSize / sizeof(Data_t);
+constexpr uint64_t kMaxAllowedPresentCnts = 2 * kNumObjsPerRegion;
+constexpr uint64_t kAdviceTimeoutUs = 5 * 1000 * 1000;
+
+namespace far_memory {
+class FarMemTest {
+public:
+  uint64_t count_missing(Array<Data_t, kNumEntries> *array, uint64_t begin,
+                         uint64_t end) {
+    uint64_t num_not_present = 0;
+    for (uint64_t i = begin; i < end; i++) {
+      num_not_present += !array->ptrs_[i].meta().is_present();
+    }
+    return num_not_present;
+  }
+
+  bool check(Array<Data_t, kNumEntries> *array, uint64_t begin, uint64_t end) {
+    for (uint64_t i = begin; i < end; i++) {
+      DerefScope scope;
+      const auto &data = array->at(scope, i);
+      if (data.buf[0] != static_cast<uint8_t>(i) ||
+          data.buf[sizeof(Data_t) - 1] != static_cast<uint8_t>(i)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  template <typename Pred> bool wait_until(Pred &&pred) {
+    auto start_us = microtime();
+    while (!pred()) {
+      if (microtime() - start_us > kAdviceTimeoutUs) {
+        return false;
+      }
+      timer_sleep(1000);
+    }
+    return true;
+  }
+
+  void run(FarMemManager *manager) {
+    auto array = std::unique_ptr<Array<Data_t, kNumEntries>>(
+        manager->allocate_array_heap<Data_t, kNumEntries>());
+    array->disable_prefetch();
+    for (uint64_t i = 0; i < kNumEntries; i++) {
+      DerefScope scope;
+      auto &data = array->at_mut(scope, i);
+      memset(data.buf, static_cast<uint8_t>(i), sizeof(Data_t));
+    }
+
+    // WILLNEED swaps in the range in the background.
+    TEST_ASSERT(count_missing(array.get(), 0, kNumPinnedEntries) ==
+                kNumPinnedEntries);
+    array->advise(0, kNumPinnedEntries, kAdviceWillNeed);
+    TEST_ASSERT(wait_until([&]() {
+      return count_missing(array.get(), 0, kNumPinnedEntries) == 0;
+    }));
+
+    // The pinned range stays local while the rest of the array, which is much
+    // larger than the cache, is scanned over it.
+    array->advise(0, kNumPinnedEntries, kAdvicePin);
+    for (uint64_t k = 0; k < kNumScans; k++) {
+      TEST_ASSERT(check(array.get(), kNumPinnedEntries, kNumEntries));
+      TEST_ASSERT(count_missing(array.get(), 0, kNumPinnedEntries) == 0);
+    }
+    array->advise(0, kNumPinnedEntries, kAdviceUnpin);
+    TEST_ASSERT(check(array.get(), 0, kNumPinnedEntries));
+
+    // DONTNEED evicts a freshly swapped-in range.
+    constexpr uint64_t kBegin = kNumPinnedEntries;
+    constexpr uint64_t kEnd = 2 * kNumPinnedEntries;
+    TEST_ASSERT(check(array.get(), kBegin, kEnd));
+    TEST_ASSERT(count_missing(array.get(), kBegin, kEnd) == 0);
+    array->advise(kBegin, kEnd, kAdviceDontNeed);
+    // Made cold without looking untouched to the in-place GC rounds.
+    for (uint64_t i = kBegin; i < kEnd; i++) {
+      auto &meta = array->ptrs_[i].meta();
+      TEST_ASSERT(!meta.is_present() || !meta.is_untouched());
+    }
+    TEST_ASSERT(wait_until([&]() {
+      return count_missing(array.get(), kBegin, kEnd) >=
+             kEnd - kBegin - kMaxAllowedPresentCnts;
+    }));
+    TEST_ASSERT(check(array.get(), kBegin, kEnd));
+
+    array->advise(0, kNumEntries, kAdviceSequential);
+    TEST_ASSERT(check(array.get(), 0, kNumEntries));
+
+    std::cout << "Passed" << std::endl;
+  }
+};
+} // namespace far_memory
+
+void do_work(FarMemManager *manager) {
+  cout << "Running " << __FILE__ "..." << endl;
+  FarMemTest test;
+  test.run(manager);
+}
+
+void _main(void *arg) {
+  std::unique_ptr<FarMemManager> manager =
+      std::unique_ptr<FarMemManager>(FarMemManagerFactory::build(
+          kCacheSize, kNumGCThreads, new FakeDevice(kFarMemSize)));
+  do_work(manager.get());
+}
+
+int main(int argc, char *argv[]) {
+  int ret;
+
+  if (argc < 2) {
+    std::cerr << "usage: [cfg_file]" << std::endl;
+    return -EINVAL;
+  }
+
+  ret = runtime_init(argv[1], _main, NULL);
+  if (ret) {
+    std::cerr << "failed to start runtime" << std::endl;
+    return ret;
+  }
+
+  return 0;
+}
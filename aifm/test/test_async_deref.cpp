@@ -0,0 +1,142 @@
+extern "C" {
+#include <runtime/runtime.h>
+}
+
+#include "async.hpp"
+#include "concurrent_hopscotch.hpp"
+#include "deref_scope.hpp"
+#include "device.hpp"
+#include "helpers.hpp"
+#include "manager.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+using namespace far_memory;
+using namespace std;
+
+constexpr uint64_t kCacheSize = 256 * Region::kSize;
+constexpr uint64_t kFarMemSize = (1ULL << 33); // 8 GB.
+constexpr uint64_t kWorkSetSize = 1 << 30;
+constexpr uint64_t kNumGCThreads = 12;
+constexpr uint32_t kNumTasks = 64;
+
+struct Data4096 {
+  char data[4096];
+};
+
+using Data_t = struct Data4096;
+
+constexpr uint64_t kNumEntries = kWorkSetSize / sizeof(Data_t);
+
+constexpr static uint32_t kHashTableNumEntriesShift = 18;
+constexpr static uint32_t kHashTableRemoteDataSize =
+    (Object::kHeaderSize + sizeof(Data_t) + sizeof(uint64_t)) *
+    (1 << kHashTableNumEntriesShift);
+constexpr static uint32_t kNumKVPairs = kNumEntries / 2;
+
+std::vector<UniquePtr<Data_t>> vec;
+uint32_t num_failed = 0;
+
+Task<bool> check(const DerefScope &scope, uint64_t i) {
+  const auto *raw_const_ptr = co_await vec[i].deref_async(scope);
+  for (uint32_t j = 0; j < sizeof(Data_t); j++) {
+    if (raw_const_ptr->data[j] != static_cast<char>(i)) {
+      co_return false;
+    }
+  }
+  co_return true;
+}
+
+Task<void> check_all(const DerefScope &scope, uint32_t tid) {
+  for (uint64_t i = tid; i < kNumEntries; i += kNumTasks) {
+    if (!co_await check(scope, i)) {
+      num_failed++;
+    }
+  }
+}
+
+Task<void> find_all(const DerefScope &scope,
+                    ConcurrentHopscotch<uint64_t, Data_t> *hopscotch,
+                    uint32_t tid) {
+  for (uint64_t i = tid; i < kNumKVPairs; i += kNumTasks) {
+    uint16_t val_len;
+    Data_t val;
+    co_await hopscotch->get_async(scope, sizeof(i),
+                                  reinterpret_cast<const uint8_t *>(&i),
+                                  &val_len, reinterpret_cast<uint8_t *>(&val));
+    if (val_len != sizeof(Data_t) || val.data[0] != static_cast<char>(i)) {
+      num_failed++;
+    }
+  }
+}
+
+void do_work(FarMemManager *manager) {
+  cout << "Running " << __FILE__ "..." << endl;
+
+  for (uint64_t i = 0; i < kNumEntries; i++) {
+    auto far_mem_ptr = manager->allocate_unique_ptr<Data_t>();
+    {
+      DerefScope scope;
+      auto raw_mut_ptr = far_mem_ptr.deref_mut(scope);
+      memset(raw_mut_ptr->data, static_cast<char>(i), sizeof(Data_t));
+    }
+    vec.emplace_back(std::move(far_mem_ptr));
+  }
+
+  // All tasks run in the current uthread.
+  {
+    AsyncExecutor executor;
+    for (uint32_t i = 0; i < kNumTasks; i++) {
+      executor.spawn(check_all(executor.scope(), i));
+    }
+    executor.run();
+  }
+  TEST_ASSERT(!num_failed);
+  vec.clear();
+
+  auto hopscotch = manager->allocate_concurrent_hopscotch<uint64_t, Data_t>(
+      kHashTableNumEntriesShift, kHashTableNumEntriesShift,
+      kHashTableRemoteDataSize);
+  for (uint64_t i = 0; i < kNumKVPairs; i++) {
+    Data_t val;
+    memset(val.data, static_cast<char>(i), sizeof(Data_t));
+    hopscotch.insert_tp(i, val);
+  }
+  {
+    AsyncExecutor executor;
+    for (uint32_t i = 0; i < kNumTasks; i++) {
+      executor.spawn(find_all(executor.scope(), &hopscotch, i));
+    }
+    executor.run();
+  }
+  TEST_ASSERT(!num_failed);
+
+  cout << "Passed" << endl;
+}
+
+void _main(void *arg) {
+  auto manager = std::unique_ptr<FarMemManager>(FarMemManagerFactory::build(
+      kCacheSize, kNumGCThreads, new FakeDevice(kFarMemSize)));
+  do_work(manager.get());
+}
+
+int main(int argc, char *argv[]) {
+  int ret;
+
+  if (argc < 2) {
+    std::cerr << "usage: [cfg_file]" << std::endl;
+    return -EINVAL;
+  }
+
+  ret = runtime_init(argv[1], _main, NULL);
+  if (ret) {
+    std::cerr << "failed to start runtime" << std::endl;
+    return ret;
+  }
+
+  return 0;
+}
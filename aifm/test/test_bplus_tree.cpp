@@ -0,0 +1,283 @@
+extern "C" {
+#include <runtime/runtime.h>
+}
+#include "thread.h"
+
+#include "bplus_tree.hpp"
+#include "dataframe_vector.hpp"
+#include "deref_scope.hpp"
+#include "device.hpp"
+#include "helpers.hpp"
+#include "manager.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace far_memory;
+using namespace std;
+
+constexpr uint64_t kCacheSize = 64 * Region::kSize;
+constexpr uint64_t kFarMemSize = (1ULL << 33); // 8 GB.
+constexpr uint64_t kNumGCThreads = 12;
+// 8M entries of 16 bytes, i.e., 128 MiB of leaves, twice the cache size.
+constexpr uint64_t kNumEntries = 8 << 20;
+constexpr uint64_t kNumThreads = 16;
+constexpr uint64_t kNumRandomOps = 1 << 18;
+static_assert((kNumRandomOps & (kNumRandomOps - 1)) == 0);
+constexpr uint64_t kNumScans = 1024;
+constexpr uint64_t kMaxScanLen = 1 << 14;
+constexpr uint64_t kNumElementsPerScope = 1024;
+constexpr long long kNumRowsPerSecond = 4;
+
+using Tree = BPlusTree<uint64_t, uint64_t>;
+
+namespace far_memory {
+class FarMemTest {
+public:
+  // Checks the key order, the inner node bounds and the leaf chain.
+  uint64_t check_structure(Tree *tree) {
+    uint64_t num = 0;
+    bool first = true;
+    uint64_t last = 0;
+    auto *leaf = tree->head_;
+    DerefScope scope;
+    while (leaf) {
+      auto *data = static_cast<const Tree::LeafData *>(leaf->ptr.deref(scope));
+      for (uint32_t i = 0; i < leaf->num_entries; i++) {
+        TEST_ASSERT(first || last <= data->keys[i]);
+        first = false;
+        last = data->keys[i];
+      }
+      num += leaf->num_entries;
+      leaf = leaf->next.load();
+      scope.renew();
+    }
+    return num;
+  }
+
+  void test_serial(FarMemManager *manager) {
+    auto tree = std::unique_ptr<Tree>(manager->allocate_bplus_tree_heap<
+                                      uint64_t, uint64_t>());
+    std::multimap<uint64_t, uint64_t> ref;
+    std::mt19937_64 rng(0);
+    for (uint64_t i = 0; i < kNumRandomOps; i++) {
+      DerefScope scope;
+      // Many duplicates.
+      auto key = rng() % (kNumRandomOps / 4);
+      tree->insert(scope, key, i);
+      ref.emplace(key, i);
+    }
+    TEST_ASSERT(tree->size() == ref.size());
+    TEST_ASSERT(check_structure(tree.get()) == ref.size());
+
+    for (uint64_t key = 0; key < kNumRandomOps / 4; key++) {
+      DerefScope scope;
+      uint64_t val;
+      auto it = ref.find(key);
+      TEST_ASSERT(tree->find(scope, key, &val) == (it != ref.end()));
+      if (it != ref.end()) {
+        TEST_ASSERT(val == it->second);
+      }
+    }
+
+    for (uint64_t i = 0; i < kNumRandomOps / 2; i++) {
+      DerefScope scope;
+      auto key = rng() % (kNumRandomOps / 4);
+      auto it = ref.find(key);
+      TEST_ASSERT(tree->remove(scope, key) == (it != ref.end()));
+      if (it != ref.end()) {
+        ref.erase(it);
+      }
+    }
+    TEST_ASSERT(tree->size() == ref.size());
+    TEST_ASSERT(check_structure(tree.get()) == ref.size());
+
+    for (uint64_t i = 0; i < kNumScans; i++) {
+      auto lo = rng() % (kNumRandomOps / 4);
+      auto hi = lo + rng() % kMaxScanLen;
+      auto it = ref.lower_bound(lo);
+      DerefScope scope;
+      tree->scan(scope, lo, hi, [&](const uint64_t &k, const uint64_t &v) {
+        TEST_ASSERT(it != ref.end() && it->first == k && it->second == v);
+        ++it;
+        return true;
+      });
+      TEST_ASSERT(it == ref.upper_bound(hi));
+    }
+  }
+
+  void test_concurrent(FarMemManager *manager) {
+    auto tree = std::unique_ptr<Tree>(manager->allocate_bplus_tree_heap<
+                                      uint64_t, uint64_t>());
+    std::vector<rt::Thread> threads;
+    for (uint32_t tid = 0; tid < kNumThreads; tid++) {
+      threads.emplace_back(rt::Thread([&, tid]() {
+        // Interleaved keys so that the threads keep splitting shared nodes.
+        for (uint64_t i = tid; i < kNumEntries; i += kNumThreads) {
+          DerefScope scope;
+          tree->insert(scope, i, i * 2);
+          if (i % 64 == tid) {
+            uint64_t val;
+            TEST_ASSERT(tree->find(scope, i, &val) && val == i * 2);
+          }
+        }
+      }));
+    }
+    for (auto &thread : threads) {
+      thread.Join();
+    }
+    TEST_ASSERT(tree->size() == kNumEntries);
+    TEST_ASSERT(check_structure(tree.get()) == kNumEntries);
+    check_all_found(tree.get(), kNumEntries, [](uint64_t i) { return i; });
+
+    // A full scan, which goes through far memory.
+    uint64_t expected = 0;
+    {
+      DerefScope scope;
+      tree->scan(scope, 0, kNumEntries,
+                 [&](const uint64_t &k, const uint64_t &v) {
+                   TEST_ASSERT(k == expected && v == k * 2);
+                   expected++;
+                   return true;
+                 });
+    }
+    TEST_ASSERT(expected == kNumEntries);
+  }
+
+  // Looks every key up concurrently.
+  template <typename KeyFn>
+  void check_all_found(Tree *tree, uint64_t num, KeyFn &&key_fn) {
+    std::vector<rt::Thread> threads;
+    for (uint32_t tid = 0; tid < kNumThreads; tid++) {
+      threads.emplace_back(rt::Thread([&, tid]() {
+        for (uint64_t i = tid; i < num; i += kNumThreads) {
+          DerefScope scope;
+          uint64_t val;
+          auto key = key_fn(i);
+          TEST_ASSERT(tree->find(scope, key, &val) && val == key * 2);
+        }
+      }));
+    }
+    for (auto &thread : threads) {
+      thread.Join();
+    }
+  }
+
+  void test_concurrent_split(FarMemManager *manager) {
+    auto tree = std::unique_ptr<Tree>(manager->allocate_bplus_tree_heap<
+                                      uint64_t, uint64_t>());
+    // A bijection over [0, kNumRandomOps), so that the inserts split leaves
+    // and inner nodes all over the tree rather than only at its right edge.
+    auto key_fn = [](uint64_t i) {
+      return (i * 0x9E3779B97F4A7C15ULL) & (kNumRandomOps - 1);
+    };
+    std::vector<rt::Thread> threads;
+    for (uint32_t tid = 0; tid < kNumThreads; tid++) {
+      threads.emplace_back(rt::Thread([&, tid]() {
+        for (uint64_t i = tid; i < kNumRandomOps; i += kNumThreads) {
+          DerefScope scope;
+          auto key = key_fn(i);
+          tree->insert(scope, key, key * 2);
+        }
+      }));
+    }
+    for (auto &thread : threads) {
+      thread.Join();
+    }
+    TEST_ASSERT(tree->size() == kNumRandomOps);
+    TEST_ASSERT(check_structure(tree.get()) == kNumRandomOps);
+    check_all_found(tree.get(), kNumRandomOps, key_fn);
+  }
+
+  void test_bulk_load(FarMemManager *manager) {
+    // A sorted timestamp column with duplicates.
+    auto times = manager->allocate_dataframe_vector<long long>();
+    for (uint64_t i = 0; i < kNumEntries; i++) {
+      DerefScope scope;
+      times.push_back(scope, static_cast<long long>(i / kNumRowsPerSecond));
+    }
+    BPlusTree<long long, uint64_t> tree;
+    tree.bulk_load(times);
+    TEST_ASSERT(tree.size() == kNumEntries);
+
+    std::mt19937_64 rng(1);
+    for (uint64_t i = 0; i < kNumScans; i++) {
+      long long lo = rng() % (kNumEntries / kNumRowsPerSecond);
+      long long hi = lo + rng() % (kMaxScanLen / kNumRowsPerSecond);
+      uint64_t row = lo * kNumRowsPerSecond;
+      DerefScope scope;
+      tree.scan(scope, lo, hi, [&](const long long &k, const uint64_t &v) {
+        TEST_ASSERT(v == row && k == static_cast<long long>(row /
+                                                            kNumRowsPerSecond));
+        row++;
+        return true;
+      });
+      TEST_ASSERT(row == std::min<uint64_t>(kNumEntries,
+                                  static_cast<uint64_t>(hi + 1) *
+                                      kNumRowsPerSecond));
+    }
+
+    // Inserts into the bulk-loaded tree, among the equal keys.
+    for (uint64_t i = 0; i < kNumEntries / kNumElementsPerScope; i++) {
+      DerefScope scope;
+      long long key = i * kNumElementsPerScope / kNumRowsPerSecond;
+      tree.insert(scope, key, kNumEntries + i);
+    }
+    uint64_t num = 0;
+    {
+      DerefScope scope;
+      tree.scan(scope, 0, kNumEntries,
+                [&](const long long &k, const uint64_t &v) {
+                  if (v >= kNumEntries) {
+                    auto i = v - kNumEntries;
+                    TEST_ASSERT(k == static_cast<long long>(
+                                         i * kNumElementsPerScope /
+                                         kNumRowsPerSecond));
+                  }
+                  num++;
+                  return true;
+                });
+    }
+    TEST_ASSERT(num == tree.size());
+  }
+
+  void do_work(FarMemManager *manager) {
+    cout << "Running " << __FILE__ "..." << endl;
+    test_serial(manager);
+    test_concurrent(manager);
+    test_concurrent_split(manager);
+    test_bulk_load(manager);
+    cout << "Passed" << endl;
+  }
+};
+} // namespace far_memory
+
+void _main(void *arg) {
+  auto manager = std::unique_ptr<FarMemManager>(FarMemManagerFactory::build(
+      kCacheSize, kNumGCThreads, new FakeDevice(kFarMemSize)));
+  FarMemTest test;
+  test.do_work(manager.get());
+}
+
+int main(int argc, char *argv[]) {
+  int ret;
+
+  if (argc < 2) {
+    std::cerr << "usage: [cfg_file]" << std::endl;
+    return -EINVAL;
+  }
+
+  ret = runtime_init(argv[1], _main, NULL);
+  if (ret) {
+    std::cerr << "failed to start runtime" << std::endl;
+    return ret;
+  }
+
+  return 0;
+}
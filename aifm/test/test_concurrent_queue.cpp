@@ -0,0 +1,162 @@
+extern "C" {
+#include <runtime/runtime.h>
+}
+#include "thread.h"
+
+#include "concurrent_queue.hpp"
+#include "deref_scope.hpp"
+#include "helpers.hpp"
+#include "manager.hpp"
+
+#include <atomic>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+using namespace far_memory;
+using namespace std;
+
+struct Item {
+  uint32_t producer;
+  uint32_t seq;
+  uint8_t padding[248];
+};
+
+constexpr uint64_t kCacheSize = (256ULL << 20);
+constexpr uint64_t kFarMemSize = (8ULL << 30);
+constexpr uint32_t kNumGCThreads = 12;
+constexpr uint32_t kNumProducers = 8;
+constexpr uint32_t kNumConsumers = 8;
+// 1 GiB in total, i.e., 4x the cache.
+constexpr uint32_t kNumItemsPerProducer = (1 << 19);
+constexpr uint32_t kMaxBatchSize = 64;
+constexpr uint32_t kScopeResetInterval = 256;
+
+std::atomic<uint64_t> num_popped;
+std::atomic<uint64_t> seq_sums[kNumProducers];
+std::atomic<uint64_t> num_failed;
+
+void produce(ConcurrentQueue<Item> *queue, uint32_t producer) {
+  Item items[kMaxBatchSize];
+  DerefScope scope;
+  uint32_t seq = 0, num_batches = 0;
+  while (seq < kNumItemsPerProducer) {
+    // Mixes single and bulk pushes.
+    auto n = std::min(seq % kMaxBatchSize + 1, kNumItemsPerProducer - seq);
+    for (uint32_t i = 0; i < n; i++) {
+      items[i].producer = producer;
+      items[i].seq = seq++;
+    }
+    if (n == 1) {
+      queue->push(scope, items[0]);
+    } else {
+      queue->push_n(scope, items, n);
+    }
+    if (++num_batches % kScopeResetInterval == 0) {
+      scope.renew();
+    }
+  }
+}
+
+void consume(ConcurrentQueue<Item> *queue) {
+  constexpr uint64_t kNumItems =
+      static_cast<uint64_t>(kNumItemsPerProducer) * kNumProducers;
+  Item items[kMaxBatchSize];
+  // Each consumer sees the items of a producer in order.
+  std::vector<int64_t> last_seqs(kNumProducers, -1);
+  DerefScope scope;
+  uint32_t num_batches = 0;
+  while (num_popped.load() < kNumItems) {
+    auto n = queue->pop_n(scope, items, num_batches % kMaxBatchSize + 1);
+    for (uint32_t i = 0; i < n; i++) {
+      auto &item = items[i];
+      if (item.producer >= kNumProducers ||
+          static_cast<int64_t>(item.seq) <= last_seqs[item.producer]) {
+        num_failed++;
+        continue;
+      }
+      last_seqs[item.producer] = item.seq;
+      seq_sums[item.producer] += item.seq;
+    }
+    num_popped += n;
+    if (!n) {
+      // Lets the GC proceed while waiting for the producers.
+      scope.renew();
+      thread_yield();
+    } else if (++num_batches % kScopeResetInterval == 0) {
+      scope.renew();
+    }
+  }
+}
+
+void check() {
+  constexpr uint64_t kSeqSum =
+      static_cast<uint64_t>(kNumItemsPerProducer) * (kNumItemsPerProducer - 1) /
+      2;
+  TEST_ASSERT(!num_failed.load());
+  for (uint32_t i = 0; i < kNumProducers; i++) {
+    TEST_ASSERT(seq_sums[i].load() == kSeqSum);
+    seq_sums[i] = 0;
+  }
+  num_popped = 0;
+}
+
+void run(ConcurrentQueue<Item> *queue, bool overlapped) {
+  std::vector<rt::Thread> threads;
+  for (uint32_t i = 0; i < kNumProducers; i++) {
+    threads.emplace_back([&, i]() { produce(queue, i); });
+  }
+  if (!overlapped) {
+    // The queue grows much larger than the cache and spills.
+    for (auto &thread : threads) {
+      thread.Join();
+    }
+    threads.clear();
+    TEST_ASSERT(queue->size() ==
+                static_cast<uint64_t>(kNumItemsPerProducer) * kNumProducers);
+  }
+  for (uint32_t i = 0; i < kNumConsumers; i++) {
+    threads.emplace_back([&]() { consume(queue); });
+  }
+  for (auto &thread : threads) {
+    thread.Join();
+  }
+  TEST_ASSERT(queue->empty());
+  check();
+}
+
+void do_work(FarMemManager *manager) {
+  cout << "Running " << __FILE__ "..." << endl;
+  auto queue = [&] {
+    DerefScope scope;
+    return std::unique_ptr<ConcurrentQueue<Item>>(
+        manager->allocate_concurrent_queue_heap<Item>(scope));
+  }();
+  run(queue.get(), /* overlapped = */ false);
+  run(queue.get(), /* overlapped = */ true);
+  cout << "Passed" << endl;
+}
+
+void _main(void *arg) {
+  std::unique_ptr<FarMemManager> manager =
+      std::unique_ptr<FarMemManager>(FarMemManagerFactory::build(
+          kCacheSize, kNumGCThreads, new FakeDevice(kFarMemSize)));
+  do_work(manager.get());
+}
+
+int main(int argc, char **argv) {
+  int ret;
+
+  if (argc < 2) {
+    std::cerr << "usage: [cfg_file]" << std::endl;
+    return -EINVAL;
+  }
+
+  ret = runtime_init(argv[1], _main, NULL);
+  if (ret) {
+    std::cerr << "failed to start runtime" << std::endl;
+    return ret;
+  }
+
+  return 0;
+}
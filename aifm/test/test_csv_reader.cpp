@@ -27,6 +27,28 @@ constexpr uint64_t kNumEntries = 64 << 20; // 64 million entries.
 namespace far_memory {
 class FarMemTest {
 private:
+  template <typename Tuple>
+  void check_parallel_parse(FarMemManager *manager, Tuple &expected,
+                            off_t segment_size) {
+    auto parallel_tuple =
+        io::parallel_parse_csv_to_vectors_in_segments<int, SimpleTime, double>(
+            manager, "test/test_csv_reader.csv", segment_size, "VendorID",
+            "tpep_pickup_datetime", "trip_distance");
+    auto num_rows = std::get<0>(expected).size();
+    TEST_ASSERT(std::get<0>(parallel_tuple).size() == num_rows);
+    TEST_ASSERT(std::get<1>(parallel_tuple).size() == num_rows);
+    TEST_ASSERT(std::get<2>(parallel_tuple).size() == num_rows);
+    DerefScope scope;
+    for (uint64_t i = 0; i < num_rows; i++) {
+      TEST_ASSERT(std::get<0>(parallel_tuple).at(scope, i) ==
+                  std::get<0>(expected).at(scope, i));
+      TEST_ASSERT(std::get<1>(parallel_tuple).at(scope, i) ==
+                  std::get<1>(expected).at(scope, i));
+      TEST_ASSERT(std::get<2>(parallel_tuple).at(scope, i) ==
+                  std::get<4>(expected).at(scope, i));
+    }
+  }
+
 public:
   void do_work(FarMemManager *manager) {
     auto my_tuple =
@@ -42,28 +64,46 @@ public:
             "mta_tax", "tip_amount", "tolls_amount", "improvement_surcharge",
             "total_amount");
 
-    DerefScope scope;
-    TEST_ASSERT(std::get<0>(my_tuple).at(scope, 0) == 2);
-    TEST_ASSERT(std::get<1>(my_tuple).at(scope, 0) ==
-                SimpleTime(2016, 1, 1, 0, 0, 0));
-
-    TEST_ASSERT(std::get<0>(my_tuple).at(scope, 7) == 1);
-    TEST_ASSERT(std::get<1>(my_tuple).at(scope, 7) ==
-                SimpleTime(2016, 1, 1, 0, 0, 1));
-
-    TEST_ASSERT(std::get<0>(my_tuple).at(scope, 17) == 1);
-    TEST_ASSERT(std::get<1>(my_tuple).at(scope, 17) ==
-                SimpleTime(2016, 1, 1, 0, 0, 6));
-    TEST_ASSERT(std::get<2>(my_tuple).at(scope, 17) ==
-                SimpleTime(2016, 1, 1, 0, 7, 14));
-    TEST_ASSERT(std::get<3>(my_tuple).at(scope, 17) == 1);
-    TEST_ASSERT(std::abs(std::get<4>(my_tuple).at(scope, 17) - 1.7) < 1E-5);
-    TEST_ASSERT(std::get<8>(my_tuple).at(scope, 17) == 'Y');
-    TEST_ASSERT(
-        std::abs(
-            std::get<std::tuple_size<decltype(my_tuple)>::value - 1>(my_tuple)
-                .at(scope, 17) -
-            9.95) < 1E-5);
+    {
+      DerefScope scope;
+      TEST_ASSERT(std::get<0>(my_tuple).at(scope, 0) == 2);
+      TEST_ASSERT(std::get<1>(my_tuple).at(scope, 0) ==
+                  SimpleTime(2016, 1, 1, 0, 0, 0));
+
+      TEST_ASSERT(std::get<0>(my_tuple).at(scope, 7) == 1);
+      TEST_ASSERT(std::get<1>(my_tuple).at(scope, 7) ==
+                  SimpleTime(2016, 1, 1, 0, 0, 1));
+
+      TEST_ASSERT(std::get<0>(my_tuple).at(scope, 17) == 1);
+      TEST_ASSERT(std::get<1>(my_tuple).at(scope, 17) ==
+                  SimpleTime(2016, 1, 1, 0, 0, 6));
+      TEST_ASSERT(std::get<2>(my_tuple).at(scope, 17) ==
+                  SimpleTime(2016, 1, 1, 0, 7, 14));
+      TEST_ASSERT(std::get<3>(my_tuple).at(scope, 17) == 1);
+      TEST_ASSERT(std::abs(std::get<4>(my_tuple).at(scope, 17) - 1.7) < 1E-5);
+      TEST_ASSERT(std::get<8>(my_tuple).at(scope, 17) == 'Y');
+      TEST_ASSERT(
+          std::abs(
+              std::get<std::tuple_size<decltype(my_tuple)>::value - 1>(my_tuple)
+                  .at(scope, 17) -
+              9.95) < 1E-5);
+    }
+
+    // Small segments so that the file is split at many line boundaries,
+    // including the ones falling right on a newline, and a single segment.
+    for (off_t segment_size : {1, 2, 7, 64, 200, 500, 1 << 20}) {
+      check_parallel_parse(manager, my_tuple, segment_size);
+    }
+
+    // A parse error of a segment reaches the caller.
+    bool thrown = false;
+    try {
+      io::parallel_parse_csv_to_vectors_in_segments<int>(
+          manager, "test/test_csv_reader.csv", 64, "NoSuchColumn");
+    } catch (const io::error::base &) {
+      thrown = true;
+    }
+    TEST_ASSERT(thrown);
 
     cout << "Passed" << endl;
     return;
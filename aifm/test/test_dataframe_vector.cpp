@@ -5,12 +5,17 @@ extern "C" {}
 #include "device.hpp"
 #include "helpers.hpp"
 #include "manager.hpp"
+#include "quantile_sketch.hpp"
 
+#include <algorithm>
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
 #include <limits>
 #include <memory>
+#include <numeric>
+#include <random>
+#include <span>
 #include <unordered_set>
 #include <vector>
 
@@ -217,6 +222,48 @@ public:
       }
     }
 
+    {
+      // Two groups holding a permutation of [0, kGroupSize) each.
+      constexpr uint64_t kGroupSize = 100000;
+      constexpr double kMaxRankError = 0.02;
+      auto key_vec = manager->allocate_dataframe_vector<int>();
+      auto data_vec = manager->allocate_dataframe_vector<long long>();
+      std::vector<long long> data(kGroupSize);
+      std::vector<int> keys(kGroupSize);
+      std::mt19937 rng(0);
+      QuantileSketch<long long> sketches[2];
+      for (int key = 0; key < 2; key++) {
+        std::iota(data.begin(), data.end(), 0);
+        std::shuffle(data.begin(), data.end(), rng);
+        std::fill(keys.begin(), keys.end(), key);
+        key_vec.append(keys.data(), kGroupSize);
+        data_vec.append(data.data(), kGroupSize);
+        for (auto d : data) {
+          sketches[key].add(d);
+        }
+      }
+      for (auto q : {0.5, 0.9, 0.99}) {
+        auto expected = static_cast<long long>(q * kGroupSize);
+        auto exact_vec = data_vec.aggregate_quantile(manager, key_vec, q,
+                                                     /* exact = */ true);
+        auto approx_vec = data_vec.aggregate_quantile(manager, key_vec, q);
+        TEST_ASSERT(exact_vec.size() == 2);
+        TEST_ASSERT(approx_vec.size() == 2);
+        for (uint64_t i = 0; i < 2; i++) {
+          DerefScope scope;
+          TEST_ASSERT(exact_vec.at(scope, i) == expected);
+          TEST_ASSERT(std::abs(approx_vec.at(scope, i) - expected) <=
+                      kMaxRankError * kGroupSize);
+        }
+      }
+      TEST_ASSERT(!sketches[0].exact());
+      sketches[0].merge(sketches[1]);
+      TEST_ASSERT(sketches[0].count() == 2 * kGroupSize);
+      TEST_ASSERT(std::abs(sketches[0].quantile(0.5) -
+                           static_cast<long long>(kGroupSize / 2)) <=
+                  kMaxRankError * kGroupSize);
+    }
+
     {
       short data[] = {2, 5, 3, 7, 4, 6, 2, 6, 9, 0, -3, -5, -4, 3, -9};
       auto data_vec = manager->allocate_dataframe_vector<short>();
@@ -235,6 +282,189 @@ public:
       }
     }
 
+    {
+      long long lhs[] = {1, 2, 2, 3, 5};
+      long long rhs[] = {2, 3, 3, 4};
+      auto lhs_vec = manager->allocate_dataframe_vector<long long>();
+      auto rhs_vec = manager->allocate_dataframe_vector<long long>();
+      lhs_vec.append(lhs, std::size(lhs));
+      rhs_vec.append(rhs, std::size(rhs));
+      auto check_join = [&](JoinType type, uint64_t expected_size) {
+        auto [lhs_idx_vec, rhs_idx_vec] =
+            lhs_vec.hash_join(manager, rhs_vec, type);
+        TEST_ASSERT(lhs_idx_vec.size() == expected_size);
+        TEST_ASSERT(rhs_idx_vec.size() == expected_size);
+        for (uint64_t i = 0; i < expected_size; i++) {
+          DerefScope scope;
+          auto lhs_idx = lhs_idx_vec.at(scope, i);
+          auto rhs_idx = rhs_idx_vec.at(scope, i);
+          TEST_ASSERT(lhs_idx != kJoinNullIdx || rhs_idx != kJoinNullIdx);
+          if (lhs_idx != kJoinNullIdx && rhs_idx != kJoinNullIdx) {
+            TEST_ASSERT(lhs[lhs_idx] == rhs[rhs_idx]);
+          }
+        }
+        auto joined = lhs_vec.copy_data_by_idx(manager, lhs_idx_vec);
+        TEST_ASSERT(joined.size() == expected_size);
+      };
+      // Matches: (2, 2) x 2 and (3, 3) x 2.
+      check_join(InnerJoin, 4);
+      check_join(LeftJoin, 6);
+      check_join(RightJoin, 5);
+      check_join(OuterJoin, 7);
+    }
+
+    {
+      // Unsorted keys; groups are numbered in the order of first appearance.
+      // {(4, {1, 7}), (1, {2, 4, 6}), (3, {3, 9})}
+      int key1[] = {4, 1, 3, 1, 4, 1, 3};
+      int key2[] = {0, 0, 0, 1, 0, 0, 0};
+      double data[] = {1, 2, 3, 4, 7, 6, 9};
+      auto key1_vec = manager->allocate_dataframe_vector<int>();
+      auto key2_vec = manager->allocate_dataframe_vector<int>();
+      auto data_vec = manager->allocate_dataframe_vector<double>();
+      key1_vec.append(key1, std::size(key1));
+      key2_vec.append(key2, std::size(key2));
+      data_vec.append(data, std::size(data));
+
+      auto [group_ids, first_idx] = key1_vec.hash_group(manager);
+      TEST_ASSERT(first_idx.size() == 3);
+      auto keys = key1_vec.copy_data_by_idx(manager, first_idx);
+      auto check = [&](AggregateOp op, std::vector<double> expected) {
+        auto agg_vec =
+            data_vec.aggregate_by_group(manager, group_ids, 3, op);
+        TEST_ASSERT(agg_vec.size() == expected.size());
+        for (uint64_t i = 0; i < expected.size(); i++) {
+          DerefScope scope;
+          TEST_ASSERT(agg_vec.at(scope, i) == expected[i]);
+        }
+      };
+      {
+        DerefScope scope;
+        TEST_ASSERT(keys.at(scope, 0) == 4);
+        TEST_ASSERT(keys.at(scope, 1) == 1);
+        TEST_ASSERT(keys.at(scope, 2) == 3);
+      }
+      check(AggSum, {8, 12, 12});
+      check(AggMean, {4, 4, 6});
+      check(AggMedian, {4, 4, 6});
+      check(AggVar, {18, 4, 18});
+      check(AggFirst, {1, 2, 3});
+      check(AggLast, {7, 6, 9});
+      check(AggMin, {1, 2, 3});
+      check(AggMax, {7, 6, 9});
+
+      // Counted in unsigned long long whatever the column type is.
+      char chars[] = {'a', 'b', 'c', 'd', 'e', 'f', 'g'};
+      auto char_vec = manager->allocate_dataframe_vector<char>();
+      char_vec.append(chars, std::size(chars));
+      auto count_vec = char_vec.count_by_group(manager, group_ids, 3);
+      TEST_ASSERT(count_vec.size() == 3);
+      {
+        DerefScope scope;
+        TEST_ASSERT(count_vec.at(scope, 0) == 2);
+        TEST_ASSERT(count_vec.at(scope, 1) == 3);
+        TEST_ASSERT(count_vec.at(scope, 2) == 2);
+      }
+
+      // Grouping by (key1, key2) splits group 1 into {2, 6} and {4}.
+      auto [group_ids2, first_idx2] =
+          key2_vec.hash_group(manager, &group_ids);
+      TEST_ASSERT(first_idx2.size() == 4);
+      auto agg_vec = data_vec.aggregate_by_group(manager, group_ids2,
+                                                 first_idx2.size(), AggSum);
+      {
+        DerefScope scope;
+        TEST_ASSERT(agg_vec.at(scope, 0) == 8);
+        TEST_ASSERT(agg_vec.at(scope, 1) == 8);
+        TEST_ASSERT(agg_vec.at(scope, 2) == 12);
+        TEST_ASSERT(agg_vec.at(scope, 3) == 4);
+      }
+    }
+
+    {
+      // Groups far larger than an exact sketch, one of them odd-sized, with
+      // plenty of ties.
+      constexpr uint64_t kNumRows = 300001;
+      constexpr uint64_t kNumGroups = 3;
+      std::mt19937 rng(1);
+      std::vector<int> keys(kNumRows);
+      std::vector<double> values(kNumRows);
+      std::vector<std::vector<double>> groups(kNumGroups);
+      for (uint64_t i = 0; i < kNumRows; i++) {
+        keys[i] = i % kNumGroups;
+        values[i] = rng() % 1000 + (i % 2) * 0.5;
+        groups[keys[i]].push_back(values[i]);
+      }
+      auto key_vec = manager->allocate_dataframe_vector<int>();
+      auto data_vec = manager->allocate_dataframe_vector<double>();
+      key_vec.append(keys.data(), kNumRows);
+      data_vec.append(values.data(), kNumRows);
+      auto [group_ids, first_idx] = key_vec.hash_group(manager);
+      auto median_vec = data_vec.aggregate_by_group(manager, group_ids,
+                                                    kNumGroups, AggMedian);
+      for (uint64_t i = 0; i < kNumGroups; i++) {
+        auto &group = groups[i];
+        std::sort(group.begin(), group.end());
+        auto n = group.size();
+        auto expected =
+            n % 2 ? group[n / 2] : (group[n / 2 - 1] + group[n / 2]) / 2;
+        DerefScope scope;
+        TEST_ASSERT(median_vec.at(scope, i) == expected);
+      }
+
+      constexpr double kQ = 0.9;
+      auto exact_vec = data_vec.quantile_by_group(manager, group_ids,
+                                                  kNumGroups, kQ, true);
+      auto approx_vec =
+          data_vec.quantile_by_group(manager, group_ids, kNumGroups, kQ);
+      for (uint64_t i = 0; i < kNumGroups; i++) {
+        auto &group = groups[i];
+        auto n = group.size();
+        auto rank = std::min<uint64_t>(n - 1, kQ * n);
+        DerefScope scope;
+        TEST_ASSERT(exact_vec.at(scope, i) == group[rank]);
+        // The sketch of the default k = 200 is off by at most 4n / 200 ranks.
+        auto approx = approx_vec.at(scope, i);
+        uint64_t lo = std::lower_bound(group.begin(), group.end(), approx) -
+                      group.begin();
+        uint64_t hi = std::upper_bound(group.begin(), group.end(), approx) -
+                      group.begin();
+        TEST_ASSERT(lo < hi);
+        TEST_ASSERT(lo <= rank + n / 50 && rank <= hi + n / 50);
+      }
+    }
+
+    {
+      // Exceed the local cache so that read_range() has to fetch chunks back.
+      constexpr uint64_t kNumRangeEntries = kCacheSize / sizeof(long long) * 2;
+      constexpr uint64_t kBatchSize = 1 << 20;
+      auto range_vec = manager->allocate_dataframe_vector<long long>();
+      std::vector<long long> buf(kBatchSize);
+      for (uint64_t i = 0; i < kNumRangeEntries; i += kBatchSize) {
+        std::iota(buf.begin(), buf.end(), static_cast<long long>(i));
+        range_vec.append(std::span<const long long>(buf));
+      }
+      TEST_ASSERT(range_vec.size() == kNumRangeEntries);
+      for (uint64_t i = 0; i < kNumRangeEntries; i += kBatchSize) {
+        range_vec.read_range(i, kBatchSize, buf.data());
+        for (uint64_t j = 0; j < kBatchSize; j++) {
+          TEST_ASSERT(buf[j] == static_cast<long long>(i + j));
+        }
+      }
+      // Unaligned range spanning multiple chunks.
+      constexpr uint64_t kOffset = 12345;
+      std::fill(buf.begin(), buf.end(), -1);
+      range_vec.write_range(kOffset, kBatchSize, buf.data());
+      buf.resize(kBatchSize + 2);
+      range_vec.read_range(kOffset - 1, kBatchSize + 2, buf.data());
+      TEST_ASSERT(buf[0] == static_cast<long long>(kOffset - 1));
+      for (uint64_t j = 1; j <= kBatchSize; j++) {
+        TEST_ASSERT(buf[j] == -1);
+      }
+      TEST_ASSERT(buf[kBatchSize + 1] ==
+                  static_cast<long long>(kOffset + kBatchSize));
+    }
+
     cout << "Passed" << endl;
   }
 };
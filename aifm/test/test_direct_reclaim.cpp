@@ -0,0 +1,154 @@
+extern "C" {
+#include <runtime/runtime.h>
+#include <runtime/timer.h>
+}
+
+#include "array.hpp"
+#include "deref_scope.hpp"
+#include "device.hpp"
+#include "helpers.hpp"
+#include "manager.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+using namespace far_memory;
+using namespace std;
+
+struct Data4096 {
+  char data[4096];
+};
+
+using Data_t = struct Data4096;
+
+constexpr uint64_t kCacheSize = 256 * Region::kSize;
+constexpr uint64_t kFarMemSize = (1ULL << 33); // 8 GB.
+constexpr uint64_t kNumGCThreads = 12;
+// Twice the size of the cache.
+constexpr uint64_t kNumEntries = 2 * kCacheSize / sizeof(Data_t);
+constexpr uint64_t kRecoverTimeoutUs = 10 * 1000 * 1000;
+constexpr uint64_t kNumArrayEntries = 2 * kCacheSize / sizeof(Data_t);
+// Swapped in ahead of use, so they stay cold.
+constexpr uint64_t kNumColdEntries = kCacheSize / 2 / sizeof(Data_t);
+// Used by a single scope, which outgrows the free cache.
+constexpr uint64_t kNumScopedEntries = 3 * kCacheSize / 8 / sizeof(Data_t);
+
+namespace far_memory {
+class FarMemTest {
+public:
+  uint64_t count_missing(Array<Data_t, kNumArrayEntries> *array,
+                         uint64_t begin, uint64_t end) {
+    uint64_t num_not_present = 0;
+    for (uint64_t i = begin; i < end; i++) {
+      num_not_present += !array->ptrs_[i].meta().is_present();
+    }
+    return num_not_present;
+  }
+
+  // Nothing is freed here, so the scope can only go on if the cold objects
+  // are evicted while it holds the GC back.
+  void run_live(FarMemManager *manager) {
+    auto array = std::unique_ptr<Array<Data_t, kNumArrayEntries>>(
+        manager->allocate_array_heap<Data_t, kNumArrayEntries>());
+    array->disable_prefetch();
+    for (uint64_t i = 0; i < kNumArrayEntries; i++) {
+      DerefScope scope;
+      auto &entry = array->at_mut(scope, i);
+      memset(entry.data, static_cast<char>(i), sizeof(Data_t));
+    }
+
+    constexpr uint64_t kColdBegin = 0;
+    constexpr uint64_t kColdEnd = kColdBegin + kNumColdEntries;
+    array->advise(kColdBegin, kColdEnd, kAdviceWillNeed);
+    auto start_us = microtime();
+    while (count_missing(array.get(), kColdBegin, kColdEnd)) {
+      TEST_ASSERT(microtime() - start_us < kRecoverTimeoutUs);
+      timer_sleep(1000);
+    }
+
+    constexpr uint64_t kScopedBegin = kColdEnd;
+    constexpr uint64_t kScopedEnd = kScopedBegin + kNumScopedEntries;
+    {
+      DerefScope scope;
+      std::vector<const Data_t *> raw_ptrs;
+      for (uint64_t i = kScopedBegin; i < kScopedEnd; i++) {
+        raw_ptrs.push_back(&array->at(scope, i));
+      }
+      // The objects used by the scope stay where they are.
+      for (uint64_t i = kScopedBegin; i < kScopedEnd; i++) {
+        const auto *entry = raw_ptrs[i - kScopedBegin];
+        TEST_ASSERT(entry->data[0] == static_cast<char>(i));
+        TEST_ASSERT(entry->data[sizeof(Data_t) - 1] == static_cast<char>(i));
+      }
+    }
+    TEST_ASSERT(count_missing(array.get(), kColdBegin, kColdEnd));
+
+    for (uint64_t i = 0; i < kNumArrayEntries; i++) {
+      DerefScope scope;
+      const auto &entry = array->at(scope, i);
+      TEST_ASSERT(entry.data[0] == static_cast<char>(i));
+      TEST_ASSERT(entry.data[sizeof(Data_t) - 1] == static_cast<char>(i));
+    }
+  }
+};
+} // namespace far_memory
+
+void do_work(FarMemManager *manager) {
+  cout << "Running " << __FILE__ "..." << endl;
+
+  // The GC cannot make progress while the scope is held, so the allocations
+  // are served by the reserve and by reclaiming the regions of the freed
+  // objects instead.
+  bool overloaded = false;
+  {
+    DerefScope scope;
+    for (uint64_t i = 0; i < kNumEntries; i++) {
+      auto far_mem_ptr = manager->allocate_unique_ptr<Data_t>();
+      auto raw_mut_ptr = far_mem_ptr.deref_mut(scope);
+      memset(raw_mut_ptr->data, static_cast<char>(i), sizeof(Data_t));
+      TEST_ASSERT(raw_mut_ptr->data[sizeof(Data_t) - 1] ==
+                  static_cast<char>(i));
+      overloaded |= manager->is_overloaded();
+    }
+  }
+  TEST_ASSERT(overloaded);
+
+  // The reserve is refilled once the GC is able to run again.
+  auto start_us = microtime();
+  while (manager->is_overloaded()) {
+    TEST_ASSERT(microtime() - start_us < kRecoverTimeoutUs);
+    thread_yield();
+  }
+
+  FarMemTest test;
+  test.run_live(manager);
+
+  cout << "Passed" << endl;
+}
+
+void _main(void *arg) {
+  auto manager = std::unique_ptr<FarMemManager>(FarMemManagerFactory::build(
+      kCacheSize, kNumGCThreads, new FakeDevice(kFarMemSize)));
+  do_work(manager.get());
+}
+
+int main(int argc, char *argv[]) {
+  int ret;
+
+  if (argc < 2) {
+    std::cerr << "usage: [cfg_file]" << std::endl;
+    return -EINVAL;
+  }
+
+  ret = runtime_init(argv[1], _main, NULL);
+  if (ret) {
+    std::cerr << "failed to start runtime" << std::endl;
+    return ret;
+  }
+
+  return 0;
+}
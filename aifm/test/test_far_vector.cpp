@@ -0,0 +1,154 @@
+extern "C" {
+#include <runtime/runtime.h>
+}
+
+#include "deref_scope.hpp"
+#include "device.hpp"
+#include "far_vector.hpp"
+#include "helpers.hpp"
+#include "manager.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+using namespace far_memory;
+using namespace std;
+
+constexpr uint64_t kCacheSize = 256 * Region::kSize;
+constexpr uint64_t kFarMemSize = (1ULL << 33); // 8 GB.
+constexpr uint64_t kNumGCThreads = 12;
+constexpr uint64_t kNumEntries = 32 << 20; // 32 million entries, 768 MiB.
+constexpr uint64_t kNumElementsPerScope = 1024;
+constexpr uint64_t kRangeSize = 1 << 20;
+
+// Not a power of 2, and not one of the DataFrameVector types.
+struct Point {
+  uint64_t id;
+  double x;
+  uint32_t tag;
+};
+
+Point make_point(uint64_t i) {
+  return Point{.id = i, .x = static_cast<double>(i) / 2, .tag = ~uint32_t(i)};
+}
+
+bool is_point(const Point &p, uint64_t i) {
+  return p.id == i && p.x == static_cast<double>(i) / 2 &&
+         p.tag == ~uint32_t(i);
+}
+
+namespace far_memory {
+class FarMemTest {
+public:
+  bool check(FarVector<Point> *vec, uint64_t offset, uint64_t num) {
+    if (vec->size() != num) {
+      return false;
+    }
+    DerefScope scope;
+    auto it = vec->cfbegin(scope);
+    for (uint64_t i = 0; i < num; i++, ++it) {
+      if (unlikely(i % kNumElementsPerScope == 0)) {
+        scope.renew();
+        it.renew(scope);
+      }
+      if (!is_point(*it, offset + i)) {
+        return false;
+      }
+    }
+    return it == vec->cfend(scope);
+  }
+
+  void test_basic(FarMemManager *manager, bool offloaded) {
+    auto vec = manager->allocate_far_vector<Point>(offloaded);
+    TEST_ASSERT(vec.is_offloaded() == offloaded);
+    for (uint64_t i = 0; i < kNumEntries; i++) {
+      DerefScope scope;
+      vec.push_back(scope, make_point(i));
+    }
+    TEST_ASSERT(vec.size() == kNumEntries);
+    TEST_ASSERT(vec.capacity() >= kNumEntries);
+    TEST_ASSERT(check(&vec, 0, kNumEntries));
+    {
+      DerefScope scope;
+      TEST_ASSERT(is_point(vec.front(scope), 0));
+      TEST_ASSERT(is_point(vec.back(scope), kNumEntries - 1));
+      vec.pop_back(scope);
+      TEST_ASSERT(vec.size() == kNumEntries - 1);
+      vec.at_mut(scope, 1) = make_point(2);
+      TEST_ASSERT(is_point(vec.at(scope, 1), 2));
+      vec.at_mut(scope, 1) = make_point(1);
+    }
+
+    // Range I/O across chunk boundaries.
+    std::vector<Point> buf(kRangeSize);
+    vec.read_range(kNumEntries / 3, kRangeSize, buf.data());
+    for (uint64_t i = 0; i < kRangeSize; i++) {
+      TEST_ASSERT(is_point(buf[i], kNumEntries / 3 + i));
+    }
+    vec.clear();
+    for (uint64_t i = 0; i < kRangeSize; i++) {
+      buf[i] = make_point(i);
+    }
+    vec.append(buf.data(), kRangeSize);
+    vec.append(std::span<const Point>(buf).subspan(0, 1));
+    vec.resize(2 * kRangeSize);
+    vec.write_range(kRangeSize, kRangeSize, buf.data());
+    for (uint64_t i = 0; i < kRangeSize; i++) {
+      buf[i] = make_point(kRangeSize + i);
+    }
+    vec.write_range(kRangeSize, kRangeSize, buf.data());
+    TEST_ASSERT(check(&vec, 0, 2 * kRangeSize));
+
+    // Copy, assign and self-assign, which are done by the server if offloaded.
+    auto copy = vec;
+    TEST_ASSERT(copy.is_offloaded() == offloaded);
+    TEST_ASSERT(check(&copy, 0, 2 * kRangeSize));
+    copy.assign(vec, kRangeSize / 2, 2 * kRangeSize);
+    TEST_ASSERT(check(&copy, kRangeSize / 2, kRangeSize * 3 / 2));
+    vec.assign(vec, kRangeSize, 2 * kRangeSize);
+    TEST_ASSERT(check(&vec, kRangeSize, kRangeSize));
+    {
+      DerefScope scope;
+      copy.push_back(scope, make_point(2 * kRangeSize));
+    }
+    TEST_ASSERT(check(&copy, kRangeSize / 2, kRangeSize * 3 / 2 + 1));
+
+    auto moved = std::move(copy);
+    TEST_ASSERT(check(&moved, kRangeSize / 2, kRangeSize * 3 / 2 + 1));
+  }
+
+  void do_work(FarMemManager *manager) {
+    cout << "Running " << __FILE__ "..." << endl;
+    test_basic(manager, /* offloaded = */ false);
+    test_basic(manager, /* offloaded = */ true);
+    cout << "Passed" << endl;
+  }
+};
+} // namespace far_memory
+
+void _main(void *arg) {
+  auto manager = std::unique_ptr<FarMemManager>(FarMemManagerFactory::build(
+      kCacheSize, kNumGCThreads, new FakeDevice(kFarMemSize)));
+  FarMemTest test;
+  test.do_work(manager.get());
+}
+
+int main(int argc, char *argv[]) {
+  int ret;
+
+  if (argc < 2) {
+    std::cerr << "usage: [cfg_file]" << std::endl;
+    return -EINVAL;
+  }
+
+  ret = runtime_init(argv[1], _main, NULL);
+  if (ret) {
+    std::cerr << "failed to start runtime" << std::endl;
+    return ret;
+  }
+
+  return 0;
+}
@@ -0,0 +1,141 @@
+extern "C" {
+#include <runtime/runtime.h>
+}
+#include "thread.h"
+
+#include "array.hpp"
+#include "deref_scope.hpp"
+#include "device.hpp"
+#include "helpers.hpp"
+#include "manager.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+using namespace far_memory;
+using namespace std;
+
+#define DEFINE_DATA_TYPE(width)                                                \
+  struct Data_##width {                                                        \
+    uint8_t buf[width];                                                        \
+  };                                                                           \
+  using Data_t = Data_##width;
+
+DEFINE_DATA_TYPE(4096);
+
+constexpr uint64_t kCacheSize = 256 * Region::kSize;
+constexpr uint64_t kFarMemSize = 8ULL << 30;
+constexpr uint64_t kArraySize = 1ULL << 30;
+constexpr uint64_t kNumGCThreads = 12;
+constexpr uint64_t kNumEntries = kArraySize / sizeof(Data_t);
+constexpr uint64_t kNumMutators = 8;
+constexpr uint64_t kNumEntriesPerMutator = kNumEntries / kNumMutators;
+
+namespace far_memory {
+class FarMemTest {
+public:
+  // A write-heavy pass by all the mutators, which drains the free cache
+  // faster than a single one.
+  void write_all(Array<Data_t, kNumEntries> *array, uint8_t seed) {
+    std::vector<rt::Thread> threads;
+    for (uint64_t tid = 0; tid < kNumMutators; tid++) {
+      threads.emplace_back(rt::Thread([&, tid]() {
+        auto begin = tid * kNumEntriesPerMutator;
+        for (uint64_t i = begin; i < begin + kNumEntriesPerMutator; i++) {
+          DerefScope scope;
+          auto &data = array->at_mut(scope, i);
+          memset(data.buf, static_cast<uint8_t>(i + seed), sizeof(Data_t));
+        }
+      }));
+    }
+    for (auto &thread : threads) {
+      thread.Join();
+    }
+  }
+
+  void check_all(Array<Data_t, kNumEntries> *array, uint8_t seed) {
+    for (uint64_t i = 0; i < kNumEntries; i++) {
+      DerefScope scope;
+      const auto &data = array->at(scope, i);
+      TEST_ASSERT(data.buf[0] == static_cast<uint8_t>(i + seed));
+      TEST_ASSERT(data.buf[sizeof(Data_t) - 1] ==
+                  static_cast<uint8_t>(i + seed));
+    }
+  }
+
+  void print(const char *name, const GCPacer::Stats &stats) {
+    cout << name << ": GC rounds = " << stats.num_rounds
+         << ", early rounds = " << stats.num_early_rounds
+         << ", stalls = " << stats.num_stalls
+         << ", stall us = " << stats.stall_us
+         << ", estimated avoided stall us = " << stats.avoided_stall_us
+         << endl;
+  }
+
+  void run(FarMemManager *manager) {
+    auto &pacer = manager->gc_pacer_;
+    auto static_low_thresh = pacer.get_low_thresh();
+    auto array = std::unique_ptr<Array<Data_t, kNumEntries>>(
+        manager->allocate_array_heap<Data_t, kNumEntries>());
+    array->disable_prefetch();
+
+    // The fixed trigger first; the rates are still measured meanwhile.
+    pacer.set_adaptive(false);
+    write_all(array.get(), 0);
+    check_all(array.get(), 0);
+    TEST_ASSERT(pacer.get_low_thresh() == static_low_thresh);
+    auto fixed_stats = pacer.get_stats();
+    TEST_ASSERT(fixed_stats.num_rounds);
+    TEST_ASSERT(!fixed_stats.num_early_rounds);
+
+    // The same passes, paced by the rates.
+    pacer.set_adaptive(true);
+    pacer.reset_stats();
+    write_all(array.get(), 1);
+    check_all(array.get(), 1);
+    auto adaptive_stats = pacer.get_stats();
+    print("Fixed", fixed_stats);
+    print("Adaptive", adaptive_stats);
+    TEST_ASSERT(adaptive_stats.num_rounds);
+    // The trigger follows the measured rates, and keeps the mutators from
+    // stalling at least as well as the static one.
+    TEST_ASSERT(pacer.get_low_thresh() != static_low_thresh);
+    TEST_ASSERT(adaptive_stats.stall_us <= fixed_stats.stall_us);
+
+    cout << "Passed" << endl;
+  }
+};
+} // namespace far_memory
+
+void do_work(FarMemManager *manager) {
+  cout << "Running " << __FILE__ "..." << endl;
+  FarMemTest test;
+  test.run(manager);
+}
+
+void _main(void *arg) {
+  auto manager = std::unique_ptr<FarMemManager>(FarMemManagerFactory::build(
+      kCacheSize, kNumGCThreads, new FakeDevice(kFarMemSize)));
+  do_work(manager.get());
+}
+
+int main(int argc, char *argv[]) {
+  int ret;
+
+  if (argc < 2) {
+    std::cerr << "usage: [cfg_file]" << std::endl;
+    return -EINVAL;
+  }
+
+  ret = runtime_init(argv[1], _main, NULL);
+  if (ret) {
+    std::cerr << "failed to start runtime" << std::endl;
+    return ret;
+  }
+
+  return 0;
+}
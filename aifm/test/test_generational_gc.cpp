@@ -0,0 +1,124 @@
+extern "C" {
+#include <runtime/runtime.h>
+}
+
+#include "deref_scope.hpp"
+#include "device.hpp"
+#include "helpers.hpp"
+#include "manager.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+using namespace far_memory;
+using namespace std;
+
+struct Data4096 {
+  char data[4096];
+};
+
+using Data_t = struct Data4096;
+
+constexpr uint64_t kCacheSize = 256 * Region::kSize;
+constexpr uint64_t kFarMemSize = (1ULL << 33); // 8 GB.
+constexpr uint64_t kNumGCThreads = 12;
+constexpr uint64_t kNumHotEntries = 4096;  // 16 MiB.
+constexpr uint64_t kNumColdEntries = 1 << 18; // 1 GiB.
+constexpr uint64_t kNumColdEntriesPerBatch = 1024;
+
+namespace far_memory {
+class FarMemTest {
+private:
+  std::vector<UniquePtr<Data_t>> hot_vec_;
+  std::vector<UniquePtr<Data_t>> cold_vec_;
+
+  void touch_hot() {
+    for (uint64_t i = 0; i < kNumHotEntries; i++) {
+      DerefScope scope;
+      const auto *raw_ptr = hot_vec_[i].deref(scope);
+      TEST_ASSERT(raw_ptr->data[0] == static_cast<char>(i));
+    }
+  }
+
+public:
+  void run(FarMemManager *manager) {
+    for (uint64_t i = 0; i < kNumHotEntries; i++) {
+      auto far_mem_ptr = manager->allocate_unique_ptr<Data_t>();
+      {
+        DerefScope scope;
+        auto raw_mut_ptr = far_mem_ptr.deref_mut(scope);
+        memset(raw_mut_ptr->data, static_cast<char>(i), sizeof(Data_t));
+      }
+      hot_vec_.emplace_back(std::move(far_mem_ptr));
+    }
+
+    // The cold entries stay live until the end but overflow the cache, so
+    // the GC keeps evacuating them while the hot ones are accessed in between.
+    for (uint64_t i = 0; i < kNumColdEntries; i++) {
+      if (i % kNumColdEntriesPerBatch == 0) {
+        touch_hot();
+      }
+      auto far_mem_ptr = manager->allocate_unique_ptr<Data_t>();
+      {
+        DerefScope scope;
+        auto raw_mut_ptr = far_mem_ptr.deref_mut(scope);
+        memset(raw_mut_ptr->data, static_cast<char>(i), sizeof(Data_t));
+      }
+      cold_vec_.emplace_back(std::move(far_mem_ptr));
+    }
+
+    // The hot entries have survived GC rounds and been promoted.
+    uint64_t num_promoted = 0;
+    for (auto &ptr : hot_vec_) {
+      auto &meta = ptr.meta();
+      if (meta.is_present() &&
+          Region::get_gen(meta.get_object_addr()) != Region::kGenYoung) {
+        num_promoted++;
+      }
+    }
+    TEST_ASSERT(num_promoted >= kNumHotEntries / 2);
+
+    touch_hot();
+    for (uint64_t i = 0; i < kNumColdEntries; i++) {
+      DerefScope scope;
+      const auto *raw_ptr = cold_vec_[i].deref(scope);
+      TEST_ASSERT(raw_ptr->data[sizeof(Data_t) - 1] == static_cast<char>(i));
+    }
+
+    cout << "Passed" << endl;
+  }
+};
+} // namespace far_memory
+
+void do_work(FarMemManager *manager) {
+  cout << "Running " << __FILE__ "..." << endl;
+  FarMemTest test;
+  test.run(manager);
+}
+
+void _main(void *arg) {
+  auto manager = std::unique_ptr<FarMemManager>(FarMemManagerFactory::build(
+      kCacheSize, kNumGCThreads, new FakeDevice(kFarMemSize)));
+  do_work(manager.get());
+}
+
+int main(int argc, char *argv[]) {
+  int ret;
+
+  if (argc < 2) {
+    std::cerr << "usage: [cfg_file]" << std::endl;
+    return -EINVAL;
+  }
+
+  ret = runtime_init(argv[1], _main, NULL);
+  if (ret) {
+    std::cerr << "failed to start runtime" << std::endl;
+    return ret;
+  }
+
+  return 0;
+}
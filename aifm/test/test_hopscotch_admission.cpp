@@ -0,0 +1,137 @@
+extern "C" {
+#include <runtime/runtime.h>
+}
+
+#include "concurrent_hopscotch.hpp"
+#include "deref_scope.hpp"
+#include "device.hpp"
+#include "helpers.hpp"
+#include "manager.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+
+using namespace far_memory;
+using namespace std;
+
+constexpr static uint32_t kValueLen = 700;
+constexpr static uint32_t kHashTableNumEntriesShift = 19;
+constexpr static uint32_t kHashTableRemoteDataSize =
+    (Object::kHeaderSize + sizeof(uint64_t) + kValueLen) *
+    (1 << kHashTableNumEntriesShift);
+constexpr static double kLoadFactor = 0.80;
+constexpr static uint32_t kNumKVPairs =
+    kLoadFactor * (1 << kHashTableNumEntriesShift);
+// About 11 MiB, which fits in the cache with plenty of room.
+constexpr static uint32_t kNumHotKeys = 16384;
+// Out of every kNumOpsPerRound lookups, one steps a scan over all keys.
+constexpr static uint32_t kNumOpsPerRound = 4;
+constexpr static uint64_t kNumWarmupOps = 1 << 20;
+constexpr static uint64_t kNumOps = 1 << 21;
+
+constexpr static uint64_t kCacheSize = (128ULL << 20);
+constexpr static uint64_t kFarMemSize = (1ULL << 30);
+constexpr static uint32_t kNumGCThreads = 12;
+constexpr static uint64_t kNumCachedKeys =
+    kCacheSize / (Object::kHeaderSize + sizeof(uint64_t) + kValueLen);
+
+struct Value {
+  char data[kValueLen];
+};
+
+namespace far_memory {
+class FarMemTest {
+public:
+  // Returns the hit ratio of the lookups of the hot keys.
+  double run_phase(ConcurrentHopscotch<uint64_t, Value> *hopscotch) {
+    for (uint64_t i = 0; i < kNumKVPairs; i++) {
+      Value value;
+      memset(value.data, static_cast<char>(i), kValueLen);
+      hopscotch->insert_tp(i, value);
+    }
+
+    uint64_t scan_key = 0, num_hot_lookups = 0, num_hot_hits = 0;
+    for (uint64_t i = 0; i < kNumWarmupOps + kNumOps; i++) {
+      bool scan = (i % kNumOpsPerRound == 0);
+      uint64_t key = scan ? scan_key++ % kNumKVPairs : rand() % kNumHotKeys;
+      Value value;
+      uint16_t value_len;
+      bool forwarded = false;
+      {
+        DerefScope scope;
+        hopscotch->_get(sizeof(key), reinterpret_cast<const uint8_t *>(&key),
+                        &value_len, reinterpret_cast<uint8_t *>(&value),
+                        &forwarded);
+      }
+      TEST_ASSERT(value_len == kValueLen);
+      TEST_ASSERT(value.data[0] == static_cast<char>(key));
+      TEST_ASSERT(value.data[kValueLen - 1] == static_cast<char>(key));
+      if (!scan && i >= kNumWarmupOps) {
+        num_hot_lookups++;
+        num_hot_hits += !forwarded;
+      }
+    }
+    return static_cast<double>(num_hot_hits) / num_hot_lookups;
+  }
+
+  void run(FarMemManager *manager) {
+    double hit_ratio;
+    {
+      auto hopscotch = std::unique_ptr<ConcurrentHopscotch<uint64_t, Value>>(
+          manager->allocate_concurrent_hopscotch_heap<uint64_t, Value>(
+              kHashTableNumEntriesShift, kHashTableNumEntriesShift,
+              kHashTableRemoteDataSize));
+      hit_ratio = run_phase(hopscotch.get());
+    }
+
+    double filtered_hit_ratio;
+    {
+      auto hopscotch = std::unique_ptr<ConcurrentHopscotch<uint64_t, Value>>(
+          manager->allocate_concurrent_hopscotch_heap<uint64_t, Value>(
+              kHashTableNumEntriesShift, kHashTableNumEntriesShift,
+              kHashTableRemoteDataSize));
+      hopscotch->set_admission_filter(kNumCachedKeys);
+      filtered_hit_ratio = run_phase(hopscotch.get());
+    }
+
+    cout << "Hot key hit ratio: without filter = " << hit_ratio
+         << ", with filter = " << filtered_hit_ratio << endl;
+    TEST_ASSERT(filtered_hit_ratio > hit_ratio);
+
+    cout << "Passed" << endl;
+  }
+};
+} // namespace far_memory
+
+void do_work(FarMemManager *manager) {
+  cout << "Running " << __FILE__ "..." << endl;
+  FarMemTest test;
+  test.run(manager);
+}
+
+void _main(void *args) {
+  std::unique_ptr<FarMemManager> manager =
+      std::unique_ptr<FarMemManager>(FarMemManagerFactory::build(
+          kCacheSize, kNumGCThreads, new FakeDevice(kFarMemSize)));
+  do_work(manager.get());
+}
+
+int main(int argc, char **argv) {
+  int ret;
+
+  if (argc < 2) {
+    std::cerr << "usage: [cfg_file]" << std::endl;
+    return -EINVAL;
+  }
+
+  ret = runtime_init(argv[1], _main, NULL);
+  if (ret) {
+    std::cerr << "failed to start runtime" << std::endl;
+    return ret;
+  }
+
+  return 0;
+}
@@ -0,0 +1,139 @@
+extern "C" {
+#include <runtime/runtime.h>
+}
+
+#include "concurrent_hopscotch.hpp"
+#include "deref_scope.hpp"
+#include "device.hpp"
+#include "hash.hpp"
+#include "helpers.hpp"
+#include "manager.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <memory>
+
+using namespace far_memory;
+using namespace std;
+
+constexpr static uint32_t kValueLen = 700;
+constexpr static uint32_t kHashTableNumEntriesShift = 19;
+constexpr static uint32_t kHashTableRemoteDataSize =
+    (Object::kHeaderSize + sizeof(uint64_t) + kValueLen) *
+    (1 << kHashTableNumEntriesShift);
+constexpr static double kLoadFactor = 0.80;
+constexpr static uint32_t kNumKVPairs =
+    kLoadFactor * (1 << kHashTableNumEntriesShift);
+constexpr static double kMaxFalsePositiveRatio = 0.05;
+
+// Much smaller than the data, so that most keys live remotely.
+constexpr static uint64_t kCacheSize = (128ULL << 20);
+constexpr static uint64_t kFarMemSize = (1ULL << 30);
+constexpr static uint32_t kNumGCThreads = 12;
+
+struct Value {
+  char data[kValueLen];
+};
+
+namespace far_memory {
+class FarMemTest {
+public:
+  using Hopscotch = ConcurrentHopscotch<uint64_t, Value>;
+
+  bool may_contain(Hopscotch *hopscotch, uint64_t key) {
+    return hopscotch->negative_filter_->may_contain(
+        hash_32(static_cast<const void *>(&key), sizeof(key)));
+  }
+
+  // Returns the ratio of the lookups that had to go to the remote side.
+  double check_absent(Hopscotch *hopscotch, uint64_t begin, uint64_t end,
+                      uint64_t stride) {
+    uint64_t num_lookups = 0, num_forwarded = 0;
+    for (uint64_t key = begin; key < end; key += stride) {
+      TEST_ASSERT(!hopscotch->find_tp(key));
+      num_lookups++;
+      num_forwarded += may_contain(hopscotch, key);
+    }
+    return static_cast<double>(num_forwarded) / num_lookups;
+  }
+
+  void check_present(Hopscotch *hopscotch, uint64_t begin, uint64_t end,
+                     uint64_t stride) {
+    for (uint64_t key = begin; key < end; key += stride) {
+      auto value = hopscotch->find_tp(key);
+      TEST_ASSERT(value);
+      TEST_ASSERT(value->data[0] == static_cast<char>(key));
+      TEST_ASSERT(value->data[kValueLen - 1] == static_cast<char>(key));
+    }
+  }
+
+  void run(FarMemManager *manager) {
+    auto hopscotch = std::unique_ptr<Hopscotch>(
+        manager->allocate_concurrent_hopscotch_heap<uint64_t, Value>(
+            kHashTableNumEntriesShift, kHashTableNumEntriesShift,
+            kHashTableRemoteDataSize));
+    hopscotch->set_negative_filter(kNumKVPairs);
+
+    // Only the even keys exist.
+    for (uint64_t i = 0; i < kNumKVPairs; i++) {
+      Value value;
+      memset(value.data, static_cast<char>(i * 2), kValueLen);
+      hopscotch->insert_tp(i * 2, value);
+    }
+    // Overwriting keys, most of which are remote by now, adds nothing.
+    for (uint64_t i = 0; i < kNumKVPairs; i += 2) {
+      Value value;
+      memset(value.data, static_cast<char>(i * 2), kValueLen);
+      hopscotch->insert_tp(i * 2, value);
+    }
+    TEST_ASSERT(hopscotch->size() == kNumKVPairs);
+
+    check_present(hopscotch.get(), 0, kNumKVPairs * 2, 2);
+    auto ratio = check_absent(hopscotch.get(), 1, kNumKVPairs * 2, 2);
+    cout << "Forwarded absent lookups: " << ratio << endl;
+    TEST_ASSERT(ratio <= kMaxFalsePositiveRatio);
+
+    // The removed keys become absent as well.
+    for (uint64_t key = 0; key < kNumKVPairs * 2; key += 4) {
+      TEST_ASSERT(hopscotch->erase_tp(key));
+    }
+    check_present(hopscotch.get(), 2, kNumKVPairs * 2, 4);
+    ratio = check_absent(hopscotch.get(), 0, kNumKVPairs * 2, 4);
+    cout << "Forwarded lookups of removed keys: " << ratio << endl;
+    TEST_ASSERT(ratio <= kMaxFalsePositiveRatio);
+
+    cout << "Passed" << endl;
+  }
+};
+} // namespace far_memory
+
+void do_work(FarMemManager *manager) {
+  cout << "Running " << __FILE__ "..." << endl;
+  FarMemTest test;
+  test.run(manager);
+}
+
+void _main(void *args) {
+  std::unique_ptr<FarMemManager> manager =
+      std::unique_ptr<FarMemManager>(FarMemManagerFactory::build(
+          kCacheSize, kNumGCThreads, new FakeDevice(kFarMemSize)));
+  do_work(manager.get());
+}
+
+int main(int argc, char **argv) {
+  int ret;
+
+  if (argc < 2) {
+    std::cerr << "usage: [cfg_file]" << std::endl;
+    return -EINVAL;
+  }
+
+  ret = runtime_init(argv[1], _main, NULL);
+  if (ret) {
+    std::cerr << "failed to start runtime" << std::endl;
+    return ret;
+  }
+
+  return 0;
+}
@@ -0,0 +1,91 @@
+extern "C" {
+#include <runtime/runtime.h>
+#include <runtime/timer.h>
+}
+#include "thread.h"
+
+#include "helpers.hpp"
+#include "io_scheduler.hpp"
+
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+
+using namespace far_memory;
+
+namespace far_memory {
+
+constexpr static uint32_t kNumSlots = 9; // One of them is reserved.
+
+class FarMemTest {
+public:
+  void run() {
+    std::cout << "Running " << __FILE__ "..." << std::endl;
+
+    IOScheduler scheduler(kNumSlots);
+    for (uint32_t i = 0; i < kNumSlots; i++) {
+      TEST_ASSERT(scheduler.acquire(kIOWriteBack));
+    }
+
+    bool prefetch_admitted = true;
+    bool prefetch_done = false;
+    bool demand_done = false;
+    rt::Thread prefetch_thread([&]() {
+      prefetch_admitted = scheduler.acquire(kIOPrefetch);
+      ACCESS_ONCE(prefetch_done) = true;
+    });
+    rt::Thread demand_thread([&]() {
+      TEST_ASSERT(scheduler.acquire(kIODemand));
+      ACCESS_ONCE(demand_done) = true;
+    });
+    // Let the prefetch become stale while the slots are busy.
+    timer_sleep(1000);
+
+    // The only free slot is reserved for write-backs.
+    scheduler.release(kIOWriteBack, 4096);
+    timer_sleep(100);
+    TEST_ASSERT(!ACCESS_ONCE(demand_done));
+    TEST_ASSERT(!ACCESS_ONCE(prefetch_done));
+
+    // The demand request goes first; the prefetch is then cancelled.
+    scheduler.release(kIOWriteBack, 4096);
+    demand_thread.Join();
+    scheduler.release(kIOWriteBack, 4096);
+    prefetch_thread.Join();
+    TEST_ASSERT(!prefetch_admitted);
+
+    auto demand_stats = scheduler.get_stats(kIODemand);
+    auto prefetch_stats = scheduler.get_stats(kIOPrefetch);
+    auto write_back_stats = scheduler.get_stats(kIOWriteBack);
+    TEST_ASSERT(demand_stats.num_ops == 1);
+    TEST_ASSERT(prefetch_stats.num_ops == 0);
+    TEST_ASSERT(prefetch_stats.num_cancelled == 1);
+    TEST_ASSERT(write_back_stats.num_ops == kNumSlots);
+    TEST_ASSERT(write_back_stats.num_bytes == 3 * 4096);
+
+    std::cout << "Passed" << std::endl;
+  }
+};
+} // namespace far_memory
+
+void _main(void *args) {
+  FarMemTest ts;
+  ts.run();
+}
+
+int main(int argc, char **argv) {
+  int ret;
+
+  if (argc < 2) {
+    std::cerr << "usage: [cfg_file]" << std::endl;
+    return -EINVAL;
+  }
+
+  ret = runtime_init(argv[1], _main, NULL);
+  if (ret) {
+    std::cerr << "failed to start runtime" << std::endl;
+    return ret;
+  }
+
+  return 0;
+}
@@ -0,0 +1,143 @@
+extern "C" {
+#include <runtime/runtime.h>
+#include <runtime/timer.h>
+}
+
+#include "deref_scope.hpp"
+#include "list.hpp"
+#include "manager.hpp"
+#include "queue.hpp"
+
+#include <iostream>
+#include <memory>
+
+using namespace far_memory;
+
+struct Data {
+  uint32_t data;
+  uint32_t dummy[1023];
+
+  Data(uint32_t _data) : data(_data) {}
+};
+
+constexpr uint64_t kCacheSize = (256ULL << 20);
+constexpr uint64_t kFarMemSize = (8ULL << 30);
+constexpr uint32_t kNumGCThreads = 12;
+constexpr uint32_t kNumDataEntries = 8 * kCacheSize / sizeof(Data);
+constexpr uint32_t kScopeResetInterval = 256;
+constexpr uint64_t kMaxDrainUs = 1000 * 1000;
+
+namespace far_memory {
+
+class FarMemTest {
+public:
+  // All in-flight prefetches complete, and the window stays in bounds. Must be
+  // invoked outside of any DerefScope, as the prefetches may wait for the GC.
+  void check_prefetch_state(GenericList *list) {
+    auto start_us = microtime();
+    for (auto iter = ++list->local_list_.begin();
+         iter != --list->local_list_.end(); ++iter) {
+      while (ACCESS_ONCE(iter->swapping_in)) {
+        TEST_ASSERT(microtime() - start_us < kMaxDrainUs);
+        thread_yield();
+      }
+    }
+    TEST_ASSERT(list->prefetch_window_ >= 1);
+    TEST_ASSERT(list->prefetch_window_ <= GenericList::kMaxPrefetchNumNodes);
+  }
+
+  void test_list() {
+    auto list = [&] {
+      DerefScope scope;
+      return FarMemManagerFactory::get()->allocate_list<Data>(scope);
+    }();
+    fill_and_scan(&list);
+    check_prefetch_state(&list);
+  }
+
+  void fill_and_scan(List<Data> *list_ptr) {
+    auto &list = *list_ptr;
+    DerefScope scope;
+    for (uint32_t i = 0; i < kNumDataEntries; i++) {
+      if (unlikely(i % kScopeResetInterval == 0)) {
+        scope.renew();
+      }
+      list.push_back(scope, Data(i));
+    }
+
+    uint32_t idx = 0;
+    for (auto iter = list.begin(scope); iter != list.end(scope);
+         iter.inc(scope)) {
+      if (unlikely(idx % kScopeResetInterval == 0)) {
+        scope.renew();
+      }
+      TEST_ASSERT(iter.deref(scope).data == idx++);
+    }
+    TEST_ASSERT(idx == kNumDataEntries);
+
+    for (auto iter = list.rbegin(scope); iter != list.rend(scope);
+         iter.inc(scope)) {
+      if (unlikely(idx % kScopeResetInterval == 0)) {
+        scope.renew();
+      }
+      TEST_ASSERT(iter.deref(scope).data == --idx);
+    }
+    TEST_ASSERT(idx == 0);
+  }
+
+  void test_queue() {
+    DerefScope scope;
+    Queue<Data> queue =
+        FarMemManagerFactory::get()->allocate_queue<Data>(scope);
+    for (uint32_t i = 0; i < kNumDataEntries; i++) {
+      if (unlikely(i % kScopeResetInterval == 0)) {
+        scope.renew();
+      }
+      queue.push(scope, Data(i));
+    }
+
+    for (uint32_t i = 0; i < kNumDataEntries; i++) {
+      if (unlikely(i % kScopeResetInterval == 0)) {
+        scope.renew();
+      }
+      TEST_ASSERT(queue.cfront(scope).data == i);
+      queue.pop(scope);
+    }
+    TEST_ASSERT(queue.empty());
+    // No node is left to wait for.
+    check_prefetch_state(&queue.list_);
+  }
+
+  void do_work(FarMemManager *manager) {
+    std::cout << "Running " << __FILE__ "..." << std::endl;
+    test_list();
+    test_queue();
+    std::cout << "Passed" << std::endl;
+  }
+};
+} // namespace far_memory
+
+void _main(void *arg) {
+  std::unique_ptr<FarMemManager> manager =
+      std::unique_ptr<FarMemManager>(FarMemManagerFactory::build(
+          kCacheSize, kNumGCThreads, new FakeDevice(kFarMemSize)));
+  FarMemTest test;
+  test.do_work(manager.get());
+}
+
+int main(int argc, char *argv[]) {
+  int ret;
+
+  if (argc < 2) {
+    std::cerr << "usage: [cfg_file]" << std::endl;
+    return -EINVAL;
+  }
+
+  ret = runtime_init(argv[1], _main, NULL);
+  if (ret) {
+    std::cerr << "failed to start runtime" << std::endl;
+    return ret;
+  }
+
+  return 0;
+}
@@ -0,0 +1,117 @@
+extern "C" {
+#include <runtime/runtime.h>
+}
+#include "thread.h"
+
+#include "helpers.hpp"
+#include "local_skiplist.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+using namespace far_memory;
+using namespace std;
+
+constexpr static uint64_t kLocalSkiplistDataSize = (1 << 30);
+constexpr static uint32_t kNumThreads = 32;
+constexpr static uint32_t kNumScanThreads = 4;
+constexpr static uint32_t kNumEntries = 1 << 18;
+constexpr static uint32_t kNumRounds = 4;
+constexpr static uint32_t kScanLen = 1 << 12;
+
+// Descending order, to exercise a non-default comparator.
+using Skiplist = LocalSkiplist<uint64_t, std::greater<uint64_t>>;
+
+void do_work(void *arg) {
+  auto skiplist = std::make_unique<Skiplist>(kLocalSkiplistDataSize);
+  std::atomic<bool> done{false};
+  std::vector<rt::Thread> threads;
+
+  // Scanners only ever see the keys in order.
+  for (uint32_t tid = 0; tid < kNumScanThreads; tid++) {
+    threads.emplace_back(rt::Thread([&, tid]() {
+      uint64_t hi = tid;
+      while (!done.load()) {
+        hi = (hi * 7 + kScanLen) % kNumEntries;
+        uint64_t lo = hi > kScanLen ? hi - kScanLen : 0;
+        bool first = true;
+        uint64_t last = 0;
+        for (const auto &key : skiplist->range(hi, lo)) {
+          TEST_ASSERT(key <= hi && key >= lo && (first || key < last));
+          first = false;
+          last = key;
+        }
+        thread_yield();
+      }
+    }));
+  }
+
+  // In each round, all threads race on inserting every key, then on removing
+  // the odd ones, and then the even ones; each key is inserted and removed
+  // exactly once.
+  auto race_fn = [&](std::function<bool(uint64_t)> op, uint64_t begin) {
+    std::atomic<uint64_t> num_succeeded{0};
+    std::vector<rt::Thread> mutators;
+    for (uint32_t tid = 0; tid < kNumThreads; tid++) {
+      mutators.emplace_back(rt::Thread([&, tid]() {
+        uint64_t num = 0;
+        auto offset = tid * kNumEntries / kNumThreads;
+        for (uint64_t i = begin; i < kNumEntries; i += 2) {
+          num += op((i + offset) % kNumEntries);
+        }
+        num_succeeded += num;
+      }));
+    }
+    for (auto &mutator : mutators) {
+      mutator.Join();
+    }
+    return num_succeeded.load();
+  };
+
+  for (uint32_t round = 0; round < kNumRounds; round++) {
+    auto insert_fn = [&](uint64_t key) { return skiplist->insert(key); };
+    auto remove_fn = [&](uint64_t key) { return skiplist->remove(key); };
+    // kNumEntries and the offsets are even, so begin picks the parity.
+    TEST_ASSERT(race_fn(insert_fn, 0) + race_fn(insert_fn, 1) == kNumEntries);
+    TEST_ASSERT(race_fn(remove_fn, 1) == kNumEntries / 2);
+    uint64_t expected = kNumEntries - 2;
+    for (const auto &key : skiplist->range(kNumEntries, 0)) {
+      TEST_ASSERT(key == expected);
+      expected -= 2;
+    }
+    TEST_ASSERT(expected == static_cast<uint64_t>(-2));
+    for (uint64_t i = 0; i < kNumEntries; i++) {
+      TEST_ASSERT(skiplist->exist(i) == (i % 2 == 0));
+    }
+    TEST_ASSERT(race_fn(remove_fn, 0) == kNumEntries / 2);
+    auto range = skiplist->range(kNumEntries, 0);
+    TEST_ASSERT(range.begin() == range.end());
+  }
+  done = true;
+  for (auto &thread : threads) {
+    thread.Join();
+  }
+
+  std::cout << "Passed" << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+  int ret;
+
+  if (argc < 2) {
+    std::cerr << "usage: [cfg_file]" << std::endl;
+    return -EINVAL;
+  }
+
+  ret = runtime_init(argv[1], do_work, NULL);
+  if (ret) {
+    std::cerr << "failed to start runtime" << std::endl;
+    return ret;
+  }
+
+  return 0;
+}
@@ -18,6 +18,7 @@ constexpr static uint64_t kLocalSkiplistDataSize = (1 << 30);
 
 constexpr static uint32_t kKeyMaxLen = 10;
 constexpr static uint32_t kNumEntries = 1 << 20;
+constexpr static uint32_t kNumRanges = 1 << 10;
 
 std::set<uint32_t> my_set;
 
@@ -30,9 +31,21 @@ void do_work(void *arg) {
     my_set.insert(key);
   }
 
+  for (uint32_t i = 0; i < kNumRanges; i++) {
+    uint32_t lo = rand();
+    uint32_t hi = lo + rand() % (RAND_MAX / (kNumEntries / kNumRanges));
+    auto it = my_set.lower_bound(lo);
+    for (const auto &key : local_skiplist.range(lo, hi)) {
+      TEST_ASSERT(it != my_set.end() && *it == key);
+      ++it;
+    }
+    TEST_ASSERT(it == my_set.upper_bound(hi));
+  }
+
   for (const auto &key : my_set) {
     TEST_ASSERT(local_skiplist.exist(key));
     TEST_ASSERT(local_skiplist.remove(key));
+    TEST_ASSERT(!local_skiplist.exist(key));
   }
 
   std::cout << "Passed" << std::endl;
@@ -0,0 +1,131 @@
+extern "C" {
+#include <runtime/runtime.h>
+}
+
+#include "array.hpp"
+#include "deref_scope.hpp"
+#include "device.hpp"
+#include "manager.hpp"
+
+#include <cstdint>
+#include <iostream>
+#include <memory>
+
+using namespace far_memory;
+using namespace std;
+
+constexpr uint64_t kCacheSize = (128ULL << 20);
+constexpr uint64_t kFarMemSize = (4ULL << 30);
+constexpr uint32_t kNumGCThreads = 12;
+// 1 GiB, so the array is much larger than the local cache.
+constexpr uint64_t kNumEntries = (128ULL << 20);
+constexpr uint64_t kNumRows = 1000;
+constexpr uint64_t kNumCols = 1001;
+constexpr uint32_t kScopeResetInterval = 4096;
+
+namespace far_memory {
+class FarMemTest {
+public:
+  void test_1d(FarMemManager *manager) {
+    using Array_t = PackedArray<uint64_t, kNumEntries>;
+    auto array = std::unique_ptr<Array_t>(
+        manager->allocate_packed_array_heap<uint64_t, kNumEntries>());
+    // One object per chunk rather than per element.
+    TEST_ASSERT(Array_t::kChunkNumEntries == 4096 / sizeof(uint64_t));
+    TEST_ASSERT(array->kNumItems_ == kNumEntries / Array_t::kChunkNumEntries);
+
+    {
+      DerefScope scope;
+      for (uint64_t i = 0; i < kNumEntries; i++) {
+        if (unlikely(i % kScopeResetInterval == 0)) {
+          scope.renew();
+        }
+        array->at_mut(scope, i) = i * 3;
+      }
+    }
+    // Forward and backward scans, both served by the chunk prefetcher.
+    {
+      DerefScope scope;
+      for (uint64_t i = 0; i < kNumEntries; i++) {
+        if (unlikely(i % kScopeResetInterval == 0)) {
+          scope.renew();
+        }
+        TEST_ASSERT(array->at(scope, i) == i * 3);
+      }
+      for (uint64_t i = kNumEntries; i-- > 0;) {
+        if (unlikely(i % kScopeResetInterval == 0)) {
+          scope.renew();
+        }
+        TEST_ASSERT(array->at(scope, i) == i * 3);
+      }
+    }
+
+    array->write(static_cast<uint64_t>(7), 12345);
+    TEST_ASSERT(array->read(12345) == 7);
+    array->advise(0, kNumEntries / 2, kAdviceDontNeed);
+    TEST_ASSERT(array->read_safe(12345) == 7);
+    bool thrown = false;
+    try {
+      array->read_safe(kNumEntries);
+    } catch (std::invalid_argument &) {
+      thrown = true;
+    }
+    TEST_ASSERT(thrown);
+  }
+
+  void test_2d(FarMemManager *manager) {
+    // A chunk size that does not divide the array size.
+    auto array = manager->allocate_packed_array<uint32_t, kNumRows, kNumCols>();
+    for (uint64_t i = 0; i < kNumRows; i++) {
+      DerefScope scope;
+      for (uint64_t j = 0; j < kNumCols; j++) {
+        array.at_mut(scope, i, j) = i * kNumCols + j;
+      }
+    }
+    array.static_prefetch(std::make_tuple(0, 0), std::make_tuple(0, 1),
+                          kNumRows * kNumCols);
+    for (uint64_t i = 0; i < kNumRows; i++) {
+      DerefScope scope;
+      for (uint64_t j = 0; j < kNumCols; j++) {
+        TEST_ASSERT(array.at(scope, i, j) == i * kNumCols + j);
+      }
+    }
+  }
+
+  void run(FarMemManager *manager) {
+    test_1d(manager);
+    test_2d(manager);
+    cout << "Passed" << endl;
+  }
+};
+} // namespace far_memory
+
+void do_work(FarMemManager *manager) {
+  cout << "Running " << __FILE__ "..." << endl;
+  FarMemTest test;
+  test.run(manager);
+}
+
+void _main(void *arg) {
+  std::unique_ptr<FarMemManager> manager =
+      std::unique_ptr<FarMemManager>(FarMemManagerFactory::build(
+          kCacheSize, kNumGCThreads, new FakeDevice(kFarMemSize)));
+  do_work(manager.get());
+}
+
+int main(int argc, char *argv[]) {
+  int ret;
+
+  if (argc < 2) {
+    std::cerr << "usage: [cfg_file]" << std::endl;
+    return -EINVAL;
+  }
+
+  ret = runtime_init(argv[1], _main, NULL);
+  if (ret) {
+    std::cerr << "failed to start runtime" << std::endl;
+    return ret;
+  }
+
+  return 0;
+}
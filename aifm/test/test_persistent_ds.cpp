@@ -0,0 +1,199 @@
+extern "C" {
+#include <runtime/runtime.h>
+}
+
+#include "concurrent_hopscotch.hpp"
+#include "dataframe_vector.hpp"
+#include "deref_scope.hpp"
+#include "device.hpp"
+#include "helpers.hpp"
+#include "manager.hpp"
+#include "server.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <memory>
+
+using namespace far_memory;
+using namespace std;
+
+constexpr static uint32_t kValueLen = 200;
+constexpr static uint32_t kHashTableNumEntriesShift = 18;
+constexpr static uint32_t kHashTableRemoteDataSize =
+    (Object::kHeaderSize + sizeof(uint64_t) + kValueLen) *
+    (1 << kHashTableNumEntriesShift);
+constexpr static uint32_t kNumKVPairs =
+    0.7 * (1 << kHashTableNumEntriesShift);
+constexpr static uint64_t kNumEntries = 16 << 20;
+
+// Smaller than the data, so that it lives both locally and remotely.
+constexpr static uint64_t kCacheSize = (32ULL << 20);
+constexpr static uint64_t kFarMemSize = (1ULL << 30);
+constexpr static uint32_t kNumGCThreads = 12;
+
+struct Value {
+  char data[kValueLen];
+};
+
+using Hopscotch = ConcurrentHopscotch<uint64_t, Value>;
+
+unique_ptr<Hopscotch> attach_hopscotch(FarMemManager *manager) {
+  return unique_ptr<Hopscotch>(
+      manager->allocate_concurrent_hopscotch_heap<uint64_t, Value>(
+          kHashTableNumEntriesShift, kHashTableNumEntriesShift,
+          kHashTableRemoteDataSize, "hopscotch"));
+}
+
+void check_hopscotch(Hopscotch *hopscotch, uint64_t delta) {
+  TEST_ASSERT(hopscotch->size() == kNumKVPairs);
+  for (uint64_t key = 0; key < kNumKVPairs; key++) {
+    auto value = hopscotch->find_tp(key);
+    TEST_ASSERT(value);
+    TEST_ASSERT(value->data[0] == static_cast<char>(key + delta));
+    TEST_ASSERT(value->data[kValueLen - 1] == static_cast<char>(key + delta));
+  }
+}
+
+void test_hopscotch(FarMemManager *manager) {
+  auto hopscotch = attach_hopscotch(manager);
+  TEST_ASSERT(!hopscotch->is_attached());
+  for (uint64_t key = 0; key < kNumKVPairs; key++) {
+    Value value;
+    memset(value.data, static_cast<char>(key), kValueLen);
+    hopscotch->insert_tp(key, value);
+  }
+  hopscotch.reset();
+
+  // Both the evicted and the locally cached entries survive.
+  hopscotch = attach_hopscotch(manager);
+  TEST_ASSERT(hopscotch->is_attached());
+  check_hopscotch(hopscotch.get(), 0);
+  for (uint64_t key = 0; key < kNumKVPairs; key++) {
+    Value value;
+    memset(value.data, static_cast<char>(key + 1), kValueLen);
+    hopscotch->insert_tp(key, value);
+  }
+  hopscotch.reset();
+
+  hopscotch = attach_hopscotch(manager);
+  TEST_ASSERT(hopscotch->is_attached());
+  check_hopscotch(hopscotch.get(), 1);
+  hopscotch->set_persistent(false);
+  hopscotch.reset();
+
+  hopscotch = attach_hopscotch(manager);
+  TEST_ASSERT(!hopscotch->is_attached());
+  TEST_ASSERT(hopscotch->empty());
+  TEST_ASSERT(!hopscotch->find_tp(0));
+  hopscotch->set_persistent(false);
+}
+
+void check_dataframe_vector(DataFrameVector<long long> *vec, uint64_t delta) {
+  TEST_ASSERT(vec->size() == kNumEntries);
+  for (uint64_t i = 0; i < kNumEntries; i++) {
+    DerefScope scope;
+    TEST_ASSERT(vec->at(scope, i) == static_cast<long long>(i + delta));
+  }
+}
+
+void test_dataframe_vector(FarMemManager *manager) {
+  auto vec = unique_ptr<DataFrameVector<long long>>(
+      manager->allocate_dataframe_vector_heap<long long>("dataframe"));
+  TEST_ASSERT(!vec->is_attached());
+  for (uint64_t i = 0; i < kNumEntries; i++) {
+    DerefScope scope;
+    vec->push_back(scope, static_cast<long long>(i));
+  }
+  vec.reset();
+
+  vec.reset(manager->allocate_dataframe_vector_heap<long long>("dataframe"));
+  TEST_ASSERT(vec->is_attached());
+  check_dataframe_vector(vec.get(), 0);
+  for (uint64_t i = 0; i < kNumEntries; i++) {
+    DerefScope scope;
+    vec->at_mut(scope, i)++;
+  }
+  vec.reset();
+
+  vec.reset(manager->allocate_dataframe_vector_heap<long long>("dataframe"));
+  TEST_ASSERT(vec->is_attached());
+  check_dataframe_vector(vec.get(), 1);
+  vec->set_persistent(false);
+  vec.reset();
+
+  vec.reset(manager->allocate_dataframe_vector_heap<long long>("dataframe"));
+  TEST_ASSERT(!vec->is_attached());
+  TEST_ASSERT(vec->empty());
+  vec->set_persistent(false);
+}
+
+void test_server_names() {
+  Server server;
+  const uint8_t name[] = {'d', 's'};
+  uint64_t size = kFarMemSize;
+  auto *params = reinterpret_cast<uint8_t *>(&size);
+  uint8_t meta_len;
+  uint8_t meta[std::numeric_limits<uint8_t>::max()];
+
+  TEST_ASSERT(server.attach(kVanillaPtrDSType, 1, sizeof(name), name,
+                            sizeof(size), params, &meta_len,
+                            meta) == Server::kAttachConstructed);
+  // The name is bound to ds_id 1.
+  TEST_ASSERT(server.attach(kVanillaPtrDSType, 2, sizeof(name), name,
+                            sizeof(size), params, &meta_len,
+                            meta) == Server::kAttachNameInUse);
+  TEST_ASSERT(!server.get_server_ds(2));
+
+  const uint8_t detach_meta[] = {42};
+  TEST_ASSERT(server.detach(1, sizeof(detach_meta), detach_meta));
+  TEST_ASSERT(server.attach(kHashTableDSType, 2, sizeof(name), name, 0,
+                            nullptr, &meta_len,
+                            meta) == Server::kAttachTypeMismatch);
+  TEST_ASSERT(!server.get_server_ds(2));
+  TEST_ASSERT(server.attach(kVanillaPtrDSType, 2, sizeof(name), name,
+                            sizeof(size), params, &meta_len,
+                            meta) == Server::kAttachReattached);
+  TEST_ASSERT(meta_len == sizeof(detach_meta) && meta[0] == detach_meta[0]);
+
+  // Destructing drops the name for good.
+  TEST_ASSERT(server.destruct(2));
+  TEST_ASSERT(server.attach(kVanillaPtrDSType, 1, sizeof(name), name,
+                            sizeof(size), params, &meta_len,
+                            meta) == Server::kAttachConstructed);
+  TEST_ASSERT(meta_len == 0);
+  server.reset();
+}
+
+void do_work(FarMemManager *manager) {
+  cout << "Running " << __FILE__ "..." << endl;
+  test_hopscotch(manager);
+  test_dataframe_vector(manager);
+  test_server_names();
+  cout << "Passed" << endl;
+}
+
+void _main(void *args) {
+  std::unique_ptr<FarMemManager> manager =
+      std::unique_ptr<FarMemManager>(FarMemManagerFactory::build(
+          kCacheSize, kNumGCThreads, new FakeDevice(kFarMemSize)));
+  do_work(manager.get());
+}
+
+int main(int argc, char **argv) {
+  int ret;
+
+  if (argc < 2) {
+    std::cerr << "usage: [cfg_file]" << std::endl;
+    return -EINVAL;
+  }
+
+  ret = runtime_init(argv[1], _main, NULL);
+  if (ret) {
+    std::cerr << "failed to start runtime" << std::endl;
+    return ret;
+  }
+
+  return 0;
+}
@@ -0,0 +1,97 @@
+extern "C" {
+#include <runtime/runtime.h>
+}
+#include "thread.h"
+
+#include "helpers.hpp"
+#include "prefetch_service.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+using namespace far_memory;
+
+constexpr static uint32_t kNumStreams = 32;
+constexpr static uint32_t kNumTraces = 20000;
+// Long enough for any scheduled stream to have been run.
+constexpr static uint64_t kDrainTimeoutUs = 1000 * 1000;
+
+// A stream whose run function consumes every trace published so far, like the
+// master of a Prefetcher.
+struct Owner {
+  std::atomic<uint64_t> num_published = 0;
+  std::atomic<uint64_t> num_consumed = 0;
+  PrefetchStream stream;
+
+  Owner() : stream(this, run, has_pending_traces) {}
+  ~Owner() { stream.unregister(); }
+
+  static bool run(void *owner) {
+    auto *self = reinterpret_cast<Owner *>(owner);
+    self->num_consumed = self->num_published.load();
+    return false;
+  }
+
+  static bool has_pending_traces(void *owner) {
+    auto *self = reinterpret_cast<Owner *>(owner);
+    return self->num_consumed.load() < self->num_published.load();
+  }
+};
+
+void do_work() {
+  std::cout << "Running " << __FILE__ "..." << std::endl;
+
+  std::vector<std::unique_ptr<Owner>> owners;
+  for (uint32_t i = 0; i < kNumStreams; i++) {
+    owners.emplace_back(new Owner());
+  }
+  std::vector<rt::Thread> threads;
+  for (auto &owner : owners) {
+    threads.emplace_back([&, owner = owner.get()]() {
+      for (uint32_t i = 0; i < kNumTraces; i++) {
+        owner->num_published++;
+        owner->stream.schedule();
+        if (i % 64 == 0) {
+          thread_yield();
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.Join();
+  }
+
+  // No trace is published anymore, so a stream left with unconsumed traces
+  // is one whose wakeup was lost.
+  auto start_us = microtime();
+  for (auto &owner : owners) {
+    while (owner->num_consumed.load() != kNumTraces) {
+      TEST_ASSERT(microtime() - start_us < kDrainTimeoutUs);
+      thread_yield();
+    }
+  }
+
+  std::cout << "Passed" << std::endl;
+}
+
+void _main(void *args) { do_work(); }
+
+int main(int argc, char **argv) {
+  int ret;
+
+  if (argc < 2) {
+    std::cerr << "usage: [cfg_file]" << std::endl;
+    return -EINVAL;
+  }
+
+  ret = runtime_init(argv[1], _main, NULL);
+  if (ret) {
+    std::cerr << "failed to start runtime" << std::endl;
+    return ret;
+  }
+
+  return 0;
+}
@@ -0,0 +1,130 @@
+extern "C" {
+#include <runtime/runtime.h>
+}
+
+#include "deref_scope.hpp"
+#include "device.hpp"
+#include "helpers.hpp"
+#include "manager.hpp"
+#include "zipf.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace far_memory;
+using namespace std;
+
+struct Data4096 {
+  char data[4096];
+};
+
+using Data_t = struct Data4096;
+
+constexpr uint64_t kCacheSize = 256 * Region::kSize;
+constexpr uint64_t kFarMemSize = (1ULL << 33); // 8 GB.
+constexpr uint64_t kNumGCThreads = 12;
+constexpr uint64_t kNumEntries = 1 << 18; // 1 GiB, 4x the cache.
+constexpr double kZipfParamS = 0.99;
+// Out of every kNumOpsPerRound operations, kNumScanOpsPerRound step a scan
+// over all entries and the rest are Zipf-distributed.
+constexpr uint32_t kNumOpsPerRound = 4;
+constexpr uint32_t kNumScanOpsPerRound = 1;
+constexpr uint64_t kNumWarmupOps = 1 << 20;
+constexpr uint64_t kNumOps = 1 << 21;
+
+namespace far_memory {
+class FarMemTest {
+private:
+  std::vector<UniquePtr<Data_t>> vec_;
+  uint64_t scan_idx_ = 0;
+
+  void access(uint64_t idx, uint32_t num_derefs) {
+    DerefScope scope;
+    for (uint32_t i = 0; i < num_derefs; i++) {
+      const auto *raw_ptr = vec_[idx].deref(scope);
+      TEST_ASSERT(raw_ptr->data[i] == static_cast<char>(idx));
+    }
+  }
+
+  // Returns the miss ratio of the Zipf-distributed accesses.
+  double replay(FarMemManager *manager, ReplacementPolicy policy) {
+    manager->set_replacement_policy(kVanillaPtrDSID, policy);
+    std::mt19937 rng(0);
+    zipf_table_distribution<> zipf(kNumEntries, kZipfParamS);
+    uint64_t num_zipf_accesses = 0, num_zipf_misses = 0;
+    for (uint64_t i = 0; i < kNumWarmupOps + kNumOps; i++) {
+      if (i % kNumOpsPerRound < kNumScanOpsPerRound) {
+        // The scan reads each entry twice, which makes it hot.
+        access(scan_idx_, 2);
+        scan_idx_ = (scan_idx_ + 1) % kNumEntries;
+        continue;
+      }
+      auto idx = zipf(rng) - 1;
+      if (i >= kNumWarmupOps) {
+        num_zipf_accesses++;
+        num_zipf_misses += !vec_[idx].meta().is_present();
+      }
+      access(idx, 1);
+    }
+    return static_cast<double>(num_zipf_misses) / num_zipf_accesses;
+  }
+
+public:
+  void run(FarMemManager *manager) {
+    for (uint64_t i = 0; i < kNumEntries; i++) {
+      auto far_mem_ptr = manager->allocate_unique_ptr<Data_t>();
+      {
+        DerefScope scope;
+        auto raw_mut_ptr = far_mem_ptr.deref_mut(scope);
+        memset(raw_mut_ptr->data, static_cast<char>(i), sizeof(Data_t));
+      }
+      vec_.emplace_back(std::move(far_mem_ptr));
+    }
+
+    auto hot_bit_miss_ratio = replay(manager, kReplaceHotBit);
+    auto lfu_miss_ratio = replay(manager, kReplaceLFU);
+    auto clock_pro_miss_ratio = replay(manager, kReplaceClockPro);
+    cout << "Zipf miss ratio: hot bit = " << hot_bit_miss_ratio
+         << ", LFU = " << lfu_miss_ratio
+         << ", CLOCK-Pro = " << clock_pro_miss_ratio << endl;
+    TEST_ASSERT(lfu_miss_ratio <= hot_bit_miss_ratio);
+    TEST_ASSERT(clock_pro_miss_ratio <= hot_bit_miss_ratio);
+
+    cout << "Passed" << endl;
+  }
+};
+} // namespace far_memory
+
+void do_work(FarMemManager *manager) {
+  cout << "Running " << __FILE__ "..." << endl;
+  auto test = std::make_unique<FarMemTest>();
+  test->run(manager);
+}
+
+void _main(void *arg) {
+  auto manager = std::unique_ptr<FarMemManager>(FarMemManagerFactory::build(
+      kCacheSize, kNumGCThreads, new FakeDevice(kFarMemSize)));
+  do_work(manager.get());
+}
+
+int main(int argc, char *argv[]) {
+  int ret;
+
+  if (argc < 2) {
+    std::cerr << "usage: [cfg_file]" << std::endl;
+    return -EINVAL;
+  }
+
+  ret = runtime_init(argv[1], _main, NULL);
+  if (ret) {
+    std::cerr << "failed to start runtime" << std::endl;
+    return ret;
+  }
+
+  return 0;
+}
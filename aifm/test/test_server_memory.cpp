@@ -0,0 +1,64 @@
+extern "C" {
+#include <runtime/runtime.h>
+}
+
+#include "helpers.hpp"
+#include "server_memory.hpp"
+
+#include <cstdint>
+#include <iostream>
+#include <memory>
+
+using namespace far_memory;
+using namespace std;
+
+// Spans two map chunks, the second one partially.
+constexpr uint64_t kMemSize = ServerMemory::kMapChunkSize + (3 << 20);
+constexpr uint64_t kStride = 4099;
+
+void do_work(void *arg) {
+  cout << "Running " << __FILE__ "..." << endl;
+
+  auto mem = std::make_unique<ServerMemory>(kMemSize);
+  TEST_ASSERT(mem->size() >= kMemSize);
+  TEST_ASSERT(mem->size() % helpers::kHugepageSize == 0);
+  TEST_ASSERT(reinterpret_cast<uint64_t>(mem->get()) %
+                  helpers::kHugepageSize ==
+              0);
+  TEST_ASSERT(mem->get_num_hugetlb_bytes() <= mem->size());
+
+  // Races with the prefaulting threads, which must not clobber the data.
+  auto *buf = mem->get();
+  for (uint64_t i = 0; i < kMemSize; i += kStride) {
+    buf[i] = static_cast<uint8_t>(i);
+  }
+  for (uint64_t i = 0; i < kMemSize; i++) {
+    TEST_ASSERT(buf[i] == (i % kStride ? 0 : static_cast<uint8_t>(i)));
+  }
+  mem.reset();
+
+  // Destructed while still prefaulting.
+  mem.reset(new ServerMemory(kMemSize, ServerMemory::get_numa_node()));
+  TEST_ASSERT(ServerMemory::get_numa_node() <
+              ServerMemory::get_num_numa_nodes());
+  mem.reset();
+
+  cout << "Passed" << endl;
+}
+
+int main(int argc, char *argv[]) {
+  int ret;
+
+  if (argc < 2) {
+    std::cerr << "usage: [cfg_file]" << std::endl;
+    return -EINVAL;
+  }
+
+  ret = runtime_init(argv[1], do_work, NULL);
+  if (ret) {
+    std::cerr << "failed to start runtime" << std::endl;
+    return ret;
+  }
+
+  return 0;
+}
@@ -0,0 +1,167 @@
+extern "C" {
+#include <runtime/runtime.h>
+}
+
+#include "device.hpp"
+#include "helpers.hpp"
+#include "internal/dataframe_types.hpp"
+#include "internal/ds_info.hpp"
+#include "server.hpp"
+
+#include <cstdint>
+#include <iostream>
+#include <limits>
+
+using namespace far_memory;
+
+constexpr static uint64_t kFarMemSize = (1ULL << 30);
+constexpr static uint8_t kNamedDSID = 1;
+constexpr static uint8_t kExtraDSID = 2;
+const uint8_t kName[] = {'d', 'f'};
+
+namespace far_memory {
+class FarMemTest {
+private:
+  uint8_t meta_[std::numeric_limits<uint8_t>::max()];
+  uint8_t meta_len_;
+
+  uint8_t attach_vector(Server *server, uint8_t ds_id) {
+    uint8_t dt_id = DataFrameTypeID::LongLong;
+    return server->attach(kDataFrameVectorDSType, ds_id, sizeof(kName), kName,
+                          sizeof(dt_id), &dt_id, &meta_len_, meta_);
+  }
+
+  uint8_t attach_vanilla(Server *server, uint8_t ds_id, uint64_t size) {
+    return server->attach(kVanillaPtrDSType, ds_id, sizeof(kName), kName,
+                          sizeof(size), reinterpret_cast<uint8_t *>(&size),
+                          &meta_len_, meta_);
+  }
+
+  bool construct_vanilla(Server *server, uint8_t ds_id, uint64_t size) {
+    return server->construct(kVanillaPtrDSType, ds_id, sizeof(size),
+                             reinterpret_cast<uint8_t *>(&size));
+  }
+
+  void write(FakeDevice *device, uint64_t obj_id, uint64_t val) {
+    device->write_object(kVanillaPtrDSID, sizeof(obj_id),
+                         reinterpret_cast<uint8_t *>(&obj_id), sizeof(val),
+                         reinterpret_cast<uint8_t *>(&val));
+  }
+
+  uint64_t read(FakeDevice *device, uint64_t obj_id) {
+    uint64_t val;
+    uint16_t data_len;
+    device->read_object(kVanillaPtrDSID, sizeof(obj_id),
+                        reinterpret_cast<uint8_t *>(&obj_id), &data_len,
+                        reinterpret_cast<uint8_t *>(&val));
+    TEST_ASSERT(data_len == sizeof(val));
+    return val;
+  }
+
+public:
+  // Two tenants with the same ds_ids and names.
+  void test_isolation(FakeDevice *device_a, FakeDevice *device_b) {
+    write(device_a, 0, 1);
+    write(device_b, 0, 2);
+    TEST_ASSERT(read(device_a, 0) == 1);
+    TEST_ASSERT(read(device_b, 0) == 2);
+
+    auto *server_a = &device_a->server_;
+    auto *server_b = &device_b->server_;
+    TEST_ASSERT(attach_vector(server_a, kNamedDSID) ==
+                Server::kAttachConstructed);
+    TEST_ASSERT(attach_vector(server_b, kNamedDSID) ==
+                Server::kAttachConstructed);
+    TEST_ASSERT(server_a->get_server_ds(kNamedDSID) !=
+                server_b->get_server_ds(kNamedDSID));
+
+    const uint8_t meta = 42;
+    TEST_ASSERT(server_a->detach(kNamedDSID, sizeof(meta), &meta));
+    // Still bound in the other namespace.
+    TEST_ASSERT(attach_vector(server_b, kExtraDSID) ==
+                Server::kAttachNameInUse);
+    TEST_ASSERT(attach_vector(server_a, kExtraDSID) ==
+                Server::kAttachReattached);
+    TEST_ASSERT(meta_len_ == sizeof(meta) && meta_[0] == meta);
+    TEST_ASSERT(server_a->destruct(kExtraDSID));
+    TEST_ASSERT(server_b->destruct(kNamedDSID));
+  }
+
+  void test_quota(FakeDevice *device) {
+    auto *server = &device->server_;
+    // The vanilla DS of the device takes up the whole quota.
+    TEST_ASSERT(server->get_committed_bytes() == kFarMemSize);
+    TEST_ASSERT(!construct_vanilla(server, kExtraDSID, 1));
+    TEST_ASSERT(attach_vanilla(server, kNamedDSID, 1) ==
+                Server::kAttachRefused);
+    TEST_ASSERT(!server->get_server_ds(kExtraDSID));
+    TEST_ASSERT(!server->get_server_ds(kNamedDSID));
+
+    // The quota counts the total across the constructs.
+    server->set_far_mem_quota(2 * kFarMemSize);
+    TEST_ASSERT(construct_vanilla(server, kExtraDSID, kFarMemSize / 2));
+    TEST_ASSERT(!construct_vanilla(server, kNamedDSID, kFarMemSize));
+    TEST_ASSERT(server->destruct(kExtraDSID));
+    TEST_ASSERT(server->get_committed_bytes() == kFarMemSize);
+    // Invalid requests are refused rather than asserted on.
+    TEST_ASSERT(!construct_vanilla(server, kVanillaPtrDSID, 1));
+    TEST_ASSERT(!server->construct(kMaxNumDSTypes, kExtraDSID, 0, nullptr));
+    TEST_ASSERT(!server->construct(kVanillaPtrDSType, kExtraDSID, 0, nullptr));
+    TEST_ASSERT(!server->destruct(kExtraDSID));
+  }
+
+  // A detached DS stays charged to the tenant across its sessions.
+  void test_session_teardown(FakeDevice *device) {
+    auto *server = &device->server_;
+    server->set_far_mem_quota(2 * kFarMemSize);
+    TEST_ASSERT(attach_vanilla(server, kNamedDSID, kFarMemSize) ==
+                Server::kAttachConstructed);
+    TEST_ASSERT(server->detach(kNamedDSID, 0, nullptr));
+    TEST_ASSERT(!construct_vanilla(server, kExtraDSID, 1));
+
+    server->reset();
+    TEST_ASSERT(!server->get_server_ds(kVanillaPtrDSID));
+    TEST_ASSERT(server->get_committed_bytes() == kFarMemSize);
+
+    // The next session.
+    TEST_ASSERT(construct_vanilla(server, kVanillaPtrDSID, kFarMemSize));
+    TEST_ASSERT(attach_vanilla(server, kExtraDSID, kFarMemSize) ==
+                Server::kAttachReattached);
+    TEST_ASSERT(server->get_committed_bytes() == 2 * kFarMemSize);
+    TEST_ASSERT(server->destruct(kExtraDSID));
+    TEST_ASSERT(server->get_committed_bytes() == kFarMemSize);
+  }
+
+  void do_work() {
+    std::cout << "Running " << __FILE__ "..." << std::endl;
+    FakeDevice device_a(kFarMemSize);
+    FakeDevice device_b(kFarMemSize);
+    test_isolation(&device_a, &device_b);
+    test_quota(&device_a);
+    test_session_teardown(&device_b);
+    std::cout << "Passed" << std::endl;
+  }
+};
+} // namespace far_memory
+
+void _main(void *args) {
+  FarMemTest test;
+  test.do_work();
+}
+
+int main(int argc, char **argv) {
+  int ret;
+
+  if (argc < 2) {
+    std::cerr << "usage: [cfg_file]" << std::endl;
+    return -EINVAL;
+  }
+
+  ret = runtime_init(argv[1], _main, NULL);
+  if (ret) {
+    std::cerr << "failed to start runtime" << std::endl;
+    return ret;
+  }
+
+  return 0;
+}
@@ -6,14 +6,20 @@ extern "C" {
 #include "slab.hpp"
 
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <memory>
+#include <utility>
+#include <vector>
 
 using namespace far_memory;
 
 namespace far_memory {
 
 constexpr static uint32_t kAllocateMemSize = (1 << 30);
+constexpr static uint32_t kLargeObjectSize = (1 << 20);
+constexpr static uint32_t kNumChurnObjects = 1 << 14;
+constexpr static uint32_t kNumChurnRounds = 4;
 
 class FarMemTest {
 public:
@@ -24,30 +30,54 @@ public:
 
     auto base_ptr =
         static_cast<uint8_t *>(helpers::allocate_hugepage(kAllocateMemSize));
-    auto cur_ptr = base_ptr;
-    auto slab = Slab(cur_ptr, kAllocateMemSize);
-
-    cur_ptr += Slab::kReplenishChunkSize * Slab::kMinSlabClassSize;
-    TEST_ASSERT(slab.allocate(Slab::kMinSlabClassSize - 1) ==
-                cur_ptr - Slab::kMinSlabClassSize);
-    TEST_ASSERT(slab.allocate(Slab::kMinSlabClassSize) ==
-                cur_ptr - Slab::kMinSlabClassSize * 2);
-    TEST_ASSERT(slab.slabs_[get_core_num()][0].size() ==
-                Slab::kReplenishChunkSize - 2);
-
-    cur_ptr += Slab::kReplenishChunkSize * Slab::kMaxSlabClassSize;
-    TEST_ASSERT(slab.allocate(Slab::kMaxSlabClassSize / 2 + 1) ==
-                cur_ptr - Slab::kMaxSlabClassSize);
-    TEST_ASSERT(
-        slab.slabs_[get_core_num()][helpers::bsr_32(Slab::kMaxSlabClassSize >>
-                                                    Slab::kMinSlabClassShift)]
-            .size() == Slab::kReplenishChunkSize - 1);
-
-    TEST_ASSERT(slab.cur_ - slab.base_.get() == cur_ptr - base_ptr);
-
-    slab.free(cur_ptr - Slab::kMaxSlabClassSize, Slab::kMaxSlabClassSize);
-    TEST_ASSERT(slab.allocate(Slab::kMaxSlabClassSize) ==
-                cur_ptr - Slab::kMaxSlabClassSize);
+    auto slab = Slab(base_ptr, kAllocateMemSize);
+    TEST_ASSERT(slab.get_footprint() == 0);
+
+    // Objects of a class are carved out of the same span, and a freed object
+    // gets reused first.
+    auto *obj = slab.allocate(Slab::kMinSlabClassSize - 1);
+    TEST_ASSERT(obj >= base_ptr && obj < base_ptr + Slab::kMinSpanSize);
+    TEST_ASSERT(slab.get_footprint() == Slab::kMinSpanSize);
+    auto *another = slab.allocate(Slab::kMinSlabClassSize);
+    TEST_ASSERT(another >= base_ptr && another < base_ptr + Slab::kMinSpanSize);
+    TEST_ASSERT(another != obj);
+    slab.free(obj, Slab::kMinSlabClassSize);
+    TEST_ASSERT(slab.allocate(Slab::kMinSlabClassSize) == obj);
+    slab.free(obj, Slab::kMinSlabClassSize);
+    slab.free(another, Slab::kMinSlabClassSize);
+
+    // The largest class, and large objects which take whole pages.
+    obj = slab.allocate(Slab::kMaxSlabClassSize);
+    TEST_ASSERT(obj);
+    memset(obj, 0xff, Slab::kMaxSlabClassSize);
+    auto footprint = slab.get_footprint();
+    auto *large = slab.allocate(kLargeObjectSize);
+    TEST_ASSERT(large);
+    memset(large, 0xff, kLargeObjectSize);
+    TEST_ASSERT(slab.get_footprint() == footprint + kLargeObjectSize);
+    slab.free(large, kLargeObjectSize);
+    TEST_ASSERT(slab.get_footprint() == footprint);
+    slab.free(obj, Slab::kMaxSlabClassSize);
+
+    // Under churn, the freed objects overflow the magazines and the depot,
+    // and the emptied spans are returned to the page heap.
+    std::vector<std::pair<uint8_t *, uint32_t>> objs;
+    for (uint32_t round = 0; round < kNumChurnRounds; round++) {
+      for (uint32_t i = 0; i < kNumChurnObjects; i++) {
+        auto size = Slab::kMinSlabClassSize << (i % Slab::kNumSlabClasses);
+        objs.emplace_back(slab.allocate(size), size);
+        TEST_ASSERT(objs.back().first);
+      }
+      for (auto [ptr, size] : objs) {
+        slab.free(ptr, size);
+      }
+      objs.clear();
+      // Only the objects cached in this core's magazines and the depots
+      // pin their spans, plus a partially carved span per class.
+      TEST_ASSERT(slab.get_footprint() <=
+                  Slab::kNumSlabClasses * (Slab::kMaxNumDepotMagazines + 3) *
+                      Slab::kMaxMagazineBytes);
+    }
 
     preempt_disable();
 
@@ -0,0 +1,83 @@
+extern "C" {
+#include <runtime/runtime.h>
+}
+#include "thread.h"
+
+#include "helpers.hpp"
+#include "tenant_scheduler.hpp"
+
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+using namespace far_memory;
+
+constexpr static uint32_t kNumSlots = 1;
+constexpr static uint32_t kNumFloodThreads = 8;
+constexpr static uint32_t kNumOps = 1000;
+
+void do_work() {
+  std::cout << "Running " << __FILE__ "..." << std::endl;
+
+  TenantScheduler scheduler(kNumSlots);
+  uint32_t flood_id, single_id;
+  TEST_ASSERT(scheduler.add_tenant(&flood_id));
+  TEST_ASSERT(scheduler.add_tenant(&single_id));
+  // Appended by the holder of the only slot.
+  std::vector<uint32_t> grants;
+
+  auto fn = [&](uint32_t tenant_id) {
+    for (uint32_t i = 0; i < kNumOps; i++) {
+      TenantAdmission admission(&scheduler, tenant_id);
+      grants.push_back(tenant_id);
+      // Let the others queue up.
+      thread_yield();
+    }
+  };
+  std::vector<rt::Thread> threads;
+  for (uint32_t i = 0; i < kNumFloodThreads; i++) {
+    threads.emplace_back([&]() { fn(flood_id); });
+  }
+  threads.emplace_back([&]() { fn(single_id); });
+  for (auto &thread : threads) {
+    thread.Join();
+  }
+
+  // Under FIFO admission, the flooding tenant would get kNumFloodThreads
+  // grants for each one of the other.
+  uint64_t last = 0;
+  for (uint64_t i = 0; i < grants.size(); i++) {
+    if (grants[i] == single_id) {
+      last = i;
+    }
+  }
+  auto num_flood_grants = last + 1 - kNumOps;
+  TEST_ASSERT(num_flood_grants <= 3 * kNumOps);
+
+  auto flood_stats = scheduler.get_stats(flood_id);
+  auto single_stats = scheduler.get_stats(single_id);
+  TEST_ASSERT(flood_stats.num_ops == kNumFloodThreads * kNumOps);
+  TEST_ASSERT(single_stats.num_ops == kNumOps);
+
+  std::cout << "Passed" << std::endl;
+}
+
+void _main(void *args) { do_work(); }
+
+int main(int argc, char **argv) {
+  int ret;
+
+  if (argc < 2) {
+    std::cerr << "usage: [cfg_file]" << std::endl;
+    return -EINVAL;
+  }
+
+  ret = runtime_init(argv[1], _main, NULL);
+  if (ret) {
+    std::cerr << "failed to start runtime" << std::endl;
+    return ret;
+  }
+
+  return 0;
+}